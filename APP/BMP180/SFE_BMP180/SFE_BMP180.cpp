@@ -144,8 +144,8 @@ char SFE_BMP180::readInt(char address, int &value)
 	data[0] = address;
 	if (readBytes(data,2))
 	{
-		value = (((int)data[0]<<8)|(int)data[1]);
-		//if (*value & 0x8000) *value |= 0xFFFF0000; // sign extend if negative
+		// through int16_t so the sign extends where int is wider than 16 bits (ARM, PC)
+		value = (int16_t)(((int)data[0]<<8)|(int)data[1]);
 		return(1);
 	}
 	value = 0;
@@ -68,6 +68,19 @@ bool ADXL345::testConnection() {
     return getDeviceID() == 0xE5;
 }
 
+/** Shadow the configuration registers, so bit settings cost one I2C write instead
+ * of a read and a write. None of the registers written by bit changes itself.
+ * @param enabled New shadow status
+ * @see I2Cdev::enableShadow()
+ */
+void ADXL345::setShadowEnabled(bool enabled) {
+    if (enabled) {
+        I2Cdev::enableShadow(devAddr, 0, 0);
+    } else {
+        I2Cdev::disableShadow(devAddr);
+    }
+}
+
 // DEVID register
 
 /** Get Device ID.
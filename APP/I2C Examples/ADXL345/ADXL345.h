@@ -170,6 +170,7 @@ class ADXL345 {
 
         void initialize();
         bool testConnection();
+        void setShadowEnabled(bool enabled);
 
         // DEVID register
         uint8_t getDeviceID();
@@ -3,6 +3,9 @@
 // 6/9/2012 by Jeff Rowberg <jeff@rowberg.net>
 //
 // Changelog:
+//      2026-10-17 - add I2CDEV_HOST_SIMULATION implementation (I2CdevSim, PC builds)
+//      2026-10-17 - add optional register shadow so write*Bit* can skip the read
+//      2026-10-17 - add I2CDEV_BUILTIN_ASYNC interrupt driven transaction queue (I2CdevAsync)
 //      2013-05-06 - add Francesco Ferrara's Fastwire v0.24 implementation with small modifications
 //      2013-05-05 - fix issue with writing bit values to words (Sasquatch/Farzanegan)
 //      2012-06-09 - fix major issue with reading > 32 bytes at a time with Arduino Wire
@@ -72,6 +75,11 @@ THE SOFTWARE.
 
     //#error The I2CDEV_BUILTIN_FASTWIRE implementation is known to be broken right now. Patience, Iago!
 
+#elif I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_ASYNC
+
+    #include <avr/interrupt.h>
+    #include <util/twi.h>
+
 #elif I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_NBWIRE
 
     #ifdef I2CDEV_IMPLEMENTATION_WARNINGS
@@ -87,11 +95,135 @@ THE SOFTWARE.
 
 #endif
 
+#if I2CDEV_SHADOW_REGISTERS > 0
+    // devAddr 0 (general call) marks a free entry
+    typedef struct {
+        uint8_t devAddr;
+        const uint8_t* volatileRegs;
+        uint8_t volatileCount;
+    } I2CdevShadowDevice;
+
+    typedef struct {
+        uint8_t devAddr;
+        uint8_t regAddr;
+        uint8_t value;
+    } I2CdevShadowRegister;
+
+    static I2CdevShadowDevice shadow_devices[I2CDEV_SHADOW_DEVICES];
+    static I2CdevShadowRegister shadow_registers[I2CDEV_SHADOW_REGISTERS];
+    static uint8_t shadow_next; // entry to replace when the table is full
+
+    static I2CdevShadowRegister *shadow_find(uint8_t devAddr, uint8_t regAddr) {
+        for (uint8_t i = 0; i < I2CDEV_SHADOW_REGISTERS; i++) {
+            if (devAddr != 0 && shadow_registers[i].devAddr == devAddr && shadow_registers[i].regAddr == regAddr) return &shadow_registers[i];
+        }
+        return 0;
+    }
+
+    static I2CdevShadowRegister *shadow_free() {
+        for (uint8_t i = 0; i < I2CDEV_SHADOW_REGISTERS; i++) {
+            if (shadow_registers[i].devAddr == 0) return &shadow_registers[i];
+        }
+        // all in use; replace them in turn
+        I2CdevShadowRegister *r = &shadow_registers[shadow_next];
+        shadow_next = (shadow_next + 1) % I2CDEV_SHADOW_REGISTERS;
+        return r;
+    }
+
+    static bool shadow_cacheable(uint8_t devAddr, uint8_t regAddr) {
+        for (uint8_t i = 0; i < I2CDEV_SHADOW_DEVICES; i++) {
+            if (devAddr != 0 && shadow_devices[i].devAddr == devAddr) {
+                for (uint8_t j = 0; j < shadow_devices[i].volatileCount; j++) {
+                    if (shadow_devices[i].volatileRegs[j] == regAddr) return false;
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // remember a register value just written; create an entry only for single byte writes
+    static void shadow_store(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data) {
+        for (uint8_t k = 0; k < length; k++) {
+            I2CdevShadowRegister *r = shadow_find(devAddr, regAddr + k);
+            if (r == 0 && length == 1 && shadow_cacheable(devAddr, regAddr)) {
+                r = shadow_free();
+                r -> devAddr = devAddr;
+                r -> regAddr = regAddr;
+            }
+            if (r != 0) r -> value = data[k];
+        }
+    }
+
+    // refresh entries covered by a read; a single byte read creates one, since a bit write often follows
+    static void shadow_refresh(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data) {
+        if (length == 1) {
+            shadow_store(devAddr, regAddr, length, data);
+            return;
+        }
+        for (uint8_t i = 0; i < I2CDEV_SHADOW_REGISTERS; i++) {
+            uint8_t k = shadow_registers[i].regAddr - regAddr;
+            if (shadow_registers[i].devAddr == devAddr && devAddr != 0 && k < length) shadow_registers[i].value = data[k];
+        }
+    }
+#endif
+
 /** Default constructor.
  */
 I2Cdev::I2Cdev() {
 }
 
+/** Keep a shadow of the device's registers, so bit writes only need the write.
+ * Single byte writes and reads remember the register's value, and later bit writes
+ * to it patch the remembered value instead of reading the register first: one
+ * transaction instead of two. Reads still go to the device (and refresh the
+ * shadow). Registers the device changes itself (self-clearing reset bits, status
+ * registers, auto-incrementing pointers) must be listed as volatile; they are
+ * never shadowed. Call invalidateShadow() after a device reset. Writes queued
+ * directly with I2CdevAsync bypass the shadow.
+ * @param devAddr I2C slave device address
+ * @param volatileRegs Registers not to shadow (not copied; keep it static)
+ * @param volatileCount Number of volatile registers
+ * @return Status of operation (false if I2CDEV_SHADOW_DEVICES devices are shadowed already)
+ */
+bool I2Cdev::enableShadow(uint8_t devAddr, const uint8_t *volatileRegs, uint8_t volatileCount) {
+    #if I2CDEV_SHADOW_REGISTERS > 0
+        disableShadow(devAddr);
+        for (uint8_t i = 0; i < I2CDEV_SHADOW_DEVICES; i++) {
+            if (shadow_devices[i].devAddr == 0) {
+                shadow_devices[i].devAddr = devAddr;
+                shadow_devices[i].volatileRegs = volatileRegs;
+                shadow_devices[i].volatileCount = volatileCount;
+                return true;
+            }
+        }
+    #endif
+    return false;
+}
+
+/** Stop shadowing the device's registers.
+ * @param devAddr I2C slave device address
+ */
+void I2Cdev::disableShadow(uint8_t devAddr) {
+    #if I2CDEV_SHADOW_REGISTERS > 0
+        invalidateShadow(devAddr);
+        for (uint8_t i = 0; i < I2CDEV_SHADOW_DEVICES; i++) {
+            if (shadow_devices[i].devAddr == devAddr) shadow_devices[i].devAddr = 0;
+        }
+    #endif
+}
+
+/** Forget the shadowed register values of a device, e.g. after it was reset.
+ * @param devAddr I2C slave device address
+ */
+void I2Cdev::invalidateShadow(uint8_t devAddr) {
+    #if I2CDEV_SHADOW_REGISTERS > 0
+        for (uint8_t i = 0; i < I2CDEV_SHADOW_REGISTERS; i++) {
+            if (shadow_registers[i].devAddr == devAddr) shadow_registers[i].devAddr = 0;
+        }
+    #endif
+}
+
 /** Read a single bit from an 8-bit device register.
  * @param devAddr I2C slave device address
  * @param regAddr Register regAddr to read from
@@ -301,11 +433,25 @@ int8_t I2Cdev::readBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8
             count = -1; // error
         }
 
+    #elif (I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_ASYNC)
+
+        // queued like any other transaction; waits for it to complete
+        count = I2CdevAsync::transfer(devAddr, regAddr, length, data, true, timeout);
+
+    #elif (I2CDEV_IMPLEMENTATION == I2CDEV_HOST_SIMULATION)
+
+        // device models on the simulated bus; repeated start like Fastwire
+        count = I2CdevSim::readBytes(devAddr, regAddr, length, data);
+
     #endif
 
     // check for timeout
     if (timeout > 0 && millis() - t1 >= timeout && count < length) count = -1; // timeout
 
+    #if I2CDEV_SHADOW_REGISTERS > 0
+        if (count == length) shadow_refresh(devAddr, regAddr, length, data);
+    #endif
+
     #ifdef I2CDEV_SERIAL_DEBUG
         Serial.print(". Done (");
         Serial.print(count, DEC);
@@ -454,10 +600,52 @@ int8_t I2Cdev::readWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint1
             count = -1; // error
         }
 
+    #elif (I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_ASYNC)
+
+        // words are sent MSB first
+        uint8_t intermediate[(uint8_t)(length * 2)];
+        if (I2CdevAsync::transfer(devAddr, regAddr, (uint8_t)(length * 2), intermediate, true, timeout) == length * 2) {
+            count = length; // success
+            for (uint8_t i = 0; i < length; i++) {
+                data[i] = (intermediate[2*i] << 8) | intermediate[2*i + 1];
+            }
+        } else {
+            count = -1; // error
+        }
+
+    #elif (I2CDEV_IMPLEMENTATION == I2CDEV_HOST_SIMULATION)
+
+        // words are sent MSB first
+        uint8_t intermediate[(uint8_t)(length * 2)];
+        if (I2CdevSim::readBytes(devAddr, regAddr, (uint8_t)(length * 2), intermediate) == length * 2) {
+            count = length; // success
+            for (uint8_t i = 0; i < length; i++) {
+                data[i] = (intermediate[2*i] << 8) | intermediate[2*i + 1];
+            }
+        } else {
+            count = -1; // error
+        }
+
     #endif
 
     if (timeout > 0 && millis() - t1 >= timeout && count < length) count = -1; // timeout
 
+    #if I2CDEV_SHADOW_REGISTERS > 0
+        if (count == length) {
+            #if (I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_ASYNC || I2CDEV_IMPLEMENTATION == I2CDEV_HOST_SIMULATION)
+                shadow_refresh(devAddr, regAddr, (uint8_t)(length * 2), intermediate);
+            #else
+                // read straight into data; the shadow holds the bytes as they came, MSB first
+                uint8_t bytes[(uint8_t)(length * 2)];
+                for (uint8_t i = 0; i < length; i++) {
+                    bytes[2*i] = data[i] >> 8;
+                    bytes[2*i + 1] = data[i];
+                }
+                shadow_refresh(devAddr, regAddr, (uint8_t)(length * 2), bytes);
+            #endif
+        }
+    #endif
+
     #ifdef I2CDEV_SERIAL_DEBUG
         Serial.print(". Done (");
         Serial.print(count, DEC);
@@ -476,6 +664,11 @@ int8_t I2Cdev::readWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint1
  */
 bool I2Cdev::writeBit(uint8_t devAddr, uint8_t regAddr, uint8_t bitNum, uint8_t data) {
     uint8_t b;
+    #if I2CDEV_SHADOW_REGISTERS > 0
+        I2CdevShadowRegister *r = shadow_find(devAddr, regAddr);
+        if (r != 0) b = r -> value;
+        else
+    #endif
     readByte(devAddr, regAddr, &b);
     b = (data != 0) ? (b | (1 << bitNum)) : (b & ~(1 << bitNum));
     return writeByte(devAddr, regAddr, b);
@@ -512,7 +705,13 @@ bool I2Cdev::writeBits(uint8_t devAddr, uint8_t regAddr, uint8_t bitStart, uint8
     // 10100011 original & ~mask
     // 10101011 masked | value
     uint8_t b;
-    if (readByte(devAddr, regAddr, &b) != 0) {
+    #if I2CDEV_SHADOW_REGISTERS > 0
+        I2CdevShadowRegister *r = shadow_find(devAddr, regAddr);
+        if (r != 0) b = r -> value;
+        if (r != 0 || readByte(devAddr, regAddr, &b) != 0) {
+    #else
+        if (readByte(devAddr, regAddr, &b) != 0) {
+    #endif
         uint8_t mask = ((1 << length) - 1) << (bitStart - length + 1);
         data <<= (bitStart - length + 1); // shift data into correct position
         data &= mask; // zero all non-important bits in data
@@ -590,6 +789,12 @@ bool I2Cdev::writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_
         Serial.print(regAddr, HEX);
         Serial.print("...");
     #endif
+    #if (I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_ASYNC)
+        // queued like any other transaction; waits for it to complete
+        uint8_t status = I2CdevAsync::transfer(devAddr, regAddr, length, data, false, readTimeout) != length;
+    #elif (I2CDEV_IMPLEMENTATION == I2CDEV_HOST_SIMULATION)
+        uint8_t status = !I2CdevSim::writeBytes(devAddr, regAddr, length, data);
+    #else
     uint8_t status = 0;
     #if ((I2CDEV_IMPLEMENTATION == I2CDEV_ARDUINO_WIRE && ARDUINO < 100) || I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_NBWIRE)
         Wire.beginTransmission(devAddr);
@@ -622,6 +827,10 @@ bool I2Cdev::writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_
         Fastwire::stop();
         //status = Fastwire::endTransmission();
     #endif
+    #endif
+    #if I2CDEV_SHADOW_REGISTERS > 0
+        if (status == 0) shadow_store(devAddr, regAddr, length, data);
+    #endif
     #ifdef I2CDEV_SERIAL_DEBUG
         Serial.println(". Done.");
     #endif
@@ -645,6 +854,23 @@ bool I2Cdev::writeWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16
         Serial.print(regAddr, HEX);
         Serial.print("...");
     #endif
+    #if (I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_ASYNC)
+        // words are sent MSB first
+        uint8_t intermediate[(uint8_t)(length * 2)];
+        for (uint8_t i = 0; i < length; i++) {
+            intermediate[2*i] = data[i] >> 8;
+            intermediate[2*i + 1] = data[i];
+        }
+        uint8_t status = I2CdevAsync::transfer(devAddr, regAddr, (uint8_t)(length * 2), intermediate, false, readTimeout) != length * 2;
+    #elif (I2CDEV_IMPLEMENTATION == I2CDEV_HOST_SIMULATION)
+        // words are sent MSB first
+        uint8_t intermediate[(uint8_t)(length * 2)];
+        for (uint8_t i = 0; i < length; i++) {
+            intermediate[2*i] = data[i] >> 8;
+            intermediate[2*i + 1] = data[i];
+        }
+        uint8_t status = !I2CdevSim::writeBytes(devAddr, regAddr, (uint8_t)(length * 2), intermediate);
+    #else
     uint8_t status = 0;
     #if ((I2CDEV_IMPLEMENTATION == I2CDEV_ARDUINO_WIRE && ARDUINO < 100) || I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_NBWIRE)
         Wire.beginTransmission(devAddr);
@@ -681,6 +907,22 @@ bool I2Cdev::writeWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16
         Fastwire::stop();
         //status = Fastwire::endTransmission();
     #endif
+    #endif
+    #if I2CDEV_SHADOW_REGISTERS > 0
+        if (status == 0) {
+            #if (I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_ASYNC || I2CDEV_IMPLEMENTATION == I2CDEV_HOST_SIMULATION)
+                shadow_store(devAddr, regAddr, (uint8_t)(length * 2), intermediate);
+            #else
+                // sent straight from data; the shadow holds the bytes as they went, MSB first
+                uint8_t bytes[(uint8_t)(length * 2)];
+                for (uint8_t i = 0; i < length; i++) {
+                    bytes[2*i] = data[i] >> 8;
+                    bytes[2*i + 1] = data[i];
+                }
+                shadow_store(devAddr, regAddr, (uint8_t)(length * 2), bytes);
+            #endif
+        }
+    #endif
     #ifdef I2CDEV_SERIAL_DEBUG
         Serial.println(". Done.");
     #endif
@@ -889,6 +1131,311 @@ uint16_t I2Cdev::readTimeout = I2CDEV_DEFAULT_READ_TIMEOUT;
     }
 #endif
 
+#if I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_ASYNC
+    /*
+    I2CdevAsync queues register reads and writes and runs them from the TWI interrupt, so the CPU
+    is free while bytes are on the bus: at 400kHz a 14 byte MPU6050 burst read keeps the bus busy for
+    about 400us, during which a blocking implementation does nothing but poll.
+
+    Each transaction is START, device address + W, register address, then either the data bytes
+    (write) or a repeated START, device address + R and the data bytes (read), then STOP.  When it
+    completes, the callback gets the byte count or I2CDEV_ASYNC_ERROR, and the next queued
+    transaction starts.
+
+    The I2Cdev read and write methods queue a transaction and wait for it, so device classes work
+    unchanged, and can be mixed with transactions queued directly:
+
+        I2CdevAsync::readBytes(0x68, MPU6050_RA_ACCEL_XOUT_H, 14, buffer, motionRead, NULL);
+        // ... do other work; motionRead(14, NULL) is called from the interrupt when buffer is full
+
+    getBusyMicros() adds up the time transactions took from START to STOP, getWaitMicros() the
+    time the blocking methods spent waiting for them; the difference is bus time the CPU had free.
+    */
+
+    typedef struct {
+        uint8_t devAddr;
+        uint8_t regAddr;
+        uint8_t* data;
+        uint8_t length;
+        bool read;
+        I2CdevCallback callback;
+        void* context;
+    } I2CdevTransaction;
+
+    typedef struct {
+        volatile bool done;
+        volatile int8_t status;
+    } I2CdevSyncResult;
+
+    static I2CdevTransaction async_queue[I2CDEV_ASYNC_QUEUE_LENGTH];
+    static volatile uint8_t async_head; // transaction in progress, or the next to start
+    static volatile uint8_t async_count;
+    static volatile bool async_active;
+    static volatile uint8_t async_index; // data bytes of the current transaction transferred
+    static uint32_t async_startMicros;
+    static volatile uint32_t async_busyMicros;
+    static uint32_t async_waitMicros;
+
+    static void async_syncDone(int8_t status, void *context) {
+        I2CdevSyncResult *result = (I2CdevSyncResult *)context;
+        result -> status = status;
+        result -> done = true;
+    }
+
+    /** Set up the TWI for interrupt driven transfers.
+     * @param khz Bus clock in kHz (100 or 400)
+     * @param pullup Enable the internal pull-ups on SDA and SCL
+     */
+    void I2CdevAsync::setup(int khz, bool pullup) {
+        TWCR = 0;
+        #if defined(__AVR_ATmega168__) || defined(__AVR_ATmega8__) || defined(__AVR_ATmega328P__)
+            if (pullup) PORTC |= ((1 << 4) | (1 << 5));
+            else        PORTC &= ~((1 << 4) | (1 << 5));
+        #elif defined(__AVR_ATmega644P__) || defined(__AVR_ATmega644__)
+            if (pullup) PORTC |= ((1 << 0) | (1 << 1));
+            else        PORTC &= ~((1 << 0) | (1 << 1));
+        #else
+            if (pullup) PORTD |= ((1 << 0) | (1 << 1));
+            else        PORTD &= ~((1 << 0) | (1 << 1));
+        #endif
+
+        async_head = 0;
+        async_count = 0;
+        async_active = false;
+
+        TWSR = 0; // no prescaler
+        TWBR = ((F_CPU / 1000L / khz) - 16) / 2;
+        TWCR = _BV(TWEN) | _BV(TWIE);
+    }
+
+    /** Queue a read of consecutive registers.
+     * @param devAddr I2C slave device address
+     * @param regAddr First register address to read from
+     * @param length Number of bytes to read (at least 1)
+     * @param data Buffer to store read data in; must stay valid until the callback
+     * @param callback Called from the TWI interrupt when done (NULL for none)
+     * @param context Passed to the callback
+     * @return false if the queue is full
+     */
+    bool I2CdevAsync::readBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data, I2CdevCallback callback, void *context) {
+        return length > 0 && queue(devAddr, regAddr, length, data, true, callback, context);
+    }
+
+    /** Queue a write of consecutive registers.
+     * @param devAddr I2C slave device address
+     * @param regAddr First register address to write to
+     * @param length Number of bytes to write
+     * @param data Buffer to copy new data from; not copied, so it must stay valid until the callback
+     * @param callback Called from the TWI interrupt when done (NULL for none)
+     * @param context Passed to the callback
+     * @return false if the queue is full
+     */
+    bool I2CdevAsync::writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data, I2CdevCallback callback, void *context) {
+        return queue(devAddr, regAddr, length, data, false, callback, context);
+    }
+
+    bool I2CdevAsync::queue(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data, bool read, I2CdevCallback callback, void *context) {
+        uint8_t sreg = SREG;
+        cli();
+
+        if (async_count == I2CDEV_ASYNC_QUEUE_LENGTH) {
+            SREG = sreg;
+            return false;
+        }
+
+        I2CdevTransaction *t = &async_queue[(async_head + async_count) % I2CDEV_ASYNC_QUEUE_LENGTH];
+        t -> devAddr = devAddr;
+        t -> regAddr = regAddr;
+        t -> data = data;
+        t -> length = length;
+        t -> read = read;
+        t -> callback = callback;
+        t -> context = context;
+        async_count++;
+
+        if (!async_active) start();
+
+        SREG = sreg;
+        return true;
+    }
+
+    /** Queue a transaction and wait for it; this is what the I2Cdev read and write methods use.
+     * @param timeout Milliseconds to wait (0 to wait forever).  On timeout the bus is reset and
+     *                every queued transaction fails
+     * @return Number of bytes transferred (-1 indicates failure)
+     */
+    int8_t I2CdevAsync::transfer(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data, bool read, uint16_t timeout) {
+        if (read && length == 0) return 0;
+
+        I2CdevSyncResult result;
+        result.done = false;
+        result.status = I2CDEV_ASYNC_ERROR;
+
+        uint32_t t0 = micros();
+        uint32_t t1 = millis();
+        bool queued;
+
+        // wait for room in the queue, then for the transaction
+        while (!(queued = queue(devAddr, regAddr, length, data, read, async_syncDone, &result)) && (timeout == 0 || millis() - t1 < timeout));
+        while (queued && !result.done && (timeout == 0 || millis() - t1 < timeout));
+
+        // result is on this stack, so the transaction can't be left behind
+        if (queued && !result.done) reset();
+
+        async_waitMicros += micros() - t0;
+        return result.status;
+    }
+
+    /** Abandon the transaction in progress and fail every queued one (callbacks get I2CDEV_ASYNC_ERROR).
+     */
+    void I2CdevAsync::reset() {
+        uint8_t sreg = SREG;
+        cli();
+
+        TWCR = 0;
+        TWCR = _BV(TWEN) | _BV(TWIE);
+
+        // callbacks may queue more; those start afterwards
+        async_active = true;
+        for (uint8_t n = async_count; n > 0; n--) {
+            I2CdevTransaction *t = &async_queue[async_head];
+            async_head = (async_head + 1) % I2CDEV_ASYNC_QUEUE_LENGTH;
+            async_count--;
+            if (t -> callback) t -> callback(I2CDEV_ASYNC_ERROR, t -> context);
+        }
+        async_active = false;
+
+        if (async_count > 0) start();
+
+        SREG = sreg;
+    }
+
+    bool I2CdevAsync::isIdle() {
+        return async_count == 0;
+    }
+
+    uint8_t I2CdevAsync::getPendingCount() {
+        return async_count;
+    }
+
+    /** Microseconds transactions have kept the bus busy since the last clearStats().
+     */
+    uint32_t I2CdevAsync::getBusyMicros() {
+        uint8_t sreg = SREG;
+        cli();
+        uint32_t busy = async_busyMicros;
+        SREG = sreg;
+        return busy;
+    }
+
+    /** Microseconds the I2Cdev read and write methods have spent waiting since the last clearStats().
+     */
+    uint32_t I2CdevAsync::getWaitMicros() {
+        return async_waitMicros;
+    }
+
+    void I2CdevAsync::clearStats() {
+        uint8_t sreg = SREG;
+        cli();
+        async_busyMicros = 0;
+        async_waitMicros = 0;
+        SREG = sreg;
+    }
+
+    void I2CdevAsync::start() {
+        // the previous transaction's stop condition may still be going out
+        while (TWCR & _BV(TWSTO));
+
+        async_active = true;
+        async_index = 0;
+        async_startMicros = micros();
+        TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWINT) | _BV(TWSTA);
+    }
+
+    void I2CdevAsync::finish(int8_t status) {
+        // release the bus before the callback, so its time isn't bus time
+        TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWINT) | _BV(TWSTO);
+        async_busyMicros += micros() - async_startMicros;
+
+        I2CdevTransaction *t = &async_queue[async_head];
+        I2CdevCallback callback = t -> callback;
+        void *context = t -> context;
+        async_head = (async_head + 1) % I2CDEV_ASYNC_QUEUE_LENGTH;
+        async_count--;
+        async_active = false;
+
+        if (callback) callback(status, context);
+
+        // the callback may have started the next one already
+        if (!async_active && async_count > 0) start();
+    }
+
+    void I2CdevAsync::handleInterrupt() {
+        if (!async_active) return;
+
+        I2CdevTransaction *t = &async_queue[async_head];
+
+        switch (TW_STATUS) {
+            case TW_START:
+                TWDR = (t -> devAddr << 1) | TW_WRITE;
+                TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWINT);
+                break;
+
+            case TW_REP_START:
+                TWDR = (t -> devAddr << 1) | TW_READ;
+                TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWINT);
+                break;
+
+            case TW_MT_SLA_ACK:
+                TWDR = t -> regAddr;
+                TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWINT);
+                break;
+
+            case TW_MT_DATA_ACK:
+                if (t -> read) {
+                    // register address sent; turn the bus around
+                    TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWINT) | _BV(TWSTA);
+                } else if (async_index < t -> length) {
+                    TWDR = t -> data[async_index++];
+                    TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWINT);
+                } else {
+                    finish(async_index);
+                }
+                break;
+
+            case TW_MR_DATA_ACK:
+                t -> data[async_index++] = TWDR;
+                // fall through
+
+            case TW_MR_SLA_ACK:
+                // ack every byte but the last
+                if (async_index + 1 < t -> length) {
+                    TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWINT) | _BV(TWEA);
+                } else {
+                    TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWINT);
+                }
+                break;
+
+            case TW_MR_DATA_NACK:
+                t -> data[async_index++] = TWDR;
+                finish(async_index);
+                break;
+
+            case TW_NO_INFO:
+                break;
+
+            default:
+                // address or data not acknowledged, arbitration lost, bus error
+                finish(I2CDEV_ASYNC_ERROR);
+                break;
+        }
+    }
+
+    ISR(TWI_vect) {
+        I2CdevAsync::handleInterrupt();
+    }
+#endif
+
 #if I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_NBWIRE
     // NBWire implementation based heavily on code by Gene Knight <Gene@Telobot.com>
     // Originally posted on the Arduino forum at http://arduino.cc/forum/index.php/topic,70705.0.html
@@ -3,6 +3,9 @@
 // 6/9/2012 by Jeff Rowberg <jeff@rowberg.net>
 //
 // Changelog:
+//      2026-10-17 - add I2CDEV_HOST_SIMULATION implementation (I2CdevSim, PC builds)
+//      2026-10-17 - add optional register shadow so write*Bit* can skip the read
+//      2026-10-17 - add I2CDEV_BUILTIN_ASYNC interrupt driven transaction queue (I2CdevAsync)
 //      2013-05-06 - add Francesco Ferrara's Fastwire v0.24 implementation with small modifications
 //      2013-05-05 - fix issue with writing bit values to words (Sasquatch/Farzanegan)
 //      2012-06-09 - fix major issue with reading > 32 bytes at a time with Arduino Wire
@@ -49,8 +52,11 @@ THE SOFTWARE.
 // -----------------------------------------------------------------------------
 // I2C interface implementation setting
 // -----------------------------------------------------------------------------
+// (may also be given on the compiler command line, e.g. -DI2CDEV_IMPLEMENTATION=I2CDEV_HOST_SIMULATION)
+#ifndef I2CDEV_IMPLEMENTATION
 #define I2CDEV_IMPLEMENTATION       I2CDEV_ARDUINO_WIRE
 //#define I2CDEV_IMPLEMENTATION       I2CDEV_BUILTIN_FASTWIRE
+#endif
 
 // comment this out if you are using a non-optimal IDE/implementation setting
 // but want the compiler to shut up about it
@@ -64,6 +70,8 @@ THE SOFTWARE.
                                       // ^^^ NBWire implementation is still buggy w/some interrupts!
 #define I2CDEV_BUILTIN_FASTWIRE     3 // FastWire object from Francesco Ferrara's project
 #define I2CDEV_I2CMASTER_LIBRARY    4 // I2C object from DSSCircuits I2C-Master Library at https://github.com/DSSCircuits/I2C-Master-Library
+#define I2CDEV_BUILTIN_ASYNC        5 // I2CdevAsync interrupt driven transaction queue (AVR TWI; don't include Wire.h)
+#define I2CDEV_HOST_SIMULATION      6 // I2CdevSim bus and device models for building on a PC (see extras/host)
 
 // -----------------------------------------------------------------------------
 // Arduino-style "Serial.print" debug constant (uncomment to enable)
@@ -82,11 +90,22 @@ THE SOFTWARE.
     #if I2CDEV_IMPLEMENTATION == I2CDEV_I2CMASTER_LIBRARY
         #include <I2C.h>
     #endif
+    #if I2CDEV_IMPLEMENTATION == I2CDEV_HOST_SIMULATION
+        #include "I2CdevSim.h"
+    #endif
 #endif
 
 // 1000ms default read timeout (modify with "I2Cdev::readTimeout = [ms];")
 #define I2CDEV_DEFAULT_READ_TIMEOUT     1000
 
+// register shadow size (see I2Cdev::enableShadow); set I2CDEV_SHADOW_REGISTERS to 0 to leave it out
+#ifndef I2CDEV_SHADOW_DEVICES
+    #define I2CDEV_SHADOW_DEVICES       2
+#endif
+#ifndef I2CDEV_SHADOW_REGISTERS
+    #define I2CDEV_SHADOW_REGISTERS     16
+#endif
+
 class I2Cdev {
     public:
         I2Cdev();
@@ -109,6 +128,10 @@ class I2Cdev {
         static bool writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data);
         static bool writeWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16_t *data);
 
+        static bool enableShadow(uint8_t devAddr, const uint8_t *volatileRegs, uint8_t volatileCount);
+        static void disableShadow(uint8_t devAddr);
+        static void invalidateShadow(uint8_t devAddr);
+
         static uint16_t readTimeout;
 };
 
@@ -156,6 +179,40 @@ class I2Cdev {
     };
 #endif
 
+#if I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_ASYNC
+    // transactions that can wait for the bus, including the one in progress
+    #ifndef I2CDEV_ASYNC_QUEUE_LENGTH
+        #define I2CDEV_ASYNC_QUEUE_LENGTH 8
+    #endif
+
+    // completion status of a transaction the device didn't acknowledge, or that the bus lost
+    #define I2CDEV_ASYNC_ERROR -1
+
+    // called from the TWI interrupt when a transaction completes, with the number of bytes
+    // transferred (or I2CDEV_ASYNC_ERROR) and the context it was queued with
+    typedef void (*I2CdevCallback)(int8_t status, void *context);
+
+    class I2CdevAsync {
+        private:
+            static bool queue(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data, bool read, I2CdevCallback callback, void *context);
+            static void start();
+            static void finish(int8_t status);
+
+        public:
+            static void setup(int khz, bool pullup);
+            static bool readBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data, I2CdevCallback callback, void *context);
+            static bool writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data, I2CdevCallback callback, void *context);
+            static int8_t transfer(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data, bool read, uint16_t timeout);
+            static bool isIdle();
+            static uint8_t getPendingCount();
+            static void reset();
+            static uint32_t getBusyMicros();
+            static uint32_t getWaitMicros();
+            static void clearStats();
+            static void handleInterrupt();
+    };
+#endif
+
 #if I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_NBWIRE
     // NBWire implementation based heavily on code by Gene Knight <Gene@Telobot.com>
     // Originally posted on the Arduino forum at http://arduino.cc/forum/index.php/topic,70705.0.html
@@ -0,0 +1,368 @@
+// I2Cdev library collection - simulated I2C bus for building on a PC
+// See I2CdevSim.h.
+//
+// Bus time is counted in bit periods of the configured clock: one for a START
+// or repeated START, nine per byte (eight data bits and the ACK), and two for a
+// STOP (the STOP itself and the bus free time before the next START).  Clock
+// stretching is not modelled, and CPU time only as I2CDEV_SIM_CALL_MICROS per
+// millis()/micros() call.
+
+/* ============================================
+I2Cdev device library code is placed under the MIT license
+Copyright (c) 2013 Jeff Rowberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+===============================================
+*/
+
+#include "I2CdevSim.h"
+
+static I2CdevSimDevice *devices[I2CDEV_SIM_MAX_DEVICES];
+static uint32_t busClock = 400000;
+static uint64_t nanos = 0;
+// a write ended without STOP (Wire.endTransmission(false)), so the next START is a repeated one
+static bool held = false;
+static I2CdevSimStats stats;
+// busy time at nanosecond resolution; a 400kHz bit is 2.5us
+static uint64_t busNanos = 0;
+static void (*timeHook)() = 0;
+// when the hook next has something to finish, and whether it is running
+static uint64_t hookNanos = ~0ULL;
+static bool inHook = false;
+
+/** Register file device at a 7-bit bus address, all registers 0.
+ * @param address 7-bit I2C address the device answers to
+ */
+I2CdevSimDevice::I2CdevSimDevice(uint8_t address) {
+    this->address = address;
+    time = 0;
+    reset();
+}
+
+I2CdevSimDevice::~I2CdevSimDevice() {
+    I2CdevSim::detach(this);
+}
+
+/** Get the 7-bit I2C address the device answers to.
+ * @return Device address
+ */
+uint8_t I2CdevSimDevice::getAddress() {
+    return address;
+}
+
+/** Return the device to its power-on state.
+ */
+void I2CdevSimDevice::reset() {
+    memset(registers, 0, sizeof(registers));
+    pointer = 0;
+}
+
+/** Peek at a register without going through the bus or the model's read hooks.
+ * @param regAddr Register to read
+ * @return Register value
+ */
+uint8_t I2CdevSimDevice::getRegister(uint8_t regAddr) {
+    return registers[regAddr];
+}
+
+/** Poke a register without going through the bus or the model's write hooks.
+ * @param regAddr Register to write
+ * @param value New register value
+ */
+void I2CdevSimDevice::setRegister(uint8_t regAddr, uint8_t value) {
+    registers[regAddr] = value;
+}
+
+void I2CdevSimDevice::update() {
+}
+
+void I2CdevSimDevice::beginRead(uint8_t) {
+}
+
+uint8_t I2CdevSimDevice::readRegister(uint8_t regAddr) {
+    return registers[regAddr];
+}
+
+void I2CdevSimDevice::writeRegister(uint8_t regAddr, uint8_t value) {
+    registers[regAddr] = value;
+}
+
+uint8_t I2CdevSimDevice::nextRegister(uint8_t regAddr) {
+    return regAddr + 1;
+}
+
+/** Set the bus clock used to charge transfers.
+ * @param hz SCL frequency, usually 100000 or 400000
+ */
+void I2CdevSim::setClock(uint32_t hz) {
+    busClock = hz;
+}
+
+/** Get the bus clock used to charge transfers.
+ * @return SCL frequency in Hz
+ */
+uint32_t I2CdevSim::getClock() {
+    return busClock;
+}
+
+/** Put a device on the bus.
+ * @param device Device model; must stay alive until it is detached
+ * @return True if there was a free slot and the address was not taken
+ */
+bool I2CdevSim::attach(I2CdevSimDevice *device) {
+    if (find(device->getAddress()) != 0) return false;
+    for (uint8_t i = 0; i < I2CDEV_SIM_MAX_DEVICES; i++) {
+        if (devices[i] == 0) {
+            devices[i] = device;
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Take a device off the bus; it no longer acknowledges its address.
+ * @param device Device model passed to attach()
+ */
+void I2CdevSim::detach(I2CdevSimDevice *device) {
+    for (uint8_t i = 0; i < I2CDEV_SIM_MAX_DEVICES; i++) {
+        if (devices[i] == device) devices[i] = 0;
+    }
+}
+
+/** Find the device answering to an address.
+ * @param devAddr 7-bit I2C address
+ * @return Device model, or 0 if nothing on the bus has that address
+ */
+I2CdevSimDevice *I2CdevSim::find(uint8_t devAddr) {
+    for (uint8_t i = 0; i < I2CDEV_SIM_MAX_DEVICES; i++) {
+        if (devices[i] != 0 && devices[i]->address == devAddr) return devices[i];
+    }
+    return 0;
+}
+
+void I2CdevSim::clock(uint8_t bytes) {
+    stats.bytes += bytes;
+    nanos += 9000000000ULL * bytes / busClock;
+}
+
+void I2CdevSim::start(bool repeated) {
+    if (!repeated && !held) stats.transactions++;
+    held = false;
+    nanos += 1000000000ULL / busClock;
+}
+
+void I2CdevSim::stop() {
+    held = false;
+    nanos += 2000000000ULL / busClock;
+}
+
+/** Read registers the way I2Cdev::readBytes does: the register address is
+ * written, then the data read back after a repeated START.
+ * @param devAddr 7-bit I2C address
+ * @param regAddr First register to read
+ * @param length Number of bytes to read
+ * @param data Buffer to store read data in
+ * @return Number of bytes read (-1 if the address was not acknowledged)
+ */
+int8_t I2CdevSim::readBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data) {
+    uint8_t status = transmit(devAddr, &regAddr, 1, false);
+    if (status != 0) return -1;
+    return receive(devAddr, data, length) == length ? length : -1;
+}
+
+/** Write registers the way I2Cdev::writeBytes does: register address, then
+ * data, in one transaction.
+ * @param devAddr 7-bit I2C address
+ * @param regAddr First register to write
+ * @param length Number of bytes to write
+ * @param data Buffer to copy new data from
+ * @return True if the address was acknowledged
+ */
+bool I2CdevSim::writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data) {
+    uint8_t buffer[length + 1];
+    buffer[0] = regAddr;
+    memcpy(buffer + 1, data, length);
+    return transmit(devAddr, buffer, length + 1, true) == 0;
+}
+
+/** Master write: START (or repeated START), address, data.  The first data
+ * byte sets the device's register pointer, the rest are written from there.
+ * @param devAddr 7-bit I2C address
+ * @param data Bytes to send
+ * @param length Number of bytes to send
+ * @param stop End with STOP; false keeps the bus for a repeated START
+ * @return 0 on success, 2 if the address was not acknowledged (as Wire.endTransmission())
+ */
+uint8_t I2CdevSim::transmit(uint8_t devAddr, const uint8_t *data, uint8_t length, bool stop) {
+    uint64_t before = nanos;
+    start(false);
+    clock(1);
+
+    I2CdevSimDevice *device = find(devAddr);
+    if (device == 0) {
+        stats.nacks++;
+        I2CdevSim::stop();
+        busNanos += nanos - before;
+        return 2;
+    }
+
+    device->time = now();
+    device->update();
+    if (length > 0) device->pointer = data[0];
+    for (uint8_t i = 1; i < length; i++) {
+        device->writeRegister(device->pointer, data[i]);
+        device->pointer = device->nextRegister(device->pointer);
+    }
+    if (length > 1) stats.writes++;
+    clock(length);
+
+    if (stop) {
+        I2CdevSim::stop();
+    } else {
+        held = true;
+    }
+    busNanos += nanos - before;
+    return 0;
+}
+
+/** Master read: START (or repeated START after transmit(..., false)), address,
+ * data from the device's register pointer, STOP.
+ * @param devAddr 7-bit I2C address
+ * @param data Buffer to store read data in
+ * @param length Number of bytes to read
+ * @return Number of bytes read (0 if the address was not acknowledged)
+ */
+uint8_t I2CdevSim::receive(uint8_t devAddr, uint8_t *data, uint8_t length) {
+    uint64_t before = nanos;
+    start(false);
+    clock(1);
+
+    I2CdevSimDevice *device = find(devAddr);
+    if (device == 0) {
+        stats.nacks++;
+        stop();
+        busNanos += nanos - before;
+        return 0;
+    }
+
+    stats.reads++;
+    device->time = now();
+    device->update();
+    device->beginRead(device->pointer);
+    for (uint8_t i = 0; i < length; i++) {
+        data[i] = device->readRegister(device->pointer);
+        device->pointer = device->nextRegister(device->pointer);
+    }
+    clock(length);
+    stop();
+    busNanos += nanos - before;
+    return length;
+}
+
+/** Simulated time since the program started.
+ * @return Microseconds
+ */
+uint64_t I2CdevSim::now() {
+    return nanos / 1000;
+}
+
+/** Move simulated time forward without bus traffic (delay() and friends).
+ * @param micros Microseconds to skip
+ */
+void I2CdevSim::advance(uint32_t micros) {
+    uint64_t target = nanos + 1000ULL * micros;
+
+    // time the hook itself takes (an interrupt handler calling micros()) just passes
+    if (timeHook == 0 || inHook) {
+        nanos = target;
+        return;
+    }
+
+    // stop at everything the hook asked for on the way, so a long delay() doesn't
+    // swallow a whole transfer's worth of interrupts
+    inHook = true;
+    while (hookNanos <= target) {
+        if (hookNanos > nanos) nanos = hookNanos;
+        hookNanos = ~0ULL;
+        timeHook();
+    }
+    if (target > nanos) nanos = target;
+    timeHook();
+    inHook = false;
+}
+
+/** Have a function called whenever advance() moves simulated time.
+ * @param hook Function to call, or 0 for none
+ */
+void I2CdevSim::setTimeHook(void (*hook)()) {
+    timeHook = hook;
+}
+
+// have advance() stop at this time and call the hook
+void I2CdevSim::wakeAt(uint64_t at) {
+    if (at < hookNanos) hookNanos = at;
+}
+
+uint64_t I2CdevSim::nowNanos() {
+    return nanos;
+}
+
+// adds a peripheral model's traffic to the counters
+void I2CdevSim::count(const I2CdevSimStats &delta, uint64_t busy) {
+    stats.transactions += delta.transactions;
+    stats.reads += delta.reads;
+    stats.writes += delta.writes;
+    stats.bytes += delta.bytes;
+    stats.nacks += delta.nacks;
+    busNanos += busy;
+}
+
+/** Get the bus counters.
+ * @return Counters since the last clearStats()
+ */
+I2CdevSimStats I2CdevSim::getStats() {
+    I2CdevSimStats result = stats;
+    result.busMicros = busNanos / 1000;
+    return result;
+}
+
+/** Reset the bus counters.
+ */
+void I2CdevSim::clearStats() {
+    memset(&stats, 0, sizeof(stats));
+    busNanos = 0;
+}
+
+uint32_t millis() {
+    I2CdevSim::advance(I2CDEV_SIM_CALL_MICROS);
+    return I2CdevSim::now() / 1000;
+}
+
+uint32_t micros() {
+    I2CdevSim::advance(I2CDEV_SIM_CALL_MICROS);
+    return I2CdevSim::now();
+}
+
+void delay(uint32_t ms) {
+    I2CdevSim::advance(ms * 1000);
+}
+
+void delayMicroseconds(uint32_t us) {
+    I2CdevSim::advance(us);
+}
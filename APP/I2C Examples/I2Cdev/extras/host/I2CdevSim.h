@@ -0,0 +1,126 @@
+// I2Cdev library collection - simulated I2C bus for building on a PC
+// Backs the I2CDEV_HOST_SIMULATION implementation: I2Cdev::readBytes/writeBytes
+// (and the Wire replacement in this directory) talk to in-process device models
+// instead of a TWI peripheral, and every transfer is charged the time it would
+// take on a real bus at the configured clock.
+
+/* ============================================
+I2Cdev device library code is placed under the MIT license
+Copyright (c) 2013 Jeff Rowberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+===============================================
+*/
+
+#ifndef _I2CDEVSIM_H_
+#define _I2CDEVSIM_H_
+
+#include "Arduino.h"
+
+#ifndef I2CDEV_SIM_MAX_DEVICES
+    #define I2CDEV_SIM_MAX_DEVICES  8
+#endif
+
+// charged to the simulated clock by every millis()/micros() call, so that
+// "while (micros() - start < wait);" loops finish
+#ifndef I2CDEV_SIM_CALL_MICROS
+    #define I2CDEV_SIM_CALL_MICROS  1
+#endif
+
+// bus counters since the last I2CdevSim::clearStats()
+struct I2CdevSimStats {
+    uint32_t transactions;  // START conditions, repeated STARTs not included
+    uint32_t reads;         // read phases (repeated START + address + data)
+    uint32_t writes;        // write transactions carrying data after the register address
+    uint32_t bytes;         // bytes clocked on the bus, address bytes included
+    uint32_t nacks;         // address bytes nobody acknowledged
+    uint64_t busMicros;     // time the bus was busy
+};
+
+// a slave on the simulated bus.  the base class is a plain 256 byte register file
+// with an auto-incrementing register pointer; models override the hooks below
+class I2CdevSimDevice {
+    friend class I2CdevSim;
+    friend class I2CdevSimTwi;
+
+    public:
+        I2CdevSimDevice(uint8_t address);
+        virtual ~I2CdevSimDevice();
+
+        uint8_t getAddress();
+        virtual void reset();
+
+        uint8_t getRegister(uint8_t regAddr);
+        void setRegister(uint8_t regAddr, uint8_t value);
+
+    protected:
+        // brings the model up to the simulated time before each access
+        virtual void update();
+        // called at the start of each read phase, with the pointer where it will read
+        virtual void beginRead(uint8_t regAddr);
+        virtual uint8_t readRegister(uint8_t regAddr);
+        virtual void writeRegister(uint8_t regAddr, uint8_t value);
+        // register the pointer moves to after an access to regAddr
+        virtual uint8_t nextRegister(uint8_t regAddr);
+
+        uint8_t address;
+        uint8_t pointer;
+        uint64_t time;      // simulated micros of the current access
+        uint8_t registers[256];
+};
+
+class I2CdevSim {
+    friend class I2CdevSimTwi;
+
+    public:
+        static void setClock(uint32_t hz);
+        static uint32_t getClock();
+
+        static bool attach(I2CdevSimDevice *device);
+        static void detach(I2CdevSimDevice *device);
+        static I2CdevSimDevice *find(uint8_t devAddr);
+
+        // register access as I2Cdev does it: START, address, register, repeated START, data, STOP
+        static int8_t readBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data);
+        static bool writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data);
+
+        // raw transfers as Wire does them; status codes follow Wire.endTransmission()
+        static uint8_t transmit(uint8_t devAddr, const uint8_t *data, uint8_t length, bool stop);
+        static uint8_t receive(uint8_t devAddr, uint8_t *data, uint8_t length);
+
+        static uint64_t now();
+        static void advance(uint32_t micros);
+        // called after every advance() and at the times it asked for, so a
+        // peripheral model (I2CdevSimTwi) can finish what it has on the bus and
+        // raise its interrupt on time
+        static void setTimeHook(void (*hook)());
+
+        static I2CdevSimStats getStats();
+        static void clearStats();
+
+    private:
+        static void start(bool repeated);
+        static void stop();
+        static void clock(uint8_t bytes);
+        static uint64_t nowNanos();
+        static void wakeAt(uint64_t at);
+        static void count(const I2CdevSimStats &delta, uint64_t busy);
+};
+
+#endif /* _I2CDEVSIM_H_ */
@@ -0,0 +1,448 @@
+// I2Cdev library collection - device models for the simulated I2C bus
+// See I2CdevSimDevices.h.
+
+/* ============================================
+I2Cdev device library code is placed under the MIT license
+Copyright (c) 2013 Jeff Rowberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+===============================================
+*/
+
+#include "I2CdevSimDevices.h"
+
+// ============================================================================
+// MPU6050
+// ============================================================================
+
+#define MPU6050_SIM_XG_OFFS_TC      0x00
+#define MPU6050_SIM_YG_OFFS_TC      0x01
+#define MPU6050_SIM_ZG_OFFS_TC      0x02
+#define MPU6050_SIM_SMPLRT_DIV      0x19
+#define MPU6050_SIM_CONFIG          0x1A
+#define MPU6050_SIM_INT_STATUS      0x3A
+#define MPU6050_SIM_ACCEL_XOUT_H    0x3B
+#define MPU6050_SIM_GYRO_ZOUT_L     0x48
+#define MPU6050_SIM_USER_CTRL       0x6A
+#define MPU6050_SIM_PWR_MGMT_1      0x6B
+#define MPU6050_SIM_BANK_SEL        0x6D
+#define MPU6050_SIM_MEM_START_ADDR  0x6E
+#define MPU6050_SIM_MEM_R_W         0x6F
+#define MPU6050_SIM_FIFO_COUNTH     0x72
+#define MPU6050_SIM_FIFO_COUNTL     0x73
+#define MPU6050_SIM_FIFO_R_W        0x74
+#define MPU6050_SIM_WHO_AM_I        0x75
+
+#define MPU6050_SIM_DATA_RDY_INT    0x01
+#define MPU6050_SIM_DMP_INT         0x02
+#define MPU6050_SIM_FIFO_OFLOW_INT  0x10
+
+#define MPU6050_SIM_DMP_EN          0x80
+#define MPU6050_SIM_FIFO_EN         0x40
+#define MPU6050_SIM_FIFO_RESET      0x04
+#define MPU6050_SIM_DEVICE_RESET    0x80
+#define MPU6050_SIM_SLEEP           0x40
+
+// ACCEL_XOUT_H..GYRO_ZOUT_L: 1g on Z at +/-2g, 15 degC, no rotation
+static const uint8_t mpu6050Sensors[14] = {
+    0x00, 0x00, 0x00, 0x00, 0x40, 0x00,
+    0xE3, 0x68,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+/** MPU-6050 in its power-on state (asleep).
+ * @param address 7-bit I2C address, 0x68 or 0x69 depending on AD0
+ */
+MPU6050Sim::MPU6050Sim(uint8_t address) : I2CdevSimDevice(address) {
+    reset();
+}
+
+/** Return to the power-on state, as after PWR_MGMT_1 DEVICE_RESET.
+ */
+void MPU6050Sim::reset() {
+    I2CdevSimDevice::reset();
+    // OTP bank valid, small factory gyro offsets
+    registers[MPU6050_SIM_XG_OFFS_TC] = 0x01 | (0x1A << 1);
+    registers[MPU6050_SIM_YG_OFFS_TC] = 0x03 << 1;
+    registers[MPU6050_SIM_ZG_OFFS_TC] = 0x3C << 1;
+    registers[MPU6050_SIM_PWR_MGMT_1] = MPU6050_SIM_SLEEP;
+    registers[MPU6050_SIM_WHO_AM_I] = 0x68;
+    memcpy(registers + MPU6050_SIM_ACCEL_XOUT_H, mpu6050Sensors, sizeof(mpu6050Sensors));
+
+    memset(memory, 0, sizeof(memory));
+    // hardware revision, read by dmpInitialize() from bank 0x10
+    memory[0x10][0x06] = 0x02;
+
+    fifoHead = 0;
+    fifoCount = 0;
+    nextPacket = 0;
+    nextSample = time;
+    streaming = false;
+}
+
+/** Get the number of bytes waiting in the FIFO.
+ * @return FIFO count
+ */
+uint16_t MPU6050Sim::getFIFOCount() {
+    return fifoCount;
+}
+
+/** Peek at DMP memory.
+ * @param bank Memory bank (0-31)
+ * @param memAddr Address in the bank
+ * @return Memory contents
+ */
+uint8_t MPU6050Sim::getMemory(uint8_t bank, uint8_t memAddr) {
+    return memory[bank % MPU6050_SIM_MEMORY_BANKS][memAddr];
+}
+
+void MPU6050Sim::update() {
+    if (registers[MPU6050_SIM_PWR_MGMT_1] & MPU6050_SIM_SLEEP) return;
+
+    // sample rate = gyro output rate / (1 + SMPLRT_DIV); 1kHz with the DLPF on, else 8kHz
+    uint8_t dlpf = registers[MPU6050_SIM_CONFIG] & 0x07;
+    uint32_t samplePeriod = (dlpf == 0 || dlpf == 7 ? 125 : 1000) * (1 + (uint32_t)registers[MPU6050_SIM_SMPLRT_DIV]);
+    if (time >= nextSample) {
+        registers[MPU6050_SIM_INT_STATUS] |= MPU6050_SIM_DATA_RDY_INT;
+        nextSample = time + samplePeriod;
+    }
+
+    if (!streaming || time < nextPacket) return;
+
+    // a full FIFO only keeps the newest packets, so don't generate more than fit
+    uint64_t due = (time - nextPacket) / MPU6050_SIM_DMP_PERIOD + 1;
+    nextPacket += due * MPU6050_SIM_DMP_PERIOD;
+    if (due > MPU6050_SIM_FIFO_SIZE / MPU6050_SIM_DMP_PACKET_SIZE + 1) {
+        due = MPU6050_SIM_FIFO_SIZE / MPU6050_SIM_DMP_PACKET_SIZE + 1;
+    }
+    while (due-- > 0) pushPacket();
+}
+
+void MPU6050Sim::pushPacket() {
+    // MotionApps 2.0 layout: quaternion w/x/y/z (32-bit, 1.0 = 2^30) at 0,
+    // gyro at 16, accel at 28 (1g = 8192), each field 32 bits wide
+    uint8_t packet[MPU6050_SIM_DMP_PACKET_SIZE];
+    memset(packet, 0, sizeof(packet));
+    packet[0] = 0x40;
+    packet[36] = 0x20;
+
+    if (fifoCount + sizeof(packet) > MPU6050_SIM_FIFO_SIZE) {
+        // overflow: the oldest data is overwritten
+        uint16_t drop = fifoCount + sizeof(packet) - MPU6050_SIM_FIFO_SIZE;
+        fifoHead = (fifoHead + drop) % MPU6050_SIM_FIFO_SIZE;
+        fifoCount -= drop;
+        registers[MPU6050_SIM_INT_STATUS] |= MPU6050_SIM_FIFO_OFLOW_INT;
+    }
+    for (uint8_t i = 0; i < sizeof(packet); i++) {
+        fifo[(fifoHead + fifoCount++) % MPU6050_SIM_FIFO_SIZE] = packet[i];
+    }
+    registers[MPU6050_SIM_INT_STATUS] |= MPU6050_SIM_DMP_INT;
+}
+
+// the DMP starts writing packets one period after it is enabled with the FIFO, and the part awake
+void MPU6050Sim::startStreaming() {
+    bool on = (registers[MPU6050_SIM_USER_CTRL] & (MPU6050_SIM_DMP_EN | MPU6050_SIM_FIFO_EN)) == (MPU6050_SIM_DMP_EN | MPU6050_SIM_FIFO_EN)
+        && !(registers[MPU6050_SIM_PWR_MGMT_1] & MPU6050_SIM_SLEEP);
+    if (on && !streaming) nextPacket = time + MPU6050_SIM_DMP_PERIOD;
+    streaming = on;
+}
+
+uint8_t MPU6050Sim::readRegister(uint8_t regAddr) {
+    uint8_t value;
+    switch (regAddr) {
+        case MPU6050_SIM_INT_STATUS:
+            // cleared by reading
+            value = registers[regAddr];
+            registers[regAddr] = 0;
+            return value;
+        case MPU6050_SIM_MEM_R_W:
+            value = memory[registers[MPU6050_SIM_BANK_SEL] & 0x1F][registers[MPU6050_SIM_MEM_START_ADDR]];
+            registers[MPU6050_SIM_MEM_START_ADDR]++;
+            return value;
+        case MPU6050_SIM_FIFO_COUNTH:
+            return fifoCount >> 8;
+        case MPU6050_SIM_FIFO_COUNTL:
+            return fifoCount & 0xFF;
+        case MPU6050_SIM_FIFO_R_W:
+            if (fifoCount == 0) return 0;
+            value = fifo[fifoHead];
+            fifoHead = (fifoHead + 1) % MPU6050_SIM_FIFO_SIZE;
+            fifoCount--;
+            return value;
+    }
+    return registers[regAddr];
+}
+
+void MPU6050Sim::writeRegister(uint8_t regAddr, uint8_t value) {
+    if (regAddr >= MPU6050_SIM_ACCEL_XOUT_H && regAddr <= MPU6050_SIM_GYRO_ZOUT_L) return;
+    switch (regAddr) {
+        case MPU6050_SIM_INT_STATUS:
+        case MPU6050_SIM_FIFO_COUNTH:
+        case MPU6050_SIM_FIFO_COUNTL:
+        case MPU6050_SIM_WHO_AM_I:
+            return;
+        case MPU6050_SIM_PWR_MGMT_1:
+            if (value & MPU6050_SIM_DEVICE_RESET) {
+                reset();
+                return;
+            }
+            registers[regAddr] = value;
+            startStreaming();
+            return;
+        case MPU6050_SIM_USER_CTRL:
+            if (value & MPU6050_SIM_FIFO_RESET) {
+                fifoHead = 0;
+                fifoCount = 0;
+            }
+            // the reset bits (3:0) clear themselves
+            registers[regAddr] = value & 0xF0;
+            startStreaming();
+            return;
+        case MPU6050_SIM_MEM_R_W:
+            memory[registers[MPU6050_SIM_BANK_SEL] & 0x1F][registers[MPU6050_SIM_MEM_START_ADDR]] = value;
+            registers[MPU6050_SIM_MEM_START_ADDR]++;
+            return;
+        case MPU6050_SIM_FIFO_R_W:
+            if (fifoCount < MPU6050_SIM_FIFO_SIZE) fifo[(fifoHead + fifoCount++) % MPU6050_SIM_FIFO_SIZE] = value;
+            return;
+    }
+    registers[regAddr] = value;
+}
+
+uint8_t MPU6050Sim::nextRegister(uint8_t regAddr) {
+    // burst access to the memory and FIFO ports stays on the port
+    if (regAddr == MPU6050_SIM_MEM_R_W || regAddr == MPU6050_SIM_FIFO_R_W) return regAddr;
+    return regAddr + 1;
+}
+
+// ============================================================================
+// BMP085 / BMP180
+// ============================================================================
+
+#define BMP085_SIM_AC1_H            0xAA
+#define BMP085_SIM_CHIP_ID          0xD0
+#define BMP085_SIM_SOFT_RESET       0xE0
+#define BMP085_SIM_CONTROL          0xF4
+#define BMP085_SIM_OUT_MSB          0xF6
+#define BMP085_SIM_OUT_LSB          0xF7
+#define BMP085_SIM_OUT_XLSB         0xF8
+
+#define BMP085_SIM_SCO              0x20
+#define BMP085_SIM_TEMPERATURE      0x0E
+
+// AC1..MD from the datasheet's calculation example (AC1 = 408 ... MD = 2868)
+static const uint8_t bmp085Calibration[22] = {
+    0x01, 0x98, 0xFF, 0xB8, 0xC7, 0xD1, 0x7F, 0xE5, 0x7F, 0xF5, 0x5A, 0x71,
+    0x18, 0x2E, 0x00, 0x04, 0x80, 0x00, 0xDD, 0xF9, 0x0B, 0x34
+};
+
+// the example's raw readings: UT = 27898 (15.0 degC), UP = 23843 (69964 Pa).
+// pressure is returned as UP << 8, which a driver shifts back by 8 - oss
+#define BMP085_SIM_UT               27898
+#define BMP085_SIM_UP               23843
+
+// conversion times in micros: temperature, then pressure at oss 0..3
+static const uint16_t bmp085Conversion[5] = { 4500, 4500, 7500, 13500, 25500 };
+
+/** BMP085/BMP180 in its power-on state.
+ * @param address 7-bit I2C address (always 0x77 on real parts)
+ */
+BMP085Sim::BMP085Sim(uint8_t address) : I2CdevSimDevice(address) {
+    reset();
+}
+
+/** Return to the power-on state, as after a soft reset.
+ */
+void BMP085Sim::reset() {
+    I2CdevSimDevice::reset();
+    memcpy(registers + BMP085_SIM_AC1_H, bmp085Calibration, sizeof(bmp085Calibration));
+    registers[BMP085_SIM_CHIP_ID] = 0x55;
+    registers[BMP085_SIM_OUT_MSB] = 0x80;
+    converting = false;
+    ready = 0;
+    command = 0;
+}
+
+void BMP085Sim::update() {
+    if (!converting || time < ready) return;
+    converting = false;
+    registers[BMP085_SIM_CONTROL] &= ~BMP085_SIM_SCO;
+    if ((command & 0x1F) == BMP085_SIM_TEMPERATURE) {
+        registers[BMP085_SIM_OUT_MSB] = BMP085_SIM_UT >> 8;
+        registers[BMP085_SIM_OUT_LSB] = BMP085_SIM_UT & 0xFF;
+    } else {
+        registers[BMP085_SIM_OUT_MSB] = BMP085_SIM_UP >> 8;
+        registers[BMP085_SIM_OUT_LSB] = BMP085_SIM_UP & 0xFF;
+        registers[BMP085_SIM_OUT_XLSB] = 0;
+    }
+}
+
+void BMP085Sim::writeRegister(uint8_t regAddr, uint8_t value) {
+    if (regAddr == BMP085_SIM_SOFT_RESET && value == 0xB6) {
+        reset();
+    } else if (regAddr == BMP085_SIM_CONTROL) {
+        // reading the output early returns the previous result, as on the part
+        registers[regAddr] = value;
+        if (value & BMP085_SIM_SCO) {
+            command = value;
+            converting = true;
+            ready = time + bmp085Conversion[(value & 0x1F) == BMP085_SIM_TEMPERATURE ? 0 : 1 + (value >> 6)];
+        }
+    }
+    // everything else is read-only
+}
+
+// ============================================================================
+// ADXL345
+// ============================================================================
+
+#define ADXL345_SIM_DEVID           0x00
+#define ADXL345_SIM_ACT_TAP_STATUS  0x2B
+#define ADXL345_SIM_BW_RATE         0x2C
+#define ADXL345_SIM_POWER_CTL       0x2D
+#define ADXL345_SIM_INT_SOURCE      0x30
+#define ADXL345_SIM_DATAX0          0x32
+#define ADXL345_SIM_DATAZ1          0x37
+#define ADXL345_SIM_FIFO_CTL        0x38
+#define ADXL345_SIM_FIFO_STATUS     0x39
+
+#define ADXL345_SIM_MEASURE         0x08
+#define ADXL345_SIM_DATA_READY      0x80
+#define ADXL345_SIM_WATERMARK       0x02
+#define ADXL345_SIM_OVERRUN         0x01
+
+#define ADXL345_SIM_MODE_BYPASS     0
+#define ADXL345_SIM_MODE_FIFO       1
+
+// DATAX0..DATAZ1: 1g on Z at 10-bit +/-2g (256 LSB/g), little endian
+static const uint8_t adxl345Sample[6] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x01 };
+
+/** ADXL345 in its power-on state (standby, 100Hz, bypass).
+ * @param address 7-bit I2C address, 0x53 or 0x1D depending on ALT ADDRESS
+ */
+ADXL345Sim::ADXL345Sim(uint8_t address) : I2CdevSimDevice(address) {
+    reset();
+}
+
+/** Return to the power-on state.
+ */
+void ADXL345Sim::reset() {
+    I2CdevSimDevice::reset();
+    registers[ADXL345_SIM_DEVID] = 0xE5;
+    registers[ADXL345_SIM_BW_RATE] = 0x0A;
+    registers[ADXL345_SIM_INT_SOURCE] = ADXL345_SIM_WATERMARK;
+    fifoHead = 0;
+    fifoLength = 0;
+    nextSample = 0;
+    triggered = false;
+}
+
+/** Get the number of samples waiting in the FIFO.
+ * @return FIFO entries (0-32)
+ */
+uint8_t ADXL345Sim::getFIFOLength() {
+    return fifoLength;
+}
+
+// output data rate is 3200Hz / 2^(15 - rate code)
+uint32_t ADXL345Sim::getSamplePeriod() {
+    return (625UL << (15 - (registers[ADXL345_SIM_BW_RATE] & 0x0F))) / 2;
+}
+
+void ADXL345Sim::update() {
+    if (!(registers[ADXL345_SIM_POWER_CTL] & ADXL345_SIM_MEASURE) || time < nextSample) return;
+
+    // once the FIFO is full older samples don't matter
+    uint32_t period = getSamplePeriod();
+    uint64_t due = (time - nextSample) / period + 1;
+    nextSample += due * period;
+    if (due > ADXL345_SIM_FIFO_SIZE + 1) due = ADXL345_SIM_FIFO_SIZE + 1;
+    while (due-- > 0) sample();
+}
+
+void ADXL345Sim::sample() {
+    uint8_t mode = registers[ADXL345_SIM_FIFO_CTL] >> 6;
+    if (mode == ADXL345_SIM_MODE_BYPASS) {
+        memcpy(registers + ADXL345_SIM_DATAX0, adxl345Sample, sizeof(adxl345Sample));
+        registers[ADXL345_SIM_INT_SOURCE] |= ADXL345_SIM_DATA_READY;
+        return;
+    }
+
+    if (fifoLength == ADXL345_SIM_FIFO_SIZE) {
+        registers[ADXL345_SIM_INT_SOURCE] |= ADXL345_SIM_OVERRUN;
+        // FIFO mode stops collecting when full, stream and trigger modes drop the oldest
+        if (mode == ADXL345_SIM_MODE_FIFO) return;
+        fifoHead = (fifoHead + 1) % ADXL345_SIM_FIFO_SIZE;
+        fifoLength--;
+    }
+    memcpy(fifo[(fifoHead + fifoLength++) % ADXL345_SIM_FIFO_SIZE], adxl345Sample, sizeof(adxl345Sample));
+    updateStatus();
+}
+
+void ADXL345Sim::updateStatus() {
+    uint8_t source = registers[ADXL345_SIM_INT_SOURCE] & ~(ADXL345_SIM_DATA_READY | ADXL345_SIM_WATERMARK);
+    if (fifoLength > 0) source |= ADXL345_SIM_DATA_READY;
+    if (fifoLength >= (registers[ADXL345_SIM_FIFO_CTL] & 0x1F)) source |= ADXL345_SIM_WATERMARK;
+    registers[ADXL345_SIM_INT_SOURCE] = source;
+    registers[ADXL345_SIM_FIFO_STATUS] = (triggered ? 0x80 : 0) | fifoLength;
+}
+
+void ADXL345Sim::beginRead(uint8_t regAddr) {
+    if (regAddr < ADXL345_SIM_DATAX0 || regAddr > ADXL345_SIM_DATAZ1) return;
+
+    // a read of the data registers takes the oldest FIFO entry
+    if ((registers[ADXL345_SIM_FIFO_CTL] >> 6) != ADXL345_SIM_MODE_BYPASS) {
+        if (fifoLength > 0) {
+            memcpy(registers + ADXL345_SIM_DATAX0, fifo[fifoHead], 6);
+            fifoHead = (fifoHead + 1) % ADXL345_SIM_FIFO_SIZE;
+            fifoLength--;
+        }
+        registers[ADXL345_SIM_INT_SOURCE] &= ~ADXL345_SIM_OVERRUN;
+        updateStatus();
+    } else {
+        registers[ADXL345_SIM_INT_SOURCE] &= ~(ADXL345_SIM_DATA_READY | ADXL345_SIM_OVERRUN);
+    }
+}
+
+void ADXL345Sim::writeRegister(uint8_t regAddr, uint8_t value) {
+    switch (regAddr) {
+        case ADXL345_SIM_DEVID:
+        case ADXL345_SIM_ACT_TAP_STATUS:
+        case ADXL345_SIM_INT_SOURCE:
+        case ADXL345_SIM_FIFO_STATUS:
+            return;
+        case ADXL345_SIM_POWER_CTL:
+            if ((value & ADXL345_SIM_MEASURE) && !(registers[regAddr] & ADXL345_SIM_MEASURE)) {
+                nextSample = time + getSamplePeriod();
+            }
+            break;
+        case ADXL345_SIM_FIFO_CTL:
+            // switching modes starts the FIFO over
+            if ((value >> 6) != (registers[regAddr] >> 6)) {
+                fifoHead = 0;
+                fifoLength = 0;
+                triggered = false;
+            }
+            registers[regAddr] = value;
+            updateStatus();
+            return;
+    }
+    if (regAddr >= ADXL345_SIM_DATAX0 && regAddr <= ADXL345_SIM_DATAZ1) return;
+    registers[regAddr] = value;
+}
@@ -0,0 +1,116 @@
+// I2Cdev library collection - device models for the simulated I2C bus
+// Enough of each part's register map for the drivers in this collection to run
+// their setup and read paths against: the models keep datasheet reset values,
+// self-clearing bits and conversion/sample timing, and return fixed, plausible
+// sensor data (level and still, 15 degC, 1 atm).
+
+/* ============================================
+I2Cdev device library code is placed under the MIT license
+Copyright (c) 2013 Jeff Rowberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+===============================================
+*/
+
+#ifndef _I2CDEVSIMDEVICES_H_
+#define _I2CDEVSIMDEVICES_H_
+
+#include "I2CdevSim.h"
+
+#define MPU6050_SIM_FIFO_SIZE       1024
+#define MPU6050_SIM_MEMORY_BANKS    32
+#define MPU6050_SIM_DMP_PACKET_SIZE 42
+// the MotionApps 2.0 image configures a 100Hz output rate
+#define MPU6050_SIM_DMP_PERIOD      10000
+
+// InvenSense MPU-6050: registers, the 1024 byte FIFO, DMP memory banks and the
+// 42 byte MotionApps 2.0 packet stream (identity quaternion, 1g on Z)
+class MPU6050Sim : public I2CdevSimDevice {
+    public:
+        MPU6050Sim(uint8_t address=0x68);
+        void reset();
+
+        uint16_t getFIFOCount();
+        uint8_t getMemory(uint8_t bank, uint8_t memAddr);
+
+    protected:
+        void update();
+        uint8_t readRegister(uint8_t regAddr);
+        void writeRegister(uint8_t regAddr, uint8_t value);
+        uint8_t nextRegister(uint8_t regAddr);
+
+    private:
+        void pushPacket();
+        void startStreaming();
+
+        uint8_t memory[MPU6050_SIM_MEMORY_BANKS][256];
+        uint8_t fifo[MPU6050_SIM_FIFO_SIZE];
+        uint16_t fifoHead;
+        uint16_t fifoCount;
+        uint64_t nextPacket;
+        uint64_t nextSample;
+        bool streaming;
+};
+
+// Bosch BMP085 / BMP180 (same map; chip id 0x55): datasheet example calibration
+// and raw values, conversion times per oversampling setting
+class BMP085Sim : public I2CdevSimDevice {
+    public:
+        BMP085Sim(uint8_t address=0x77);
+        void reset();
+
+    protected:
+        void update();
+        void writeRegister(uint8_t regAddr, uint8_t value);
+
+    private:
+        uint64_t ready;
+        bool converting;
+        uint8_t command;
+};
+
+#define ADXL345_SIM_FIFO_SIZE       32
+
+// Analog Devices ADXL345: output data rate, bypass/FIFO/stream/trigger modes of
+// the 32 sample FIFO and the INT_SOURCE bits that go with it
+class ADXL345Sim : public I2CdevSimDevice {
+    public:
+        ADXL345Sim(uint8_t address=0x53);
+        void reset();
+
+        uint8_t getFIFOLength();
+
+    protected:
+        void update();
+        void beginRead(uint8_t regAddr);
+        void writeRegister(uint8_t regAddr, uint8_t value);
+
+    private:
+        void sample();
+        void updateStatus();
+        uint32_t getSamplePeriod();
+
+        uint8_t fifo[ADXL345_SIM_FIFO_SIZE][6];
+        uint8_t fifoHead;
+        uint8_t fifoLength;
+        uint64_t nextSample;
+        bool triggered;
+};
+
+#endif /* _I2CDEVSIMDEVICES_H_ */
@@ -0,0 +1,223 @@
+// I2Cdev library collection - AVR TWI peripheral on the simulated I2C bus
+// See I2CdevSimTwi.h.
+//
+// Only the master side is modelled: START, repeated START, SLA+R/W, data bytes
+// with or without ACK, and STOP, each taking the bit periods I2CdevSim charges
+// (one per START, nine per byte, two per STOP) at the SCL clock set by TWBR.
+// The status an action leads to is in TWSR when TWINT comes up, with the
+// TW_* codes of util/twi.h.  Arbitration and bus errors never happen.
+
+/* ============================================
+I2Cdev device library code is placed under the MIT license
+Copyright (c) 2013 Jeff Rowberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+===============================================
+*/
+
+#include <avr/interrupt.h>
+#include <util/twi.h>
+
+I2CdevSimTwcr TWCR;
+uint8_t TWSR = TW_NO_INFO, TWBR, TWDR, TWAR;
+// interrupts are on once the Arduino core has started
+uint8_t SREG = _BV(SREG_I), PORTC, PORTD;
+
+// TWCR as the chip shows it
+static uint8_t twcr;
+// an action is on the bus until doneNanos; TWSR becomes status then
+static bool pending = false;
+static uint64_t doneNanos;
+static uint8_t status;
+// TWSTO stays set until the STOP is out
+static uint64_t stopNanos;
+// START sent and no STOP yet
+static bool owned = false;
+static I2CdevSimDevice *device = 0;
+// the next byte written is the register address
+static bool registerNext;
+static uint8_t dataBytes;
+static bool running = false;
+static uint32_t errors = 0;
+
+I2CdevSimTwcr &I2CdevSimTwcr::operator=(uint8_t value) {
+    I2CdevSimTwi::control(value);
+    return *this;
+}
+
+I2CdevSimTwcr::operator uint8_t() {
+    I2CdevSim::advance(I2CDEV_SIM_CALL_MICROS);
+    return I2CdevSimTwi::getControl();
+}
+
+/** Write TWCR.  With TWINT set this starts the next bus action: STOP, START,
+ * or the byte transfer TWSR calls for (SLA+R/W after a START, data otherwise).
+ * @param value New TWCR value
+ */
+void I2CdevSimTwi::control(uint8_t value) {
+    uint64_t now = I2CdevSim::nowNanos();
+    // the TWI runs in the background from the first register write on
+    I2CdevSim::setTimeHook(run);
+
+    if (!(value & _BV(TWEN))) {
+        // switching the TWI off abandons whatever it was doing
+        twcr = value & ~(_BV(TWINT) | _BV(TWSTO));
+        pending = false;
+        owned = false;
+        device = 0;
+        TWSR = TW_NO_INFO;
+        return;
+    }
+
+    // writing a one clears TWINT; TWSTO clears itself once the STOP is out
+    bool go = value & _BV(TWINT);
+    twcr = (value & ~(_BV(TWINT) | _BV(TWSTO))) | (twcr & _BV(TWSTO)) | (go ? 0 : twcr & _BV(TWINT));
+    if (!go) return;
+
+    if (pending) {
+        errors++;
+        return;
+    }
+
+    uint64_t bitNanos = (16 + 2 * (uint64_t)TWBR) * 1000000000ULL / F_CPU;
+    I2CdevSimStats delta;
+    memset(&delta, 0, sizeof(delta));
+    uint64_t duration;
+    uint64_t start = now > stopNanos ? now : stopNanos;
+
+    if (value & _BV(TWSTO)) {
+        if (owned && dataBytes > 0) delta.writes++;
+        owned = false;
+        device = 0;
+        twcr |= _BV(TWSTO);
+        stopNanos = start + 2 * bitNanos;
+        I2CdevSim::wakeAt(stopNanos);
+        TWSR = TW_NO_INFO;
+        I2CdevSim::count(delta, 2 * bitNanos);
+        return;
+    }
+
+    if (value & _BV(TWSTA)) {
+        status = owned ? TW_REP_START : TW_START;
+        if (!owned) delta.transactions++;
+        owned = true;
+        device = 0;
+        dataBytes = 0;
+        duration = bitNanos;
+    } else {
+        switch (TW_STATUS) {
+            case TW_START:
+            case TW_REP_START: {
+                bool read = TWDR & TW_READ;
+                device = I2CdevSim::find(TWDR >> 1);
+                if (device == 0) {
+                    delta.nacks++;
+                    status = read ? TW_MR_SLA_NACK : TW_MT_SLA_NACK;
+                    break;
+                }
+
+                device->time = I2CdevSim::now();
+                device->update();
+                if (read) {
+                    delta.reads++;
+                    device->beginRead(device->pointer);
+                    status = TW_MR_SLA_ACK;
+                } else {
+                    registerNext = true;
+                    status = TW_MT_SLA_ACK;
+                }
+                break;
+            }
+
+            case TW_MT_SLA_ACK:
+            case TW_MT_DATA_ACK:
+                if (registerNext) {
+                    device->pointer = TWDR;
+                    registerNext = false;
+                } else {
+                    device->writeRegister(device->pointer, TWDR);
+                    device->pointer = device->nextRegister(device->pointer);
+                    dataBytes++;
+                }
+                status = TW_MT_DATA_ACK;
+                break;
+
+            case TW_MR_SLA_ACK:
+            case TW_MR_DATA_ACK:
+                TWDR = device->readRegister(device->pointer);
+                device->pointer = device->nextRegister(device->pointer);
+                status = (value & _BV(TWEA)) ? TW_MR_DATA_ACK : TW_MR_DATA_NACK;
+                break;
+
+            default:
+                // nothing to clock after a NACK or without a START
+                errors++;
+                return;
+        }
+
+        delta.bytes++;
+        duration = 9 * bitNanos;
+    }
+
+    pending = true;
+    doneNanos = start + duration;
+    I2CdevSim::wakeAt(doneNanos);
+    I2CdevSim::count(delta, duration);
+}
+
+/** Read TWCR without charging the poll.
+ * @return TWCR value
+ */
+uint8_t I2CdevSimTwi::getControl() {
+    return twcr;
+}
+
+void I2CdevSimTwi::complete() {
+    pending = false;
+    TWSR = status;
+    twcr |= _BV(TWINT);
+}
+
+void I2CdevSimTwi::run() {
+    // the interrupt handler calls micros(), which comes back here
+    if (running) return;
+    running = true;
+
+    uint64_t now = I2CdevSim::nowNanos();
+    if (pending && now >= doneNanos) complete();
+    if ((twcr & _BV(TWSTO)) && now >= stopNanos) twcr &= ~_BV(TWSTO);
+
+    if ((twcr & _BV(TWINT)) && (twcr & _BV(TWIE)) && (twcr & _BV(TWEN)) && (SREG & _BV(SREG_I))) {
+        // as on the chip, the handler runs with interrupts off
+        uint8_t sreg = SREG;
+        SREG &= ~_BV(SREG_I);
+        TWI_vect();
+        SREG = sreg;
+    }
+
+    running = false;
+}
+
+/** Count of bus actions the model had to ignore: TWINT written while an action
+ * was still on the bus, or a byte transfer with no device addressed.
+ * @return Errors since the program started
+ */
+uint32_t I2CdevSimTwi::getErrorCount() {
+    return errors;
+}
@@ -0,0 +1,83 @@
+// I2Cdev library collection - AVR TWI peripheral on the simulated I2C bus
+// Lets the I2CDEV_BUILTIN_ASYNC implementation (I2CdevAsync) run on a PC: its
+// register writes drive a model of the ATmega TWI master, which moves bytes
+// to and from the I2CdevSim device models in the background, in simulated
+// time, and calls ISR(TWI_vect) when each step completes.  Included through the
+// avr/interrupt.h replacement in this directory.
+
+/* ============================================
+I2Cdev device library code is placed under the MIT license
+Copyright (c) 2013 Jeff Rowberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+===============================================
+*/
+
+#ifndef _I2CDEVSIMTWI_H_
+#define _I2CDEVSIMTWI_H_
+
+#include "I2CdevSim.h"
+
+// the SCL frequency follows from TWBR as on an ATmega at this clock
+#ifndef F_CPU
+    #define F_CPU 16000000L
+#endif
+
+#define _BV(bit) (1 << (bit))
+
+// TWCR bits
+#define TWINT   7
+#define TWEA    6
+#define TWSTA   5
+#define TWSTO   4
+#define TWWC    3
+#define TWEN    2
+#define TWIE    0
+
+// SREG global interrupt enable
+#define SREG_I  7
+
+// TWCR: writing it starts bus actions, as on the chip.  reading it costs
+// I2CDEV_SIM_CALL_MICROS like millis()/micros(), so loops polling a bit finish
+class I2CdevSimTwcr {
+    public:
+        I2CdevSimTwcr &operator=(uint8_t value);
+        operator uint8_t();
+};
+
+class I2CdevSimTwi {
+    public:
+        // called from I2CdevSim::advance(): completes the bus action in progress
+        // once its time is up, and runs ISR(TWI_vect) if TWIE and interrupts are on
+        static void run();
+        static void control(uint8_t value);
+        static uint8_t getControl();
+
+        // bus actions the model could not make sense of (e.g. data without START)
+        static uint32_t getErrorCount();
+
+    private:
+        static void complete();
+};
+
+extern I2CdevSimTwcr TWCR;
+extern uint8_t TWSR, TWBR, TWDR, TWAR;
+extern uint8_t SREG, PORTC, PORTD;
+
+#endif /* _I2CDEVSIMTWI_H_ */
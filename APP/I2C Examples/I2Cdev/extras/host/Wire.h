@@ -0,0 +1,62 @@
+// I2Cdev library collection - Wire library replacement for building on a PC:
+// transfers go to the I2CdevSim bus, so classes written against Wire (e.g.
+// SFE_BMP180) talk to the same device models as I2Cdev-based ones
+
+/* ============================================
+I2Cdev device library code is placed under the MIT license
+Copyright (c) 2013 Jeff Rowberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+===============================================
+*/
+
+#ifndef _WIRE_H_
+#define _WIRE_H_
+
+#include "Arduino.h"
+
+#define BUFFER_LENGTH 32
+
+class TwoWire {
+    private:
+        uint8_t txAddress;
+        uint8_t txBuffer[BUFFER_LENGTH];
+        uint8_t txLength;
+        uint8_t rxBuffer[BUFFER_LENGTH];
+        uint8_t rxIndex;
+        uint8_t rxLength;
+
+    public:
+        TwoWire();
+        void begin();
+        void beginTransmission(uint8_t address);
+        void beginTransmission(int address);
+        uint8_t endTransmission(bool sendStop=true);
+        uint8_t requestFrom(uint8_t address, uint8_t quantity);
+        uint8_t requestFrom(int address, int quantity);
+        size_t write(uint8_t data);
+        size_t write(const uint8_t *data, size_t length);
+        int available();
+        int read();
+        int peek();
+};
+
+extern TwoWire Wire;
+
+#endif /* _WIRE_H_ */
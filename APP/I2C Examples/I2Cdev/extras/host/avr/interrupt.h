@@ -0,0 +1,11 @@
+// I2Cdev library collection - avr/interrupt.h replacement for building on a PC
+// with the I2CDEV_BUILTIN_ASYNC implementation: the TWI registers and vector
+// are those of the I2CdevSimTwi model, and cli()/sei() work on its SREG
+#ifndef _INTERRUPT_H_
+#define _INTERRUPT_H_
+#include "I2CdevSimTwi.h"
+#define ISR(vector) void vector()
+void TWI_vect();
+inline void cli() { SREG &= ~_BV(SREG_I); }
+inline void sei() { SREG |= _BV(SREG_I); }
+#endif /* _INTERRUPT_H_ */
@@ -0,0 +1,14 @@
+// I2Cdev library collection - avr/pgmspace.h replacement for building on a PC:
+// flash and RAM are the same thing there
+
+#ifndef _PGMSPACE_H_
+#define _PGMSPACE_H_
+
+#define PROGMEM
+#define PSTR(str) (str)
+#define F(str) (str)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_float(addr) (*(const float *)(addr))
+
+#endif /* _PGMSPACE_H_ */
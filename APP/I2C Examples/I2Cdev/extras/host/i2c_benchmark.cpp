@@ -0,0 +1,305 @@
+// I2Cdev library collection - driver call costs on the simulated I2C bus
+// Runs the MPU6050 (with MotionApps 2.0), ADXL345, BMP085 and SFE_BMP180 drivers
+// against the I2CdevSim device models at 100kHz and 400kHz, and reports for each
+// driver call the transactions, bytes and bus time it took, and the simulated
+// time it took end to end (delays and conversion waits included).  The last
+// table compares setup with the register shadow (I2Cdev::enableShadow) off and on.
+//
+// Built with I2CDEV_BUILTIN_ASYNC, the drivers go through I2CdevAsync on the TWI
+// model in I2CdevSimTwi.  Each row then also shows I2CdevAsync::getBusyMicros()
+// and getWaitMicros(), and another table compares a sensor loop that blocks on
+// its reads with one that queues them and works while they are on the bus.
+//
+// Build from the I2Cdev directory:
+//
+// g++ -O2 -std=c++11 -DARDUINO=101 -DI2CDEV_IMPLEMENTATION=I2CDEV_HOST_SIMULATION -Iextras/host -I. -I../MPU6050 -I../ADXL345 -I../BMP085 -I../../BMP180/SFE_BMP180 extras/host/i2c_benchmark.cpp extras/host/I2CdevSim.cpp extras/host/I2CdevSimDevices.cpp extras/host/Wire.cpp I2Cdev.cpp ../MPU6050/MPU6050.cpp ../ADXL345/ADXL345.cpp ../BMP085/BMP085.cpp ../../BMP180/SFE_BMP180/SFE_BMP180.cpp -o i2c_benchmark
+//
+// or, for I2CdevAsync (SFE_BMP180 talks to Wire directly, so it stays on Wire.cpp):
+//
+// g++ -O2 -std=c++11 -DARDUINO=101 -DI2CDEV_IMPLEMENTATION=I2CDEV_BUILTIN_ASYNC -Iextras/host -I. -I../MPU6050 -I../ADXL345 -I../BMP085 -I../../BMP180/SFE_BMP180 extras/host/i2c_benchmark.cpp extras/host/I2CdevSim.cpp extras/host/I2CdevSimDevices.cpp extras/host/I2CdevSimTwi.cpp extras/host/Wire.cpp I2Cdev.cpp ../MPU6050/MPU6050.cpp ../ADXL345/ADXL345.cpp ../BMP085/BMP085.cpp ../../BMP180/SFE_BMP180/SFE_BMP180.cpp -o i2c_benchmark_async
+
+/* ============================================
+I2Cdev device library code is placed under the MIT license
+Copyright (c) 2013 Jeff Rowberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+===============================================
+*/
+
+#include "I2Cdev.h"
+#include "I2CdevSimDevices.h"
+#include "MPU6050_6Axis_MotionApps20.h"
+#include "ADXL345.h"
+#include "BMP085.h"
+#include "SFE_BMP180.h"
+
+#include <stdio.h>
+
+#if I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_ASYNC
+    #include "I2CdevSimTwi.h"
+#endif
+
+static MPU6050 mpu;
+static ADXL345 accel;
+static BMP085 barometer;
+static SFE_BMP180 pressure;
+
+static int16_t ax, ay, az, gx, gy, gz;
+static uint8_t fifoBuffer[64];
+static bool ok;
+
+// prints one row: what the call cost on the bus and in simulated time
+static void measure(const char *name, void (*call)()) {
+    I2CdevSim::clearStats();
+    #if I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_ASYNC
+        I2CdevAsync::clearStats();
+    #endif
+    uint64_t start = I2CdevSim::now();
+    ok = true;
+    call();
+    uint64_t elapsed = I2CdevSim::now() - start;
+    I2CdevSimStats stats = I2CdevSim::getStats();
+
+    printf("  %-36s %6u %6u %9u %9u", name, (unsigned)stats.transactions, (unsigned)stats.bytes,
+        (unsigned)stats.busMicros, (unsigned)elapsed);
+    #if I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_ASYNC
+        printf(" %9u %9u", (unsigned)I2CdevAsync::getBusyMicros(), (unsigned)I2CdevAsync::getWaitMicros());
+    #endif
+    printf("%s\n", ok ? "" : "  FAILED");
+}
+
+// the clock for I2Cdev, and the column headings
+static void setClock(uint32_t hz, const char *title) {
+    I2CdevSim::setClock(hz);
+    #if I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_ASYNC
+        I2CdevAsync::setup(hz / 1000, true);
+    #endif
+
+    printf("%lukHz %-36s %6s %6s %9s %9s", (unsigned long)hz / 1000, title, "trans", "bytes", "bus us", "total us");
+    #if I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_ASYNC
+        printf(" %9s %9s", "busy us", "wait us");
+    #endif
+    printf("\n");
+}
+
+static void mpuInitialize() {
+    mpu.initialize();
+}
+
+static void mpuTestConnection() {
+    ok = mpu.testConnection();
+}
+
+static void mpuGetMotion6() {
+    mpu.getMotion6(&ax, &ay, &az, &gx, &gy, &gz);
+    ok = az == 16384;
+}
+
+static void mpuDmpInitialize() {
+    ok = mpu.dmpInitialize() == 0;
+}
+
+static void mpuDmpPacket() {
+    // what the MPU6050_DMP6 loop does per interrupt
+    uint8_t status = mpu.getIntStatus();
+    uint16_t count = mpu.getFIFOCount();
+    if ((status & 0x02) && count >= mpu.dmpGetFIFOPacketSize()) {
+        mpu.getFIFOBytes(fifoBuffer, mpu.dmpGetFIFOPacketSize());
+        Quaternion q;
+        mpu.dmpGetQuaternion(&q, fifoBuffer);
+        ok = q.w == 1.0f;
+    } else {
+        ok = false;
+    }
+}
+
+static void accelInitialize() {
+    accel.initialize();
+}
+
+static void accelTestConnection() {
+    ok = accel.testConnection();
+}
+
+static void accelGetAcceleration() {
+    accel.getAcceleration(&ax, &ay, &az);
+    ok = az == 256;
+}
+
+static void accelDrainFIFO() {
+    // stream mode at 100Hz, then read everything that piled up in 320ms
+    // (at 100kHz a few more samples arrive while draining)
+    accel.setFIFOMode(ADXL345_FIFO_MODE_STREAM);
+    delay(320);
+    uint8_t length = accel.getFIFOLength();
+    for (uint8_t i = 0; i < length; i++) accel.getAcceleration(&ax, &ay, &az);
+    ok = length == ADXL345_SIM_FIFO_SIZE && az == 256;
+    accel.setFIFOMode(ADXL345_FIFO_MODE_BYPASS);
+}
+
+static void barometerInitialize() {
+    barometer.initialize();
+    ok = barometer.testConnection();
+}
+
+static void barometerTemperature() {
+    barometer.setControl(BMP085_MODE_TEMPERATURE);
+    uint32_t lastMicros = micros();
+    while (micros() - lastMicros < barometer.getMeasureDelayMicroseconds());
+    ok = fabs(barometer.getTemperatureC() - 15.0f) < 0.1f;
+}
+
+static void barometerPressure() {
+    barometer.setControl(BMP085_MODE_PRESSURE_3);
+    uint32_t lastMicros = micros();
+    while (micros() - lastMicros < barometer.getMeasureDelayMicroseconds());
+    ok = fabs(barometer.getPressure() - 69964) < 50;
+}
+
+static void pressureBegin() {
+    ok = pressure.begin() != 0;
+}
+
+static void pressureReading() {
+    double t, p;
+    char wait = pressure.startTemperature();
+    delay(wait);
+    pressure.getTemperature(t);
+    wait = pressure.startPressure(3);
+    delay(wait);
+    ok = pressure.getPressure(p, t) != 0 && fabs(t - 15.0) < 0.1 && fabs(p - 699.64) < 0.5;
+}
+
+static void calls(uint32_t hz) {
+    setClock(hz, "");
+    MPU6050Sim mpuModel;
+    ADXL345Sim accelModel;
+    BMP085Sim barometerModel;
+    I2CdevSim::attach(&mpuModel);
+    I2CdevSim::attach(&accelModel);
+    I2CdevSim::attach(&barometerModel);
+
+    measure("MPU6050::initialize()", mpuInitialize);
+    measure("MPU6050::testConnection()", mpuTestConnection);
+    measure("MPU6050::getMotion6()", mpuGetMotion6);
+    measure("MPU6050::dmpInitialize()", mpuDmpInitialize);
+    mpu.setDMPEnabled(true);
+    delay(15);
+    measure("DMP packet (status, count, 42 bytes)", mpuDmpPacket);
+
+    measure("ADXL345::initialize()", accelInitialize);
+    measure("ADXL345::testConnection()", accelTestConnection);
+    delay(10);
+    measure("ADXL345::getAcceleration()", accelGetAcceleration);
+    measure("ADXL345 drain 32 sample FIFO", accelDrainFIFO);
+
+    measure("BMP085::initialize()", barometerInitialize);
+    measure("BMP085 temperature", barometerTemperature);
+    measure("BMP085 pressure, oss 3", barometerPressure);
+
+    measure("SFE_BMP180::begin()", pressureBegin);
+    measure("SFE_BMP180 temperature + pressure", pressureReading);
+    printf("\n");
+}
+
+#if I2CDEV_SHADOW_REGISTERS > 0
+static void shadow(uint32_t hz) {
+    setClock(hz, "register shadow off / on");
+
+    for (uint8_t enabled = 0; enabled < 2; enabled++) {
+        MPU6050Sim mpuModel;
+        ADXL345Sim accelModel;
+        I2CdevSim::attach(&mpuModel);
+        I2CdevSim::attach(&accelModel);
+        mpu.setShadowEnabled(enabled);
+        accel.setShadowEnabled(enabled);
+
+        measure(enabled ? "MPU6050::initialize(), shadow" : "MPU6050::initialize()", mpuInitialize);
+        measure(enabled ? "MPU6050::dmpInitialize(), shadow" : "MPU6050::dmpInitialize()", mpuDmpInitialize);
+        measure(enabled ? "ADXL345::initialize(), shadow" : "ADXL345::initialize()", accelInitialize);
+
+        mpu.setShadowEnabled(false);
+        accel.setShadowEnabled(false);
+    }
+    printf("\n");
+}
+#endif
+
+#if I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_ASYNC
+// a sensor loop: read the MPU6050's 14 motion bytes, then do LOOP_WORK_MICROS of
+// other work.  Blocking, the read and the work add up; queued, the work starts
+// as soon as the read is, and the loop only waits for whatever is still left
+#define LOOP_COUNT 100
+#define LOOP_WORK_MICROS 300
+
+static uint8_t motionBuffer[14];
+static volatile bool motionDone;
+static volatile int8_t motionStatus;
+
+static void motionRead(int8_t status, void *) {
+    motionStatus = status;
+    motionDone = true;
+}
+
+static void loopBlocking() {
+    for (uint8_t i = 0; i < LOOP_COUNT && ok; i++) {
+        ok = I2Cdev::readBytes(0x68, MPU6050_RA_ACCEL_XOUT_H, 14, motionBuffer) == 14;
+        delayMicroseconds(LOOP_WORK_MICROS);
+    }
+}
+
+static void loopQueued() {
+    for (uint8_t i = 0; i < LOOP_COUNT && ok; i++) {
+        motionDone = false;
+        ok = I2CdevAsync::readBytes(0x68, MPU6050_RA_ACCEL_XOUT_H, 14, motionBuffer, motionRead, NULL);
+        delayMicroseconds(LOOP_WORK_MICROS);
+        while (ok && !motionDone) micros();
+        ok = ok && motionStatus == 14 && motionBuffer[4] == 0x40;
+    }
+}
+
+static void overlap(uint32_t hz) {
+    setClock(hz, "100 x (14 byte read + 300us work)");
+    MPU6050Sim mpuModel;
+    I2CdevSim::attach(&mpuModel);
+    mpu.initialize();
+
+    measure("read, then work", loopBlocking);
+    measure("queue read, work, wait for callback", loopQueued);
+    ok = I2CdevSimTwi::getErrorCount() == 0;
+    printf("%s\n", ok ? "" : "  TWI model errors\n");
+}
+#endif
+
+int main() {
+    calls(100000);
+    calls(400000);
+
+    #if I2CDEV_SHADOW_REGISTERS > 0
+        shadow(100000);
+        shadow(400000);
+    #endif
+
+    #if I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_ASYNC
+        overlap(100000);
+        overlap(400000);
+    #endif
+
+    return 0;
+}
@@ -165,6 +165,8 @@ void setup() {
         TWBR = 24; // 400kHz I2C clock (200kHz if CPU is 8MHz)
     #elif I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_FASTWIRE
         Fastwire::setup(400, true);
+    #elif I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_ASYNC
+        I2CdevAsync::setup(400, true);
     #endif
 
     // initialize serial communication
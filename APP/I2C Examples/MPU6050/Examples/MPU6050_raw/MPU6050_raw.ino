@@ -75,6 +75,8 @@ void setup() {
         Wire.begin();
     #elif I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_FASTWIRE
         Fastwire::setup(400, true);
+    #elif I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_ASYNC
+        I2CdevAsync::setup(400, true);
     #endif
 
     // initialize serial communication
@@ -75,6 +75,27 @@ bool MPU6050::testConnection() {
     return getDeviceID() == 0x34;
 }
 
+// registers the MPU-60X0 changes itself: self-clearing reset and enable bits, and
+// the DMP memory and FIFO ports, whose addresses move with every access
+static const uint8_t volatileRegisters[] = {
+    MPU6050_RA_I2C_SLV4_CTRL, MPU6050_RA_SIGNAL_PATH_RESET, MPU6050_RA_USER_CTRL,
+    MPU6050_RA_PWR_MGMT_1, MPU6050_RA_BANK_SEL, MPU6050_RA_MEM_START_ADDR,
+    MPU6050_RA_MEM_R_W, MPU6050_RA_FIFO_R_W
+};
+
+/** Shadow the configuration registers, so bit settings cost one I2C write instead
+ * of a read and a write. Registers the device changes itself are always read.
+ * @param enabled New shadow status
+ * @see I2Cdev::enableShadow()
+ */
+void MPU6050::setShadowEnabled(bool enabled) {
+    if (enabled) {
+        I2Cdev::enableShadow(devAddr, volatileRegisters, sizeof(volatileRegisters));
+    } else {
+        I2Cdev::disableShadow(devAddr);
+    }
+}
+
 // AUX_VDDIO register (InvenSense demo code calls this RA_*G_OFFS_TC)
 
 /** Get the auxiliary I2C supply voltage level.
@@ -2358,6 +2379,7 @@ void MPU6050::resetSensors() {
  */
 void MPU6050::reset() {
     I2Cdev::writeBit(devAddr, MPU6050_RA_PWR_MGMT_1, MPU6050_PWR1_DEVICE_RESET_BIT, true);
+    I2Cdev::invalidateShadow(devAddr); // every register is back to its default
 }
 /** Get sleep mode status.
  * Setting the SLEEP bit in the register puts the device into very low power
@@ -415,6 +415,7 @@ class MPU6050 {
 
         void initialize();
         bool testConnection();
+        void setShadowEnabled(bool enabled);
 
         // AUX_VDDIO register
         uint8_t getAuxVDDIOLevel();
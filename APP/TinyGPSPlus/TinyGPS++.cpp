@@ -26,9 +26,13 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include <string.h>
 #include <ctype.h>
 #include <stdlib.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
-#define _GPRMCterm   "GPRMC"
-#define _GPGGAterm   "GPGGA"
+// Sentence types are identified by the three characters following the
+// two-character talker ID (GP, GN, GL, GA, GB...), packed into one integer
+#define _GPS_SENTENCE_ID(a, b, c) (((uint32_t)(a) << 16) | ((uint32_t)(b) << 8) | (uint32_t)(c))
 
 TinyGPSPlus::TinyGPSPlus()
   :  parity(0)
@@ -37,14 +41,104 @@ TinyGPSPlus::TinyGPSPlus()
   ,  curTermNumber(0)
   ,  curTermOffset(0)
   ,  sentenceHasFix(false)
+  ,  skipSentence(false)
+  ,  sentenceMask(SENTENCE_ALL)
+  ,  termWhole(0)
+  ,  termFraction(0)
+  ,  termFractionDigits(0)
+  ,  termHundredths(0)
+  ,  termNumberState(GPS_NUMBER_WHOLE)
+  ,  termNegative(false)
   ,  customElts(0)
   ,  customCandidates(0)
+  ,  customCursor(0)
+  ,  ubxState(UBX_IDLE)
+  ,  tapBuffer(0)
+  ,  tapSize(0)
+  ,  tapLength(0)
+  ,  tapDiscard(true)
+  ,  tapCallback(0)
+  ,  satelliteTable(0)
   ,  encodedCharCount(0)
   ,  sentencesWithFixCount(0)
   ,  failedChecksumCount(0)
   ,  passedChecksumCount(0)
+  ,  sentencesSkippedCount(0)
 {
   term[0] = '\0';
+  location.clock = date.clock = time.clock = &clock;
+  speed.clock = course.clock = altitude.clock = &clock;
+  satellites.clock = hdop.clock = pdop.clock = vdop.clock = &clock;
+}
+
+//
+// incremental number parsing
+//
+
+inline void TinyGPSPlus::resetTermNumber()
+{
+  termWhole = termFraction = 0;
+  termFractionDigits = termHundredths = 0;
+  termNumberState = GPS_NUMBER_WHOLE;
+  termNegative = false;
+}
+
+// Fold one stored term character into the term's numeric value, so that
+// endOfTermHandler never has to rescan the term with atol.  Accepts the
+// same -xxxx.yyyy forms as parseDecimal and parseDegrees and stops at the
+// first character they would stop at.
+inline void TinyGPSPlus::accumulateNumber(char c)
+{
+  uint8_t digit = (uint8_t)(c - '0');
+
+  switch(termNumberState)
+  {
+  case GPS_NUMBER_WHOLE:
+    if (digit <= 9)
+      termWhole = 10 * termWhole + digit;
+    else if (c == '.')
+      termNumberState = GPS_NUMBER_FRACTION;
+    else if (c == '-' && curTermOffset == 1)
+      termNegative = true;
+    else
+      termNumberState = GPS_NUMBER_DONE;
+    break;
+
+  case GPS_NUMBER_FRACTION:
+    if (digit > 9)
+      termNumberState = GPS_NUMBER_DONE;
+    else if (termFractionDigits < _GPS_MAX_FRACTION_DIGITS)
+    {
+      if (termFractionDigits == 0)
+        termHundredths = 10 * digit;
+      else if (termFractionDigits == 1)
+        termHundredths += digit;
+      termFraction = 10 * termFraction + digit;
+      ++termFractionDigits;
+    }
+    break;
+  }
+}
+
+// The current term as a (potentially negative) number with 2 decimal digits,
+// as parseDecimal would return it
+int32_t TinyGPSPlus::termDecimal() const
+{
+  int32_t ret = 100 * (int32_t)termWhole + termHundredths;
+  return termNegative ? -ret : ret;
+}
+
+// The current term as NMEA DDMM.MMMM degrees, as parseDegrees would return it
+void TinyGPSPlus::termDegrees(RawDegrees &deg) const
+{
+  uint32_t tenMillionthsOfMinutes = termFraction;
+  for (uint8_t i = termFractionDigits; i < _GPS_MAX_FRACTION_DIGITS; ++i)
+    tenMillionthsOfMinutes *= 10;
+  tenMillionthsOfMinutes += (termWhole % 100) * 10000000UL;
+
+  deg.deg = (int16_t)(termWhole / 100);
+  deg.billionths = (5 * tenMillionthsOfMinutes + 1) / 3;
+  deg.negative = false;
 }
 
 //
@@ -54,6 +148,25 @@ TinyGPSPlus::TinyGPSPlus()
 bool TinyGPSPlus::encode(char c)
 {
   ++encodedCharCount;
+  if (ubxState == UBX_SYNC2 && (uint8_t)c != UBX_SYNC_CHAR2)
+  {
+    // A lone 0xB5 was not the start of a UBX frame: it and this character
+    // belong to the NMEA stream
+    ubxState = UBX_IDLE;
+    encodeNmea((char)UBX_SYNC_CHAR1);
+  }
+  if (ubxState != UBX_IDLE || (uint8_t)c == UBX_SYNC_CHAR1)
+    return encodeUbx((uint8_t)c);
+  return encodeNmea(c);
+}
+
+// Process one character of an NMEA sentence
+bool TinyGPSPlus::encodeNmea(char c)
+{
+  if (skipSentence && c != '$')
+    return false;
+  if (tapBuffer != NULL)
+    tapChar(c);
 
   switch(c)
   {
@@ -71,6 +184,7 @@ bool TinyGPSPlus::encode(char c)
       }
       ++curTermNumber;
       curTermOffset = 0;
+      resetTermNumber();
       isChecksumTerm = c == '*';
       return isValidSentence;
     }
@@ -78,15 +192,20 @@ bool TinyGPSPlus::encode(char c)
 
   case '$': // sentence begin
     curTermNumber = curTermOffset = 0;
+    resetTermNumber();
     parity = 0;
     curSentenceType = GPS_SENTENCE_OTHER;
     isChecksumTerm = false;
     sentenceHasFix = false;
+    skipSentence = false;
     return false;
 
   default: // ordinary characters
     if (curTermOffset < sizeof(term) - 1)
+    {
       term[curTermOffset++] = c;
+      accumulateNumber(c);
+    }
     if (!isChecksumTerm)
       parity ^= c;
     return false;
@@ -95,9 +214,386 @@ bool TinyGPSPlus::encode(char c)
   return false;
 }
 
+// Process a block of characters.  The resulting state and statistics are
+// exactly what feeding each character to encode(char) would produce, but
+// runs of ordinary characters are copied and checksummed a span at a time.
+// Returns the number of sentences that passed their checksum.
+size_t TinyGPSPlus::encode(const char *buf, size_t len)
+{
+  size_t validSentences = 0;
+  const char *end = buf + len;
+
+  while (buf < end)
+  {
+    if (ubxState != UBX_IDLE)
+    {
+      if (encode(*buf++))
+        ++validSentences;
+      continue;
+    }
+
+    if (skipSentence)
+    {
+      // Skip to the next NMEA sentence, or UBX frame
+      const char *next = (const char *)memchr(buf, '$', end - buf);
+      if (next == NULL)
+        next = end;
+      const char *ubx = (const char *)memchr(buf, UBX_SYNC_CHAR1, next - buf);
+      if (ubx != NULL)
+        next = ubx;
+      encodedCharCount += next - buf;
+      buf = next;
+      if (buf == end)
+        break;
+    }
+
+    const char *stop = findTermDelimiter(buf, end);
+    if (stop != buf)
+    {
+      encodeRun(buf, stop - buf);
+      buf = stop;
+    }
+    if (buf < end && encode(*buf++))
+      ++validSentences;
+  }
+
+  return validSentences;
+}
+
+void TinyGPSPlus::setSentenceTap(char *buffer, uint8_t size, TinyGPSSentenceCallback callback)
+{
+  tapBuffer = size ? buffer : NULL;
+  tapSize = size;
+  tapLength = 0;
+  tapDiscard = true; // start with the next '$'
+  tapCallback = callback;
+}
+
+//
+// UBX binary protocol
+//
+
+// Feed one byte of a UBX frame (sync chars 0xB5 0x62, class, id, 16-bit
+// length, payload, Fletcher checksum).  NAV-PVT payload fields are decoded
+// straight into the same staging values the NMEA path uses, so no payload
+// buffer is needed.  Returns true when a frame passes its checksum.
+bool TinyGPSPlus::encodeUbx(uint8_t b)
+{
+  switch(ubxState)
+  {
+  case UBX_IDLE:
+    ubxState = UBX_SYNC2;
+    return false;
+
+  case UBX_SYNC2: // encode() only passes UBX_SYNC_CHAR2 on
+    ubxState = UBX_CLASS;
+    ubxCkA = ubxCkB = 0;
+    return false;
+
+  case UBX_CK_A:
+    ubxState = UBX_CK_B;
+    ubxWord = b; // the payload window is no longer needed; hold CK_A here
+    return false;
+
+  case UBX_CK_B:
+    ubxState = UBX_IDLE;
+    if (ubxWord == ubxCkA && b == ubxCkB)
+      return endOfUbxFrame();
+    ++failedChecksumCount;
+    return false;
+  }
+
+  ubxCkA += b;
+  ubxCkB += ubxCkA;
+
+  switch(ubxState)
+  {
+  case UBX_CLASS:
+    ubxClass = b;
+    ubxState = UBX_ID;
+    break;
+
+  case UBX_ID:
+    ubxId = b;
+    ubxState = UBX_LENGTH1;
+    break;
+
+  case UBX_LENGTH1:
+    ubxLength = b;
+    ubxState = UBX_LENGTH2;
+    break;
+
+  case UBX_LENGTH2:
+    ubxLength |= (uint16_t)b << 8;
+    ubxOffset = 0;
+    ubxFixType = ubxValid = 0;
+    ubxHasFix = false;
+    if (ubxLength > _GPS_MAX_UBX_PAYLOAD) // most likely a false sync
+      ubxState = UBX_IDLE;
+    else
+      ubxState = ubxLength ? UBX_PAYLOAD : UBX_CK_A;
+    break;
+
+  case UBX_PAYLOAD:
+    // Shift each byte into a little-endian window, so a field is complete
+    // in the top of ubxWord when its last byte arrives
+    ubxWord = (ubxWord >> 8) | ((uint32_t)b << 24);
+    if (ubxClass == UBX_CLASS_NAV && ubxId == UBX_ID_NAV_PVT)
+      ubxNavPvtField(ubxOffset);
+    if (++ubxOffset == ubxLength)
+      ubxState = UBX_CK_A;
+    break;
+  }
+
+  return false;
+}
+
+// Stage the NAV-PVT field whose last byte is at payload offset 'offset'
+void TinyGPSPlus::ubxNavPvtField(uint16_t offset)
+{
+  int32_t i4 = (int32_t)ubxWord;
+  uint16_t u2 = (uint16_t)(ubxWord >> 16);
+  uint8_t u1 = (uint8_t)(ubxWord >> 24);
+
+  switch(offset)
+  {
+  case 5: // year
+    date.newDate = u2 % 100;
+    break;
+  case 6: // month
+    date.newDate += 100UL * u1;
+    break;
+  case 7: // day
+    date.newDate += 10000UL * u1;
+    break;
+  case 8: // hour
+    time.newTime = 1000000UL * u1;
+    break;
+  case 9: // minute
+    time.newTime += 10000UL * u1;
+    break;
+  case 10: // second
+    time.newTime += 100UL * u1;
+    break;
+  case 11: // validity flags: bit 0 date, bit 1 time
+    ubxValid = u1;
+    break;
+  case 19: // nanoseconds, may be negative
+    if (i4 > 0)
+      time.newTime += i4 / 10000000L;
+    break;
+  case 20: // fix type: 2 = 2D, 3 = 3D, 4 = GNSS + dead reckoning
+    ubxFixType = u1;
+    break;
+  case 21: // flags: bit 0 gnssFixOK
+    ubxHasFix = (u1 & 0x01) && ubxFixType >= 2 && ubxFixType <= 4;
+    break;
+  case 23: // satellites used
+    satellites.newval = u1;
+    break;
+  case 27: // longitude, degrees x 10^7
+    fromE7(i4, location.rawNewLngData);
+    break;
+  case 31: // latitude, degrees x 10^7
+    fromE7(i4, location.rawNewLatData);
+    break;
+  case 39: // height above mean sea level, mm
+    altitude.newval = i4 / 10;
+    break;
+  case 63: // ground speed, mm/s, to hundredths of a knot
+    speed.newval = i4 * 90 / 463;
+    break;
+  case 67: // heading of motion, degrees x 10^5
+    course.newval = i4 / 1000;
+    break;
+  case 77: // position DOP x 100
+    pdop.newval = u2;
+    break;
+  }
+}
+
+// static
+void TinyGPSPlus::fromE7(int32_t e7, RawDegrees &deg)
+{
+  deg.negative = e7 < 0;
+  uint32_t a = deg.negative ? -e7 : e7;
+  deg.deg = a / 10000000UL;
+  deg.billionths = (a % 10000000UL) * 100;
+}
+
+// A UBX frame just passed its checksum
+bool TinyGPSPlus::endOfUbxFrame()
+{
+  passedChecksumCount++;
+  if (ubxClass != UBX_CLASS_NAV || ubxId != UBX_ID_NAV_PVT || ubxLength < 92)
+    return true;
+
+  if (ubxHasFix)
+    ++sentencesWithFixCount;
+  if (ubxValid & 0x02)
+  {
+    clock.advance(time.newTime);
+    time.commit();
+  }
+  if (ubxValid & 0x01)
+    date.commit();
+  if (ubxHasFix)
+  {
+    location.commit();
+    speed.commit();
+    course.commit();
+    altitude.commit();
+  }
+  satellites.commit();
+  pdop.commit();
+  return true;
+}
+
 //
 // internal utilities
 //
+
+// Copy one received character into the sentence tap buffer.  Line endings
+// are left out, so a delivered sentence runs from '$' to the checksum.
+void TinyGPSPlus::tapChar(char c)
+{
+  if (c == '$')
+  {
+    tapLength = 0;
+    tapDiscard = false;
+  }
+  else if (c == '\r' || c == '\n' || tapDiscard)
+    return;
+
+  if (tapLength < tapSize)
+    tapBuffer[tapLength++] = c;
+  else
+    tapDiscard = true;
+}
+
+// Bulk scanning helpers.  On AVR the plain byte loops are already the
+// cheapest option; wider targets compare a machine word (or an SSE2
+// register) against all five NMEA delimiters at once.
+#if !defined(__AVR__)
+typedef uintptr_t gps_word_t;
+static const gps_word_t GPS_ONES = (gps_word_t)~(gps_word_t)0 / 0xFF;
+static const gps_word_t GPS_HIGHS = GPS_ONES * 0x80;
+
+static inline gps_word_t loadWord(const char *p)
+{
+  gps_word_t w;
+  memcpy(&w, p, sizeof(w));
+  return w;
+}
+
+static inline gps_word_t hasByte(gps_word_t w, uint8_t c)
+{
+  w ^= GPS_ONES * c;
+  return (w - GPS_ONES) & ~w & GPS_HIGHS;
+}
+#endif
+
+// Delimiters, plus any non-ASCII byte so UBX sync characters reach encode(char)
+static inline bool isTermDelimiter(char c)
+{
+  return c == ',' || c == '*' || c == '\r' || c == '\n' || c == '$' || (uint8_t)c >= 0x80;
+}
+
+// static
+// Returns the first of ',', '*', '\r', '\n', '$' or a non-ASCII byte in
+// [p, end), or end.
+const char *TinyGPSPlus::findTermDelimiter(const char *p, const char *end)
+{
+#if defined(__SSE2__)
+  const __m128i comma = _mm_set1_epi8(','), star = _mm_set1_epi8('*');
+  const __m128i cr = _mm_set1_epi8('\r'), lf = _mm_set1_epi8('\n');
+  const __m128i dollar = _mm_set1_epi8('$');
+  for (; end - p >= 16; p += 16)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i hit = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(v, comma), _mm_cmpeq_epi8(v, star)),
+      _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf)),
+                   _mm_cmpeq_epi8(v, dollar)));
+    int mask = _mm_movemask_epi8(hit) | _mm_movemask_epi8(v);
+    if (mask)
+      return p + __builtin_ctz(mask);
+  }
+#elif !defined(__AVR__)
+  for (; (size_t)(end - p) >= sizeof(gps_word_t); p += sizeof(gps_word_t))
+  {
+    gps_word_t w = loadWord(p);
+    if (hasByte(w, ',') | hasByte(w, '*') | hasByte(w, '\r') | hasByte(w, '\n') | hasByte(w, '$') | (w & GPS_HIGHS))
+      break;
+  }
+#endif
+  while (p < end && !isTermDelimiter(*p))
+    ++p;
+  return p;
+}
+
+// static
+// XOR of every byte in [p, p + len)
+uint8_t TinyGPSPlus::xorSpan(const char *p, size_t len)
+{
+  uint8_t x = 0;
+#if !defined(__AVR__)
+  if (len >= sizeof(gps_word_t))
+  {
+    gps_word_t w = 0;
+    for (; len >= sizeof(gps_word_t); len -= sizeof(gps_word_t), p += sizeof(gps_word_t))
+      w ^= loadWord(p);
+    for (unsigned shift = 0; shift < 8 * sizeof(gps_word_t); shift += 8)
+      x ^= (uint8_t)(w >> shift);
+  }
+#endif
+  while (len--)
+    x ^= (uint8_t)*p++;
+  return x;
+}
+
+// Consume a run of ordinary (non-delimiter) characters in one step
+void TinyGPSPlus::encodeRun(const char *run, size_t len)
+{
+  encodedCharCount += len;
+
+  if (tapBuffer != NULL && !tapDiscard)
+  {
+    if (len <= (size_t)(tapSize - tapLength))
+    {
+      memcpy(tapBuffer + tapLength, run, len);
+      tapLength += len;
+    }
+    else
+      tapDiscard = true;
+  }
+
+  size_t room = curTermOffset < sizeof(term) - 1 ? sizeof(term) - 1 - curTermOffset : 0;
+  if (len <= room)
+  {
+    // The common case: the whole run fits in the term buffer, so copy
+    // and checksum it in the same pass
+    uint8_t x = 0;
+    for (size_t i = 0; i < len; ++i)
+    {
+      term[curTermOffset++] = run[i];
+      accumulateNumber(run[i]);
+      x ^= (uint8_t)run[i];
+    }
+    if (!isChecksumTerm)
+      parity ^= x;
+    return;
+  }
+
+  for (size_t i = 0; i < room; ++i)
+  {
+    term[curTermOffset++] = run[i];
+    accumulateNumber(run[i]);
+  }
+  if (!isChecksumTerm)
+    parity ^= xorSpan(run, len);
+}
+
 int TinyGPSPlus::fromHex(char a)
 {
   if (a >= 'A' && a <= 'F')
@@ -125,6 +621,25 @@ int32_t TinyGPSPlus::parseDecimal(const char *term)
   return negative ? -ret : ret;
 }
 
+// static
+// Map a sentence header such as "GPRMC" or "GNGGA" to its sentence type,
+// regardless of talker ID
+uint8_t TinyGPSPlus::sentenceTypeOf(const char *term)
+{
+  if (!term[0] || !term[1] || !term[2] || !term[3] || !term[4] || term[5])
+    return GPS_SENTENCE_OTHER;
+
+  switch(_GPS_SENTENCE_ID(term[2], term[3], term[4]))
+  {
+  case _GPS_SENTENCE_ID('G', 'G', 'A'): return GPS_SENTENCE_GGA;
+  case _GPS_SENTENCE_ID('R', 'M', 'C'): return GPS_SENTENCE_RMC;
+  case _GPS_SENTENCE_ID('G', 'S', 'A'): return GPS_SENTENCE_GSA;
+  case _GPS_SENTENCE_ID('G', 'S', 'V'): return GPS_SENTENCE_GSV;
+  case _GPS_SENTENCE_ID('V', 'T', 'G'): return GPS_SENTENCE_VTG;
+  default: return GPS_SENTENCE_OTHER;
+  }
+}
+
 // static
 // Parse degrees in that funny NMEA format DDMM.MMMM
 void TinyGPSPlus::parseDegrees(const char *term, RawDegrees &deg)
@@ -168,7 +683,8 @@ bool TinyGPSPlus::endOfTermHandler()
 
       switch(curSentenceType)
       {
-      case GPS_SENTENCE_GPRMC:
+      case GPS_SENTENCE_RMC:
+        clock.advance(time.newTime);
         date.commit();
         time.commit();
         if (sentenceHasFix)
@@ -178,7 +694,8 @@ bool TinyGPSPlus::endOfTermHandler()
            course.commit();
         }
         break;
-      case GPS_SENTENCE_GPGGA:
+      case GPS_SENTENCE_GGA:
+        clock.advance(time.newTime);
         time.commit();
         if (sentenceHasFix)
         {
@@ -188,11 +705,36 @@ bool TinyGPSPlus::endOfTermHandler()
         satellites.commit();
         hdop.commit();
         break;
+      case GPS_SENTENCE_GSA:
+        if (sentenceHasFix)
+        {
+          pdop.commit();
+          hdop.commit();
+          vdop.commit();
+        }
+        break;
+      case GPS_SENTENCE_VTG:
+        if (sentenceHasFix)
+        {
+          speed.commit();
+          course.commit();
+        }
+        break;
+      case GPS_SENTENCE_GSV:
+        if (satelliteTable != NULL)
+          satelliteTable->commit(curTermNumber);
+        break;
       }
 
       // Commit all custom listeners of this sentence type
-      for (TinyGPSCustom *p = customCandidates; p != NULL && strcmp(p->sentenceName, customCandidates->sentenceName) == 0; p = p->next)
+      for (TinyGPSCustom *p = customCandidates; p != NULL; p = p->next)
          p->commit();
+
+      if (tapCallback != NULL && !tapDiscard)
+      {
+        tapDiscard = true;
+        tapCallback(tapBuffer, tapLength);
+      }
       return true;
     }
 
@@ -207,17 +749,21 @@ bool TinyGPSPlus::endOfTermHandler()
   // the first term determines the sentence type
   if (curTermNumber == 0)
   {
-    if (!strcmp(term, _GPRMCterm))
-      curSentenceType = GPS_SENTENCE_GPRMC;
-    else if (!strcmp(term, _GPGGAterm))
-      curSentenceType = GPS_SENTENCE_GPGGA;
-    else
-      curSentenceType = GPS_SENTENCE_OTHER;
+    curSentenceType = sentenceTypeOf(term);
+    if (curSentenceType == GPS_SENTENCE_GSV && satelliteTable != NULL)
+      satelliteTable->beginSentence(TinyGPSSatellites::constellationOf(term));
 
     // Any custom candidates of this sentence type?
-    for (customCandidates = customElts; customCandidates != NULL && strcmp(customCandidates->sentenceName, term) < 0; customCandidates = customCandidates->next);
-    if (customCandidates != NULL && strcmp(customCandidates->sentenceName, term) > 0)
-       customCandidates = NULL;
+    for (customCandidates = customElts; customCandidates != NULL && strcmp(customCandidates->sentenceName, term) != 0; customCandidates = customCandidates->nextSentence);
+    customCursor = customCandidates;
+
+    // Nobody wants this sentence: ignore everything up to the next '$'
+    if (!(sentenceMask & (1 << curSentenceType)) && customCandidates == NULL &&
+        (curSentenceType != GPS_SENTENCE_GSV || satelliteTable == NULL))
+    {
+      skipSentence = true;
+      ++sentencesSkippedCount;
+    }
 
     return false;
   }
@@ -225,56 +771,81 @@ bool TinyGPSPlus::endOfTermHandler()
   if (curSentenceType != GPS_SENTENCE_OTHER && term[0])
     switch(COMBINE(curSentenceType, curTermNumber))
   {
-    case COMBINE(GPS_SENTENCE_GPRMC, 1): // Time in both sentences
-    case COMBINE(GPS_SENTENCE_GPGGA, 1):
-      time.setTime(term);
+    case COMBINE(GPS_SENTENCE_RMC, 1): // Time in both sentences
+    case COMBINE(GPS_SENTENCE_GGA, 1):
+      time.setTime((uint32_t)termDecimal());
       break;
-    case COMBINE(GPS_SENTENCE_GPRMC, 2): // GPRMC validity
+    case COMBINE(GPS_SENTENCE_RMC, 2): // RMC validity
       sentenceHasFix = term[0] == 'A';
       break;
-    case COMBINE(GPS_SENTENCE_GPRMC, 3): // Latitude
-    case COMBINE(GPS_SENTENCE_GPGGA, 2):
-      location.setLatitude(term);
+    case COMBINE(GPS_SENTENCE_RMC, 3): // Latitude
+    case COMBINE(GPS_SENTENCE_GGA, 2):
+      termDegrees(location.rawNewLatData);
       break;
-    case COMBINE(GPS_SENTENCE_GPRMC, 4): // N/S
-    case COMBINE(GPS_SENTENCE_GPGGA, 3):
+    case COMBINE(GPS_SENTENCE_RMC, 4): // N/S
+    case COMBINE(GPS_SENTENCE_GGA, 3):
       location.rawNewLatData.negative = term[0] == 'S';
       break;
-    case COMBINE(GPS_SENTENCE_GPRMC, 5): // Longitude
-    case COMBINE(GPS_SENTENCE_GPGGA, 4):
-      location.setLongitude(term);
+    case COMBINE(GPS_SENTENCE_RMC, 5): // Longitude
+    case COMBINE(GPS_SENTENCE_GGA, 4):
+      termDegrees(location.rawNewLngData);
       break;
-    case COMBINE(GPS_SENTENCE_GPRMC, 6): // E/W
-    case COMBINE(GPS_SENTENCE_GPGGA, 5):
+    case COMBINE(GPS_SENTENCE_RMC, 6): // E/W
+    case COMBINE(GPS_SENTENCE_GGA, 5):
       location.rawNewLngData.negative = term[0] == 'W';
       break;
-    case COMBINE(GPS_SENTENCE_GPRMC, 7): // Speed (GPRMC)
-      speed.set(term);
+    case COMBINE(GPS_SENTENCE_RMC, 7): // Speed (RMC)
+      speed.set(termDecimal());
       break;
-    case COMBINE(GPS_SENTENCE_GPRMC, 8): // Course (GPRMC)
-      course.set(term);
+    case COMBINE(GPS_SENTENCE_RMC, 8): // Course (RMC)
+    case COMBINE(GPS_SENTENCE_VTG, 1): // True course (VTG)
+      course.set(termDecimal());
       break;
-    case COMBINE(GPS_SENTENCE_GPRMC, 9): // Date (GPRMC)
-      date.setDate(term);
+    case COMBINE(GPS_SENTENCE_RMC, 9): // Date (RMC)
+      date.setDate(termWhole);
       break;
-    case COMBINE(GPS_SENTENCE_GPGGA, 6): // Fix data (GPGGA)
+    case COMBINE(GPS_SENTENCE_GGA, 6): // Fix data (GGA)
       sentenceHasFix = term[0] > '0';
       break;
-    case COMBINE(GPS_SENTENCE_GPGGA, 7): // Satellites used (GPGGA)
-      satellites.set(term);
+    case COMBINE(GPS_SENTENCE_GGA, 7): // Satellites used (GGA)
+      satellites.set(termWhole);
+      break;
+    case COMBINE(GPS_SENTENCE_GGA, 8): // HDOP
+    case COMBINE(GPS_SENTENCE_GSA, 16):
+      hdop.set(termDecimal());
+      break;
+    case COMBINE(GPS_SENTENCE_GGA, 9): // Altitude (GGA)
+      altitude.set(termDecimal());
       break;
-    case COMBINE(GPS_SENTENCE_GPGGA, 8): // HDOP
-      hdop.set(term);
+    case COMBINE(GPS_SENTENCE_GSA, 2): // Fix mode (GSA): 1 = none, 2 = 2D, 3 = 3D
+      sentenceHasFix = term[0] > '1';
       break;
-    case COMBINE(GPS_SENTENCE_GPGGA, 9): // Altitude (GPGGA)
-      altitude.set(term);
+    case COMBINE(GPS_SENTENCE_GSA, 15): // PDOP (GSA)
+      pdop.set(termDecimal());
+      break;
+    case COMBINE(GPS_SENTENCE_GSA, 17): // VDOP (GSA)
+      vdop.set(termDecimal());
+      break;
+    case COMBINE(GPS_SENTENCE_VTG, 5): // Speed in knots (VTG); left empty when there is no fix
+      speed.set(termDecimal());
+      sentenceHasFix = true;
+      break;
+    case COMBINE(GPS_SENTENCE_VTG, 9): // Mode indicator (VTG, NMEA 2.3+)
+      sentenceHasFix = term[0] != 'N';
+      break;
+    default:
+      // Message number, satellites in view and per-satellite fields (GSV)
+      if (curSentenceType == GPS_SENTENCE_GSV && curTermNumber >= 2 && satelliteTable != NULL)
+        satelliteTable->set(curTermNumber, termNegative ? -(int32_t)termWhole : (int32_t)termWhole);
       break;
   }
 
-  // Set custom values as needed
-  for (TinyGPSCustom *p = customCandidates; p != NULL && strcmp(p->sentenceName, customCandidates->sentenceName) == 0 && p->termNumber <= curTermNumber; p = p->next)
-    if (p->termNumber == curTermNumber)
-         p->set(term);
+  // Set custom values as needed.  Candidates are sorted by term number and
+  // terms arrive in order, so the cursor only ever moves forward.
+  while (customCursor != NULL && customCursor->termNumber < curTermNumber)
+    customCursor = customCursor->next;
+  for (TinyGPSCustom *p = customCursor; p != NULL && p->termNumber == curTermNumber; p = p->next)
+    p->set(term);
 
   return false;
 }
@@ -332,22 +903,172 @@ const char *TinyGPSPlus::cardinal(double course)
   return directions[direction % 16];
 }
 
-void TinyGPSLocation::commit()
+// Move the sentence clock forward to a just-validated UTC time (hhmmsscc).
+// Times are turned into a count that never runs backwards: a step back of
+// more than 12 hours is taken as crossing midnight, a smaller one (e.g.
+// GGA and RMC for the same fix arriving out of order) is ignored.
+void TinyGPSClock::advance(uint32_t hhmmsscc)
 {
-   rawLatData = rawNewLatData;
-   rawLngData = rawNewLngData;
-   lastCommitTime = millis();
-   valid = updated = true;
+   uint32_t timeOfDay = (hhmmsscc / 1000000) * 3600000UL + ((hhmmsscc / 10000) % 100) * 60000UL +
+      ((hhmmsscc / 100) % 100) * 1000UL + (hhmmsscc % 100) * 10UL;
+
+   if (!sentenceTimeValid)
+   {
+      sentenceMillis = timeOfDay;
+      sentenceTimeValid = true;
+   }
+   else if (timeOfDay >= sentenceTimeOfDay)
+      sentenceMillis += timeOfDay - sentenceTimeOfDay;
+   else if (sentenceTimeOfDay - timeOfDay > 43200000UL)
+      sentenceMillis += timeOfDay + 86400000UL - sentenceTimeOfDay;
+   else
+      return;
+
+   sentenceTimeOfDay = timeOfDay;
+}
+
+static int32_t toE7(const RawDegrees &raw)
+{
+   int32_t ret = raw.deg * 10000000L + (int32_t)((raw.billionths + 50) / 100);
+   return raw.negative ? -ret : ret;
+}
+
+// cos() of 0, 2, 4 ... 90 degrees, scaled by 65536
+static const uint16_t cosTable[46] = {
+   65535, 65496, 65376, 65177, 64898, 64540, 64104, 63589, 62997, 62328,
+   61584, 60764, 59870, 58903, 57865, 56756, 55578, 54332, 53020, 51643,
+   50203, 48703, 47143, 45525, 43852, 42126, 40348, 38521, 36647, 34729,
+   32768, 30767, 28729, 26656, 24550, 22415, 20252, 18064, 15855, 13626,
+   11380,  9121,  6850,  4572,  2287,     0};
+
+// atan(2^-i) in thousandths of a degree, for the CORDIC in courseToE7
+static const int32_t atanTable[16] = {
+   45000, 26565, 14036, 7125, 3576, 1790, 895, 448, 224, 112, 56, 28, 14, 7, 3, 2};
+
+// cos() of a latitude in degrees x 10^7, scaled by 65536
+static uint32_t cosE7(int32_t latE7)
+{
+   uint32_t a = latE7 < 0 ? -latE7 : latE7;
+   if (a >= 900000000UL)
+      return 0;
+   uint8_t i = a / 20000000UL;
+   uint16_t frac = (a % 20000000UL) / 10000; // 0..1999
+   return cosTable[i] - (uint32_t)(cosTable[i] - cosTable[i + 1]) * frac / 2000;
+}
+
+static uint32_t isqrt64(uint64_t v)
+{
+   uint64_t bit = (uint64_t)1 << 62, ret = 0;
+   while (bit > v)
+      bit >>= 2;
+   for (; bit; bit >>= 2)
+   {
+      if (v >= ret + bit)
+      {
+         v -= ret + bit;
+         ret = (ret >> 1) + bit;
+      }
+      else
+         ret >>= 1;
+   }
+   return (uint32_t)ret;
 }
 
-void TinyGPSLocation::setLatitude(const char *term)
+// Flat-earth offsets between two points in degrees x 10^7: north along
+// the meridian and east along the parallel at their mean latitude.
+// Returns false if they are too far apart for that to be accurate.
+static bool flatEarthOffsetE7(int32_t lat1, int32_t long1, int32_t lat2, int32_t long2, int32_t &north, int32_t &east)
 {
-   TinyGPSPlus::parseDegrees(term, rawNewLatData);
+   int64_t dlon = (int64_t)long2 - long1;
+   if (dlon > 1800000000L)
+      dlon -= 3600000000LL;
+   else if (dlon < -1800000000L)
+      dlon += 3600000000LL;
+   north = lat2 - lat1;
+   if (north > _GPS_FLAT_EARTH_LIMIT_E7 || north < -_GPS_FLAT_EARTH_LIMIT_E7 ||
+       dlon > _GPS_FLAT_EARTH_LIMIT_E7 || dlon < -_GPS_FLAT_EARTH_LIMIT_E7)
+      return false;
+   east = (int32_t)((dlon * (int32_t)cosE7(lat1 / 2 + lat2 / 2) + 0x8000) >> 16);
+   return true;
 }
 
-void TinyGPSLocation::setLongitude(const char *term)
+/* static */
+uint32_t TinyGPSPlus::distanceBetweenE7(int32_t lat1, int32_t long1, int32_t lat2, int32_t long2)
 {
-   TinyGPSPlus::parseDegrees(term, rawNewLngData);
+  // returns distance in meters between two positions, both specified as
+  // signed degrees x 10^7 (see TinyGPSLocation::latE7()). Uses integer math
+  // only: an equirectangular projection, within 0.1% of distanceBetween()
+  // for separations up to _GPS_FLAT_EARTH_LIMIT_E7. Anything farther apart
+  // falls back to distanceBetween().
+  int32_t north, east;
+  if (!flatEarthOffsetE7(lat1, long1, lat2, long2, north, east))
+    return (uint32_t)(distanceBetween(lat1 / 1e7, long1 / 1e7, lat2 / 1e7, long2 / 1e7) + 0.5);
+
+  uint32_t d = isqrt64((uint64_t)((int64_t)north * north + (int64_t)east * east));
+  // 6372795 m sphere: 0.0111226 meters per 10^-7 degree, scaled by 2^22
+  return (uint32_t)(((uint64_t)d * 46652 + (1UL << 21)) >> 22);
+}
+
+/* static */
+uint16_t TinyGPSPlus::courseToE7(int32_t lat1, int32_t long1, int32_t lat2, int32_t long2)
+{
+  // returns course in hundredths of a degree (North=0, West=27000) from
+  // position 1 to position 2, both specified as signed degrees x 10^7.
+  // Integer-only for the same separations as distanceBetweenE7(); the
+  // bearing of the flat-earth offset is found by CORDIC.  That is the
+  // bearing at the middle of the path rather than at its start, within
+  // 0.55 degree of courseTo() up to 85 degrees latitude.
+  int32_t north, east;
+  if (!flatEarthOffsetE7(lat1, long1, lat2, long2, north, east))
+    return (uint16_t)(courseTo(lat1 / 1e7, long1 / 1e7, lat2 / 1e7, long2 / 1e7) * 100 + 0.5) % 36000;
+  if (north == 0 && east == 0)
+    return 0;
+
+  int32_t angle = 0; // thousandths of a degree
+  if (north < 0)
+  {
+    north = -north;
+    east = -east;
+    angle = 180000L;
+  }
+
+  // Scale up tiny offsets so the shifts below keep their precision
+  while (north < (1L << 26) && east < (1L << 26) && east > -(1L << 26))
+  {
+    north <<= 1;
+    east <<= 1;
+  }
+
+  for (uint8_t i = 0; i < 16; ++i)
+  {
+    int32_t n = north;
+    if (east > 0)
+    {
+      north += east >> i;
+      east -= n >> i;
+      angle += atanTable[i];
+    }
+    else
+    {
+      north -= east >> i;
+      east += n >> i;
+      angle -= atanTable[i];
+    }
+  }
+
+  if (angle < 0)
+    angle += 360000L;
+  return (uint16_t)(((angle + 5) / 10) % 36000);
+}
+
+void TinyGPSLocation::commit()
+{
+   rawLatData = rawNewLatData;
+   rawLngData = rawNewLngData;
+   latE7Data = toE7(rawLatData);
+   lngE7Data = toE7(rawLngData);
+   lastCommitTime = clock->now();
+   valid = updated = true;
 }
 
 double TinyGPSLocation::lat()
@@ -367,27 +1088,17 @@ double TinyGPSLocation::lng()
 void TinyGPSDate::commit()
 {
    date = newDate;
-   lastCommitTime = millis();
+   lastCommitTime = clock->now();
    valid = updated = true;
 }
 
 void TinyGPSTime::commit()
 {
    time = newTime;
-   lastCommitTime = millis();
+   lastCommitTime = clock->now();
    valid = updated = true;
 }
 
-void TinyGPSTime::setTime(const char *term)
-{
-   newTime = (uint32_t)TinyGPSPlus::parseDecimal(term);
-}
-
-void TinyGPSDate::setDate(const char *term)
-{
-   newDate = atol(term);
-}
-
 uint16_t TinyGPSDate::year()
 {
    updated = false;
@@ -434,25 +1145,122 @@ uint8_t TinyGPSTime::centisecond()
 void TinyGPSDecimal::commit()
 {
    val = newval;
-   lastCommitTime = millis();
+   lastCommitTime = clock->now();
    valid = updated = true;
 }
 
-void TinyGPSDecimal::set(const char *term)
-{
-   newval = TinyGPSPlus::parseDecimal(term);
-}
-
 void TinyGPSInteger::commit()
 {
    val = newval;
-   lastCommitTime = millis();
+   lastCommitTime = clock->now();
    valid = updated = true;
 }
 
-void TinyGPSInteger::set(const char *term)
+TinyGPSSatellites::TinyGPSSatellites(TinyGPSPlus &gps)
+   :  stagingConstellation(CONSTELLATION_COUNT)
+   ,  stagingMessage(0)
+   ,  stagingInView(0)
+   ,  lastCommitTime(0)
+   ,  clock(&gps.clock)
+   ,  valid(false)
+   ,  updated(false)
 {
-   newval = atol(term);
+   memset(table, 0, sizeof(table));
+   memset(inViewCount, 0, sizeof(inViewCount));
+   memset(staging, 0, sizeof(staging));
+   gps.satelliteTable = this;
+}
+
+uint8_t TinyGPSSatellites::inView(uint8_t constellation) const
+{
+   return constellation < CONSTELLATION_COUNT ? inViewCount[constellation] : 0;
+}
+
+// Returns a copy of one table entry and clears its updated flag.  Entries at
+// or beyond inView() are left over from earlier cycles.
+TinyGPSSatellite TinyGPSSatellites::satellite(uint8_t constellation, uint8_t index)
+{
+   updated = false;
+   if (constellation >= CONSTELLATION_COUNT || index >= _GPS_MAX_SATELLITES)
+   {
+      TinyGPSSatellite empty = {0, 0, 0, 0, false};
+      return empty;
+   }
+   TinyGPSSatellite ret = table[constellation][index];
+   table[constellation][index].updated = false;
+   return ret;
+}
+
+// static
+// Map the talker ID of a GSV header ("GPGSV", "GLGSV"...) to a constellation
+uint8_t TinyGPSSatellites::constellationOf(const char *talker)
+{
+   if (talker[0] == 'G')
+      switch(talker[1])
+      {
+      case 'P': return CONSTELLATION_GPS;
+      case 'L': return CONSTELLATION_GLONASS;
+      case 'A': return CONSTELLATION_GALILEO;
+      case 'B': return CONSTELLATION_BEIDOU;
+      }
+   else if (talker[0] == 'B' && talker[1] == 'D')
+      return CONSTELLATION_BEIDOU;
+   return CONSTELLATION_COUNT;
+}
+
+void TinyGPSSatellites::beginSentence(uint8_t constellation)
+{
+   stagingConstellation = constellation;
+   stagingMessage = stagingInView = 0;
+   memset(staging, 0, sizeof(staging));
+}
+
+// Stage one GSV term: 2 = message number, 3 = satellites in view, then
+// PRN, elevation, azimuth and SNR for each of up to four satellites.
+// NMEA 4.10 adds a signal ID as the last term.
+void TinyGPSSatellites::set(uint8_t termNumber, int32_t value)
+{
+   if (termNumber == 2)
+      stagingMessage = (uint8_t)value;
+   else if (termNumber == 3)
+      stagingInView = (uint8_t)value;
+   else if (termNumber >= 4 && termNumber < 4 + 4 * 4)
+   {
+      TinyGPSSatellite &sat = staging[(termNumber - 4) / 4];
+      switch((termNumber - 4) % 4)
+      {
+      case 0: sat.prn = (uint8_t)value; break;
+      case 1: sat.elevation = (int8_t)value; break;
+      case 2: sat.azimuth = (uint16_t)value; break;
+      case 3: sat.snr = (uint8_t)value; break;
+      }
+   }
+}
+
+// Commit a GSV sentence of termCount terms (the '*' ends term termCount - 1).
+// Empty terms are never set, so the count has to come from the sentence:
+// a satellite in view but not tracked has no SNR, and may be the last term.
+void TinyGPSSatellites::commit(uint8_t termCount)
+{
+   if (stagingConstellation >= CONSTELLATION_COUNT || stagingMessage == 0)
+      return;
+
+   // Only complete groups of four terms are satellites; a lone term after
+   // them is the NMEA 4.10 signal ID, which landed in the next PRN slot
+   uint8_t count = termCount > 4 ? (termCount - 4) / 4 : 0;
+   for (uint8_t i = count; i < 4; ++i)
+      memset(&staging[i], 0, sizeof(staging[i]));
+
+   inViewCount[stagingConstellation] = stagingInView;
+   uint8_t first = 4 * (stagingMessage - 1);
+   for (uint8_t i = 0; i < 4 && first + i < _GPS_MAX_SATELLITES; ++i)
+   {
+      table[stagingConstellation][first + i] = staging[i];
+      table[stagingConstellation][first + i].updated = true;
+   }
+
+   lastCommitTime = clock->now();
+   valid = updated = true;
 }
 
 TinyGPSCustom::TinyGPSCustom(TinyGPSPlus &gps, const char *_sentenceName, int _termNumber)
@@ -463,6 +1271,7 @@ TinyGPSCustom::TinyGPSCustom(TinyGPSPlus &gps, const char *_sentenceName, int _t
 void TinyGPSCustom::begin(TinyGPSPlus &gps, const char *_sentenceName, int _termNumber)
 {
    lastCommitTime = 0;
+   clock = &gps.clock;
    updated = valid = false;
    sentenceName = _sentenceName;
    termNumber = _termNumber;
@@ -476,7 +1285,7 @@ void TinyGPSCustom::begin(TinyGPSPlus &gps, const char *_sentenceName, int _term
 void TinyGPSCustom::commit()
 {
    strcpy(this->buffer, this->stagingBuffer);
-   lastCommitTime = millis();
+   lastCommitTime = clock->now();
    valid = updated = true;
 }
 
@@ -487,15 +1296,28 @@ void TinyGPSCustom::set(const char *term)
 
 void TinyGPSPlus::insertCustom(TinyGPSCustom *pElt, const char *sentenceName, int termNumber)
 {
-   TinyGPSCustom **ppelt;
+   TinyGPSCustom **ppHead;
 
-   for (ppelt = &this->customElts; *ppelt != NULL; ppelt = &(*ppelt)->next)
-   {
-      int cmp = strcmp(sentenceName, (*ppelt)->sentenceName);
-      if (cmp < 0 || (cmp == 0 && termNumber < (*ppelt)->termNumber))
+   // Find the group of listeners for this sentence, or start a new one
+   for (ppHead = &this->customElts; *ppHead != NULL; ppHead = &(*ppHead)->nextSentence)
+      if (strcmp(sentenceName, (*ppHead)->sentenceName) == 0)
          break;
+
+   pElt->nextSentence = NULL;
+   if (*ppHead == NULL || termNumber < (*ppHead)->termNumber)
+   {
+      // New head of its group
+      pElt->next = *ppHead;
+      if (*ppHead != NULL)
+         pElt->nextSentence = (*ppHead)->nextSentence;
+      *ppHead = pElt;
+      return;
    }
 
-   pElt->next = *ppelt;
-   *ppelt = pElt;
+   // Keep the rest of the group sorted by term number
+   TinyGPSCustom *p = *ppHead;
+   while (p->next != NULL && p->next->termNumber <= termNumber)
+      p = p->next;
+   pElt->next = p->next;
+   p->next = pElt;
 }
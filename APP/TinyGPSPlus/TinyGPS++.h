@@ -38,7 +38,11 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #define _GPS_MILES_PER_METER 0.00062137112
 #define _GPS_KM_PER_METER 0.001
 #define _GPS_FEET_PER_METER 3.2808399
+#define _GPS_FLAT_EARTH_LIMIT_E7 10000000L // largest separation (1 degree) handled by the integer geodesy
 #define _GPS_MAX_FIELD_SIZE 15
+#define _GPS_MAX_FRACTION_DIGITS 7
+#define _GPS_MAX_UBX_PAYLOAD 512 // longer UBX frames are taken as false syncs
+#define _GPS_MAX_SATELLITES 12 // GSV table entries per constellation; sizes TinyGPSSatellites, so change it here
 
 struct RawDegrees
 {
@@ -50,28 +54,55 @@ public:
    {}
 };
 
+// Timestamp source behind every commit() and age() of one TinyGPSPlus
+// object (its clock member).  Defaults to millis(); host tools replaying
+// recorded NMEA can install their own source, or useSentenceTime() to
+// measure ages in GPS time rather than wall time.
+class TinyGPSClock
+{
+public:
+   typedef uint32_t (*Source)();
+   TinyGPSClock() : source(0), sentenceMode(false), sentenceMillis(0), sentenceTimeOfDay(0), sentenceTimeValid(false)
+   {}
+
+   void set(Source s)            { source = s; sentenceMode = false; }
+   void useSentenceTime()        { sentenceMode = true; }
+   uint32_t now() const          { return sentenceMode ? sentenceMillis : source ? source() : millis(); }
+   uint32_t sentenceTime() const { return sentenceMillis; } // ms, following the UTC time of parsed sentences
+
+private:
+   Source source;
+   bool sentenceMode;
+   uint32_t sentenceMillis, sentenceTimeOfDay;
+   bool sentenceTimeValid;
+   void advance(uint32_t hhmmsscc);
+   friend class TinyGPSPlus;
+};
+
 struct TinyGPSLocation
 {
    friend class TinyGPSPlus;
 public:
    bool isValid() const    { return valid; }
    bool isUpdated() const  { return updated; }
-   uint32_t age() const    { return valid ? millis() - lastCommitTime : (uint32_t)ULONG_MAX; }
+   uint32_t age() const    { return valid ? clock->now() - lastCommitTime : (uint32_t)ULONG_MAX; }
    const RawDegrees &rawLat()     { updated = false; return rawLatData; }
    const RawDegrees &rawLng()     { updated = false; return rawLngData; }
    double lat();
    double lng();
+   int32_t latE7()                { updated = false; return latE7Data; } // signed degrees x 10^7
+   int32_t lngE7()                { updated = false; return lngE7Data; }
 
-   TinyGPSLocation() : valid(false), updated(false)
+   TinyGPSLocation() : valid(false), updated(false), latE7Data(0), lngE7Data(0)
    {}
 
 private:
    bool valid, updated;
    RawDegrees rawLatData, rawLngData, rawNewLatData, rawNewLngData;
+   int32_t latE7Data, lngE7Data;
    uint32_t lastCommitTime;
+   const TinyGPSClock *clock;
    void commit();
-   void setLatitude(const char *term);
-   void setLongitude(const char *term);
 };
 
 struct TinyGPSDate
@@ -80,7 +111,7 @@ struct TinyGPSDate
 public:
    bool isValid() const       { return valid; }
    bool isUpdated() const     { return updated; }
-   uint32_t age() const       { return valid ? millis() - lastCommitTime : (uint32_t)ULONG_MAX; }
+   uint32_t age() const       { return valid ? clock->now() - lastCommitTime : (uint32_t)ULONG_MAX; }
 
    uint32_t value()           { updated = false; return date; }
    uint16_t year();
@@ -94,8 +125,9 @@ private:
    bool valid, updated;
    uint32_t date, newDate;
    uint32_t lastCommitTime;
+   const TinyGPSClock *clock;
    void commit();
-   void setDate(const char *term);
+   void setDate(uint32_t value)  { newDate = value; }
 };
 
 struct TinyGPSTime
@@ -104,7 +136,7 @@ struct TinyGPSTime
 public:
    bool isValid() const       { return valid; }
    bool isUpdated() const     { return updated; }
-   uint32_t age() const       { return valid ? millis() - lastCommitTime : (uint32_t)ULONG_MAX; }
+   uint32_t age() const       { return valid ? clock->now() - lastCommitTime : (uint32_t)ULONG_MAX; }
 
    uint32_t value()           { updated = false; return time; }
    uint8_t hour();
@@ -119,8 +151,9 @@ private:
    bool valid, updated;
    uint32_t time, newTime;
    uint32_t lastCommitTime;
+   const TinyGPSClock *clock;
    void commit();
-   void setTime(const char *term);
+   void setTime(uint32_t value)  { newTime = value; }
 };
 
 struct TinyGPSDecimal
@@ -129,7 +162,7 @@ struct TinyGPSDecimal
 public:
    bool isValid() const    { return valid; }
    bool isUpdated() const  { return updated; }
-   uint32_t age() const    { return valid ? millis() - lastCommitTime : (uint32_t)ULONG_MAX; }
+   uint32_t age() const    { return valid ? clock->now() - lastCommitTime : (uint32_t)ULONG_MAX; }
    int32_t value()         { updated = false; return val; }
 
    TinyGPSDecimal() : valid(false), updated(false), val(0)
@@ -138,9 +171,10 @@ public:
 private:
    bool valid, updated;
    uint32_t lastCommitTime;
+   const TinyGPSClock *clock;
    int32_t val, newval;
    void commit();
-   void set(const char *term);
+   void set(int32_t value)  { newval = value; }
 };
 
 struct TinyGPSInteger
@@ -149,7 +183,7 @@ struct TinyGPSInteger
 public:
    bool isValid() const    { return valid; }
    bool isUpdated() const  { return updated; }
-   uint32_t age() const    { return valid ? millis() - lastCommitTime : (uint32_t)ULONG_MAX; }
+   uint32_t age() const    { return valid ? clock->now() - lastCommitTime : (uint32_t)ULONG_MAX; }
    uint32_t value()        { updated = false; return val; }
 
    TinyGPSInteger() : valid(false), updated(false), val(0)
@@ -158,9 +192,10 @@ public:
 private:
    bool valid, updated;
    uint32_t lastCommitTime;
+   const TinyGPSClock *clock;
    uint32_t val, newval;
    void commit();
-   void set(const char *term);
+   void set(uint32_t value) { newval = value; }
 };
 
 struct TinyGPSSpeed : TinyGPSDecimal
@@ -194,7 +229,7 @@ public:
 
    bool isUpdated() const  { return updated; }
    bool isValid() const    { return valid; }
-   uint32_t age() const    { return valid ? millis() - lastCommitTime : (uint32_t)ULONG_MAX; }
+   uint32_t age() const    { return valid ? clock->now() - lastCommitTime : (uint32_t)ULONG_MAX; }
    const char *value()     { updated = false; return buffer; }
 
 private:
@@ -204,20 +239,75 @@ private:
    char stagingBuffer[_GPS_MAX_FIELD_SIZE + 1];
    char buffer[_GPS_MAX_FIELD_SIZE + 1];
    unsigned long lastCommitTime;
+   const TinyGPSClock *clock;
    bool valid, updated;
    const char *sentenceName;
    int termNumber;
    friend class TinyGPSPlus;
-   TinyGPSCustom *next;
+   TinyGPSCustom *next;         // next listener of the same sentence, by term number
+   TinyGPSCustom *nextSentence; // first listener of the next sentence (group heads only)
+};
+
+struct TinyGPSSatellite
+{
+   uint8_t prn;         // 0 if the slot is empty
+   int8_t elevation;    // degrees
+   uint16_t azimuth;    // degrees true
+   uint8_t snr;         // dB-Hz, 0 if not tracked
+   bool updated;
 };
 
+class TinyGPSSatellites
+{
+public:
+   enum {CONSTELLATION_GPS, CONSTELLATION_GLONASS, CONSTELLATION_GALILEO, CONSTELLATION_BEIDOU, CONSTELLATION_COUNT};
+
+   TinyGPSSatellites(TinyGPSPlus &gps);
+
+   bool isUpdated() const  { return updated; }
+   bool isValid() const    { return valid; }
+   uint32_t age() const    { return valid ? clock->now() - lastCommitTime : (uint32_t)ULONG_MAX; }
+   uint8_t inView(uint8_t constellation) const;
+   TinyGPSSatellite satellite(uint8_t constellation, uint8_t index);
+
+private:
+   void beginSentence(uint8_t constellation);
+   void set(uint8_t termNumber, int32_t value);
+   void commit(uint8_t termCount);
+   static uint8_t constellationOf(const char *talker);
+
+   TinyGPSSatellite table[CONSTELLATION_COUNT][_GPS_MAX_SATELLITES];
+   uint8_t inViewCount[CONSTELLATION_COUNT];
+   TinyGPSSatellite staging[4]; // a GSV sentence carries up to four satellites
+   uint8_t stagingConstellation, stagingMessage, stagingInView;
+   uint32_t lastCommitTime;
+   const TinyGPSClock *clock;
+   bool valid, updated;
+   friend class TinyGPSPlus;
+};
+
+typedef void (*TinyGPSSentenceCallback)(const char *sentence, uint8_t len);
+
 class TinyGPSPlus
 {
 public:
   TinyGPSPlus();
-  bool encode(char c); // process one character received from GPS
+  bool encode(char c); // process one character (NMEA or UBX) received from GPS
+  size_t encode(const char *buf, size_t len); // process a block of characters; returns # of valid sentences
   TinyGPSPlus &operator << (char c) {encode(c); return *this;}
 
+  // Hand each checksum-valid sentence ("$...*hh", no CR/LF) to a callback.
+  // Sentences are assembled directly in the caller's buffer, which may be
+  // moved (e.g. to the next free spot in a log block) from the callback.
+  void setSentenceTap(char *buffer, uint8_t size, TinyGPSSentenceCallback callback);
+
+  // Sentence types to decode.  A sentence whose type is not in the mask,
+  // and that no TinyGPSCustom or TinyGPSSatellites object listens to, is
+  // skipped straight to the next '$' once its header has been read.
+  enum {SENTENCE_GGA = 0x01, SENTENCE_RMC = 0x02, SENTENCE_GSA = 0x04, SENTENCE_GSV = 0x08,
+        SENTENCE_VTG = 0x10, SENTENCE_OTHER = 0x20, SENTENCE_ALL = 0x3F};
+  void setSentenceMask(uint8_t mask) { sentenceMask = mask; }
+
   TinyGPSLocation location;
   TinyGPSDate date;
   TinyGPSTime time;
@@ -226,12 +316,17 @@ public:
   TinyGPSAltitude altitude;
   TinyGPSInteger satellites;
   TinyGPSDecimal hdop;
+  TinyGPSDecimal pdop;
+  TinyGPSDecimal vdop;
+  TinyGPSClock clock; // behind the age() of all of the above
 
   static const char *libraryVersion() { return _GPS_VERSION; }
 
   static double distanceBetween(double lat1, double long1, double lat2, double long2);
   static double courseTo(double lat1, double long1, double lat2, double long2);
   static const char *cardinal(double course);
+  static uint32_t distanceBetweenE7(int32_t lat1, int32_t long1, int32_t lat2, int32_t long2);
+  static uint16_t courseToE7(int32_t lat1, int32_t long1, int32_t lat2, int32_t long2);
 
   static int32_t parseDecimal(const char *term);
   static void parseDegrees(const char *term, RawDegrees &deg);
@@ -240,9 +335,11 @@ public:
   uint32_t sentencesWithFix() const { return sentencesWithFixCount; }
   uint32_t failedChecksum()   const { return failedChecksumCount; }
   uint32_t passedChecksum()   const { return passedChecksumCount; }
+  uint32_t sentencesSkipped() const { return sentencesSkippedCount; }
 
 private:
-  enum {GPS_SENTENCE_GPGGA, GPS_SENTENCE_GPRMC, GPS_SENTENCE_OTHER};
+  // in the same order as the SENTENCE_* mask bits
+  enum {GPS_SENTENCE_GGA, GPS_SENTENCE_RMC, GPS_SENTENCE_GSA, GPS_SENTENCE_GSV, GPS_SENTENCE_VTG, GPS_SENTENCE_OTHER};
 
   // parsing state variables
   uint8_t parity;
@@ -252,22 +349,71 @@ private:
   uint8_t curTermNumber;
   uint8_t curTermOffset;
   bool sentenceHasFix;
+  bool skipSentence;
+  uint8_t sentenceMask;
+
+  // numeric value of the current term, accumulated as characters arrive
+  enum {GPS_NUMBER_WHOLE, GPS_NUMBER_FRACTION, GPS_NUMBER_DONE};
+  uint32_t termWhole;
+  uint32_t termFraction;       // first _GPS_MAX_FRACTION_DIGITS digits after the '.'
+  uint8_t termFractionDigits;
+  uint8_t termHundredths;
+  uint8_t termNumberState;
+  bool termNegative;
 
   // custom element support
   friend class TinyGPSCustom;
-  TinyGPSCustom *customElts;
-  TinyGPSCustom *customCandidates;
+  TinyGPSCustom *customElts;       // one group per sentence name, linked by nextSentence
+  TinyGPSCustom *customCandidates; // group of the sentence being parsed
+  TinyGPSCustom *customCursor;     // first candidate not yet behind the current term
   void insertCustom(TinyGPSCustom *pElt, const char *sentenceName, int index);
 
+  // UBX binary protocol state
+  enum {UBX_SYNC_CHAR1 = 0xB5, UBX_SYNC_CHAR2 = 0x62, UBX_CLASS_NAV = 0x01, UBX_ID_NAV_PVT = 0x07};
+  enum {UBX_IDLE, UBX_SYNC2, UBX_CLASS, UBX_ID, UBX_LENGTH1, UBX_LENGTH2, UBX_PAYLOAD, UBX_CK_A, UBX_CK_B};
+  uint8_t ubxState;
+  uint8_t ubxClass, ubxId;
+  uint16_t ubxLength, ubxOffset;
+  uint8_t ubxCkA, ubxCkB;
+  uint32_t ubxWord;
+  uint8_t ubxValid, ubxFixType;
+  bool ubxHasFix;
+  bool encodeUbx(uint8_t b);
+  void ubxNavPvtField(uint16_t offset);
+  bool endOfUbxFrame();
+  static void fromE7(int32_t e7, RawDegrees &deg);
+
+  // raw sentence tap
+  char *tapBuffer;
+  uint8_t tapSize;
+  uint8_t tapLength;
+  bool tapDiscard; // sentence overflowed the buffer, or was already delivered
+  TinyGPSSentenceCallback tapCallback;
+  void tapChar(char c);
+
+  // satellite table support
+  friend class TinyGPSSatellites;
+  TinyGPSSatellites *satelliteTable;
+
   // statistics
   uint32_t encodedCharCount;
   uint32_t sentencesWithFixCount;
   uint32_t failedChecksumCount;
   uint32_t passedChecksumCount;
+  uint32_t sentencesSkippedCount;
 
   // internal utilities
   int fromHex(char a);
+  bool encodeNmea(char c);
   bool endOfTermHandler();
+  static uint8_t sentenceTypeOf(const char *term);
+  void encodeRun(const char *run, size_t len);
+  void resetTermNumber();
+  void accumulateNumber(char c);
+  int32_t termDecimal() const;
+  void termDegrees(RawDegrees &deg) const;
+  static const char *findTermDelimiter(const char *p, const char *end);
+  static uint8_t xorSpan(const char *p, size_t len);
 };
 
 #endif // def(__TinyGPSPlus_h)
@@ -0,0 +1,60 @@
+#include <TinyGPS++.h>
+#include <SoftwareSerial.h>
+/*
+   This sample sketch lists the satellites in view using the built-in
+   TinyGPSSatellites table, which decodes $--GSV sentences directly into
+   small integers.  It does the same job as SatElevTracker.ino without
+   any TinyGPSCustom objects, in a fraction of the RAM.
+
+   It requires the use of SoftwareSerial, and assumes that you have a
+   4800-baud serial GPS device hooked up on pins 4(rx) and 3(tx).
+*/
+static const int RXPin = 4, TXPin = 3;
+static const uint32_t GPSBaud = 4800;
+
+// The TinyGPS++ object and its satellite table
+TinyGPSPlus gps;
+TinyGPSSatellites sats(gps);
+
+// The serial connection to the GPS device
+SoftwareSerial ss(RXPin, TXPin);
+
+void setup()
+{
+  Serial.begin(115200);
+  ss.begin(GPSBaud);
+
+  Serial.println(F("SatelliteTable.ino"));
+  Serial.println(F("Lists satellites in view from the built-in GSV table"));
+  Serial.print(F("Testing TinyGPS++ library v. ")); Serial.println(TinyGPSPlus::libraryVersion());
+  Serial.print(F("Table size: ")); Serial.print(sizeof(sats)); Serial.println(F(" bytes"));
+  Serial.println();
+}
+
+void loop()
+{
+  while (ss.available() > 0)
+    gps.encode(ss.read());
+
+  if (sats.isUpdated())
+  {
+    static const char *names[] = {"GPS", "GLONASS", "Galileo", "BeiDou"};
+    for (uint8_t c = 0; c < TinyGPSSatellites::CONSTELLATION_COUNT; ++c)
+    {
+      uint8_t n = sats.inView(c);
+      if (n > _GPS_MAX_SATELLITES)
+        n = _GPS_MAX_SATELLITES;
+      for (uint8_t i = 0; i < n; ++i)
+      {
+        TinyGPSSatellite sat = sats.satellite(c, i);
+        if (!sat.updated)
+          continue;
+        Serial.print(names[c]);
+        Serial.print(F(" PRN "));   Serial.print(sat.prn);
+        Serial.print(F(" elev "));  Serial.print(sat.elevation);
+        Serial.print(F(" azim "));  Serial.print(sat.azimuth);
+        Serial.print(F(" SNR "));   Serial.println(sat.snr);
+      }
+    }
+  }
+}
@@ -0,0 +1,192 @@
+/*
+TinyGPS++ - a small GPS library for Arduino providing universal NMEA parsing
+Copyright (C) 2008-2013 Mikal Hart
+All rights reserved.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "SampleLog.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+// SatElevTracker prints 40 PRN columns, 4 characters each, after "hh:mm:ss"
+#define LOG_SATELLITES 40
+#define LOG_FIRST_COLUMN 8
+#define LOG_COLUMN_WIDTH 4
+
+void appendSentence(std::string &out, const char *body)
+{
+   uint8_t parity = 0;
+   for (const char *p = body; *p; ++p)
+      parity ^= (uint8_t)*p;
+
+   char checksum[6];
+   snprintf(checksum, sizeof(checksum), "*%02X\r\n", parity);
+   out += '$';
+   out += body;
+   out += checksum;
+}
+
+// One row of the log, as the fix the NMEA and UBX streams describe
+struct SampleRow
+{
+   int hh, mm, ss;
+   double latMinutes; // 48 degrees and this many minutes north
+   int inView;
+   int prn[LOG_SATELLITES], elevation[LOG_SATELLITES];
+};
+
+// Reads the next time-stamped row, skipping the headers
+static bool readRow(FILE *f, unsigned row, SampleRow &r)
+{
+   char line[256];
+   while (fgets(line, sizeof(line), f))
+   {
+      if (sscanf(line, "%2d:%2d:%2d", &r.hh, &r.mm, &r.ss) != 3)
+         continue;
+
+      r.latMinutes = 7.038 + (row % 50000) * 0.0001;
+      r.inView = 0;
+      size_t len = strlen(line);
+      for (int i = 0; i < LOG_SATELLITES; ++i)
+      {
+         size_t column = LOG_FIRST_COLUMN + i * LOG_COLUMN_WIDTH;
+         if (column + LOG_COLUMN_WIDTH > len)
+            break;
+         char field[LOG_COLUMN_WIDTH + 1];
+         memcpy(field, line + column, LOG_COLUMN_WIDTH);
+         field[LOG_COLUMN_WIDTH] = '\0';
+         if (strspn(field, " ") == LOG_COLUMN_WIDTH)
+            continue;
+         r.prn[r.inView] = i + 1;
+         r.elevation[r.inView++] = atoi(field);
+      }
+      return true;
+   }
+   return false;
+}
+
+size_t sampleLogNmea(const char *path, std::string &out, std::vector<size_t> *rowEnds)
+{
+   FILE *f = fopen(path, "r");
+   if (!f)
+      return 0;
+
+   size_t sentences = 0;
+   SampleRow r;
+   for (unsigned row = 0; readRow(f, row, r); ++row)
+   {
+      char body[160];
+      snprintf(body, sizeof(body), "GPRMC,%02d%02d%02d.00,A,48%07.4f,N,01131.0000,E,022.4,084.4,230394,003.1,W", r.hh, r.mm, r.ss, r.latMinutes);
+      appendSentence(out, body);
+      snprintf(body, sizeof(body), "GPGGA,%02d%02d%02d.00,48%07.4f,N,01131.0000,E,1,%02d,0.9,545.4,M,46.9,M,,", r.hh, r.mm, r.ss, r.latMinutes, r.inView);
+      appendSentence(out, body);
+
+      int n = snprintf(body, sizeof(body), "GPGSA,A,3");
+      for (int i = 0; i < 12; ++i)
+         n += i < r.inView ? snprintf(body + n, sizeof(body) - n, ",%02d", r.prn[i]) : snprintf(body + n, sizeof(body) - n, ",");
+      snprintf(body + n, sizeof(body) - n, ",2.5,1.3,2.1");
+      appendSentence(out, body);
+      sentences += 3;
+
+      int messages = (r.inView + 3) / 4;
+      for (int m = 0; m < messages; ++m)
+      {
+         n = snprintf(body, sizeof(body), "GPGSV,%d,%d,%02d", messages, m + 1, r.inView);
+         for (int i = 4 * m; i < r.inView && i < 4 * m + 4; ++i)
+            n += snprintf(body + n, sizeof(body) - n, ",%02d,%02d,%03d,%02d", r.prn[i], r.elevation[i], r.prn[i] * 37 % 360, 20 + r.elevation[i] / 3);
+         appendSentence(out, body);
+         ++sentences;
+      }
+      if (rowEnds)
+         rowEnds->push_back(out.size());
+   }
+
+   fclose(f);
+   return sentences;
+}
+
+void appendUbxFrame(std::string &out, uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len)
+{
+   std::string frame;
+   frame += (char)cls;
+   frame += (char)id;
+   frame += (char)(len & 0xFF);
+   frame += (char)(len >> 8);
+   frame.append((const char *)payload, len);
+
+   uint8_t a = 0, b = 0;
+   for (size_t i = 0; i < frame.size(); ++i)
+   {
+      a += (uint8_t)frame[i];
+      b += a;
+   }
+   out += (char)0xB5;
+   out += (char)0x62;
+   out += frame;
+   out += (char)a;
+   out += (char)b;
+}
+
+static void put(uint8_t *p, int32_t value, int bytes)
+{
+   for (int i = 0; i < bytes; ++i)
+      p[i] = (uint8_t)(value >> (8 * i));
+}
+
+size_t sampleLogUbx(const char *path, std::string &out, std::vector<size_t> *rowEnds)
+{
+   FILE *f = fopen(path, "r");
+   if (!f)
+      return 0;
+
+   size_t frames = 0;
+   SampleRow r;
+   for (unsigned row = 0; readRow(f, row, r); ++row)
+   {
+      // NAV-PVT with the values of the row's RMC, GGA and GSA
+      uint8_t pvt[92];
+      memset(pvt, 0, sizeof(pvt));
+      put(pvt + 4, 1994, 2);
+      pvt[6] = 3;
+      pvt[7] = 23;
+      pvt[8] = r.hh;
+      pvt[9] = r.mm;
+      pvt[10] = r.ss;
+      pvt[11] = 0x07;                                          // date, time valid, fully resolved
+      pvt[20] = 3;                                             // 3D fix
+      pvt[21] = 0x01;                                          // gnssFixOK
+      pvt[23] = r.inView;
+      put(pvt + 24, (int32_t)llround((11 + 31.0 / 60) * 1e7), 4);
+      put(pvt + 28, (int32_t)llround((48 + r.latMinutes / 60) * 1e7), 4);
+      put(pvt + 36, 545400, 4);                                // hMSL, mm
+      put(pvt + 60, (2240 * 463 + 89) / 90, 4);                // 22.40 knots in mm/s
+      put(pvt + 64, 8440000, 4);                               // 84.4 degrees x 10^5
+      put(pvt + 76, 250, 2);                                   // PDOP 2.5
+      appendUbxFrame(out, 0x01, 0x07, pvt, sizeof(pvt));
+      ++frames;
+      if (rowEnds)
+         rowEnds->push_back(out.size());
+   }
+
+   fclose(f);
+   return frames;
+}
@@ -0,0 +1,51 @@
+/*
+TinyGPS++ - a small GPS library for Arduino providing universal NMEA parsing
+Copyright (C) 2008-2013 Mikal Hart
+All rights reserved.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SampleLog_h
+#define SampleLog_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define SAMPLE_LOG_PATH "examples/SatElevTracker/sample_satellite_elevation_log.txt"
+
+// Appends "$<body>*hh\r\n" to out
+void appendSentence(std::string &out, const char *body);
+
+// Rebuilds the NMEA stream behind the SatElevTracker sample log: for every
+// row an RMC, GGA and GSA sentence at the row's time, and GSV sentences
+// carrying each satellite in the row with its logged elevation (azimuth and
+// SNR are made up per PRN).  The position creeps north a little each row.
+// Returns the number of sentences, 0 if the log can't be read.  If rowEnds
+// is given, the length of out after each row is appended to it.
+size_t sampleLogNmea(const char *path, std::string &out, std::vector<size_t> *rowEnds = 0);
+
+// Appends a UBX frame: sync chars, class, id, length, payload, checksum
+void appendUbxFrame(std::string &out, uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len);
+
+// The same fixes as sampleLogNmea() as one UBX NAV-PVT frame per row:
+// time, date, position, altitude, speed, course, satellites used and PDOP
+// as the RMC, GGA and GSA sentences give them.  Returns the number of
+// frames, 0 if the log can't be read.
+size_t sampleLogUbx(const char *path, std::string &out, std::vector<size_t> *rowEnds = 0);
+
+#endif
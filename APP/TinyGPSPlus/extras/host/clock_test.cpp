@@ -0,0 +1,92 @@
+/*
+TinyGPS++ - a small GPS library for Arduino providing universal NMEA parsing
+Copyright (C) 2008-2013 Mikal Hart
+All rights reserved.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Checks that each TinyGPSPlus keeps its own clock: one parser replays the
+// sample log in sentence time while another, on a simulated millis()
+// source, is fed a single fix, and neither's ages move with the other's.
+// Exits non-zero on the first mismatch.
+//
+// Build and run from the library directory:
+//
+// g++ -O2 -std=c++11 -DARDUINO=100 -Iextras/host -I. extras/host/clock_test.cpp extras/host/SampleLog.cpp extras/host/HostClock.cpp TinyGPS++.cpp -o clock_test
+// ./clock_test [sample log]
+
+#include "SampleLog.h"
+#include <TinyGPS++.h>
+
+#include <stdio.h>
+#include <string>
+
+static int failures = 0;
+static uint32_t simulatedMillis = 0;
+
+static uint32_t simulatedClock()
+{
+   return simulatedMillis;
+}
+
+static void expect(const char *what, bool ok)
+{
+   printf("%-60s %s\n", what, ok ? "ok" : "FAILED");
+   if (!ok)
+      ++failures;
+}
+
+int main(int argc, char **argv)
+{
+   const char *path = argc > 1 ? argv[1] : SAMPLE_LOG_PATH;
+   std::string log;
+   if (sampleLogNmea(path, log) == 0)
+   {
+      fprintf(stderr, "can't read %s\n", path);
+      return 1;
+   }
+
+   TinyGPSPlus replay, live;
+   replay.clock.useSentenceTime();
+   live.clock.set(simulatedClock);
+
+   std::string fix;
+   appendSentence(fix, "GPRMC,120000.00,A,4807.0380,N,01131.0000,E,022.4,084.4,230394,003.1,W");
+   simulatedMillis = 1000;
+   live.encode(fix.data(), fix.size());
+
+   // the whole log up to its last RMC, then the rest
+   size_t last = log.rfind("$GPRMC");
+   replay.encode(log.data(), last);
+   uint32_t before = replay.clock.sentenceTime();
+   std::string later = log.substr(last);
+   replay.encode(later.data(), later.size());
+   expect("sentence time: location age 0 right after the last fix", replay.location.age() == 0);
+   expect("sentence time: advances with the log", replay.clock.sentenceTime() > before);
+
+   simulatedMillis = 5000;
+   expect("simulated source: location age 4000 ms", live.location.age() == 4000);
+   expect("simulated source: doesn't move the replay's ages", replay.location.age() == 0);
+   expect("replay doesn't move the live parser's sentence time", live.clock.sentenceTime() == 43200000UL);
+
+   std::string next;
+   appendSentence(next, "GPRMC,120010.00,A,4807.0380,N,01131.0000,E,022.4,084.4,230394,003.1,W");
+   replay.encode(next.data(), next.size());
+   expect("live parser's ages unchanged by replay input", live.location.age() == 4000);
+
+   printf("\n%s\n", failures ? "FAILED" : "all passed");
+   return failures ? 1 : 0;
+}
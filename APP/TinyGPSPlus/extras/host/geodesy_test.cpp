@@ -0,0 +1,210 @@
+/*
+TinyGPS++ - a small GPS library for Arduino providing universal NMEA parsing
+Copyright (C) 2008-2013 Mikal Hart
+All rights reserved.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Checks distanceBetweenE7/courseToE7 against distanceBetween/courseTo in
+// 64-bit double, and shows how far the same formulas drift in the 32-bit
+// float AVR gives them.  Random point pairs up to _GPS_FLAT_EARTH_LIMIT_E7
+// apart (the integer path) at latitudes to +-85 degrees; farther pairs
+// take the floating point fallback and must match it exactly.  Also times
+// each version.  Exits non-zero if an error bound is broken.
+//
+// Build and run from the library directory:
+//
+// g++ -O2 -std=c++11 -DARDUINO=100 -Iextras/host -I. extras/host/geodesy_test.cpp extras/host/HostClock.cpp TinyGPS++.cpp -o geodesy_test
+// ./geodesy_test
+
+#include <TinyGPS++.h>
+
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+#define PAIRS 200000
+#define MAX_LATITUDE_E7 850000000L
+
+// distanceBetweenE7: 0.1% (as documented), on top of rounding to whole
+// meters, for pairs at least DISTANCE_MIN_METERS apart
+#define DISTANCE_RELATIVE_ERROR 0.001
+#define DISTANCE_MIN_METERS 100.0
+#define DISTANCE_ROUNDING 0.5
+// courseToE7: hundredths of a degree (as documented), for pairs at least
+// COURSE_MIN_METERS apart
+#define COURSE_ERROR 55
+#define COURSE_MIN_METERS 1.0
+
+struct Pair
+{
+   int32_t lat1, lng1, lat2, lng2;
+};
+
+// distanceBetween/courseTo with everything in 32-bit float, as on AVR
+static float distanceBetweenFloat(float lat1, float long1, float lat2, float long2)
+{
+   float delta = radians(long1 - long2);
+   float sdlong = sinf(delta), cdlong = cosf(delta);
+   lat1 = radians(lat1);
+   lat2 = radians(lat2);
+   float slat1 = sinf(lat1), clat1 = cosf(lat1);
+   float slat2 = sinf(lat2), clat2 = cosf(lat2);
+   delta = (clat1 * slat2) - (slat1 * clat2 * cdlong);
+   delta = sq(delta);
+   delta += sq(clat2 * sdlong);
+   delta = sqrtf(delta);
+   float denom = (slat1 * slat2) + (clat1 * clat2 * cdlong);
+   return atan2f(delta, denom) * 6372795.0f;
+}
+
+static float courseToFloat(float lat1, float long1, float lat2, float long2)
+{
+   float dlon = radians(long2 - long1);
+   lat1 = radians(lat1);
+   lat2 = radians(lat2);
+   float a1 = sinf(dlon) * cosf(lat2);
+   float a2 = sinf(lat1) * cosf(lat2) * cosf(dlon);
+   a2 = cosf(lat1) * sinf(lat2) - a2;
+   a2 = atan2f(a1, a2);
+   if (a2 < 0.0f)
+      a2 += (float)TWO_PI;
+   return degrees(a2);
+}
+
+// difference between two courses in hundredths of a degree
+static double courseError(double a, double b)
+{
+   double d = fabs(a - b);
+   return d > 18000 ? 36000 - d : d;
+}
+
+static int32_t randomRange(int32_t lo, int32_t hi)
+{
+   return lo + (int32_t)(((uint64_t)rand() << 16 ^ (uint64_t)rand()) % (uint64_t)(hi - lo + 1));
+}
+
+struct Errors
+{
+   double distance, relative, course;
+   Errors() : distance(0), relative(0), course(0) {}
+   void add(double d, double reference, double c, double courseReference, double rounding)
+   {
+      double e = fabs(d - reference);
+      if (e > distance)
+         distance = e;
+      e = e > rounding ? e - rounding : 0;
+      if (reference >= DISTANCE_MIN_METERS && e / reference > relative)
+         relative = e / reference;
+      if (reference >= COURSE_MIN_METERS && courseError(c, courseReference) > course)
+         course = courseError(c, courseReference);
+   }
+};
+
+template <typename F> static double nanosPerCall(const std::vector<Pair> &pairs, F f)
+{
+   double best = 1e9;
+   volatile double sink = 0;
+   for (int pass = 0; pass < 5; ++pass)
+   {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      double sum = 0;
+      for (size_t i = 0; i < pairs.size(); ++i)
+         sum += f(pairs[i]);
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      sink = sink + sum;
+      if (elapsed.count() < best)
+         best = elapsed.count();
+   }
+   return best / pairs.size() * 1e9;
+}
+
+int main()
+{
+   srand(1);
+   std::vector<Pair> pairs(PAIRS);
+   for (size_t i = 0; i < pairs.size(); ++i)
+   {
+      Pair &p = pairs[i];
+      // a spread of separations, from centimeters to the limit
+      int32_t reach = _GPS_FLAT_EARTH_LIMIT_E7 >> (i % 24);
+      p.lat1 = randomRange(-MAX_LATITUDE_E7, MAX_LATITUDE_E7);
+      p.lng1 = randomRange(-1800000000L, 1799999999L);
+      p.lat2 = p.lat1 + randomRange(-reach, reach);
+      p.lng2 = p.lng1 + randomRange(-reach, reach);
+      if (p.lng2 >= 1800000000L)
+         p.lng2 -= 3600000000LL;
+      else if (p.lng2 < -1800000000L)
+         p.lng2 += 3600000000LL;
+   }
+
+   Errors e7, single;
+   for (size_t i = 0; i < pairs.size(); ++i)
+   {
+      const Pair &p = pairs[i];
+      double lat1 = p.lat1 / 1e7, lng1 = p.lng1 / 1e7, lat2 = p.lat2 / 1e7, lng2 = p.lng2 / 1e7;
+      double d = TinyGPSPlus::distanceBetween(lat1, lng1, lat2, lng2);
+      double c = TinyGPSPlus::courseTo(lat1, lng1, lat2, lng2) * 100;
+      e7.add(TinyGPSPlus::distanceBetweenE7(p.lat1, p.lng1, p.lat2, p.lng2), d,
+         TinyGPSPlus::courseToE7(p.lat1, p.lng1, p.lat2, p.lng2), c, DISTANCE_ROUNDING);
+      single.add(distanceBetweenFloat(lat1, lng1, lat2, lng2), d, courseToFloat(lat1, lng1, lat2, lng2) * 100, c, 0);
+   }
+
+   // beyond the flat-earth limit the E7 versions hand over to the double ones
+   bool fallback = true;
+   for (int i = 0; i < 10000; ++i)
+   {
+      Pair p;
+      p.lat1 = randomRange(-MAX_LATITUDE_E7, MAX_LATITUDE_E7);
+      p.lat2 = randomRange(-MAX_LATITUDE_E7, MAX_LATITUDE_E7);
+      p.lng1 = randomRange(-1800000000L, 1799999999L);
+      p.lng2 = p.lng1 + (i & 1 ? 1 : -1) * randomRange(_GPS_FLAT_EARTH_LIMIT_E7 + 1, 1800000000L);
+      if (p.lng2 >= 1800000000L)
+         p.lng2 -= 3600000000LL;
+      else if (p.lng2 < -1800000000L)
+         p.lng2 += 3600000000LL;
+      double d = TinyGPSPlus::distanceBetween(p.lat1 / 1e7, p.lng1 / 1e7, p.lat2 / 1e7, p.lng2 / 1e7);
+      double c = TinyGPSPlus::courseTo(p.lat1 / 1e7, p.lng1 / 1e7, p.lat2 / 1e7, p.lng2 / 1e7);
+      fallback = fallback && TinyGPSPlus::distanceBetweenE7(p.lat1, p.lng1, p.lat2, p.lng2) == (uint32_t)(d + 0.5) &&
+         TinyGPSPlus::courseToE7(p.lat1, p.lng1, p.lat2, p.lng2) == (uint16_t)(c * 100 + 0.5) % 36000;
+   }
+
+   printf("%u pairs up to %.1f degrees apart, against distanceBetween/courseTo in double\n\n",
+      (unsigned)pairs.size(), _GPS_FLAT_EARTH_LIMIT_E7 / 1e7);
+   printf("%-20s %14s %18s %18s\n", "", "max error, m", "relative, >100 m", "max course error");
+   printf("%-20s %14.3f %17.4f%% %14.2f deg\n", "E7 integer", e7.distance, e7.relative * 100, e7.course / 100);
+   printf("%-20s %14.3f %17.4f%% %14.2f deg\n", "32-bit float", single.distance, single.relative * 100, single.course / 100);
+
+   double nsDouble = nanosPerCall(pairs, [](const Pair &p) {
+      return TinyGPSPlus::distanceBetween(p.lat1 / 1e7, p.lng1 / 1e7, p.lat2 / 1e7, p.lng2 / 1e7) +
+         TinyGPSPlus::courseTo(p.lat1 / 1e7, p.lng1 / 1e7, p.lat2 / 1e7, p.lng2 / 1e7); });
+   double nsFloat = nanosPerCall(pairs, [](const Pair &p) {
+      return (double)distanceBetweenFloat(p.lat1 / 1e7f, p.lng1 / 1e7f, p.lat2 / 1e7f, p.lng2 / 1e7f) +
+         courseToFloat(p.lat1 / 1e7f, p.lng1 / 1e7f, p.lat2 / 1e7f, p.lng2 / 1e7f); });
+   double nsE7 = nanosPerCall(pairs, [](const Pair &p) {
+      return (double)TinyGPSPlus::distanceBetweenE7(p.lat1, p.lng1, p.lat2, p.lng2) +
+         TinyGPSPlus::courseToE7(p.lat1, p.lng1, p.lat2, p.lng2); });
+
+   printf("\n%-20s %14s %10s\n", "distance + course", "ns/pair", "speedup");
+   printf("%-20s %14.1f %9.2fx\n", "double", nsDouble, 1.0);
+   printf("%-20s %14.1f %9.2fx\n", "32-bit float", nsFloat, nsDouble / nsFloat);
+   printf("%-20s %14.1f %9.2fx\n", "E7 integer", nsE7, nsDouble / nsE7);
+
+   bool ok = e7.relative <= DISTANCE_RELATIVE_ERROR && e7.course <= COURSE_ERROR && fallback;
+
+   printf("\nfallback beyond the limit %s; error bounds %s\n", fallback ? "matches" : "DIFFERS", ok ? "hold" : "BROKEN");
+   return ok ? 0 : 1;
+}
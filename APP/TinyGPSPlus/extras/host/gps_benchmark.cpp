@@ -0,0 +1,439 @@
+/*
+TinyGPS++ - a small GPS library for Arduino providing universal NMEA parsing
+Copyright (C) 2008-2013 Mikal Hart
+All rights reserved.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Replays the NMEA behind the SatElevTracker sample log through TinyGPS++
+// on a PC and reports parsing cost:
+//
+//   - encode(char) one character at a time against encode(buf, len) over
+//     the whole capture and over 64-byte serial reads, in MB/s and
+//     sentences/s, checking both paths end with the same counters and fix
+//   - the cost per sentence with 0, 10 and 64 TinyGPSCustom fields
+//     registered on sentences that aren't in the stream (lookup only) and
+//     on sentences that are, and what each field value delivered costs
+//   - cycles per GGA/RMC sentence and per numeric term with the numbers
+//     accumulated as they arrive, against what re-scanning the same terms
+//     with parseDecimal/parseDegrees (atol) costs on its own
+//   - each path with setSentenceMask(SENTENCE_GGA | SENTENCE_RMC) against
+//     all sentences decoded, checking the masked GSA/GSV sentences are
+//     counted in sentencesSkipped() and the GGA/RMC fields come out the same
+//   - RAM and time per GSV sentence for a satellite table: TinyGPSSatellites
+//     against SatElevTracker's TinyGPSCustom fields, and against enough
+//     TinyGPSCustom fields to keep the same table (PRN, elevation, azimuth
+//     and SNR of four constellations); RAM as on the host and as on AVR
+//
+// Build and run from the library directory:
+//
+// g++ -O2 -std=c++11 -DARDUINO=100 -Iextras/host -I. extras/host/gps_benchmark.cpp extras/host/SampleLog.cpp extras/host/HostClock.cpp TinyGPS++.cpp -o gps_benchmark
+// ./gps_benchmark [sample log]
+
+#include "SampleLog.h"
+#include <TinyGPS++.h>
+
+#include <stdio.h>
+#include <ctype.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// passes over the capture per measurement; the fastest pass is reported
+#define PASSES 20
+#define SERIAL_READ 64
+#define MAX_CUSTOM 64
+
+// custom fields go round four sentences, then to the next term number
+#define CUSTOM_SENTENCES 4
+static const char *streamSentence[CUSTOM_SENTENCES] = { "GPGSV", "GPGGA", "GPRMC", "GPGSA" };
+static const char *absentSentence[CUSTOM_SENTENCES] = { "GPVTG", "GPZDA", "GPGLL", "GPTXT" };
+
+// time stamp counter where there is one, nanoseconds otherwise
+#if defined(__x86_64__) || defined(__i386__)
+#define TICKS "cycles"
+static uint64_t ticks() { return __rdtsc(); }
+#else
+#define TICKS "ns"
+static uint64_t ticks() { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+#endif
+
+enum Path { BY_CHAR, BY_READ, BY_CAPTURE };
+
+static const char *pathName[] = { "encode(char)", "encode(buf, 64)", "encode(buf, all)" };
+
+struct Result
+{
+   double seconds;
+   uint32_t passed, failed, fixes;
+   uint32_t latBillionths;
+   uint32_t time, date;
+   int32_t altitude, speed;
+   uint32_t satellites;
+   bool pdopValid;
+   uint32_t skipped;
+};
+
+static void feed(TinyGPSPlus &gps, const std::string &nmea, Path path)
+{
+   const char *p = nmea.data();
+   size_t len = nmea.size();
+
+   if (path == BY_CHAR)
+   {
+      for (size_t i = 0; i < len; ++i)
+         gps.encode(p[i]);
+   }
+   else if (path == BY_READ)
+   {
+      for (size_t i = 0; i < len; i += SERIAL_READ)
+         gps.encode(p + i, len - i < SERIAL_READ ? len - i : SERIAL_READ);
+   }
+   else
+   {
+      gps.encode(p, len);
+   }
+}
+
+static Result measure(const std::string &nmea, Path path, int customFields = 0, const char **customSentence = streamSentence,
+   uint8_t mask = TinyGPSPlus::SENTENCE_ALL)
+{
+   Result r;
+   r.seconds = 1e9;
+   for (int pass = 0; pass < PASSES; ++pass)
+   {
+      TinyGPSPlus gps;
+      gps.setSentenceMask(mask);
+      TinyGPSCustom custom[MAX_CUSTOM];
+      for (int i = 0; i < customFields; ++i)
+         custom[i].begin(gps, customSentence[i % CUSTOM_SENTENCES], 1 + i / CUSTOM_SENTENCES);
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      feed(gps, nmea, path);
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      if (elapsed.count() < r.seconds)
+         r.seconds = elapsed.count();
+      r.passed = gps.passedChecksum();
+      r.failed = gps.failedChecksum();
+      r.fixes = gps.sentencesWithFix();
+      r.latBillionths = gps.location.rawLat().billionths;
+      r.time = gps.time.value();
+      r.date = gps.date.value();
+      r.altitude = gps.altitude.value();
+      r.speed = gps.speed.value();
+      r.satellites = gps.satellites.value();
+      r.pdopValid = gps.pdop.isValid();
+      r.skipped = gps.sentencesSkipped();
+   }
+   return r;
+}
+
+// sentences of the given types ("GSA", ...) in the capture
+static size_t countSentences(const std::string &nmea, const char *type)
+{
+   size_t n = 0;
+   for (size_t at = nmea.find('$'); at != std::string::npos; at = nmea.find('$', at + 1))
+      n += nmea.compare(at + 3, 3, type) == 0;
+   return n;
+}
+
+static bool masked(const std::string &nmea, size_t sentences)
+{
+   uint8_t mask = TinyGPSPlus::SENTENCE_GGA | TinyGPSPlus::SENTENCE_RMC;
+   size_t skippable = countSentences(nmea, "GSA") + countSentences(nmea, "GSV");
+   bool ok = true;
+
+   printf("\n%-18s %10s %10s %10s %10s\n", "GGA|RMC mask", "MB/s all", "MB/s mask", "speedup", "skipped");
+   for (int p = BY_CHAR; p <= BY_CAPTURE; ++p)
+   {
+      Result all = measure(nmea, (Path)p);
+      Result r = measure(nmea, (Path)p, 0, streamSentence, mask);
+      printf("%-18s %10.1f %10.1f %9.2fx %10u\n", pathName[p], nmea.size() / all.seconds / 1e6,
+         nmea.size() / r.seconds / 1e6, all.seconds / r.seconds, (unsigned)r.skipped);
+
+      // skipped sentences never get to their checksum (nor count as fixes); GSA's PDOP must not show up
+      ok = ok && all.skipped == 0 && r.skipped == skippable && r.passed == sentences - skippable &&
+         r.latBillionths == all.latBillionths && r.time == all.time && r.date == all.date &&
+         r.altitude == all.altitude && r.speed == all.speed && r.satellites == all.satellites &&
+         all.pdopValid && !r.pdopValid;
+   }
+
+   printf("%u GSA/GSV sentences skipped, GGA/RMC fields %s\n", (unsigned)skippable,
+      ok ? "same as with all decoded" : "DIFFER");
+   return ok;
+}
+
+// GGA and RMC sentences from the capture, and their numeric terms
+// (NMEA degrees separately, as they go through parseDegrees)
+static void numericTerms(const std::string &nmea, std::string &fixes, size_t &sentences,
+   std::vector<std::string> &decimals, std::vector<std::string> &degrees)
+{
+   sentences = 0;
+   for (size_t at = 0, end; (end = nmea.find('\n', at)) != std::string::npos; at = end + 1)
+   {
+      std::string line = nmea.substr(at, end + 1 - at);
+      bool gga = line.compare(3, 3, "GGA") == 0;
+      if (!gga && line.compare(3, 3, "RMC") != 0)
+         continue;
+      fixes += line;
+      ++sentences;
+
+      size_t star = line.find('*');
+      for (size_t t = line.find(',') + 1, term = 1, comma; t < star; t = comma + 1, ++term)
+      {
+         comma = line.find_first_of(",*", t);
+         std::string value = line.substr(t, comma - t);
+         if (value.empty() || !(isdigit(value[0]) || value[0] == '-'))
+            continue;
+         if ((gga && (term == 2 || term == 4)) || (!gga && (term == 3 || term == 5)))
+            degrees.push_back(value);
+         else
+            decimals.push_back(value);
+      }
+   }
+}
+
+static void parseNumbers(const std::string &nmea, size_t sentences)
+{
+   std::string fixes;
+   size_t fixSentences;
+   std::vector<std::string> decimals, degrees;
+   numericTerms(nmea, fixes, fixSentences, decimals, degrees);
+   size_t numbers = decimals.size() + degrees.size();
+
+   uint64_t encodeTicks = ~(uint64_t)0, rescanTicks = ~(uint64_t)0;
+   int32_t sink = 0;
+   for (int pass = 0; pass < PASSES; ++pass)
+   {
+      TinyGPSPlus gps;
+      uint64_t start = ticks();
+      gps.encode(fixes.data(), fixes.size());
+      uint64_t elapsed = ticks() - start;
+      if (elapsed < encodeTicks)
+         encodeTicks = elapsed;
+
+      start = ticks();
+      RawDegrees raw;
+      for (size_t i = 0; i < decimals.size(); ++i)
+         sink += TinyGPSPlus::parseDecimal(decimals[i].c_str());
+      for (size_t i = 0; i < degrees.size(); ++i)
+      {
+         TinyGPSPlus::parseDegrees(degrees[i].c_str(), raw);
+         sink += raw.billionths;
+      }
+      elapsed = ticks() - start;
+      if (elapsed < rescanTicks)
+         rescanTicks = elapsed;
+   }
+
+   printf("\n%u GGA/RMC sentences, %u numeric terms (%u NMEA degrees)\n", (unsigned)fixSentences,
+      (unsigned)numbers, (unsigned)degrees.size());
+   printf("%-32s %16s %14s\n", "", TICKS "/sentence", TICKS "/number");
+   printf("%-32s %16.0f %14.1f\n", "encode(buf, all), accumulated", (double)encodeTicks / fixSentences,
+      (double)encodeTicks / numbers);
+   printf("%-32s %16.0f %14.1f\n", "parseDecimal/parseDegrees rescan", (double)rescanTicks / fixSentences,
+      (double)rescanTicks / numbers);
+   (void)sentences;
+   if (sink == 42)
+      printf("\n");
+}
+
+// The same members with AVR's widths (2 byte pointers and int, 4 byte
+// long) and no padding, for RAM as a sketch would see it
+struct __attribute__((packed)) AvrSatellite
+{
+   uint8_t prn;
+   int8_t elevation;
+   uint16_t azimuth;
+   uint8_t snr;
+   bool updated;
+};
+
+struct __attribute__((packed)) AvrSatellites
+{
+   AvrSatellite table[TinyGPSSatellites::CONSTELLATION_COUNT][_GPS_MAX_SATELLITES];
+   uint8_t inViewCount[TinyGPSSatellites::CONSTELLATION_COUNT];
+   AvrSatellite staging[4];
+   uint8_t stagingConstellation, stagingMessage, stagingInView;
+   uint32_t lastCommitTime;
+   uint16_t clock;
+   bool valid, updated;
+};
+
+struct __attribute__((packed)) AvrCustom
+{
+   char stagingBuffer[_GPS_MAX_FIELD_SIZE + 1];
+   char buffer[_GPS_MAX_FIELD_SIZE + 1];
+   uint32_t lastCommitTime;
+   uint16_t clock;
+   bool valid, updated;
+   uint16_t sentenceName;
+   int16_t termNumber;
+   uint16_t next, nextSentence;
+};
+
+// SatElevTracker's own table of what its fields delivered
+struct SatElev
+{
+   int elevation;
+   bool active;
+};
+
+struct __attribute__((packed)) AvrSatElev
+{
+   int16_t elevation;
+   bool active;
+};
+
+#define SATELEV_SATELLITES 40
+// message number, satellites in view, then four terms for each of four satellites
+#define GSV_FIELDS (2 + 4 * 4)
+
+static const char *gsvSentence[TinyGPSSatellites::CONSTELLATION_COUNT] = { "GPGSV", "GLGSV", "GAGSV", "BDGSV" };
+
+enum SatelliteTable { TABLE_NONE, TABLE_BUILT_IN, TABLE_SATELEV, TABLE_CUSTOM };
+
+// best time over the capture with the table attached
+static double satelliteTime(const std::string &nmea, SatelliteTable table)
+{
+   double best = 1e9;
+   for (int pass = 0; pass < PASSES; ++pass)
+   {
+      TinyGPSPlus gps;
+      TinyGPSSatellites *sats = table == TABLE_BUILT_IN ? new TinyGPSSatellites(gps) : 0;
+      TinyGPSCustom custom[TinyGPSSatellites::CONSTELLATION_COUNT * GSV_FIELDS];
+      if (table == TABLE_SATELEV)
+      {
+         // SatElevTracker: total and message number, then PRN and elevation of four satellites
+         custom[0].begin(gps, "GPGSV", 1);
+         custom[1].begin(gps, "GPGSV", 2);
+         for (int i = 0; i < 4; ++i)
+         {
+            custom[2 + 2 * i].begin(gps, "GPGSV", 4 + 4 * i);
+            custom[3 + 2 * i].begin(gps, "GPGSV", 5 + 4 * i);
+         }
+      }
+      else if (table == TABLE_CUSTOM)
+      {
+         for (int c = 0; c < TinyGPSSatellites::CONSTELLATION_COUNT; ++c)
+            for (int t = 0; t < GSV_FIELDS; ++t)
+               custom[c * GSV_FIELDS + t].begin(gps, gsvSentence[c], 2 + t);
+      }
+
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      gps.encode(nmea.data(), nmea.size());
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      if (elapsed.count() < best)
+         best = elapsed.count();
+      delete sats;
+   }
+   return best;
+}
+
+static void satelliteRam(const std::string &nmea)
+{
+   size_t gsv = 0;
+   for (size_t at = nmea.find("GSV,"); at != std::string::npos; at = nmea.find("GSV,", at + 1))
+      ++gsv;
+
+   // the custom field table keeps what it is given in a table like the built-in one,
+   // as the fields only hold the last message's text
+   size_t customFields = TinyGPSSatellites::CONSTELLATION_COUNT * GSV_FIELDS;
+   size_t host[] = { 0, sizeof(TinyGPSSatellites),
+      10 * sizeof(TinyGPSCustom) + SATELEV_SATELLITES * sizeof(SatElev),
+      customFields * sizeof(TinyGPSCustom) + sizeof(TinyGPSSatellite[TinyGPSSatellites::CONSTELLATION_COUNT][_GPS_MAX_SATELLITES]) };
+   size_t avr[] = { 0, sizeof(AvrSatellites),
+      10 * sizeof(AvrCustom) + SATELEV_SATELLITES * sizeof(AvrSatElev),
+      customFields * sizeof(AvrCustom) + sizeof(AvrSatellite[TinyGPSSatellites::CONSTELLATION_COUNT][_GPS_MAX_SATELLITES]) };
+   static const char *name[] = { "no satellite table", "TinyGPSSatellites",
+      "SatElevTracker: 10 TinyGPSCustom", "TinyGPSCustom: 72 fields + table" };
+
+   printf("\n%u GSV sentences, satellite table of %d constellations x %d\n", (unsigned)gsv,
+      TinyGPSSatellites::CONSTELLATION_COUNT, _GPS_MAX_SATELLITES);
+   printf("%-36s %10s %10s %14s\n", "", "host RAM", "AVR RAM", "ns/GSV extra");
+   double none = satelliteTime(nmea, TABLE_NONE);
+   for (int t = TABLE_NONE; t <= TABLE_CUSTOM; ++t)
+   {
+      double seconds = t == TABLE_NONE ? none : satelliteTime(nmea, (SatelliteTable)t);
+      printf("%-36s %10u %10u %14.1f\n", name[t], (unsigned)host[t], (unsigned)avr[t], (seconds - none) / gsv * 1e9);
+   }
+}
+
+int main(int argc, char **argv)
+{
+   const char *path = argc > 1 ? argv[1] : SAMPLE_LOG_PATH;
+   std::string nmea;
+   size_t sentences = sampleLogNmea(path, nmea);
+   if (sentences == 0)
+   {
+      fprintf(stderr, "can't read %s\n", path);
+      return 1;
+   }
+
+   printf("%s: %u sentences, %u bytes\n\n", path, (unsigned)sentences, (unsigned)nmea.size());
+   printf("%-18s %10s %14s %10s\n", "path", "MB/s", "sentences/s", "speedup");
+
+   bool same = true;
+   Result base = measure(nmea, BY_CHAR);
+   for (int p = BY_CHAR; p <= BY_CAPTURE; ++p)
+   {
+      Result r = p == BY_CHAR ? base : measure(nmea, (Path)p);
+      printf("%-18s %10.1f %14.0f %9.2fx\n", pathName[p], nmea.size() / r.seconds / 1e6,
+         sentences / r.seconds, base.seconds / r.seconds);
+      same = same && r.passed == base.passed && r.failed == base.failed && r.fixes == base.fixes &&
+         r.latBillionths == base.latBillionths && r.time == base.time;
+   }
+
+   // how many of each custom sentence the stream carries
+   size_t seen[CUSTOM_SENTENCES] = { 0 };
+   for (size_t i = 0; i < CUSTOM_SENTENCES; ++i)
+      for (size_t at = nmea.find(streamSentence[i]); at != std::string::npos; at = nmea.find(streamSentence[i], at + 1))
+         ++seen[i];
+
+   printf("\n%-6s %-14s %12s %10s %12s\n", "custom", "sentences", "ns/sentence", "vs none", "ns/value");
+   static const int customFields[] = { 10, MAX_CUSTOM };
+   Result none = measure(nmea, BY_CAPTURE);
+   printf("%-6d %-14s %12.1f %9.2fx %12s\n", 0, "-", none.seconds / sentences * 1e9, 1.0, "-");
+   for (int present = 0; present <= 1; ++present)
+   {
+      for (size_t i = 0; i < sizeof(customFields) / sizeof(customFields[0]); ++i)
+      {
+         Result r = measure(nmea, BY_CAPTURE, customFields[i], present ? streamSentence : absentSentence);
+         printf("%-6d %-14s %12.1f %9.2fx ", customFields[i], present ? "in stream" : "not in stream",
+            r.seconds / sentences * 1e9, r.seconds / none.seconds);
+
+         // every field on a sentence in the stream is set and committed once per sentence
+         size_t values = 0;
+         for (int f = 0; present && f < customFields[i]; ++f)
+            values += seen[f % CUSTOM_SENTENCES];
+         if (values)
+            printf("%12.1f\n", (r.seconds - none.seconds) / values * 1e9);
+         else
+            printf("%12s\n", "-");
+         same = same && r.passed == base.passed && r.fixes == base.fixes;
+      }
+   }
+
+   parseNumbers(nmea, sentences);
+   same = masked(nmea, sentences) && same;
+   satelliteRam(nmea);
+
+   printf("\nchecksums passed %u, failed %u, with fix %u: %s\n", (unsigned)base.passed,
+      (unsigned)base.failed, (unsigned)base.fixes, same ? "same on every path" : "PATHS DIFFER");
+   return same && base.passed == sentences ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+/*
+TinyGPS++ - a small GPS library for Arduino providing universal NMEA parsing
+Copyright (C) 2008-2013 Mikal Hart
+All rights reserved.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Feeds GSV sentences in the NMEA 4.0x layout and the 4.10 one (a signal
+// ID after the satellites) through TinyGPSSatellites, with 0 to 4
+// satellites per message, and checks the table holds exactly the
+// satellites sent.  Each count is also sent with the last satellite
+// untracked (an empty SNR, the sentence's last satellite term).  Exits
+// non-zero on the first mismatch.
+//
+// Build and run from the library directory:
+//
+// g++ -O2 -std=c++11 -DARDUINO=100 -Iextras/host -I. extras/host/satellites_test.cpp extras/host/SampleLog.cpp extras/host/HostClock.cpp TinyGPS++.cpp -o satellites_test
+// ./satellites_test
+
+#include "SampleLog.h"
+#include <TinyGPS++.h>
+
+#include <stdio.h>
+#include <string>
+
+static int failures = 0;
+
+static void feed(TinyGPSPlus &gps, const char *body)
+{
+   std::string nmea;
+   appendSentence(nmea, body);
+   gps.encode(nmea.data(), nmea.size());
+}
+
+static void expect(const char *what, bool ok)
+{
+   printf("%-64s %s\n", what, ok ? "ok" : "FAILED");
+   if (!ok)
+      ++failures;
+}
+
+// entries first..first+count-1 hold PRNs prn, prn+1..., the last of them
+// with SNR 0 if untracked, and the rest of the message's four slots are empty
+static bool holds(TinyGPSSatellites &sats, uint8_t constellation, uint8_t first, uint8_t count, uint8_t prn,
+   bool untracked = false)
+{
+   bool ok = true;
+   for (uint8_t i = 0; i < 4 && first + i < _GPS_MAX_SATELLITES; ++i)
+   {
+      TinyGPSSatellite sat = sats.satellite(constellation, first + i);
+      uint8_t snr = untracked && i + 1 == count ? 0 : 30 + i;
+      if (i < count)
+         ok = ok && sat.prn == prn + i && sat.elevation == 10 + i && sat.azimuth == 100 + i && sat.snr == snr;
+      else
+         ok = ok && sat.prn == 0;
+   }
+   return ok;
+}
+
+static void message(TinyGPSPlus &gps, const char *talker, int messages, int number, int inView, int count,
+   int prn, bool signalId, bool untracked = false)
+{
+   char body[120];
+   int n = snprintf(body, sizeof(body), "%sGSV,%d,%d,%02d", talker, messages, number, inView);
+   for (int i = 0; i < count; ++i)
+      if (untracked && i + 1 == count)
+         n += snprintf(body + n, sizeof(body) - n, ",%02d,%02d,%03d,", prn + i, 10 + i, 100 + i);
+      else
+         n += snprintf(body + n, sizeof(body) - n, ",%02d,%02d,%03d,%02d", prn + i, 10 + i, 100 + i, 30 + i);
+   if (signalId)
+      snprintf(body + n, sizeof(body) - n, ",1");
+   feed(gps, body);
+}
+
+int main()
+{
+   char what[80];
+
+   for (int signalId = 0; signalId <= 1; ++signalId)
+   {
+      const char *layout = signalId ? "NMEA 4.10" : "NMEA 4.0x";
+      for (int untracked = 0; untracked <= 1; ++untracked)
+         for (int count = 1; count <= 4; ++count)
+         {
+            TinyGPSPlus gps;
+            TinyGPSSatellites sats(gps);
+
+            // a full first message, then a last one with count satellites
+            message(gps, "GP", 2, 1, 4 + count, 4, 1, signalId, untracked);
+            message(gps, "GP", 2, 2, 4 + count, count, 20, signalId, untracked);
+            snprintf(what, sizeof(what), "%s, %d satellite(s) in the last message%s", layout, count,
+               untracked ? ", last untracked" : "");
+            expect(what, gps.passedChecksum() == 2 && sats.inView(TinyGPSSatellites::CONSTELLATION_GPS) == 4 + count &&
+               holds(sats, TinyGPSSatellites::CONSTELLATION_GPS, 0, 4, 1, untracked) &&
+               holds(sats, TinyGPSSatellites::CONSTELLATION_GPS, 4, count, 20, untracked));
+         }
+
+      // a shorter message over one that was full clears the slots it doesn't fill
+      TinyGPSPlus gps;
+      TinyGPSSatellites sats(gps);
+      message(gps, "GL", 1, 1, 4, 4, 65, signalId);
+      message(gps, "GL", 1, 1, 1, 1, 70, signalId);
+      snprintf(what, sizeof(what), "%s, 1 satellite replacing 4", layout);
+      expect(what, holds(sats, TinyGPSSatellites::CONSTELLATION_GLONASS, 0, 1, 70));
+
+      // nothing in view
+      message(gps, "GL", 1, 1, 0, 0, 0, signalId);
+      snprintf(what, sizeof(what), "%s, no satellites in view", layout);
+      expect(what, sats.inView(TinyGPSSatellites::CONSTELLATION_GLONASS) == 0 &&
+         holds(sats, TinyGPSSatellites::CONSTELLATION_GLONASS, 0, 0, 0));
+   }
+
+   printf("\n%s\n", failures ? "FAILED" : "all passed");
+   return failures ? 1 : 0;
+}
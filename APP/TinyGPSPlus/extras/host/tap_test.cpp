@@ -0,0 +1,196 @@
+/*
+TinyGPS++ - a small GPS library for Arduino providing universal NMEA parsing
+Copyright (C) 2008-2013 Mikal Hart
+All rights reserved.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Checks the sentence tap: replays the sample log, with every seventh
+// sentence damaged so its checksum fails, through encode(char) and
+// encode(buf, len) in whole, 64-byte and 7-byte pieces, and checks the
+// tap gets exactly the sentences that pass their checksum, in order, as
+// "$...*hh" without the line ending.  A tap smaller than some sentences
+// must get exactly those that fit, and a logger that moves the tap along
+// its own block buffer from the callback must end up with the valid
+// sentences back to back.  Exits non-zero on the first mismatch.
+//
+// Build and run from the library directory:
+//
+// g++ -O2 -std=c++11 -DARDUINO=100 -Iextras/host -I. extras/host/tap_test.cpp extras/host/SampleLog.cpp extras/host/HostClock.cpp TinyGPS++.cpp -o tap_test
+// ./tap_test [sample log]
+
+#include "SampleLog.h"
+#include <TinyGPS++.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#define CORRUPT_EVERY 7
+#define TAP_SIZE 96     // longer than any sentence in the log
+#define SMALL_TAP_SIZE 40
+#define LOG_BLOCK 240    // a tap is at most 255 bytes
+
+enum Path { BY_CHAR, BY_ALL, BY_READ, BY_SMALL_READ };
+
+static const char *pathName[] = { "encode(char)", "encode(buf, all)", "encode(buf, 64)", "encode(buf, 7)" };
+static const size_t pathRead[] = { 1, 0, 64, 7 };
+
+static int failures = 0;
+static std::vector<std::string> tapped;
+
+// logger state: sentences go into block, which is appended to file when the next one might not fit
+static char block[LOG_BLOCK];
+static size_t blockUsed;
+static std::string file;
+static TinyGPSPlus *logged;
+
+static void expect(const char *what, bool ok)
+{
+   printf("%-60s %s\n", what, ok ? "ok" : "FAILED");
+   if (!ok)
+      ++failures;
+}
+
+static void collect(const char *sentence, uint8_t len)
+{
+   tapped.push_back(std::string(sentence, len));
+}
+
+static void logSentence(const char *sentence, uint8_t len)
+{
+   // the sentence is already in place; just move past it
+   if (sentence != block + blockUsed)
+      ++failures;
+   blockUsed += len;
+   if (LOG_BLOCK - blockUsed < TAP_SIZE)
+   {
+      file.append(block, blockUsed);
+      blockUsed = 0;
+   }
+   logged->setSentenceTap(block + blockUsed, LOG_BLOCK - blockUsed, logSentence);
+}
+
+// "$...*hh" with a checksum that matches
+static bool checksumOk(const std::string &sentence)
+{
+   size_t star = sentence.find('*');
+   if (sentence.empty() || sentence[0] != '$' || star == std::string::npos || star + 3 != sentence.size())
+      return false;
+   uint8_t parity = 0;
+   for (size_t i = 1; i < star; ++i)
+      parity ^= (uint8_t)sentence[i];
+   return parity == strtoul(sentence.c_str() + star + 1, NULL, 16);
+}
+
+static void feed(TinyGPSPlus &gps, const std::string &nmea, Path path)
+{
+   if (path == BY_CHAR)
+   {
+      for (size_t i = 0; i < nmea.size(); ++i)
+         gps.encode(nmea[i]);
+      return;
+   }
+
+   size_t read = pathRead[path] ? pathRead[path] : nmea.size();
+   for (size_t i = 0; i < nmea.size(); i += read)
+      gps.encode(nmea.data() + i, nmea.size() - i < read ? nmea.size() - i : read);
+}
+
+static size_t badCount(const std::vector<std::string> &sentences)
+{
+   size_t bad = 0;
+   for (size_t i = 0; i < sentences.size(); ++i)
+      bad += !checksumOk(sentences[i]);
+   return bad;
+}
+
+int main(int argc, char **argv)
+{
+   const char *path = argc > 1 ? argv[1] : SAMPLE_LOG_PATH;
+   std::string log;
+   if (sampleLogNmea(path, log) == 0)
+   {
+      fprintf(stderr, "can't read %s\n", path);
+      return 1;
+   }
+
+   // damage the first character of the first term of every seventh sentence
+   std::string nmea;
+   std::vector<std::string> valid, fits;
+   size_t damaged = 0;
+   for (size_t at = 0, end, n = 0; (end = log.find('\n', at)) != std::string::npos; at = end + 1, ++n)
+   {
+      std::string line = log.substr(at, end + 1 - at);
+      std::string sentence = line.substr(0, line.find('\r'));
+      if (n % CORRUPT_EVERY == CORRUPT_EVERY - 1)
+      {
+         size_t k = line.find(',') + 1;
+         line[k] = line[k] == '9' ? '0' : line[k] + 1;
+         ++damaged;
+      }
+      else
+      {
+         valid.push_back(sentence);
+         if (sentence.size() <= SMALL_TAP_SIZE)
+            fits.push_back(sentence);
+      }
+      nmea += line;
+   }
+
+   std::string validFile;
+   for (size_t i = 0; i < valid.size(); ++i)
+      validFile += valid[i];
+
+   char what[80];
+   printf("%u sentences, %u damaged, %u of the valid ones fit in %d bytes\n\n", (unsigned)(valid.size() + damaged),
+      (unsigned)damaged, (unsigned)fits.size(), SMALL_TAP_SIZE);
+
+   for (int p = BY_CHAR; p <= BY_SMALL_READ; ++p)
+   {
+      char buffer[TAP_SIZE];
+      TinyGPSPlus gps;
+      tapped.clear();
+      gps.setSentenceTap(buffer, sizeof(buffer), collect);
+      feed(gps, nmea, (Path)p);
+      snprintf(what, sizeof(what), "%s: every valid sentence, in order", pathName[p]);
+      expect(what, tapped == valid && gps.passedChecksum() == valid.size() && gps.failedChecksum() == damaged);
+      snprintf(what, sizeof(what), "%s: no sentence that failed its checksum", pathName[p]);
+      expect(what, badCount(tapped) == 0);
+
+      char small[SMALL_TAP_SIZE];
+      TinyGPSPlus smallGps;
+      tapped.clear();
+      smallGps.setSentenceTap(small, sizeof(small), collect);
+      feed(smallGps, nmea, (Path)p);
+      snprintf(what, sizeof(what), "%s: %d byte tap gets the sentences that fit", pathName[p], SMALL_TAP_SIZE);
+      expect(what, tapped == fits && smallGps.passedChecksum() == valid.size());
+
+      TinyGPSPlus logger;
+      logged = &logger;
+      blockUsed = 0;
+      file.clear();
+      logger.setSentenceTap(block, LOG_BLOCK, logSentence);
+      feed(logger, nmea, (Path)p);
+      file.append(block, blockUsed);
+      snprintf(what, sizeof(what), "%s: logger moving the tap along its block", pathName[p]);
+      expect(what, file == validFile);
+   }
+
+   printf("\n%s\n", failures ? "FAILED" : "all passed");
+   return failures ? 1 : 0;
+}
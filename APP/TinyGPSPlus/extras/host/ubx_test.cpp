@@ -0,0 +1,147 @@
+/*
+TinyGPS++ - a small GPS library for Arduino providing universal NMEA parsing
+Copyright (C) 2008-2013 Mikal Hart
+All rights reserved.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Checks the UBX NAV-PVT path against the NMEA one: the sample log's
+// fixes are replayed as NMEA, as UBX and as the two interleaved, one row
+// at a time, and after every row time, date, position, altitude, speed,
+// course, satellites and PDOP must agree.  Then stray 0xB5 bytes are
+// mixed into NMEA, which must lose no more than the sentence a byte lands
+// in.  Exits non-zero on the first mismatch.
+//
+// Build and run from the library directory:
+//
+// g++ -O2 -std=c++11 -DARDUINO=100 -Iextras/host -I. extras/host/ubx_test.cpp extras/host/SampleLog.cpp extras/host/HostClock.cpp TinyGPS++.cpp -o ubx_test
+// ./ubx_test [sample log]
+
+#include "SampleLog.h"
+#include <TinyGPS++.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+static void expect(const char *what, bool ok)
+{
+   printf("%-60s %s\n", what, ok ? "ok" : "FAILED");
+   if (!ok)
+      ++failures;
+}
+
+// Same fix in both parsers?  UBX positions are rounded to 10^-7 degree
+// where NMEA minutes are converted exactly, so allow one step.
+static bool sameFix(TinyGPSPlus &a, TinyGPSPlus &b)
+{
+   return a.time.value() == b.time.value() && a.date.value() == b.date.value() &&
+      labs(a.location.latE7() - b.location.latE7()) <= 1 && labs(a.location.lngE7() - b.location.lngE7()) <= 1 &&
+      a.altitude.value() == b.altitude.value() && a.speed.value() == b.speed.value() &&
+      a.course.value() == b.course.value() && a.satellites.value() == b.satellites.value() &&
+      a.pdop.value() == b.pdop.value();
+}
+
+static void feed(TinyGPSPlus &gps, const std::string &s, size_t from, size_t to, bool byChar)
+{
+   if (byChar)
+      for (size_t i = from; i < to; ++i)
+         gps.encode(s[i]);
+   else
+      gps.encode(s.data() + from, to - from);
+}
+
+int main(int argc, char **argv)
+{
+   const char *path = argc > 1 ? argv[1] : SAMPLE_LOG_PATH;
+   std::string nmea, ubx;
+   std::vector<size_t> nmeaRows, ubxRows;
+   size_t sentences = sampleLogNmea(path, nmea, &nmeaRows);
+   size_t frames = sampleLogUbx(path, ubx, &ubxRows);
+   if (sentences == 0 || frames != nmeaRows.size())
+   {
+      fprintf(stderr, "can't read %s\n", path);
+      return 1;
+   }
+   printf("%s: %u rows, NMEA %u bytes, UBX %u bytes\n\n", path, (unsigned)frames, (unsigned)nmea.size(), (unsigned)ubx.size());
+
+   for (int byChar = 0; byChar <= 1; ++byChar)
+   {
+      TinyGPSPlus fromNmea, fromUbx, mixed;
+      size_t rowsAgreeing = 0, mixedAgreeing = 0;
+      for (size_t row = 0; row < frames; ++row)
+      {
+         size_t n0 = row ? nmeaRows[row - 1] : 0, u0 = row ? ubxRows[row - 1] : 0;
+         feed(fromNmea, nmea, n0, nmeaRows[row], byChar);
+         feed(fromUbx, ubx, u0, ubxRows[row], byChar);
+         if (row % 2)
+            feed(mixed, ubx, u0, ubxRows[row], byChar);
+         else
+            feed(mixed, nmea, n0, nmeaRows[row], byChar);
+         rowsAgreeing += sameFix(fromNmea, fromUbx);
+         mixedAgreeing += sameFix(fromNmea, mixed);
+      }
+
+      char what[80];
+      snprintf(what, sizeof(what), "%s: UBX matches NMEA after every row", byChar ? "encode(char)" : "encode(buf, len)");
+      expect(what, rowsAgreeing == frames && fromUbx.passedChecksum() == frames && fromUbx.failedChecksum() == 0);
+      snprintf(what, sizeof(what), "%s: interleaved UBX and NMEA match NMEA", byChar ? "encode(char)" : "encode(buf, len)");
+      expect(what, mixedAgreeing == frames && mixed.failedChecksum() == 0);
+   }
+
+   // 0xB5 before each '$' (line noise, or a UBX frame cut short by a
+   // reset): every sentence must still be decoded
+   std::string noisy;
+   for (size_t i = 0; i < nmea.size(); ++i)
+   {
+      if (nmea[i] == '$')
+         noisy += (char)0xB5;
+      noisy += nmea[i];
+   }
+   for (int byChar = 0; byChar <= 1; ++byChar)
+   {
+      TinyGPSPlus clean, gps;
+      feed(clean, nmea, 0, nmea.size(), byChar);
+      feed(gps, noisy, 0, noisy.size(), byChar);
+      char what[80];
+      snprintf(what, sizeof(what), "%s: 0xB5 before every '$' loses nothing", byChar ? "encode(char)" : "encode(buf, len)");
+      expect(what, gps.passedChecksum() == sentences && gps.failedChecksum() == 0 && sameFix(clean, gps) &&
+         gps.charsProcessed() == noisy.size());
+   }
+
+   // 0xB5 inside a sentence fails its checksum, as any other stray byte
+   // would, and the next sentence is unharmed; 0xB5 0xB5 0x62 is a frame
+   std::string rmc;
+   appendSentence(rmc, "GPRMC,120000.00,A,4807.0380,N,01131.0000,E,022.4,084.4,230394,003.1,W");
+   std::string corrupt = rmc;
+   corrupt.insert(20, 1, (char)0xB5);
+   std::string doubled = std::string(1, (char)0xB5) + ubx.substr(0, ubxRows[0]);
+   for (int byChar = 0; byChar <= 1; ++byChar)
+   {
+      TinyGPSPlus gps;
+      std::string s = corrupt + rmc + doubled;
+      feed(gps, s, 0, s.size(), byChar);
+      char what[80];
+      snprintf(what, sizeof(what), "%s: 0xB5 in a sentence, then 0xB5 0xB5 0x62", byChar ? "encode(char)" : "encode(buf, len)");
+      expect(what, gps.failedChecksum() == 1 && gps.passedChecksum() == 2 && gps.pdop.value() == 250);
+   }
+
+   printf("\n%s\n", failures ? "FAILED" : "all passed");
+   return failures ? 1 : 0;
+}
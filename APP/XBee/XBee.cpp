@@ -747,21 +747,42 @@ void XBeeResponse::reset() {
 	_errorCode = NO_ERROR;
 }
 
-void XBee::resetResponse() {
+void XBeeBase::resetResponse() {
 	_pos = 0;
 	_escape = false;
 	_checksumTotal = 0;
 	_response.reset();
 }
 
-XBee::XBee(): _response(XBeeResponse()) {
+XBee::XBee() : XBeeRadio<ATAP, MAX_FRAME_DATA_SIZE>() {
+
+}
+
+XBeeBase::XBeeBase(uint8_t apiMode, uint8_t* frameData, uint8_t frameDataSize): _response(XBeeResponse()) {
         _pos = 0;
         _escape = false;
         _checksumTotal = 0;
         _nextFrameId = 0;
+        _readPos = 0;
+        _readLength = 0;
+
+        _responseFrameData = frameData;
+        _frameDataSize = frameDataSize;
+        _startByte = apiMode == 2 ? START_BYTE : 0x100;
+        _escapeByte = apiMode == 2 ? ESCAPE : 0x100;
 
         _response.init();
         _response.setFrameData(_responseFrameData);
+#if RX_QUEUE_SIZE > 0
+        _queueFrameData = NULL;
+        _queueHead = 0;
+        _queueCount = 0;
+        for (uint8_t i = 0; i < RX_QUEUE_SIZE; i++) {
+        	_queue[i].reset();
+        }
+        _droppedFrames = 0;
+        _failedFrames = 0;
+#endif
 		// Contributed by Paul Stoffregen for Teensy support
 #if defined(__AVR_ATmega32U4__) || defined(__MK20DX128__)
         _serial = &Serial1;
@@ -770,7 +791,15 @@ XBee::XBee(): _response(XBeeResponse()) {
 #endif
 }
 
-uint8_t XBee::getNextFrameId() {
+uint8_t XBeeBase::getApiMode() {
+	return _escapeByte == ESCAPE ? 2 : 1;
+}
+
+uint8_t XBeeBase::getMaxFrameDataSize() {
+	return _frameDataSize;
+}
+
+uint8_t XBeeBase::getNextFrameId() {
 
 	_nextFrameId++;
 
@@ -783,53 +812,136 @@ uint8_t XBee::getNextFrameId() {
 }
 
 // Support for SoftwareSerial. Contributed by Paul Stoffregen
-void XBee::begin(Stream &serial) {
+void XBeeBase::begin(Stream &serial) {
 	_serial = &serial;
 }
 
-void XBee::setSerial(Stream &serial) {
+void XBeeBase::setSerial(Stream &serial) {
 	_serial = &serial;
 }
 
-bool XBee::available() {
-	return _serial->available();
+bool XBeeBase::available() {
+	return _readPos < _readLength || _serial->available();
 }
 
-uint8_t XBee::read() {
-	return _serial->read();
-} 
+uint8_t XBeeBase::read() {
+	if (_readPos == _readLength && !fillReadBuffer()) {
+		return _serial->read();
+	}
+
+	return _readBuffer[_readPos++];
+}
+
+// reads as much as the serial port has buffered, up to READ_BLOCK_SIZE bytes.  never waits for data
+bool XBeeBase::fillReadBuffer() {
+	int count = _serial->available();
+
+	if (count <= 0) {
+		return false;
+	}
+
+	if (count > READ_BLOCK_SIZE) {
+		count = READ_BLOCK_SIZE;
+	}
 
-void XBee::flush() {
+	_readPos = 0;
+	_readLength = _serial->readBytes((char*)_readBuffer, count);
+
+	return _readLength > 0;
+}
+
+// consumes a run of bytes from the read buffer without going through the per byte state machine:
+// the noise before a start byte, or frame data up to the next escape/start byte, which is copied
+// straight into the response and added to the checksum.  returns false if the next byte needs the state machine
+bool XBeeBase::readRun() {
+	if (_escape || (_pos > 0 && _pos <= API_ID_INDEX)) {
+		return false;
+	}
+
+	if (_readPos == _readLength && !fillReadBuffer()) {
+		return false;
+	}
+
+	uint8_t* run = _readBuffer + _readPos;
+	uint8_t length = _readLength - _readPos;
+
+	if (_pos == 0) {
+		// looking for a start byte
+		uint8_t* start = (uint8_t*)memchr(run, START_BYTE, length);
+		uint8_t skip = start != NULL ? start - run : length;
+
+		_readPos+= skip;
+		return skip > 0;
+	}
+
+	// frame data ends at the checksum, or where it would overflow the frame buffer
+	int end = _response.getPacketLength() + 3;
+
+	if (end > _frameDataSize + 4) {
+		end = _frameDataSize + 4;
+	}
+
+	if (end - _pos < length) {
+		length = end > _pos ? end - _pos : 0;
+	}
+
+	uint8_t count = 0;
+	uint8_t sum = 0;
+
+	while (count < length && run[count] != _escapeByte && run[count] != _startByte) {
+		sum+= run[count];
+		count++;
+	}
+
+	if (count == 0) {
+		return false;
+	}
+
+	memcpy(_response.getFrameData() + _pos - 4, run, count);
+	_checksumTotal+= sum;
+	_pos+= count;
+	_readPos+= count;
+
+	return true;
+}
+
+void XBeeBase::flush() {
 	_serial->flush();
 } 
 
-void XBee::write(uint8_t val) {
+void XBeeBase::write(uint8_t val) {
 	_serial->write(val);
 }
 
-XBeeResponse& XBee::getResponse() {
+XBeeResponse& XBeeBase::getResponse() {
+#if RX_QUEUE_SIZE > 0
+	// _response is the frame being parsed; it may be incomplete, or already queued and released
+	return _queue[_queueHead];
+#else
 	return _response;
+#endif
 }
 
 // TODO how to convert response to proper subclass?
-void XBee::getResponse(XBeeResponse &response) {
+void XBeeBase::getResponse(XBeeResponse &response) {
+	XBeeResponse& current = getResponse();
 
-	response.setMsbLength(_response.getMsbLength());
-	response.setLsbLength(_response.getLsbLength());
-	response.setApiId(_response.getApiId());
-	response.setFrameLength(_response.getFrameDataLength());
+	response.setMsbLength(current.getMsbLength());
+	response.setLsbLength(current.getLsbLength());
+	response.setApiId(current.getApiId());
+	response.setFrameLength(current.getFrameDataLength());
 
-	response.setFrameData(_response.getFrameData());
+	response.setFrameData(current.getFrameData());
 }
 
-void XBee::readPacketUntilAvailable() {
+void XBeeBase::readPacketUntilAvailable() {
 	while (!(getResponse().isAvailable() || getResponse().isError())) {
 		// read some more
 		readPacket();
 	}
 }
 
-bool XBee::readPacket(int timeout) {
+bool XBeeBase::readPacket(int timeout) {
 
 	if (timeout < 0) {
 		return false;
@@ -852,24 +964,40 @@ bool XBee::readPacket(int timeout) {
     return false;
 }
 
-void XBee::readPacket() {
+void XBeeBase::readPacket() {
 	// reset previous response
 	if (_response.isAvailable() || _response.isError()) {
+#if RX_QUEUE_SIZE > 0
+		// completed frames are already queued, but a partial frame may follow them so keep the parser state
+		_response.init();
+#else
 		// discard previous packet and start over
 		resetResponse();
+#endif
 	}
 
     while (available()) {
 
+        if (readRun()) {
+        	continue;
+        }
+
         b = read();
 
-        if (_pos > 0 && b == START_BYTE && ATAP == 2) {
+        if (_pos > 0 && b == _startByte) {
         	// new packet start before previous packeted completed -- discard previous packet and start over
         	_response.setErrorCode(UNEXPECTED_START_BYTE);
+#if RX_QUEUE_SIZE > 0
+        	// the start byte belongs to the next frame, so keep parsing it
+        	endQueuedFrame(false);
+        	beginQueuedFrame();
+        	continue;
+#else
         	return;
+#endif
         }
 
-		if (_pos > 0 && b == ESCAPE) {
+		if (_pos > 0 && b == _escapeByte) {
 			if (available()) {
 				b = read();
 				b = 0x20 ^ b;
@@ -893,7 +1021,11 @@ void XBee::readPacket() {
         switch(_pos) {
 			case 0:
 		        if (b == START_BYTE) {
+#if RX_QUEUE_SIZE > 0
+		        	beginQueuedFrame();
+#else
 		        	_pos++;
+#endif
 		        }
 
 		        break;
@@ -917,12 +1049,6 @@ void XBee::readPacket() {
 			default:
 				// starts at fifth byte
 
-				if (_pos > MAX_FRAME_DATA_SIZE) {
-					// exceed max size.  should never occur
-					_response.setErrorCode(PACKET_EXCEEDS_BYTE_ARRAY_LENGTH);
-					return;
-				}
-
 				// check if we're at the end of the packet
 				// packet length does not include start, length, or checksum bytes, so add 3
 				if (_pos == (_response.getPacketLength() + 3)) {
@@ -947,7 +1073,21 @@ void XBee::readPacket() {
 					// reset state vars
 					_pos = 0;
 
+#if RX_QUEUE_SIZE > 0
+					endQueuedFrame(!_response.isError());
+					continue;
+#else
+					return;
+#endif
+				} else if (_pos - 4 >= _frameDataSize) {
+					// exceed max size.  should never occur
+					_response.setErrorCode(PACKET_EXCEEDS_BYTE_ARRAY_LENGTH);
+#if RX_QUEUE_SIZE > 0
+					endQueuedFrame(false);
+					continue;
+#else
 					return;
+#endif
 				} else {
 					// add to packet array, starting with the fourth byte of the apiFrame
 					_response.getFrameData()[_pos - 4] = b;
@@ -957,6 +1097,76 @@ void XBee::readPacket() {
     }
 }
 
+#if RX_QUEUE_SIZE > 0
+
+// called on a start byte: parse the frame straight into the next free queue slot, or into the
+// single response buffer when the queue is full (the frame is then counted as dropped)
+void XBeeBase::beginQueuedFrame() {
+	_pos = 1;
+	_escape = false;
+	_checksumTotal = 0;
+
+	if (_queueCount < RX_QUEUE_SIZE) {
+		_response.setFrameData(_queueFrameData + ((_queueHead + _queueCount) % RX_QUEUE_SIZE) * _frameDataSize);
+	} else {
+		_response.setFrameData(_responseFrameData);
+	}
+}
+
+void XBeeBase::endQueuedFrame(bool valid) {
+	_pos = 0;
+	_escape = false;
+	_checksumTotal = 0;
+
+	if (!valid) {
+		_failedFrames++;
+	} else if (_response.getFrameData() == _responseFrameData) {
+		_droppedFrames++;
+	} else {
+		XBeeResponse& frame = _queue[(_queueHead + _queueCount) % RX_QUEUE_SIZE];
+
+		frame.setMsbLength(_response.getMsbLength());
+		frame.setLsbLength(_response.getLsbLength());
+		frame.setApiId(_response.getApiId());
+		frame.setFrameLength(_response.getFrameDataLength());
+		frame.setFrameData(_response.getFrameData());
+		frame.setChecksum(_response.getChecksum());
+		frame.setErrorCode(NO_ERROR);
+		frame.setAvailable(true);
+		_queueCount++;
+	}
+}
+
+void XBeeBase::setQueueFrameData(uint8_t* queueFrameData) {
+	_queueFrameData = queueFrameData;
+}
+
+uint8_t XBeeBase::getQueuedFrameCount() {
+	return _queueCount;
+}
+
+XBeeResponse& XBeeBase::getQueuedFrame() {
+	return _queue[_queueHead];
+}
+
+void XBeeBase::releaseQueuedFrame() {
+	if (_queueCount > 0) {
+		_queue[_queueHead].reset();
+		_queueHead = (_queueHead + 1) % RX_QUEUE_SIZE;
+		_queueCount--;
+	}
+}
+
+uint16_t XBeeBase::getDroppedFrameCount() {
+	return _droppedFrames;
+}
+
+uint16_t XBeeBase::getFailedFrameCount() {
+	return _failedFrames;
+}
+
+#endif
+
 // it's peanut butter jelly time!!
 
 XBeeRequest::XBeeRequest(uint8_t apiId, uint8_t frameId) {
@@ -980,6 +1190,32 @@ void XBeeRequest::setApiId(uint8_t apiId) {
 	_apiId = apiId;
 }
 
+uint8_t XBeeRequest::getFrameHeader(uint8_t*) {
+	// no spans; send() reads the frame with getFrameData(pos)
+	return 0;
+}
+
+uint8_t* XBeeRequest::getFrameDataTail() {
+	return NULL;
+}
+
+// writes a 64-bit address msb first, as it appears in the frame
+static uint8_t* putAddress64(uint8_t* out, XBeeAddress64& addr64) {
+	uint32_t msb = addr64.getMsb();
+	uint32_t lsb = addr64.getLsb();
+
+	out[0] = (msb >> 24) & 0xff;
+	out[1] = (msb >> 16) & 0xff;
+	out[2] = (msb >> 8) & 0xff;
+	out[3] = msb & 0xff;
+	out[4] = (lsb >> 24) & 0xff;
+	out[5] = (lsb >> 16) & 0xff;
+	out[6] = (lsb >> 8) & 0xff;
+	out[7] = lsb & 0xff;
+
+	return out + 8;
+}
+
 //void XBeeRequest::reset() {
 //	_frameId = DEFAULT_FRAME_ID;
 //}
@@ -1107,6 +1343,21 @@ uint8_t ZBTxRequest::getFrameDataLength() {
 	return ZB_TX_API_LENGTH + getPayloadLength();
 }
 
+uint8_t ZBTxRequest::getFrameHeader(uint8_t* header) {
+	uint8_t* p = putAddress64(header, _addr64);
+
+	p[0] = (_addr16 >> 8) & 0xff;
+	p[1] = _addr16 & 0xff;
+	p[2] = _broadcastRadius;
+	p[3] = _option;
+
+	return ZB_TX_API_LENGTH;
+}
+
+uint8_t* ZBTxRequest::getFrameDataTail() {
+	return getPayload();
+}
+
 XBeeAddress64& ZBTxRequest::getAddress64() {
 	return _addr64;
 }
@@ -1174,6 +1425,18 @@ uint8_t Tx16Request::getFrameDataLength() {
 	return TX_16_API_LENGTH + getPayloadLength();
 }
 
+uint8_t Tx16Request::getFrameHeader(uint8_t* header) {
+	header[0] = (_addr16 >> 8) & 0xff;
+	header[1] = _addr16 & 0xff;
+	header[2] = _option;
+
+	return TX_16_API_LENGTH;
+}
+
+uint8_t* Tx16Request::getFrameDataTail() {
+	return getPayload();
+}
+
 uint16_t Tx16Request::getAddress16() {
 	return _addr16;
 }
@@ -1233,6 +1496,16 @@ uint8_t Tx64Request::getFrameDataLength() {
 	return TX_64_API_LENGTH + getPayloadLength();
 }
 
+uint8_t Tx64Request::getFrameHeader(uint8_t* header) {
+	putAddress64(header, _addr64)[0] = _option;
+
+	return TX_64_API_LENGTH;
+}
+
+uint8_t* Tx64Request::getFrameDataTail() {
+	return getPayload();
+}
+
 XBeeAddress64& Tx64Request::getAddress64() {
 	return _addr64;
 }
@@ -1316,8 +1589,31 @@ uint8_t AtCommandRequest::getFrameDataLength() {
 	return AT_COMMAND_API_LENGTH + _commandValueLength;
 }
 
+uint8_t AtCommandRequest::getFrameHeader(uint8_t* header) {
+	header[0] = _command[0];
+	header[1] = _command[1];
+
+	return AT_COMMAND_API_LENGTH;
+}
+
+uint8_t* AtCommandRequest::getFrameDataTail() {
+	return _commandValue;
+}
+
 XBeeAddress64 RemoteAtCommandRequest::broadcastAddress64 = XBeeAddress64(0x0, BROADCAST_ADDRESS);
 
+AtCommandQueueRequest::AtCommandQueueRequest() : AtCommandRequest() {
+	setApiId(AT_COMMAND_QUEUE_REQUEST);
+}
+
+AtCommandQueueRequest::AtCommandQueueRequest(uint8_t *command) : AtCommandRequest(command) {
+	setApiId(AT_COMMAND_QUEUE_REQUEST);
+}
+
+AtCommandQueueRequest::AtCommandQueueRequest(uint8_t *command, uint8_t *commandValue, uint8_t commandValueLength) : AtCommandRequest(command, commandValue, commandValueLength) {
+	setApiId(AT_COMMAND_QUEUE_REQUEST);
+}
+
 RemoteAtCommandRequest::RemoteAtCommandRequest() : AtCommandRequest(NULL, NULL, 0) {
 	_remoteAddress16 = 0;
 	_applyChanges = false;
@@ -1414,15 +1710,66 @@ uint8_t RemoteAtCommandRequest::getFrameDataLength() {
 	return REMOTE_AT_COMMAND_API_LENGTH + getCommandValueLength();
 }
 
+uint8_t RemoteAtCommandRequest::getFrameHeader(uint8_t* header) {
+	uint8_t* p = putAddress64(header, _remoteAddress64);
+
+	p[0] = (_remoteAddress16 >> 8) & 0xff;
+	p[1] = _remoteAddress16 & 0xff;
+	p[2] = _applyChanges ? 2: 0;
+	p[3] = getCommand()[0];
+	p[4] = getCommand()[1];
+
+	return REMOTE_AT_COMMAND_API_LENGTH;
+}
+
 
 // TODO
 //GenericRequest::GenericRequest(uint8_t* frame, uint8_t len, uint8_t apiId): XBeeRequest(apiId, *(frame), len) {
 //	_frame = frame;
 //}
 
-void XBee::send(XBeeRequest &request) {
+void XBeeBase::send(XBeeRequest &request) {
 	// the new new deal
 
+	// start, length, api id, frame id and the fixed part of the frame data are staged here
+	// so the whole frame goes out as two spans: this header and the request's payload
+	uint8_t frame[API_ID_INDEX + 2 + MAX_FRAME_HEADER_LENGTH];
+	uint8_t frameDataLength = request.getFrameDataLength();
+	uint8_t headerLength = request.getFrameHeader(frame + API_ID_INDEX + 2);
+	uint8_t* tail = request.getFrameDataTail();
+
+	if (tail == NULL && headerLength < frameDataLength) {
+		// request doesn't expose its frame as spans
+		sendByByte(request);
+		return;
+	}
+
+	frame[0] = START_BYTE;
+	// send length
+	frame[1] = ((frameDataLength + 2) >> 8) & 0xff;
+	frame[2] = (frameDataLength + 2) & 0xff;
+	// api id
+	frame[3] = request.getApiId();
+	frame[4] = request.getFrameId();
+
+	write(START_BYTE);
+
+	// checksum starts at api id, so take the length bytes back out
+	uint8_t checksum = sendEscaped(frame + 1, API_ID_INDEX + 1 + headerLength) - frame[1] - frame[2];
+	checksum+= sendEscaped(tail, frameDataLength - headerLength);
+
+	// perform 2s complement
+	checksum = 0xff - checksum;
+
+	// send checksum
+	sendByte(checksum, true);
+
+	// send packet (Note: prior to Arduino 1.0 this flushed the incoming buffer, which of course was not so great)
+	flush();
+}
+
+void XBeeBase::sendByByte(XBeeRequest &request) {
+
 	sendByte(START_BYTE, false);
 
 	// send length
@@ -1446,8 +1793,9 @@ void XBee::send(XBeeRequest &request) {
 
 	for (int i = 0; i < request.getFrameDataLength(); i++) {
 //		std::cout << "sending byte [" << static_cast<unsigned int>(i) << "] " << std::endl;
-		sendByte(request.getFrameData(i), true);
-		checksum+= request.getFrameData(i);
+		uint8_t b = request.getFrameData(i);
+		sendByte(b, true);
+		checksum+= b;
 	}
 
 	// perform 2s complement
@@ -1462,9 +1810,51 @@ void XBee::send(XBeeRequest &request) {
 	flush();
 }
 
-void XBee::sendByte(uint8_t b, bool escape) {
+// escapes and writes length bytes of data, writing each run of bytes that needs no escaping with a
+// single Stream write. returns the sum of the unescaped bytes
+uint8_t XBeeBase::sendEscaped(const uint8_t* data, uint8_t length) {
+	uint8_t sum = 0;
+	const uint8_t* run = data;
+	const uint8_t* end = data + length;
+
+	if (_escapeByte != ESCAPE) {
+		// AP=1 sends everything as is
+		for (const uint8_t* p = data; p < end; p++) {
+			sum+= *p;
+		}
+
+		if (length > 0) {
+			_serial->write(data, length);
+		}
+
+		return sum;
+	}
+
+	for (const uint8_t* p = data; p < end; p++) {
+		uint8_t c = *p;
+		sum+= c;
+
+		if (c == START_BYTE || c == ESCAPE || c == XON || c == XOFF) {
+			if (p > run) {
+				_serial->write(run, p - run);
+			}
+
+			write(ESCAPE);
+			write(c ^ 0x20);
+			run = p + 1;
+		}
+	}
+
+	if (end > run) {
+		_serial->write(run, end - run);
+	}
+
+	return sum;
+}
+
+void XBeeBase::sendByte(uint8_t b, bool escape) {
 
-	if (escape && (b == START_BYTE || b == ESCAPE || b == XON || b == XOFF)) {
+	if (escape && _escapeByte == ESCAPE && (b == START_BYTE || b == ESCAPE || b == XON || b == XOFF)) {
 //		std::cout << "escaping byte [" << toHexString(b) << "] " << std::endl;
 		write(ESCAPE);
 		write(b ^ 0x20);
@@ -1473,3 +1863,331 @@ void XBee::sendByte(uint8_t b, bool escape) {
 	}
 }
 
+
+TxWindow::TxWindow(XBeeBase &xbee, uint16_t timeout) {
+	_xbee = &xbee;
+	_timeout = timeout;
+	_callback = NULL;
+	_inFlight = 0;
+	_delivered = 0;
+	_failed = 0;
+	_timeouts = 0;
+	_lastLatency = 0;
+
+	for (uint8_t i = 0; i < TX_WINDOW_SIZE; i++) {
+		_frameIds[i] = NO_RESPONSE_FRAME_ID;
+	}
+}
+
+uint8_t TxWindow::send(XBeeRequest &request) {
+	for (uint8_t i = 0; i < TX_WINDOW_SIZE; i++) {
+		if (_frameIds[i] == NO_RESPONSE_FRAME_ID) {
+			uint8_t frameId = _xbee->getNextFrameId();
+
+			request.setFrameId(frameId);
+			_xbee->send(request);
+
+			_frameIds[i] = frameId;
+			_sentAt[i] = millis();
+			_inFlight++;
+
+			return frameId;
+		}
+	}
+
+	return NO_RESPONSE_FRAME_ID;
+}
+
+bool TxWindow::handleResponse(XBeeResponse &response) {
+	uint8_t status;
+	uint8_t retries = 0;
+
+	if (!response.isAvailable() || _inFlight == 0) {
+		return false;
+	}
+
+	// frame id is the first byte of both status responses
+	if (response.getApiId() == ZB_TX_STATUS_RESPONSE) {
+		retries = response.getFrameData()[3];
+		status = response.getFrameData()[4];
+	} else if (response.getApiId() == TX_STATUS_RESPONSE) {
+		status = response.getFrameData()[1];
+	} else {
+		return false;
+	}
+
+	uint8_t frameId = response.getFrameData()[0];
+
+	for (uint8_t i = 0; i < TX_WINDOW_SIZE; i++) {
+		if (_frameIds[i] == frameId) {
+			complete(i, status, retries);
+			return true;
+		}
+	}
+
+	// late status for a frame that already timed out, or one we didn't send
+	return false;
+}
+
+void TxWindow::poll() {
+	if (_inFlight == 0) {
+		return;
+	}
+
+	unsigned long now = millis();
+
+	for (uint8_t i = 0; i < TX_WINDOW_SIZE; i++) {
+		if (_frameIds[i] != NO_RESPONSE_FRAME_ID && now - _sentAt[i] >= _timeout) {
+			complete(i, TX_STATUS_TIMEOUT, 0);
+		}
+	}
+}
+
+void TxWindow::complete(uint8_t slot, uint8_t status, uint8_t retries) {
+	uint8_t frameId = _frameIds[slot];
+	unsigned long latency = millis() - _sentAt[slot];
+
+	if (latency > 0xffff) {
+		latency = 0xffff;
+	}
+
+	_frameIds[slot] = NO_RESPONSE_FRAME_ID;
+	_inFlight--;
+
+	if (status == SUCCESS) {
+		_delivered++;
+		_lastLatency = latency;
+	} else if (status == TX_STATUS_TIMEOUT) {
+		_timeouts++;
+	} else {
+		_failed++;
+	}
+
+	if (_callback != NULL) {
+		_callback(frameId, status, retries, latency);
+	}
+}
+
+void TxWindow::setCallback(TxStatusCallback callback) {
+	_callback = callback;
+}
+
+bool TxWindow::isFull() {
+	return _inFlight == TX_WINDOW_SIZE;
+}
+
+uint8_t TxWindow::getInFlightCount() {
+	return _inFlight;
+}
+
+uint32_t TxWindow::getDeliveredCount() {
+	return _delivered;
+}
+
+uint32_t TxWindow::getFailedCount() {
+	return _failed;
+}
+
+uint32_t TxWindow::getTimeoutCount() {
+	return _timeouts;
+}
+
+uint16_t TxWindow::getLastLatency() {
+	return _lastLatency;
+}
+
+static uint8_t acCommand[] = {'A','C'};
+static uint8_t wrCommand[] = {'W','R'};
+
+AtCommandBatch::AtCommandBatch(XBeeBase &xbee, uint16_t timeout) {
+	_xbee = &xbee;
+	_timeout = timeout;
+	_callback = NULL;
+	_remote = false;
+	_writeChanges = false;
+	_remoteRequest.setApplyChanges(false);
+	_lastActivity = 0;
+
+	clear();
+}
+
+void AtCommandBatch::setRemoteAddress64(XBeeAddress64 &remoteAddress64) {
+	_remoteRequest.setRemoteAddress64(remoteAddress64);
+	_remote = true;
+}
+
+void AtCommandBatch::setWriteChanges(bool writeChanges) {
+	_writeChanges = writeChanges;
+}
+
+void AtCommandBatch::setCallback(AtCommandCallback callback) {
+	_callback = callback;
+}
+
+bool AtCommandBatch::add(uint8_t *command) {
+	return add(command, NULL, 0);
+}
+
+bool AtCommandBatch::add(uint8_t *command, uint8_t *value, uint8_t valueLength) {
+	if (_count == AT_BATCH_SIZE) {
+		return false;
+	}
+
+	_commands[_count] = command;
+	_values[_count] = value;
+	_valueLengths[_count] = valueLength;
+	_count++;
+
+	return true;
+}
+
+void AtCommandBatch::clear() {
+	_count = 0;
+	_next = 0;
+	_pending = 0;
+	_failed = 0;
+	_sent = false;
+	_applying = false;
+
+	for (uint8_t i = 0; i < AT_BATCH_SIZE + 2; i++) {
+		_frameIds[i] = NO_RESPONSE_FRAME_ID;
+	}
+}
+
+void AtCommandBatch::send() {
+	for (uint8_t i = 0; i < AT_BATCH_SIZE + 2; i++) {
+		_frameIds[i] = NO_RESPONSE_FRAME_ID;
+	}
+
+	_next = 0;
+	_pending = 0;
+	_failed = 0;
+	_applying = false;
+	_sent = true;
+
+	sendNext();
+}
+
+void AtCommandBatch::sendNext() {
+	// back to back: the radio buffers them and answers each in turn
+	while (_failed == 0 && _pending < AT_BATCH_WINDOW && _next < _count) {
+		_frameIds[_next] = sendCommand(_commands[_next], _values[_next], _valueLengths[_next], true);
+		_pending++;
+		_next++;
+	}
+
+	if (_failed > 0 || _pending > 0 || _applying) {
+		return;
+	}
+
+	// every command succeeded: apply the queued values
+	_applying = true;
+
+	_frameIds[AT_BATCH_SIZE] = sendCommand(acCommand, NULL, 0, false);
+	_pending++;
+
+	if (_writeChanges) {
+		_frameIds[AT_BATCH_SIZE + 1] = sendCommand(wrCommand, NULL, 0, false);
+		_pending++;
+	}
+}
+
+uint8_t AtCommandBatch::sendCommand(uint8_t *command, uint8_t *value, uint8_t valueLength, bool queue) {
+	AtCommandRequest* request;
+
+	if (_remote) {
+		request = &_remoteRequest;
+	} else if (queue) {
+		request = &_queueRequest;
+	} else {
+		request = &_localRequest;
+	}
+
+	uint8_t frameId = _xbee->getNextFrameId();
+
+	request->setCommand(command);
+	request->setCommandValue(value);
+	request->setCommandValueLength(valueLength);
+	request->setFrameId(frameId);
+	_xbee->send(*request);
+
+	_lastActivity = millis();
+
+	return frameId;
+}
+
+bool AtCommandBatch::handleResponse(XBeeResponse &response) {
+	if (!response.isAvailable() || _pending == 0) {
+		return false;
+	}
+
+	// frame id is the first byte of both; command, status and value follow, after the addresses for remote
+	uint8_t offset;
+
+	if (!_remote && response.getApiId() == AT_COMMAND_RESPONSE) {
+		offset = 1;
+	} else if (_remote && response.getApiId() == REMOTE_AT_COMMAND_RESPONSE) {
+		offset = 11;
+	} else {
+		return false;
+	}
+
+	if (response.getFrameDataLength() < offset + 3) {
+		return false;
+	}
+
+	uint8_t* frameData = response.getFrameData();
+
+	for (uint8_t i = 0; i < AT_BATCH_SIZE + 2; i++) {
+		if (_frameIds[i] != NO_RESPONSE_FRAME_ID && _frameIds[i] == frameData[0]) {
+			_lastActivity = millis();
+			complete(i, frameData[offset + 2], frameData + offset + 3, response.getFrameDataLength() - offset - 3);
+			sendNext();
+			return true;
+		}
+	}
+
+	// late response to a command that already timed out, or one we didn't send
+	return false;
+}
+
+void AtCommandBatch::poll() {
+	if (_pending == 0 || millis() - _lastActivity < _timeout) {
+		return;
+	}
+
+	for (uint8_t i = 0; i < AT_BATCH_SIZE + 2; i++) {
+		if (_frameIds[i] != NO_RESPONSE_FRAME_ID) {
+			complete(i, AT_STATUS_TIMEOUT, NULL, 0);
+		}
+	}
+}
+
+void AtCommandBatch::complete(uint8_t slot, uint8_t status, uint8_t *value, uint8_t valueLength) {
+	_frameIds[slot] = NO_RESPONSE_FRAME_ID;
+	_pending--;
+
+	if (status != AT_OK) {
+		_failed++;
+	}
+
+	if (slot < _count && _callback != NULL) {
+		_callback(slot, status, value, valueLength);
+	}
+}
+
+bool AtCommandBatch::isDone() {
+	return _sent && _pending == 0;
+}
+
+bool AtCommandBatch::isOk() {
+	return isDone() && _applying && _failed == 0;
+}
+
+uint8_t AtCommandBatch::getFailedCount() {
+	return _failed;
+}
+
+uint8_t AtCommandBatch::getCommandCount() {
+	return _count;
+}
@@ -47,6 +47,16 @@
 // This value is determined by the largest packet size (100 byte payload + 64-bit address + option byte and rssi byte) of a series 1 radio
 #define MAX_FRAME_DATA_SIZE 110
 
+// readPacket() pulls serial data in blocks of up to this many bytes, so runs of frame data can be copied
+// and checksummed in one go instead of stepping the parser byte by byte
+#define READ_BLOCK_SIZE 32
+
+// Number of parsed RX frames readPacket() can hold until they are consumed with getQueuedFrame()/releaseQueuedFrame().
+// Each slot costs MAX_FRAME_DATA_SIZE bytes plus a response, so this is off (0) by default; set it to 2 or more if
+// frames arrive back to back (e.g. a TX status followed by an RX packet) faster than your loop consumes them.
+// Like MAX_FRAME_DATA_SIZE, change it here: it sizes XBeeBase, so every file must see the same value
+#define RX_QUEUE_SIZE 0
+
 #define BROADCAST_ADDRESS 0xffff
 #define ZB_BROADCAST_ADDRESS 0xfffe
 
@@ -56,6 +66,8 @@
 #define TX_64_API_LENGTH 9
 #define AT_COMMAND_API_LENGTH 2
 #define REMOTE_AT_COMMAND_API_LENGTH 13
+// largest fixed (non payload/value) part of the frame data of any request; sizes the send() header buffer
+#define MAX_FRAME_HEADER_LENGTH REMOTE_AT_COMMAND_API_LENGTH
 // start/length(2)/api/frameid/checksum bytes
 #define PACKET_OVERHEAD_LENGTH 6
 // api is always the third byte in packet
@@ -68,6 +80,17 @@
 #define DEFAULT_FRAME_ID 1
 #define NO_RESPONSE_FRAME_ID 0
 
+// Number of frames a TxWindow keeps in flight while waiting for their TX status.
+// Radios buffer only a few frames, so there is little point in going much higher.
+// It sizes TxWindow, so change it here rather than defining it in a sketch
+#define TX_WINDOW_SIZE 4
+
+// Number of commands an AtCommandBatch can hold, and how many it keeps waiting for a response at once.
+// Remote commands queue for the air like TX frames, so the window should not exceed the radio's buffers.
+// They size AtCommandBatch, so change them here rather than defining them in a sketch
+#define AT_BATCH_SIZE 16
+#define AT_BATCH_WINDOW 4
+
 // TODO put in tx16 class
 #define ACK_OPTION 0
 #define DISABLE_ACK_OPTION 1
@@ -137,6 +160,11 @@
 #define AT_INVALID_PARAMETER 3
 #define AT_NO_RESPONSE 4
 
+// TxWindow status for a frame that got no TX status response in time
+#define TX_STATUS_TIMEOUT 0xff
+// AtCommandBatch status for a command that got no response in time
+#define AT_STATUS_TIMEOUT 0xff
+
 #define NO_ERROR 0
 #define CHECKSUM_FAILURE 1
 #define PACKET_EXCEEDS_BYTE_ARRAY_LENGTH 2
@@ -643,6 +671,18 @@ public:
 	 * Returns the size of the api frame (not including frame id or api id or checksum).
 	 */
 	virtual uint8_t getFrameDataLength() = 0;
+	/**
+	 * Copies the fixed part of the frame data (addresses, options, command) into header, which must hold
+	 * MAX_FRAME_HEADER_LENGTH bytes, and returns its length.  The rest of the frame data is the array
+	 * returned by getFrameDataTail().  This lets send() escape and checksum the frame as two contiguous
+	 * spans instead of calling getFrameData(pos) for every byte.
+	 * The default returns 0 and a NULL tail, in which case send() falls back to getFrameData(pos).
+	 */
+	virtual uint8_t getFrameHeader(uint8_t* header);
+	/**
+	 * Returns the variable part of the frame data (payload or command value) that follows the header
+	 */
+	virtual uint8_t* getFrameDataTail();
 	//void reset();
 protected:
 	void setApiId(uint8_t apiId);
@@ -655,7 +695,7 @@ private:
 /**
  * Primary interface for communicating with an XBee Radio.
  * This class provides methods for sending and receiving packets with an XBee radio via the serial port.
- * The XBee radio must be configured in API (packet) mode (AP=2)
+ * The XBee radio must be configured in API (packet) mode (AP=2, or AP=1 with an XBeeRadio<1, ...>)
  * in order to use this software.
  * <p/>
  * Since this code is designed to run on a microcontroller, with only one thread, you are responsible for reading the
@@ -668,14 +708,20 @@ private:
  * This means that you must fully consume the packet prior to calling readPacket(...), because calling
  * readPacket(...) overwrites the previous response.
  * <p/>
- * This class creates an array of size MAX_FRAME_DATA_SIZE for storing the response packet.  You may want
- * to adjust this value to conserve memory.
+ * The XBee class creates an array of size MAX_FRAME_DATA_SIZE for storing the response packet and follows the
+ * ATAP setting.  You may want to adjust these values to conserve memory, or use XBeeRadio to pick the API mode
+ * and frame size per radio.  All radios share this class, so code that talks to a radio should take an XBeeBase&.
+ * <p/>
+ * If RX_QUEUE_SIZE is greater than zero, readPacket() instead parses every available frame into a ring of
+ * RX_QUEUE_SIZE frame buffers.  Frames stay there, in arrival order, until released with releaseQueuedFrame().
+ * getResponse() then returns the oldest queued frame, the same one as getQueuedFrame(), and it stays available
+ * until released.  Frames that fail to parse are counted (getFailedFrameCount()) instead of being reported
+ * through getResponse().isError().
  *
  * \author Andrew Rapp
  */
-class XBee {
+class XBeeBase {
 public:
-	XBee();
 	/**
 	 * Reads all available serial bytes until a packet is parsed, an error occurs, or the buffer is empty.
 	 * You may call <i>xbee</i>.getResponse().isAvailable() after calling this method to determine if
@@ -708,6 +754,8 @@ public:
 	/**
 	 * Returns a reference to the current response
 	 * Note: once readPacket is called again this response will be overwritten!
+	 * With RX_QUEUE_SIZE > 0 this is the oldest queued frame instead, which readPacket() leaves alone;
+	 * it is not available while the queue is empty
 	 */
 	XBeeResponse& getResponse();
 	/**
@@ -723,12 +771,59 @@ public:
 	 * Specify the serial port.  Only relevant for Arduinos that support multiple serial ports (e.g. Mega)
 	 */
 	void setSerial(Stream &serial);
+#if RX_QUEUE_SIZE > 0
+	/**
+	 * Returns the number of parsed frames waiting in the receive queue
+	 */
+	uint8_t getQueuedFrameCount();
+	/**
+	 * Returns the oldest queued frame.  The frame data is not copied; it remains valid until releaseQueuedFrame() is called.
+	 * Use the getXXXResponse methods on it as you would on getResponse().
+	 * Only call this when getQueuedFrameCount() > 0
+	 */
+	XBeeResponse& getQueuedFrame();
+	/**
+	 * Removes the oldest queued frame, making its buffer available to readPacket()
+	 */
+	void releaseQueuedFrame();
+	/**
+	 * Returns the number of valid frames that were discarded because the receive queue was full
+	 */
+	uint16_t getDroppedFrameCount();
+	/**
+	 * Returns the number of frames that were discarded with an error (checksum, length or unexpected start byte)
+	 */
+	uint16_t getFailedFrameCount();
+#endif
+	/**
+	 * Returns the API mode (ATAP) this instance speaks: 1 (unescaped) or 2 (escaped)
+	 */
+	uint8_t getApiMode();
+	/**
+	 * Returns the largest frame data length this instance can receive
+	 */
+	uint8_t getMaxFrameDataSize();
+protected:
+	/**
+	 * frameData must hold frameDataSize bytes and live as long as this object; see XBeeRadio
+	 */
+	XBeeBase(uint8_t apiMode, uint8_t* frameData, uint8_t frameDataSize);
+#if RX_QUEUE_SIZE > 0
+	/**
+	 * Sets the storage for the receive queue: RX_QUEUE_SIZE frames of frameDataSize bytes each
+	 */
+	void setQueueFrameData(uint8_t* queueFrameData);
+#endif
 private:
 	bool available();
 	uint8_t read();
+	bool fillReadBuffer();
+	bool readRun();
 	void flush();
 	void write(uint8_t val);
 	void sendByte(uint8_t b, bool escape);
+	void sendByByte(XBeeRequest &request);
+	uint8_t sendEscaped(const uint8_t* data, uint8_t length);
 	void resetResponse();
 	XBeeResponse _response;
 	bool _escape;
@@ -739,8 +834,64 @@ private:
 	uint8_t _checksumTotal;
 	uint8_t _nextFrameId;
 	// buffer for incoming RX packets.  holds only the api specific frame data, starting after the api id byte and prior to checksum
-	uint8_t _responseFrameData[MAX_FRAME_DATA_SIZE];
+	uint8_t* _responseFrameData;
+	uint8_t _frameDataSize;
+	// bytes that are special inside a frame: START_BYTE and ESCAPE in AP=2.  in AP=1 they are 0x100, which no byte
+	// matches, so the parser and sender need no separate mode test
+	uint16_t _startByte;
+	uint16_t _escapeByte;
 	Stream* _serial;
+	// serial bytes read ahead by readPacket() but not consumed yet
+	uint8_t _readBuffer[READ_BLOCK_SIZE];
+	uint8_t _readPos;
+	uint8_t _readLength;
+#if RX_QUEUE_SIZE > 0
+	void beginQueuedFrame();
+	void endQueuedFrame(bool valid);
+	XBeeResponse _queue[RX_QUEUE_SIZE];
+	// frames are parsed directly into these RX_QUEUE_SIZE buffers; _responseFrameData only receives frames that don't fit
+	uint8_t* _queueFrameData;
+	uint8_t _queueHead;
+	uint8_t _queueCount;
+	uint16_t _droppedFrames;
+	uint16_t _failedFrames;
+#endif
+};
+
+/**
+ * An XBee radio whose API mode and frame size are fixed at compile time.  apiMode is the radio's ATAP
+ * setting (1 or 2) and frameDataSize the largest frame data it needs to receive (at most 250), so a radio on small
+ * frames only uses the RAM it needs, and radios with different settings can coexist in one sketch:
+ * <p/>
+ * XBeeRadio<2, 40> telemetry;
+ * XBeeRadio<1, MAX_FRAME_DATA_SIZE> groundLink;
+ * <p/>
+ * Only the storage is specialised.  The codec in XBeeBase is shared by all radios and turns apiMode into
+ * data once, in the constructor (_startByte/_escapeByte), so its inner loops don't test the mode.  Note that
+ * AP=1 neither escapes nor unescapes any byte.  extras/host/api_mode_test.cpp round trips both modes and
+ * compares the radios' size and speed
+ */
+template <uint8_t apiMode, uint8_t frameDataSize>
+class XBeeRadio : public XBeeBase {
+public:
+	XBeeRadio() : XBeeBase(apiMode, _frameData, frameDataSize) {
+#if RX_QUEUE_SIZE > 0
+		setQueueFrameData(_queueFrameData);
+#endif
+	}
+private:
+	uint8_t _frameData[frameDataSize];
+#if RX_QUEUE_SIZE > 0
+	uint8_t _queueFrameData[RX_QUEUE_SIZE * frameDataSize];
+#endif
+};
+
+/**
+ * The default radio: API mode ATAP and MAX_FRAME_DATA_SIZE frame data
+ */
+class XBee : public XBeeRadio<ATAP, MAX_FRAME_DATA_SIZE> {
+public:
+	XBee();
 };
 
 /**
@@ -800,6 +951,8 @@ public:
 	void setOption(uint8_t option);
 	uint8_t getFrameData(uint8_t pos);
 	uint8_t getFrameDataLength();
+	uint8_t getFrameHeader(uint8_t* header);
+	uint8_t* getFrameDataTail();
 protected:
 private:
 	uint16_t _addr16;
@@ -833,6 +986,8 @@ public:
 	void setOption(uint8_t option);
 	uint8_t getFrameData(uint8_t pos);
 	uint8_t getFrameDataLength();
+	uint8_t getFrameHeader(uint8_t* header);
+	uint8_t* getFrameDataTail();
 private:
 	XBeeAddress64 _addr64;
 	uint8_t _option;
@@ -879,6 +1034,8 @@ protected:
 	// declare virtual functions
 	uint8_t getFrameData(uint8_t pos);
 	uint8_t getFrameDataLength();
+	uint8_t getFrameHeader(uint8_t* header);
+	uint8_t* getFrameDataTail();
 private:
 	XBeeAddress64 _addr64;
 	uint16_t _addr16;
@@ -899,6 +1056,8 @@ public:
 	AtCommandRequest(uint8_t *command, uint8_t *commandValue, uint8_t commandValueLength);
 	uint8_t getFrameData(uint8_t pos);
 	uint8_t getFrameDataLength();
+	uint8_t getFrameHeader(uint8_t* header);
+	uint8_t* getFrameDataTail();
 	uint8_t* getCommand();
 	void setCommand(uint8_t* command);
 	uint8_t* getCommandValue();
@@ -916,6 +1075,18 @@ private:
 	uint8_t _commandValueLength;
 };
 
+/**
+ * Represents an AT Command Queue Parameter Value TX packet.  Works like AtCommandRequest, except that a
+ * value set is only queued: the radio applies all queued values on the next AC (or AT command that
+ * applies changes).  Queries are answered as usual
+ */
+class AtCommandQueueRequest : public AtCommandRequest {
+public:
+	AtCommandQueueRequest();
+	AtCommandQueueRequest(uint8_t *command);
+	AtCommandQueueRequest(uint8_t *command, uint8_t *commandValue, uint8_t commandValueLength);
+};
+
 /**
  * Represents an Remote AT Command TX packet
  * The command is used to configure a remote XBee radio
@@ -951,6 +1122,7 @@ public:
 	void setApplyChanges(bool applyChanges);
 	uint8_t getFrameData(uint8_t pos);
 	uint8_t getFrameDataLength();
+	uint8_t getFrameHeader(uint8_t* header);
 	static XBeeAddress64 broadcastAddress64;
 //	static uint16_t broadcast16Address;
 private:
@@ -959,6 +1131,187 @@ private:
 	bool _applyChanges;
 };
 
+/**
+ * Called by TxWindow when a frame completes: with its frame id, delivery status (SUCCESS, a TX status
+ * code, or TX_STATUS_TIMEOUT), the radio's transmit retry count (ZB only, 0 otherwise) and the milliseconds
+ * between send and status
+ */
+typedef void (*TxStatusCallback)(uint8_t frameId, uint8_t status, uint8_t retries, uint16_t latency);
+
+/**
+ * Keeps up to TX_WINDOW_SIZE frames in flight instead of waiting for each TX status before sending the next.
+ * send() gives each request a frame id from getNextFrameId() and remembers when it was sent; pass every
+ * response to handleResponse(), which matches TX status responses (Series 1 and ZB) back to their frame,
+ * and call poll() so frames whose status never arrives time out.
+ * <p/>
+ * xbee.readPacket();
+ * if (xbee.getResponse().isAvailable() && !txWindow.handleResponse(xbee.getResponse())) {
+ *   // not a TX status for us; handle RX packets etc. here
+ * }
+ * txWindow.poll();
+ * if (!txWindow.isFull()) {
+ *   txWindow.send(zbTx);
+ * }
+ */
+class TxWindow {
+public:
+	/**
+	 * timeout is how long to wait for a TX status, in milliseconds.  ZB unicasts with retries and
+	 * route discovery can take several seconds
+	 */
+	TxWindow(XBeeBase &xbee, uint16_t timeout);
+	/**
+	 * Sends the request with a new frame id and returns the id, or returns 0 without sending if the window is full
+	 */
+	uint8_t send(XBeeRequest &request);
+	/**
+	 * Returns true if the response was a TX status for a frame in the window, which is then complete
+	 */
+	bool handleResponse(XBeeResponse &response);
+	/**
+	 * Times out frames that have waited longer than the timeout for their status
+	 */
+	void poll();
+	void setCallback(TxStatusCallback callback);
+	bool isFull();
+	uint8_t getInFlightCount();
+	uint32_t getDeliveredCount();
+	/**
+	 * Returns the number of frames whose TX status reported a failure
+	 */
+	uint32_t getFailedCount();
+	uint32_t getTimeoutCount();
+	/**
+	 * Returns the latency of the most recently delivered frame, in milliseconds
+	 */
+	uint16_t getLastLatency();
+private:
+	void complete(uint8_t slot, uint8_t status, uint8_t retries);
+	XBeeBase* _xbee;
+	uint16_t _timeout;
+	TxStatusCallback _callback;
+	// frame id of each slot; NO_RESPONSE_FRAME_ID when free
+	uint8_t _frameIds[TX_WINDOW_SIZE];
+	unsigned long _sentAt[TX_WINDOW_SIZE];
+	uint8_t _inFlight;
+	uint32_t _delivered;
+	uint32_t _failed;
+	uint32_t _timeouts;
+	uint16_t _lastLatency;
+};
+
+/**
+ * Called by AtCommandBatch when a command is answered: with its index in the batch, its status (AT_OK,
+ * an AT error code, or AT_STATUS_TIMEOUT) and the value returned by a query (length 0 for a set)
+ */
+typedef void (*AtCommandCallback)(uint8_t index, uint8_t status, uint8_t *value, uint8_t valueLength);
 
+/**
+ * Configures a radio, local or remote, with a list of AT commands pipelined instead of sent one at a time:
+ * up to AT_BATCH_WINDOW commands wait for their response at once, each with its own frame id, so the
+ * responses can come back in any order and the next command is already queued in the radio when one is
+ * answered.  That saves a serial round trip per command locally, and an RF round trip per command remotely.
+ * <p/>
+ * Values are only queued while the batch runs (AT_COMMAND_QUEUE_REQUEST locally, apply changes off remotely).
+ * Once every command has answered AT_OK the batch sends AC, and WR if setWriteChanges(true).  After a
+ * failure the rest of the commands are not sent and the batch sends no AC, but the values the radio already
+ * queued (including those of commands still in the window when the failure came back) stay pending: the
+ * radio's next AC, WR or immediate AT command applies them.  To discard them, reset the radio (FR, or a
+ * power cycle) before sending it anything else; it then comes back with the values last written.
+ * <p/>
+ * uint8_t myValue[] = { 0x12, 0x34 };
+ * batch.add(myCmd, myValue, sizeof(myValue));
+ * batch.add(slCmd);
+ * batch.send();
+ * while (!batch.isDone()) {
+ *   xbee.readPacket();
+ *   if (xbee.getResponse().isAvailable()) {
+ *     batch.handleResponse(xbee.getResponse());
+ *   }
+ *   batch.poll();
+ * }
+ */
+class AtCommandBatch {
+public:
+	/**
+	 * timeout is how long to wait for the next response, in milliseconds.  Remote commands need an RF
+	 * round trip, and more when routes have to be discovered
+	 */
+	AtCommandBatch(XBeeBase &xbee, uint16_t timeout);
+	/**
+	 * Sends the batch to a remote radio instead of the local one
+	 */
+	void setRemoteAddress64(XBeeAddress64 &remoteAddress64);
+	/**
+	 * Also saves the values to non-volatile memory once they are applied
+	 */
+	void setWriteChanges(bool writeChanges);
+	void setCallback(AtCommandCallback callback);
+	/**
+	 * Adds a query.  See add(uint8_t*, uint8_t*, uint8_t)
+	 */
+	bool add(uint8_t *command);
+	/**
+	 * Adds a command, setting a value if valueLength > 0.  command and value are not copied and must stay
+	 * valid until the batch is done.  Returns false if the batch already holds AT_BATCH_SIZE commands
+	 */
+	bool add(uint8_t *command, uint8_t *value, uint8_t valueLength);
+	/**
+	 * Removes all commands
+	 */
+	void clear();
+	/**
+	 * Starts the batch, sending the first AT_BATCH_WINDOW commands.  The rest go out as responses arrive
+	 */
+	void send();
+	/**
+	 * Returns true if the response was to one of the batch's commands
+	 */
+	bool handleResponse(XBeeResponse &response);
+	/**
+	 * Times out commands that got no response
+	 */
+	void poll();
+	/**
+	 * Returns true once every command is answered and the changes applied, or a command failed or timed out
+	 */
+	bool isDone();
+	/**
+	 * Returns true if the batch is done, every command succeeded and the changes were applied
+	 */
+	bool isOk();
+	/**
+	 * Returns the number of commands (including AC and WR) that failed or timed out
+	 */
+	uint8_t getFailedCount();
+	uint8_t getCommandCount();
+private:
+	void sendNext();
+	uint8_t sendCommand(uint8_t *command, uint8_t *value, uint8_t valueLength, bool queue);
+	void complete(uint8_t slot, uint8_t status, uint8_t *value, uint8_t valueLength);
+	XBeeBase* _xbee;
+	uint16_t _timeout;
+	AtCommandCallback _callback;
+	AtCommandQueueRequest _queueRequest;
+	AtCommandRequest _localRequest;
+	RemoteAtCommandRequest _remoteRequest;
+	bool _remote;
+	bool _writeChanges;
+	uint8_t* _commands[AT_BATCH_SIZE];
+	uint8_t* _values[AT_BATCH_SIZE];
+	uint8_t _valueLengths[AT_BATCH_SIZE];
+	// frame id of each command, then AC and WR; NO_RESPONSE_FRAME_ID once answered
+	uint8_t _frameIds[AT_BATCH_SIZE + 2];
+	uint8_t _count;
+	// next command to send
+	uint8_t _next;
+	uint8_t _pending;
+	uint8_t _failed;
+	bool _sent;
+	// AC (and WR) sent
+	bool _applying;
+	// time of the last send or response
+	unsigned long _lastActivity;
+};
 
 #endif //XBee_h
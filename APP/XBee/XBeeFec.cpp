@@ -0,0 +1,511 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "XBeeFec.h"
+
+#if defined(ARDUINO) && ARDUINO >= 100
+	#include "Arduino.h"
+#else
+	#include "WProgram.h"
+#endif
+
+#if defined(__AVR__)
+	#include <avr/pgmspace.h>
+#endif
+
+#ifndef pgm_read_byte
+	#define PROGMEM
+	#define pgm_read_byte(address) (*(const uint8_t*)(address))
+#endif
+
+// GF(256) with the polynomial x^8 + x^4 + x^3 + x^2 + 1 (0x11d) and generator 2
+static const uint8_t gfExpTable[255] PROGMEM = {
+	0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1d, 0x3a, 0x74, 0xe8, 0xcd, 0x87, 0x13, 0x26,
+	0x4c, 0x98, 0x2d, 0x5a, 0xb4, 0x75, 0xea, 0xc9, 0x8f, 0x03, 0x06, 0x0c, 0x18, 0x30, 0x60, 0xc0,
+	0x9d, 0x27, 0x4e, 0x9c, 0x25, 0x4a, 0x94, 0x35, 0x6a, 0xd4, 0xb5, 0x77, 0xee, 0xc1, 0x9f, 0x23,
+	0x46, 0x8c, 0x05, 0x0a, 0x14, 0x28, 0x50, 0xa0, 0x5d, 0xba, 0x69, 0xd2, 0xb9, 0x6f, 0xde, 0xa1,
+	0x5f, 0xbe, 0x61, 0xc2, 0x99, 0x2f, 0x5e, 0xbc, 0x65, 0xca, 0x89, 0x0f, 0x1e, 0x3c, 0x78, 0xf0,
+	0xfd, 0xe7, 0xd3, 0xbb, 0x6b, 0xd6, 0xb1, 0x7f, 0xfe, 0xe1, 0xdf, 0xa3, 0x5b, 0xb6, 0x71, 0xe2,
+	0xd9, 0xaf, 0x43, 0x86, 0x11, 0x22, 0x44, 0x88, 0x0d, 0x1a, 0x34, 0x68, 0xd0, 0xbd, 0x67, 0xce,
+	0x81, 0x1f, 0x3e, 0x7c, 0xf8, 0xed, 0xc7, 0x93, 0x3b, 0x76, 0xec, 0xc5, 0x97, 0x33, 0x66, 0xcc,
+	0x85, 0x17, 0x2e, 0x5c, 0xb8, 0x6d, 0xda, 0xa9, 0x4f, 0x9e, 0x21, 0x42, 0x84, 0x15, 0x2a, 0x54,
+	0xa8, 0x4d, 0x9a, 0x29, 0x52, 0xa4, 0x55, 0xaa, 0x49, 0x92, 0x39, 0x72, 0xe4, 0xd5, 0xb7, 0x73,
+	0xe6, 0xd1, 0xbf, 0x63, 0xc6, 0x91, 0x3f, 0x7e, 0xfc, 0xe5, 0xd7, 0xb3, 0x7b, 0xf6, 0xf1, 0xff,
+	0xe3, 0xdb, 0xab, 0x4b, 0x96, 0x31, 0x62, 0xc4, 0x95, 0x37, 0x6e, 0xdc, 0xa5, 0x57, 0xae, 0x41,
+	0x82, 0x19, 0x32, 0x64, 0xc8, 0x8d, 0x07, 0x0e, 0x1c, 0x38, 0x70, 0xe0, 0xdd, 0xa7, 0x53, 0xa6,
+	0x51, 0xa2, 0x59, 0xb2, 0x79, 0xf2, 0xf9, 0xef, 0xc3, 0x9b, 0x2b, 0x56, 0xac, 0x45, 0x8a, 0x09,
+	0x12, 0x24, 0x48, 0x90, 0x3d, 0x7a, 0xf4, 0xf5, 0xf7, 0xf3, 0xfb, 0xeb, 0xcb, 0x8b, 0x0b, 0x16,
+	0x2c, 0x58, 0xb0, 0x7d, 0xfa, 0xe9, 0xcf, 0x83, 0x1b, 0x36, 0x6c, 0xd8, 0xad, 0x47, 0x8e
+};
+
+static const uint8_t gfLogTable[256] PROGMEM = {
+	0x00, 0x00, 0x01, 0x19, 0x02, 0x32, 0x1a, 0xc6, 0x03, 0xdf, 0x33, 0xee, 0x1b, 0x68, 0xc7, 0x4b,
+	0x04, 0x64, 0xe0, 0x0e, 0x34, 0x8d, 0xef, 0x81, 0x1c, 0xc1, 0x69, 0xf8, 0xc8, 0x08, 0x4c, 0x71,
+	0x05, 0x8a, 0x65, 0x2f, 0xe1, 0x24, 0x0f, 0x21, 0x35, 0x93, 0x8e, 0xda, 0xf0, 0x12, 0x82, 0x45,
+	0x1d, 0xb5, 0xc2, 0x7d, 0x6a, 0x27, 0xf9, 0xb9, 0xc9, 0x9a, 0x09, 0x78, 0x4d, 0xe4, 0x72, 0xa6,
+	0x06, 0xbf, 0x8b, 0x62, 0x66, 0xdd, 0x30, 0xfd, 0xe2, 0x98, 0x25, 0xb3, 0x10, 0x91, 0x22, 0x88,
+	0x36, 0xd0, 0x94, 0xce, 0x8f, 0x96, 0xdb, 0xbd, 0xf1, 0xd2, 0x13, 0x5c, 0x83, 0x38, 0x46, 0x40,
+	0x1e, 0x42, 0xb6, 0xa3, 0xc3, 0x48, 0x7e, 0x6e, 0x6b, 0x3a, 0x28, 0x54, 0xfa, 0x85, 0xba, 0x3d,
+	0xca, 0x5e, 0x9b, 0x9f, 0x0a, 0x15, 0x79, 0x2b, 0x4e, 0xd4, 0xe5, 0xac, 0x73, 0xf3, 0xa7, 0x57,
+	0x07, 0x70, 0xc0, 0xf7, 0x8c, 0x80, 0x63, 0x0d, 0x67, 0x4a, 0xde, 0xed, 0x31, 0xc5, 0xfe, 0x18,
+	0xe3, 0xa5, 0x99, 0x77, 0x26, 0xb8, 0xb4, 0x7c, 0x11, 0x44, 0x92, 0xd9, 0x23, 0x20, 0x89, 0x2e,
+	0x37, 0x3f, 0xd1, 0x5b, 0x95, 0xbc, 0xcf, 0xcd, 0x90, 0x87, 0x97, 0xb2, 0xdc, 0xfc, 0xbe, 0x61,
+	0xf2, 0x56, 0xd3, 0xab, 0x14, 0x2a, 0x5d, 0x9e, 0x84, 0x3c, 0x39, 0x53, 0x47, 0x6d, 0x41, 0xa2,
+	0x1f, 0x2d, 0x43, 0xd8, 0xb7, 0x7b, 0xa4, 0x76, 0xc4, 0x17, 0x49, 0xec, 0x7f, 0x0c, 0x6f, 0xf6,
+	0x6c, 0xa1, 0x3b, 0x52, 0x29, 0x9d, 0x55, 0xaa, 0xfb, 0x60, 0x86, 0xb1, 0xbb, 0xcc, 0x3e, 0x5a,
+	0xcb, 0x59, 0x5f, 0xb0, 0x9c, 0xa9, 0xa0, 0x51, 0x0b, 0xf5, 0x16, 0xeb, 0x7a, 0x75, 0x2c, 0xd7,
+	0x4f, 0xae, 0xd5, 0xe9, 0xe6, 0xe7, 0xad, 0xe8, 0x74, 0xd6, 0xf4, 0xea, 0xa8, 0x50, 0x58, 0xaf
+};
+
+// log of zero, which doesn't exist
+#define GF_LOG_ZERO 0xff
+
+static uint8_t gfExp(uint16_t power) {
+	return pgm_read_byte(gfExpTable + power % 255);
+}
+
+static uint8_t gfLog(uint8_t value) {
+	return value == 0 ? GF_LOG_ZERO : pgm_read_byte(gfLogTable + value);
+}
+
+// multiplies value by the element whose log is given
+static uint8_t gfMulLog(uint8_t value, uint8_t log) {
+	if (value == 0 || log == GF_LOG_ZERO) {
+		return 0;
+	}
+
+	uint16_t sum = pgm_read_byte(gfLogTable + value) + log;
+
+	return pgm_read_byte(gfExpTable + (sum >= 255 ? sum - 255 : sum));
+}
+
+static uint8_t gfMul(uint8_t a, uint8_t b) {
+	return gfMulLog(a, gfLog(b));
+}
+
+static uint8_t gfInverse(uint8_t value) {
+	return gfExp(255 - gfLog(value));
+}
+
+FecEncoder::FecEncoder(XBeeBase &xbee, PayloadRequest &request, uint8_t *buffer, uint8_t bufferSize, uint8_t *parity, uint8_t dataFrames, uint8_t parityFrames) {
+	_xbee = &xbee;
+	_request = &request;
+	_buffer = buffer;
+	_bufferSize = bufferSize;
+	_parity = parity;
+	_parityFrames = parityFrames < 1 ? 1 : parityFrames > FEC_MAX_PARITY ? FEC_MAX_PARITY : parityFrames;
+	_dataFrames = dataFrames < 1 ? 1 : dataFrames > FEC_MAX_GROUP - _parityFrames ? FEC_MAX_GROUP - _parityFrames : dataFrames;
+	_group = 0;
+	_count = 0;
+	_width = 0;
+	_frames = 0;
+	_parityFrameCount = 0;
+	_enabled = true;
+	_enableLoss = 0;
+	_disableLoss = 0;
+	_loss = 0;
+
+	// generator polynomial (x - 1)(x - 2)...(x - 2^(parityFrames - 1)); g[i] is the coefficient of x^i
+	uint8_t g[FEC_MAX_PARITY + 1];
+
+	memset(g, 0, sizeof(g));
+	g[0] = 1;
+
+	for (uint8_t i = 0; i < _parityFrames; i++) {
+		uint8_t root = gfExp(i);
+
+		for (uint8_t j = i + 1; j > 0; j--) {
+			g[j] = g[j - 1] ^ gfMul(g[j], root);
+		}
+
+		g[0] = gfMul(g[0], root);
+	}
+
+	// highest power first, leaving out the leading 1, as the remainder is shifted
+	for (uint8_t i = 0; i < _parityFrames; i++) {
+		_generator[i] = gfLog(g[_parityFrames - 1 - i]);
+	}
+
+	memset(_parity, 0, _parityFrames * (getMaxDataLength() + 1));
+}
+
+uint8_t FecEncoder::getMaxDataLength() {
+	return _bufferSize > FEC_HEADER_LENGTH ? _bufferSize - FEC_HEADER_LENGTH - 1 : 0;
+}
+
+bool FecEncoder::send(const uint8_t *data, uint8_t length) {
+	if (length > getMaxDataLength()) {
+		return false;
+	}
+
+	if (!_enabled) {
+		memcpy(_buffer, data, length);
+		_request->setPayload(_buffer);
+		_request->setPayloadLength(length);
+		_xbee->send(*_request);
+		_frames++;
+		return true;
+	}
+
+	memcpy(_buffer + FEC_HEADER_LENGTH, data, length);
+
+	// byte 0 of each codeword position is the length, so a rebuilt payload gets its length back
+	if (length + 1 > _width) {
+		_width = length + 1;
+	}
+
+	for (uint8_t p = 0; p < _width; p++) {
+		uint8_t symbol = p == 0 ? length : p <= length ? data[p - 1] : 0;
+		uint8_t* r = _parity + p * _parityFrames;
+		uint8_t feedback = symbol ^ r[0];
+
+		for (uint8_t i = 0; i < _parityFrames - 1; i++) {
+			r[i] = r[i + 1] ^ gfMulLog(feedback, _generator[i]);
+		}
+
+		r[_parityFrames - 1] = gfMulLog(feedback, _generator[_parityFrames - 1]);
+	}
+
+	_buffer[3] = _dataFrames;
+	sendFrame(_count, FEC_HEADER_LENGTH + length);
+	_frames++;
+	_count++;
+
+	if (_count == _dataFrames) {
+		flush();
+	}
+
+	return true;
+}
+
+void FecEncoder::flush() {
+	if (_count == 0) {
+		return;
+	}
+
+	// parity frames carry the number of data frames the group really had
+	_buffer[3] = _count;
+
+	for (uint8_t i = 0; i < _parityFrames; i++) {
+		for (uint8_t p = 0; p < _width; p++) {
+			_buffer[FEC_HEADER_LENGTH + p] = _parity[p * _parityFrames + i];
+		}
+
+		sendFrame(_count + i, FEC_HEADER_LENGTH + _width);
+		_parityFrameCount++;
+	}
+
+	memset(_parity, 0, _parityFrames * _width);
+	_group++;
+	_count = 0;
+	_width = 0;
+}
+
+void FecEncoder::sendFrame(uint8_t index, uint8_t length) {
+	_buffer[0] = FEC_ID;
+	_buffer[1] = _group;
+	_buffer[2] = index;
+	_buffer[4] = _parityFrames;
+
+	_request->setPayload(_buffer);
+	_request->setPayloadLength(length);
+	_xbee->send(*_request);
+}
+
+void FecEncoder::setEnabled(bool enabled) {
+	if (!enabled) {
+		flush();
+	}
+
+	_enabled = enabled;
+}
+
+bool FecEncoder::isEnabled() {
+	return _enabled;
+}
+
+void FecEncoder::setAdaptive(uint8_t enablePercent, uint8_t disablePercent) {
+	_enableLoss = enablePercent;
+	_disableLoss = disablePercent;
+}
+
+void FecEncoder::handleDelivery(bool delivered) {
+	// each report moves the average 1/64 of the way, so one lost frame in a clean run reads as 1.5%
+	int32_t target = delivered ? 0 : 0xffff;
+	_loss+= (target - _loss) / 64;
+
+	if (_enableLoss == 0) {
+		return;
+	}
+
+	uint8_t loss = getLossPercent();
+
+	if (!_enabled && loss > _enableLoss) {
+		setEnabled(true);
+	} else if (_enabled && loss < _disableLoss) {
+		setEnabled(false);
+	}
+}
+
+uint8_t FecEncoder::getLossPercent() {
+	return (uint32_t(_loss) * 100 + 0x8000) >> 16;
+}
+
+uint32_t FecEncoder::getFrameCount() {
+	return _frames;
+}
+
+uint32_t FecEncoder::getParityFrameCount() {
+	return _parityFrameCount;
+}
+
+FecDecoder::FecDecoder(uint8_t *buffer, uint8_t maxDataLength, uint8_t dataFrames, uint8_t parityFrames, FecDataCallback callback) {
+	_buffer = buffer;
+	_width = maxDataLength + 1;
+	_dataFrames = dataFrames;
+	_parityFrames = parityFrames;
+	_callback = callback;
+	_active = false;
+	_group = 0;
+	_groupDataFrames = 0;
+	_received = 0;
+	_recovered = 0;
+	_lost = 0;
+}
+
+bool FecDecoder::handlePayload(const uint8_t *data, uint8_t length) {
+	if (length < FEC_HEADER_LENGTH || data[0] != FEC_ID) {
+		return false;
+	}
+
+	uint8_t group = data[1];
+	uint8_t index = data[2];
+	uint8_t dataFrames = data[3];
+	uint8_t count = length - FEC_HEADER_LENGTH;
+
+	if (data[4] != _parityFrames || dataFrames > _dataFrames || index >= dataFrames + _parityFrames || count > _width) {
+		// not ours
+		return true;
+	}
+
+	if (_active && group != _group) {
+		if (uint8_t(group - _group) > 0x80) {
+			// straggler from a group that is already done
+			return true;
+		}
+
+		flush();
+	}
+
+	if (!_active) {
+		_active = true;
+		_group = group;
+		_groupDataFrames = 0;
+		_received = 0;
+		memset(_buffer, 0, (_dataFrames + _parityFrames) * _width);
+	}
+
+	if ((_received >> index) & 1) {
+		return true;
+	}
+
+	uint8_t* slot = _buffer + index * _width;
+
+	if (index < dataFrames) {
+		// data: a length byte then the payload, as the encoder saw it
+		if (count + 1 > _width) {
+			return true;
+		}
+
+		slot[0] = count;
+		memcpy(slot + 1, data + FEC_HEADER_LENGTH, count);
+		_callback(data + FEC_HEADER_LENGTH, count, false);
+	} else {
+		_groupDataFrames = dataFrames;
+		memcpy(slot, data + FEC_HEADER_LENGTH, count);
+	}
+
+	_received|= uint32_t(1) << index;
+
+	if (_groupDataFrames > 0) {
+		recover();
+	}
+
+	return true;
+}
+
+void FecDecoder::recover() {
+	uint8_t n = _groupDataFrames + _parityFrames;
+	uint8_t missing[FEC_MAX_PARITY];
+	uint8_t erasures = 0;
+	bool missingData = false;
+
+	for (uint8_t t = 0; t < n; t++) {
+		if (!((_received >> t) & 1)) {
+			if (erasures == _parityFrames) {
+				// too many gone, for now
+				return;
+			}
+
+			missing[erasures++] = t;
+			missingData|= t < _groupDataFrames;
+		}
+	}
+
+	if (!missingData) {
+		return;
+	}
+
+	// frame t holds the coefficient of x^(n - 1 - t), and every codeword has roots 2^0..2^(parityFrames - 1),
+	// so sum over frames of c[t] * X[t]^i = 0 with X[t] = 2^(n - 1 - t).  Moving the received frames to the
+	// right hand side leaves erasures equations in erasures unknowns: A x = S, with A[i][j] = X[missing j]^i
+	uint8_t a[FEC_MAX_PARITY][FEC_MAX_PARITY];
+	uint8_t inverse[FEC_MAX_PARITY][FEC_MAX_PARITY];
+
+	for (uint8_t i = 0; i < erasures; i++) {
+		for (uint8_t j = 0; j < erasures; j++) {
+			a[i][j] = gfExp(uint16_t(i) * (n - 1 - missing[j]));
+			inverse[i][j] = i == j;
+		}
+	}
+
+	// Gauss-Jordan; a Vandermonde matrix with distinct X is never singular
+	for (uint8_t col = 0; col < erasures; col++) {
+		uint8_t pivot = col;
+
+		while (a[pivot][col] == 0) {
+			pivot++;
+		}
+
+		for (uint8_t j = 0; j < erasures; j++) {
+			uint8_t swap = a[col][j];
+			a[col][j] = a[pivot][j];
+			a[pivot][j] = swap;
+			swap = inverse[col][j];
+			inverse[col][j] = inverse[pivot][j];
+			inverse[pivot][j] = swap;
+		}
+
+		uint8_t scale = gfInverse(a[col][col]);
+
+		for (uint8_t j = 0; j < erasures; j++) {
+			a[col][j] = gfMul(a[col][j], scale);
+			inverse[col][j] = gfMul(inverse[col][j], scale);
+		}
+
+		for (uint8_t i = 0; i < erasures; i++) {
+			uint8_t factor = a[i][col];
+
+			if (i == col || factor == 0) {
+				continue;
+			}
+
+			for (uint8_t j = 0; j < erasures; j++) {
+				a[i][j]^= gfMul(a[col][j], factor);
+				inverse[i][j]^= gfMul(inverse[col][j], factor);
+			}
+		}
+	}
+
+	// logs of X[t]^i for the received frames, and of the inverse, so the loop below is lookups only
+	uint8_t powers[FEC_MAX_GROUP][FEC_MAX_PARITY];
+	uint8_t inverseLog[FEC_MAX_PARITY][FEC_MAX_PARITY];
+
+	for (uint8_t t = 0; t < n; t++) {
+		for (uint8_t i = 0; i < erasures; i++) {
+			powers[t][i] = (uint16_t(i) * (n - 1 - t)) % 255;
+		}
+	}
+
+	for (uint8_t i = 0; i < erasures; i++) {
+		for (uint8_t j = 0; j < erasures; j++) {
+			inverseLog[i][j] = gfLog(inverse[i][j]);
+		}
+	}
+
+	for (uint8_t p = 0; p < _width; p++) {
+		uint8_t syndromes[FEC_MAX_PARITY];
+
+		memset(syndromes, 0, sizeof(syndromes));
+
+		for (uint8_t t = 0; t < n; t++) {
+			uint8_t c = _buffer[t * _width + p];
+
+			if (c == 0 || !((_received >> t) & 1)) {
+				continue;
+			}
+
+			for (uint8_t i = 0; i < erasures; i++) {
+				syndromes[i]^= gfMulLog(c, powers[t][i]);
+			}
+		}
+
+		for (uint8_t j = 0; j < erasures; j++) {
+			uint8_t value = 0;
+
+			for (uint8_t i = 0; i < erasures; i++) {
+				value^= gfMulLog(syndromes[i], inverseLog[j][i]);
+			}
+
+			_buffer[missing[j] * _width + p] = value;
+		}
+	}
+
+	for (uint8_t j = 0; j < erasures; j++) {
+		uint8_t* slot = _buffer + missing[j] * _width;
+
+		_received|= uint32_t(1) << missing[j];
+
+		if (missing[j] < _groupDataFrames && slot[0] < _width) {
+			_recovered++;
+			_callback(slot + 1, slot[0], true);
+		}
+	}
+}
+
+void FecDecoder::flush() {
+	if (!_active) {
+		return;
+	}
+
+	// without a parity frame the group's size is unknown; count up to the last data frame seen
+	uint8_t dataFrames = _groupDataFrames;
+
+	if (dataFrames == 0) {
+		for (uint8_t t = 0; t < _dataFrames; t++) {
+			if ((_received >> t) & 1) {
+				dataFrames = t + 1;
+			}
+		}
+	}
+
+	for (uint8_t t = 0; t < dataFrames; t++) {
+		if (!((_received >> t) & 1)) {
+			_lost++;
+		}
+	}
+
+	_active = false;
+}
+
+uint32_t FecDecoder::getRecoveredCount() {
+	return _recovered;
+}
+
+uint32_t FecDecoder::getLostCount() {
+	return _lost;
+}
@@ -0,0 +1,175 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XBeeFec_h
+#define XBeeFec_h
+
+#include "XBee.h"
+
+// first byte of every FEC payload
+#define FEC_ID 0xfe
+// FEC id, group, index in the group, data frames in the group, parity frames in the group
+#define FEC_HEADER_LENGTH 5
+// largest number of parity frames per group
+#define FEC_MAX_PARITY 4
+// largest group, data + parity frames
+#define FEC_MAX_GROUP 32
+
+/**
+ * Called by FecDecoder with each data payload: as it arrives, or later, when it was lost and has been
+ * rebuilt from the rest of its group (recovered is true)
+ */
+typedef void (*FecDataCallback)(const uint8_t *data, uint8_t length, bool recovered);
+
+/**
+ * Adds Reed-Solomon parity frames to a stream of payloads, so the receiver can rebuild lost ones.
+ * <p/>
+ * Radios drop RF frames that fail their CRC, so on a marginal link bit errors show up as lost frames,
+ * not corrupted payloads.  The code therefore runs across frames: after every dataFrames payloads,
+ * parityFrames parity frames follow, and any dataFrames frames of a group are enough to rebuild the
+ * others.  Byte j of every frame in a group forms one RS(dataFrames + parityFrames, dataFrames) codeword
+ * over GF(256), so a lost frame is one erasure in each codeword.
+ * <p/>
+ * Data frames go out as soon as send() is called, so FEC adds no delay while nothing is lost.  The encoder
+ * keeps a running remainder per byte position: parity must hold parityFrames * (getMaxDataLength() + 1)
+ * bytes; 2 parity frames for a 72 byte payload need 134 bytes of RAM.  The GF(256) tables are in flash.
+ * <p/>
+ * FEC buys fewer gaps, not more data.  In extras/host/fec_benchmark, RS(10,8) delivers a larger share of the
+ * payloads than plain frames at every bit error rate above 0, but fewer payloads per second at every one of
+ * them (e.g. 74.0/s against 84.9/s at 2e-4), because the parity frames take air time from new data.  Where
+ * the radio can retry (ZB, or Series 1 with MAC retries) retries do better on both counts.  So only use FEC
+ * when lost payloads can't be retried, and consider setAdaptive(), which leaves it off while the link is
+ * clean.
+ */
+class FecEncoder {
+public:
+	/**
+	 * Frames are built in buffer, which should be the radio's maximum payload, and sent with request
+	 */
+	FecEncoder(XBeeBase &xbee, PayloadRequest &request, uint8_t *buffer, uint8_t bufferSize, uint8_t *parity, uint8_t dataFrames, uint8_t parityFrames);
+	/**
+	 * Sends a data payload, followed by the group's parity frames if it completes a group.  Returns false if
+	 * length is over getMaxDataLength()
+	 */
+	bool send(const uint8_t *data, uint8_t length);
+	/**
+	 * Ends the group early: sends its parity frames now
+	 */
+	void flush();
+	/**
+	 * Returns the largest payload send() accepts: the buffer less the header and the parity frames' length byte
+	 */
+	uint8_t getMaxDataLength();
+	/**
+	 * Turns the parity frames on (the default) or off.  While off, send() sends each payload as it is, with
+	 * no FEC header, so FecDecoder::handlePayload() returns false for it.  Turning FEC off ends the current
+	 * group first.  Payloads must not start with FEC_ID, or the receiver may take them for FEC frames
+	 */
+	void setEnabled(bool enabled);
+	bool isEnabled();
+	/**
+	 * Turns FEC on once the loss reported through handleDelivery() goes over enablePercent, and off again
+	 * once it falls under disablePercent.  setAdaptive(0, 0) stops switching
+	 */
+	void setAdaptive(uint8_t enablePercent, uint8_t disablePercent);
+	/**
+	 * Reports whether a frame sent through this encoder was delivered, e.g. from its TX status
+	 * (the request needs a frame id for that, and the radio no MAC retries for the loss to show)
+	 */
+	void handleDelivery(bool delivered);
+	/**
+	 * Returns the share of frames lost, in percent, averaged over roughly the last 64 handleDelivery() reports
+	 */
+	uint8_t getLossPercent();
+	uint32_t getFrameCount();
+	uint32_t getParityFrameCount();
+private:
+	void sendFrame(uint8_t index, uint8_t length);
+	XBeeBase* _xbee;
+	PayloadRequest* _request;
+	uint8_t* _buffer;
+	uint8_t _bufferSize;
+	// remainder of each byte position, parityFrames bytes each
+	uint8_t* _parity;
+	uint8_t _dataFrames;
+	uint8_t _parityFrames;
+	// generator polynomial, without its leading 1; log of each coefficient
+	uint8_t _generator[FEC_MAX_PARITY];
+	uint8_t _group;
+	uint8_t _count;
+	// longest payload in the group, plus its length byte
+	uint8_t _width;
+	uint32_t _frames;
+	uint32_t _parityFrameCount;
+	bool _enabled;
+	uint8_t _enableLoss;
+	uint8_t _disableLoss;
+	// moving average of lost frames, 0xffff is all of them
+	uint16_t _loss;
+};
+
+/**
+ * Receives the frames of a FecEncoder and passes the data payloads to a callback, rebuilding lost ones
+ * once enough of their group has arrived.  dataFrames and parityFrames must match the sender's, and
+ * buffer must hold (dataFrames + parityFrames) * (maxDataLength + 1) bytes, where maxDataLength is the
+ * sender's getMaxDataLength():
+ * <p/>
+ * if (!fec.handlePayload(rx.getData(), rx.getDataLength())) {
+ *   // not FEC
+ * }
+ * <p/>
+ * Recovering takes a few microseconds per frame on a PC: syndromes, then a small matrix solved once per
+ * group and applied to every byte position.
+ */
+class FecDecoder {
+public:
+	FecDecoder(uint8_t *buffer, uint8_t maxDataLength, uint8_t dataFrames, uint8_t parityFrames, FecDataCallback callback);
+	/**
+	 * Returns true if the payload was an FEC frame
+	 */
+	bool handlePayload(const uint8_t *data, uint8_t length);
+	/**
+	 * Finishes the current group, recovering what can be recovered.  Call when the link goes quiet, otherwise
+	 * a group finishes when the next one starts
+	 */
+	void flush();
+	/**
+	 * Returns the number of data payloads rebuilt
+	 */
+	uint32_t getRecoveredCount();
+	/**
+	 * Returns the number of data payloads lost for good: their group lost more frames than it had parity
+	 */
+	uint32_t getLostCount();
+private:
+	void recover();
+	uint8_t* _buffer;
+	uint8_t _width;
+	uint8_t _dataFrames;
+	uint8_t _parityFrames;
+	FecDataCallback _callback;
+	bool _active;
+	uint8_t _group;
+	// data frames in the current group, from its parity frames' header; 0 until one arrives
+	uint8_t _groupDataFrames;
+	// bit i: frame i of the group has arrived
+	uint32_t _received;
+	uint32_t _recovered;
+	uint32_t _lost;
+};
+
+#endif //XBeeFec_h
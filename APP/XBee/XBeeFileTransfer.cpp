@@ -0,0 +1,398 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "XBeeFileTransfer.h"
+
+#if defined(ARDUINO) && ARDUINO >= 100
+	#include "Arduino.h"
+#else
+	#include "WProgram.h"
+#endif
+
+static uint32_t getUint32(const uint8_t *data) {
+	return (uint32_t(data[0]) << 24) + (uint32_t(data[1]) << 16) + (uint16_t(data[2]) << 8) + data[3];
+}
+
+static void putUint32(uint8_t *data, uint32_t value) {
+	data[0] = (value >> 24) & 0xff;
+	data[1] = (value >> 16) & 0xff;
+	data[2] = (value >> 8) & 0xff;
+	data[3] = value & 0xff;
+}
+
+FileDownlink::FileDownlink(XBeeBase &xbee, PayloadRequest &request, uint8_t *buffer, uint8_t bufferSize, FileReadCallback read, uint32_t fileSize, uint16_t retransmitTimeout) {
+	_xbee = &xbee;
+	_request = &request;
+	_buffer = buffer;
+	_blockSize = bufferSize - FILE_DOWNLINK_HEADER_LENGTH;
+	_read = read;
+	_fileSize = fileSize;
+	_timeout = retransmitTimeout;
+	_active = false;
+	_infoDue = false;
+	_start = 0;
+	_baseBlock = 0;
+	_nextBlock = 0;
+	_acked = 0;
+	_lost = 0;
+	_seq = 0;
+	_sentBlocks = 0;
+	_retransmits = 0;
+	_readErrors = 0;
+}
+
+uint32_t FileDownlink::blockOffset(uint32_t block) {
+	return _start + block * _blockSize;
+}
+
+bool FileDownlink::handlePayload(const uint8_t *data, uint8_t length) {
+	if (length >= FILE_DOWNLINK_HEADER_LENGTH && data[0] == FILE_DOWNLINK_REQUEST) {
+		uint32_t offset = getUint32(data + 1);
+
+		if (offset > _fileSize) {
+			offset = _fileSize;
+		}
+
+		// new or resumed transfer, or a receiver that restarted: whatever it asks for, begin() cleared
+		// its bitmap, so the window starts over at its offset.  blocks already in flight still count
+		// when they arrive, since they are on the same grid
+		_start = offset;
+		_baseBlock = 0;
+		_nextBlock = 0;
+		_acked = 0;
+		_lost = 0;
+
+		_active = true;
+		_infoDue = true;
+
+		return true;
+	}
+
+	if (length < FILE_DOWNLINK_ACK_LENGTH || data[0] != FILE_DOWNLINK_ACK) {
+		return false;
+	}
+
+	uint32_t offset = getUint32(data + 1);
+	uint16_t received = (data[5] << 8) + data[6];
+
+	if (!_active || offset < blockOffset(_baseBlock)) {
+		// stale
+		return true;
+	}
+
+	if (offset >= _fileSize) {
+		// all there
+		_baseBlock = _nextBlock;
+		_active = false;
+		return true;
+	}
+
+	if ((offset - _start) % _blockSize != 0) {
+		// not on our block grid; from an older transfer
+		return true;
+	}
+
+	// slide the window up to the receiver's first missing block
+	uint32_t shift = (offset - _start) / _blockSize - _baseBlock;
+
+	if (shift >= FILE_DOWNLINK_WINDOW) {
+		_acked = 0;
+		_lost = 0;
+	} else {
+		_acked >>= shift;
+		_lost >>= shift;
+	}
+
+	_baseBlock+= shift;
+
+	if (_nextBlock < _baseBlock) {
+		_nextBlock = _baseBlock;
+	}
+
+	_acked|= received;
+
+	// anything sent before the last acknowledged block that is still missing was lost
+	uint16_t lastSeq = 0;
+	bool haveLast = false;
+
+	for (uint8_t i = 0; i < FILE_DOWNLINK_WINDOW && _baseBlock + i < _nextBlock; i++) {
+		uint16_t seq = _sendSeq[(_baseBlock + i) % FILE_DOWNLINK_WINDOW];
+
+		if ((received >> i) & 1 && (!haveLast || int16_t(seq - lastSeq) > 0)) {
+			lastSeq = seq;
+			haveLast = true;
+		}
+	}
+
+	if (haveLast) {
+		for (uint8_t i = 0; i < FILE_DOWNLINK_WINDOW && _baseBlock + i < _nextBlock; i++) {
+			if (!((_acked >> i) & 1) && int16_t(_sendSeq[(_baseBlock + i) % FILE_DOWNLINK_WINDOW] - lastSeq) < 0) {
+				_lost|= 1 << i;
+			}
+		}
+	}
+
+	return true;
+}
+
+void FileDownlink::poll() {
+	if (!_active) {
+		return;
+	}
+
+	if (_infoDue) {
+		_buffer[0] = FILE_DOWNLINK_INFO;
+		putUint32(_buffer + 1, _fileSize);
+		_buffer[5] = _blockSize;
+
+		_request->setPayload(_buffer);
+		_request->setPayloadLength(FILE_DOWNLINK_INFO_LENGTH);
+		_request->setFrameId(NO_RESPONSE_FRAME_ID);
+		_xbee->send(*_request);
+
+		_infoDue = false;
+		return;
+	}
+
+	// lost blocks first, lowest offset first
+	uint16_t lost = _lost & ~_acked;
+
+	if (lost != 0) {
+		uint8_t i = 0;
+
+		while (!((lost >> i) & 1)) {
+			i++;
+		}
+
+		if (sendBlock(_baseBlock + i)) {
+			_lost&= ~(1 << i);
+			_retransmits++;
+		}
+
+		return;
+	}
+
+	// then the oldest block whose ACK is overdue
+	uint16_t now = millis();
+
+	for (uint8_t i = 0; i < FILE_DOWNLINK_WINDOW && _baseBlock + i < _nextBlock; i++) {
+		if (!((_acked >> i) & 1) && uint16_t(now - _sentAt[(_baseBlock + i) % FILE_DOWNLINK_WINDOW]) >= _timeout) {
+			if (sendBlock(_baseBlock + i)) {
+				_retransmits++;
+			}
+
+			return;
+		}
+	}
+
+	// then a new block, if the window has room
+	if (_nextBlock < _baseBlock + FILE_DOWNLINK_WINDOW && blockOffset(_nextBlock) < _fileSize && sendBlock(_nextBlock)) {
+		_nextBlock++;
+	}
+}
+
+bool FileDownlink::sendBlock(uint32_t block) {
+	uint32_t offset = blockOffset(block);
+	uint8_t length = _blockSize;
+
+	if (_fileSize - offset < length) {
+		length = _fileSize - offset;
+	}
+
+	_buffer[0] = FILE_DOWNLINK_DATA;
+	putUint32(_buffer + 1, offset);
+
+	if (_read(offset, _buffer + FILE_DOWNLINK_HEADER_LENGTH, length) != length) {
+		// failed or short read: hold the block, the next poll() tries again
+		_readErrors++;
+		return false;
+	}
+
+	_request->setPayload(_buffer);
+	_request->setPayloadLength(FILE_DOWNLINK_HEADER_LENGTH + length);
+	_request->setFrameId(NO_RESPONSE_FRAME_ID);
+	_xbee->send(*_request);
+
+	_sendSeq[block % FILE_DOWNLINK_WINDOW] = _seq++;
+	_sentAt[block % FILE_DOWNLINK_WINDOW] = millis();
+	_sentBlocks++;
+
+	return true;
+}
+
+bool FileDownlink::isActive() {
+	return _active;
+}
+
+uint32_t FileDownlink::getAckedOffset() {
+	uint32_t offset = blockOffset(_baseBlock);
+
+	return offset < _fileSize ? offset : _fileSize;
+}
+
+uint32_t FileDownlink::getSentBlockCount() {
+	return _sentBlocks;
+}
+
+uint32_t FileDownlink::getRetransmitCount() {
+	return _retransmits;
+}
+
+uint32_t FileDownlink::getReadErrorCount() {
+	return _readErrors;
+}
+
+FileDownlinkReceiver::FileDownlinkReceiver(XBeeBase &xbee, PayloadRequest &request, uint8_t *buffer, FileWriteCallback write, uint16_t ackDelay) {
+	_xbee = &xbee;
+	_request = &request;
+	_buffer = buffer;
+	_write = write;
+	_ackDelay = ackDelay;
+	_started = false;
+	_haveInfo = false;
+	_fileSize = 0;
+	_blockSize = 0;
+	_offset = 0;
+	_received = 0;
+	_unacked = 0;
+	_lastSend = 0;
+}
+
+void FileDownlinkReceiver::begin(uint32_t offset) {
+	_started = true;
+	_haveInfo = false;
+	_offset = offset;
+	_received = 0;
+	_unacked = 0;
+
+	sendRequest();
+}
+
+bool FileDownlinkReceiver::handlePayload(const uint8_t *data, uint8_t length) {
+	if (length >= FILE_DOWNLINK_INFO_LENGTH && data[0] == FILE_DOWNLINK_INFO) {
+		if (_started && data[5] > 0) {
+			_fileSize = getUint32(data + 1);
+			_blockSize = data[5];
+			_haveInfo = true;
+		}
+
+		return true;
+	}
+
+	if (length < FILE_DOWNLINK_HEADER_LENGTH || data[0] != FILE_DOWNLINK_DATA) {
+		return false;
+	}
+
+	if (!_haveInfo) {
+		// can't place blocks until we know the block size; poll() repeats the request
+		return true;
+	}
+
+	uint32_t offset = getUint32(data + 1);
+	uint8_t dataLength = length - FILE_DOWNLINK_HEADER_LENGTH;
+
+	if (offset < _offset || (offset - _offset) % _blockSize != 0) {
+		// duplicate, or from an older transfer.  the sender is missing an ACK
+		sendAck();
+		return true;
+	}
+
+	uint32_t block = (offset - _offset) / _blockSize;
+
+	if (block >= FILE_DOWNLINK_WINDOW || offset >= _fileSize) {
+		return true;
+	}
+
+	if (dataLength != (_fileSize - offset < _blockSize ? _fileSize - offset : _blockSize)) {
+		// not a whole block: drop it, and the sender sends it again like a lost one
+		return true;
+	}
+
+	if (!((_received >> block) & 1)) {
+		_write(offset, data + FILE_DOWNLINK_HEADER_LENGTH, dataLength);
+		_received|= 1 << block;
+	}
+
+	// move past every block received without a gap
+	while (_received & 1) {
+		_offset+= _blockSize;
+		_received>>= 1;
+	}
+
+	if (_offset > _fileSize) {
+		_offset = _fileSize;
+	}
+
+	_unacked++;
+
+	if (block > 0 || isComplete() || _unacked >= FILE_DOWNLINK_WINDOW / 4) {
+		sendAck();
+	}
+
+	return true;
+}
+
+void FileDownlinkReceiver::poll() {
+	if (!_started || millis() - _lastSend < _ackDelay) {
+		return;
+	}
+
+	if (!_haveInfo) {
+		sendRequest();
+	} else if (_unacked > 0) {
+		sendAck();
+	}
+}
+
+void FileDownlinkReceiver::sendRequest() {
+	_buffer[0] = FILE_DOWNLINK_REQUEST;
+	putUint32(_buffer + 1, _offset);
+
+	_request->setPayload(_buffer);
+	_request->setPayloadLength(FILE_DOWNLINK_HEADER_LENGTH);
+	_request->setFrameId(NO_RESPONSE_FRAME_ID);
+	_xbee->send(*_request);
+
+	_lastSend = millis();
+}
+
+void FileDownlinkReceiver::sendAck() {
+	_buffer[0] = FILE_DOWNLINK_ACK;
+	putUint32(_buffer + 1, _offset);
+	_buffer[5] = (_received >> 8) & 0xff;
+	_buffer[6] = _received & 0xff;
+
+	_request->setPayload(_buffer);
+	_request->setPayloadLength(FILE_DOWNLINK_ACK_LENGTH);
+	_request->setFrameId(NO_RESPONSE_FRAME_ID);
+	_xbee->send(*_request);
+
+	_unacked = 0;
+	_lastSend = millis();
+}
+
+bool FileDownlinkReceiver::isComplete() {
+	return _haveInfo && _offset >= _fileSize;
+}
+
+uint32_t FileDownlinkReceiver::getFileSize() {
+	return _fileSize;
+}
+
+uint32_t FileDownlinkReceiver::getOffset() {
+	return _offset;
+}
@@ -0,0 +1,178 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XBeeFileTransfer_h
+#define XBeeFileTransfer_h
+
+#include "XBee.h"
+
+/**
+ * File downlink message ids, the first byte of each payload.  Offsets and sizes are 4 bytes, msb first
+ */
+// receiver -> sender: id, offset to start (or resume) from
+#define FILE_DOWNLINK_REQUEST 0xf0
+// sender -> receiver: id, file size, block size
+#define FILE_DOWNLINK_INFO 0xf1
+// sender -> receiver: id, offset, block data
+#define FILE_DOWNLINK_DATA 0xf2
+// receiver -> sender: id, offset of the first missing byte, 16-bit bitmap (msb first) of the blocks received after it
+#define FILE_DOWNLINK_ACK 0xf3
+
+// id + offset
+#define FILE_DOWNLINK_HEADER_LENGTH 5
+#define FILE_DOWNLINK_INFO_LENGTH 6
+#define FILE_DOWNLINK_ACK_LENGTH 7
+// blocks in flight; one bit each in the ACK bitmap
+#define FILE_DOWNLINK_WINDOW 16
+
+/**
+ * Reads length bytes at offset of the file being sent into buffer; returns the number of bytes read
+ */
+typedef int (*FileReadCallback)(uint32_t offset, uint8_t *buffer, uint8_t length);
+/**
+ * Stores length received bytes at offset of the file.  Blocks can arrive out of order, but each is delivered once
+ */
+typedef void (*FileWriteCallback)(uint32_t offset, const uint8_t *data, uint8_t length);
+
+/**
+ * Sends a file to a FileDownlinkReceiver with a sliding window of FILE_DOWNLINK_WINDOW blocks and
+ * selective acknowledgements, so the link stays busy while ACKs are on their way and only lost
+ * blocks are sent again.  The receiver starts the transfer, at any offset, so an interrupted
+ * download resumes where it stopped.
+ * <p/>
+ * Blocks fill the payload buffer, which should be the radio's maximum payload; they are read
+ * straight into it by the read callback (e.g. SdBaseFile::seekSet + read), so the sender keeps
+ * no copy of the file.  A block that is not acknowledged is read again when it is resent.  If the
+ * callback fails (returns less than the bytes asked for) the block is held back and read again.
+ * <p/>
+ * Pass the payload of every RX packet to handlePayload() and call poll() from loop(); each poll()
+ * sends at most one frame.
+ */
+class FileDownlink {
+public:
+	/**
+	 * request carries the frames to the receiver; it is sent without a frame id, since the protocol
+	 * does its own acknowledgements.  retransmitTimeout is in milliseconds
+	 */
+	FileDownlink(XBeeBase &xbee, PayloadRequest &request, uint8_t *buffer, uint8_t bufferSize, FileReadCallback read, uint32_t fileSize, uint16_t retransmitTimeout);
+	/**
+	 * Returns true if the payload was a file downlink message (a request or an ACK)
+	 */
+	bool handlePayload(const uint8_t *data, uint8_t length);
+	/**
+	 * Sends the next frame that is due, if any
+	 */
+	void poll();
+	/**
+	 * Returns true while a transfer has been requested and not fully acknowledged
+	 */
+	bool isActive();
+	/**
+	 * Returns the number of bytes the receiver has acknowledged, counted from the start of the file
+	 */
+	uint32_t getAckedOffset();
+	uint32_t getSentBlockCount();
+	uint32_t getRetransmitCount();
+	/**
+	 * Returns the number of times the read callback failed or came up short; the block is read again
+	 */
+	uint32_t getReadErrorCount();
+private:
+	uint32_t blockOffset(uint32_t block);
+	bool sendBlock(uint32_t block);
+	XBeeBase* _xbee;
+	PayloadRequest* _request;
+	uint8_t* _buffer;
+	uint8_t _blockSize;
+	FileReadCallback _read;
+	uint32_t _fileSize;
+	uint16_t _timeout;
+	bool _active;
+	bool _infoDue;
+	// offset the receiver asked to start from; blocks are numbered from here
+	uint32_t _start;
+	// first block not acknowledged yet
+	uint32_t _baseBlock;
+	// first block never sent
+	uint32_t _nextBlock;
+	// bit i is block _baseBlock + i
+	uint16_t _acked;
+	uint16_t _lost;
+	// per block, indexed by block % FILE_DOWNLINK_WINDOW: send order and time of the last send
+	uint16_t _sendSeq[FILE_DOWNLINK_WINDOW];
+	uint16_t _sentAt[FILE_DOWNLINK_WINDOW];
+	uint16_t _seq;
+	uint32_t _sentBlocks;
+	uint32_t _retransmits;
+	uint32_t _readErrors;
+};
+
+/**
+ * Receives a file from a FileDownlink.  Call begin() with the number of bytes already saved (0 for a new
+ * download), pass the payload of every RX packet to handlePayload() and call poll() from loop().
+ * Received blocks go to the write callback as they arrive.
+ */
+class FileDownlinkReceiver {
+public:
+	/**
+	 * request carries requests and ACKs to the sender; buffer must hold FILE_DOWNLINK_ACK_LENGTH bytes.
+	 * ackDelay (milliseconds) is how long an in-order block may wait before it is acknowledged; out of
+	 * order blocks are acknowledged at once so the sender learns about losses quickly
+	 */
+	FileDownlinkReceiver(XBeeBase &xbee, PayloadRequest &request, uint8_t *buffer, FileWriteCallback write, uint16_t ackDelay);
+	/**
+	 * Asks the sender for the file, starting at offset
+	 */
+	void begin(uint32_t offset);
+	/**
+	 * Returns true if the payload was a file downlink message (file info or data).  A data block that is
+	 * not a whole block (blockSize bytes, or the rest of the file) is dropped
+	 */
+	bool handlePayload(const uint8_t *data, uint8_t length);
+	/**
+	 * Repeats the request until the sender answers, and sends delayed ACKs
+	 */
+	void poll();
+	bool isComplete();
+	/**
+	 * Returns the file size, once the sender has reported it
+	 */
+	uint32_t getFileSize();
+	/**
+	 * Returns the number of bytes received without gaps from the start of the file; resume from here
+	 */
+	uint32_t getOffset();
+private:
+	void sendRequest();
+	void sendAck();
+	XBeeBase* _xbee;
+	PayloadRequest* _request;
+	uint8_t* _buffer;
+	FileWriteCallback _write;
+	uint16_t _ackDelay;
+	bool _started;
+	bool _haveInfo;
+	uint32_t _fileSize;
+	uint8_t _blockSize;
+	uint32_t _offset;
+	// bit i is the block at _offset + i * _blockSize
+	uint16_t _received;
+	uint8_t _unacked;
+	unsigned long _lastSend;
+};
+
+#endif //XBeeFileTransfer_h
@@ -0,0 +1,318 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "XBeeTelemetry.h"
+
+#if defined(ARDUINO) && ARDUINO >= 100
+	#include "Arduino.h"
+#else
+	#include "WProgram.h"
+#endif
+
+TelemetryPacketizer::TelemetryPacketizer(XBeeBase &xbee, PayloadRequest &request, uint8_t *buffer, uint8_t bufferSize, uint16_t maxDelay) {
+	_xbee = &xbee;
+	_request = &request;
+	_buffer = buffer;
+	_bufferSize = bufferSize;
+	_maxDelay = maxDelay;
+	_length = 0;
+	_sampleCount = 0;
+	_baseTime = 0;
+	_frameCount = 0;
+	_sentSampleCount = 0;
+}
+
+bool TelemetryPacketizer::add(uint8_t source, const uint8_t *data, uint8_t length) {
+	return add(source, millis(), data, length);
+}
+
+bool TelemetryPacketizer::add(uint8_t source, uint32_t timestamp, const uint8_t *data, uint8_t length) {
+	uint16_t recordLength = TELEMETRY_RECORD_HEADER_LENGTH + length;
+
+	if (TELEMETRY_BATCH_HEADER_LENGTH + recordLength > _bufferSize) {
+		// would not fit even in an empty batch
+		return false;
+	}
+
+	// offsets are 16 bits and can't go backwards
+	uint32_t offset = timestamp - _baseTime;
+
+	if (_sampleCount > 0 && (_length + recordLength > _bufferSize || offset > 0xffff)) {
+		flush();
+	}
+
+	if (_sampleCount == 0) {
+		_baseTime = timestamp;
+		offset = 0;
+
+		_buffer[0] = TELEMETRY_BATCH_ID;
+		_buffer[1] = (timestamp >> 24) & 0xff;
+		_buffer[2] = (timestamp >> 16) & 0xff;
+		_buffer[3] = (timestamp >> 8) & 0xff;
+		_buffer[4] = timestamp & 0xff;
+		_length = TELEMETRY_BATCH_HEADER_LENGTH;
+	}
+
+	uint8_t* record = _buffer + _length;
+
+	record[0] = source;
+	record[1] = (offset >> 8) & 0xff;
+	record[2] = offset & 0xff;
+	record[3] = length;
+	memcpy(record + TELEMETRY_RECORD_HEADER_LENGTH, data, length);
+
+	_length+= recordLength;
+	_sampleCount++;
+
+	if (_length + TELEMETRY_RECORD_HEADER_LENGTH > _bufferSize) {
+		// not even an empty sample fits any more
+		flush();
+	}
+
+	return true;
+}
+
+void TelemetryPacketizer::poll() {
+	if (_sampleCount > 0 && millis() - _baseTime >= _maxDelay) {
+		flush();
+	}
+}
+
+void TelemetryPacketizer::flush() {
+	if (_sampleCount == 0) {
+		return;
+	}
+
+	_request->setPayload(_buffer);
+	_request->setPayloadLength(_length);
+	_xbee->send(*_request);
+
+	_frameCount++;
+	_sentSampleCount+= _sampleCount;
+	_sampleCount = 0;
+	_length = 0;
+}
+
+uint8_t TelemetryPacketizer::getSampleCount() {
+	return _sampleCount;
+}
+
+uint32_t TelemetryPacketizer::getFrameCount() {
+	return _frameCount;
+}
+
+uint32_t TelemetryPacketizer::getSentSampleCount() {
+	return _sentSampleCount;
+}
+
+TelemetryUnpacker::TelemetryUnpacker(const uint8_t *payload, uint8_t length) {
+	_payload = payload;
+	_length = length;
+	_next = TELEMETRY_BATCH_HEADER_LENGTH;
+	_record = 0;
+	_baseTime = 0;
+
+	if (isBatch()) {
+		_baseTime = (uint32_t(payload[1]) << 24) + (uint32_t(payload[2]) << 16) + (uint16_t(payload[3]) << 8) + payload[4];
+	}
+}
+
+bool TelemetryUnpacker::isBatch() {
+	return _length >= TELEMETRY_BATCH_HEADER_LENGTH && _payload[0] == TELEMETRY_BATCH_ID;
+}
+
+bool TelemetryUnpacker::next() {
+	if (!isBatch() || _next + TELEMETRY_RECORD_HEADER_LENGTH > _length) {
+		return false;
+	}
+
+	uint16_t end = _next + TELEMETRY_RECORD_HEADER_LENGTH + _payload[_next + 3];
+
+	if (end > _length) {
+		// truncated record
+		return false;
+	}
+
+	_record = _next;
+	_next = end;
+
+	return true;
+}
+
+uint8_t TelemetryUnpacker::getSource() {
+	return _payload[_record];
+}
+
+uint32_t TelemetryUnpacker::getTimestamp() {
+	return _baseTime + (uint16_t(_payload[_record + 1]) << 8) + _payload[_record + 2];
+}
+
+const uint8_t* TelemetryUnpacker::getData() {
+	return _payload + _record + TELEMETRY_RECORD_HEADER_LENGTH;
+}
+
+uint8_t TelemetryUnpacker::getDataLength() {
+	return _payload[_record + 3];
+}
+
+// zigzag maps small values of either sign to small unsigned values: 0, -1, 1, -2 -> 0, 1, 2, 3
+static uint32_t zigzag(int32_t value) {
+	return (uint32_t(value) << 1) ^ uint32_t(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value) {
+	return int32_t(value >> 1) ^ -int32_t(value & 1);
+}
+
+TelemetryEncoder::TelemetryEncoder(int32_t *previous, uint8_t channels) {
+	_previous = previous;
+	_channels = channels > TELEMETRY_MAX_CHANNELS ? TELEMETRY_MAX_CHANNELS : channels;
+	_buffer = NULL;
+	_size = 0;
+	_length = 0;
+	_recordCount = 0;
+}
+
+void TelemetryEncoder::begin(uint8_t *buffer, uint8_t size) {
+	_buffer = buffer;
+	_size = size;
+	_recordCount = 0;
+	_length = 0;
+
+	if (size >= TELEMETRY_DELTA_HEADER_LENGTH) {
+		buffer[0] = TELEMETRY_DELTA_ID;
+		buffer[1] = _channels;
+		_length = TELEMETRY_DELTA_HEADER_LENGTH;
+	}
+}
+
+bool TelemetryEncoder::add(const int32_t *values) {
+	if (_length < TELEMETRY_DELTA_HEADER_LENGTH) {
+		return false;
+	}
+
+	uint8_t maskLength = (_channels + 7) >> 3;
+	// 16 bits: with a buffer of up to 255 bytes, _length + maskLength must not wrap past the size check
+	uint16_t pos = _length + maskLength;
+
+	if (pos > _size) {
+		return false;
+	}
+
+	uint8_t* mask = _buffer + _length;
+	memset(mask, 0, maskLength);
+
+	for (uint8_t i = 0; i < _channels; i++) {
+		// keyframes are coded against zero
+		uint32_t code = zigzag(_recordCount == 0 ? values[i] : int32_t(uint32_t(values[i]) - uint32_t(_previous[i])));
+
+		if (code == 0) {
+			continue;
+		}
+
+		mask[i >> 3] |= 1 << (i & 7);
+
+		do {
+			if (pos == _size) {
+				// doesn't fit; _length and _previous are untouched so the payload stays as it was
+				return false;
+			}
+
+			_buffer[pos++] = (code & 0x7f) | (code > 0x7f ? 0x80 : 0);
+			code >>= 7;
+		} while (code != 0);
+	}
+
+	memcpy(_previous, values, _channels * sizeof(int32_t));
+	_length = pos;
+	_recordCount++;
+
+	return true;
+}
+
+void TelemetryEncoder::setPayload(PayloadRequest &request) {
+	request.setPayload(_buffer);
+	request.setPayloadLength(_length);
+}
+
+uint8_t* TelemetryEncoder::getPayload() {
+	return _buffer;
+}
+
+uint8_t TelemetryEncoder::getLength() {
+	return _length;
+}
+
+uint8_t TelemetryEncoder::getRecordCount() {
+	return _recordCount;
+}
+
+uint8_t TelemetryEncoder::getChannelCount() {
+	return _channels;
+}
+
+TelemetryDecoder::TelemetryDecoder(const uint8_t *payload, uint8_t length, int32_t *values, uint8_t channels) {
+	_payload = payload;
+	_length = length;
+	_pos = TELEMETRY_DELTA_HEADER_LENGTH;
+	_values = values;
+	_channels = channels;
+	_keyframe = true;
+}
+
+bool TelemetryDecoder::isValid() {
+	return _length >= TELEMETRY_DELTA_HEADER_LENGTH && _payload[0] == TELEMETRY_DELTA_ID && _payload[1] == _channels;
+}
+
+bool TelemetryDecoder::next() {
+	uint8_t maskLength = (_channels + 7) >> 3;
+
+	if (!isValid() || _pos + maskLength > _length) {
+		return false;
+	}
+
+	const uint8_t* mask = _payload + _pos;
+	uint8_t pos = _pos + maskLength;
+
+	for (uint8_t i = 0; i < _channels; i++) {
+		uint32_t code = 0;
+
+		if (mask[i >> 3] & (1 << (i & 7))) {
+			uint8_t shift = 0;
+			uint8_t b;
+
+			do {
+				if (pos == _length || shift > 28) {
+					// truncated or corrupt; leave the position so next() keeps failing
+					return false;
+				}
+
+				b = _payload[pos++];
+				code |= uint32_t(b & 0x7f) << shift;
+				shift+= 7;
+			} while (b & 0x80);
+		}
+
+		int32_t value = unzigzag(code);
+		_values[i] = _keyframe ? value : int32_t(uint32_t(_values[i]) + uint32_t(value));
+	}
+
+	_pos = pos;
+	_keyframe = false;
+
+	return true;
+}
@@ -0,0 +1,207 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XBeeTelemetry_h
+#define XBeeTelemetry_h
+
+#include "XBee.h"
+
+// first byte of every batch payload, so the ground side can tell batches from other payloads
+#define TELEMETRY_BATCH_ID 0xb1
+// batch id + 32-bit base timestamp
+#define TELEMETRY_BATCH_HEADER_LENGTH 5
+// source id + 16-bit time offset + data length
+#define TELEMETRY_RECORD_HEADER_LENGTH 4
+// first byte of every delta encoded payload
+#define TELEMETRY_DELTA_ID 0xd1
+// delta id + channel count
+#define TELEMETRY_DELTA_HEADER_LENGTH 2
+// largest number of channels in a delta encoded record
+#define TELEMETRY_MAX_CHANNELS 32
+
+/**
+ * Gathers small timestamped samples from several sources into one payload and sends it with a
+ * PayloadRequest (ZBTxRequest, Tx64Request or Tx16Request) when it is full or the oldest sample is
+ * maxDelay milliseconds old.  One frame then carries many samples instead of one, so the API and RF
+ * headers are paid once per batch.
+ * <p/>
+ * The payload is self describing, so TelemetryUnpacker can split it back into samples:
+ * <p/>
+ * TELEMETRY_BATCH_ID, base timestamp (4 bytes, msb first), then one record per sample:
+ * source id, milliseconds since the base timestamp (2 bytes, msb first), data length, data
+ * <p/>
+ * The buffer should be no larger than the radio's maximum payload (100 bytes for Series 1; ATNP on ZB radios).
+ */
+class TelemetryPacketizer {
+public:
+	TelemetryPacketizer(XBeeBase &xbee, PayloadRequest &request, uint8_t *buffer, uint8_t bufferSize, uint16_t maxDelay);
+	/**
+	 * Adds a sample taken now.  See add(uint8_t, uint32_t, const uint8_t*, uint8_t)
+	 */
+	bool add(uint8_t source, const uint8_t *data, uint8_t length);
+	/**
+	 * Adds a sample from source, taken at timestamp (millis()).  Sends the current batch first if the sample
+	 * doesn't fit in it.  Returns false if the sample is too large for an empty batch.
+	 */
+	bool add(uint8_t source, uint32_t timestamp, const uint8_t *data, uint8_t length);
+	/**
+	 * Sends the batch if its oldest sample has waited maxDelay milliseconds.  Call this from loop()
+	 */
+	void poll();
+	/**
+	 * Sends the batch now, if it holds any samples
+	 */
+	void flush();
+	/**
+	 * Returns the number of samples waiting in the current batch
+	 */
+	uint8_t getSampleCount();
+	/**
+	 * Returns the number of frames sent
+	 */
+	uint32_t getFrameCount();
+	/**
+	 * Returns the number of samples sent
+	 */
+	uint32_t getSentSampleCount();
+private:
+	XBeeBase* _xbee;
+	PayloadRequest* _request;
+	uint8_t* _buffer;
+	uint8_t _bufferSize;
+	uint8_t _length;
+	uint8_t _sampleCount;
+	uint16_t _maxDelay;
+	uint32_t _baseTime;
+	uint32_t _frameCount;
+	uint32_t _sentSampleCount;
+};
+
+/**
+ * Splits a payload built by TelemetryPacketizer back into its samples:
+ * <p/>
+ * TelemetryUnpacker batch = TelemetryUnpacker(rx.getData(), rx.getDataLength());
+ * while (batch.next()) {
+ *   use batch.getSource(), batch.getTimestamp(), batch.getData(), batch.getDataLength()
+ * }
+ */
+class TelemetryUnpacker {
+public:
+	TelemetryUnpacker(const uint8_t *payload, uint8_t length);
+	/**
+	 * Returns true if the payload starts with a batch header
+	 */
+	bool isBatch();
+	/**
+	 * Moves to the next sample.  Returns false when there are no more, or the rest of the payload is truncated
+	 */
+	bool next();
+	uint8_t getSource();
+	/**
+	 * Returns the sample's timestamp, in the sender's millis()
+	 */
+	uint32_t getTimestamp();
+	const uint8_t* getData();
+	uint8_t getDataLength();
+private:
+	const uint8_t* _payload;
+	uint8_t _length;
+	// offset of the next record
+	uint8_t _next;
+	// offset of the current record
+	uint8_t _record;
+	uint32_t _baseTime;
+};
+
+/**
+ * Compresses records of integer channels (e.g. latitude/longitude E7, altitude cm, pressure Pa, raw IMU axes)
+ * into a payload.  The first record of each payload is a keyframe holding the values themselves; every
+ * following record holds the difference from the one before it.  Values are zigzag varint coded, so small
+ * changes of either sign take one byte, and a bitmask in front of each record leaves out channels that
+ * did not change at all.
+ * <p/>
+ * Since every payload starts with a keyframe, a receiver that misses a frame only loses that frame's records.
+ * <p/>
+ * The caller provides the payload buffer and an array of channels int32_t, which holds the previous record;
+ * for 10 channels and a 72 byte payload that is about 120 bytes of RAM:
+ * <p/>
+ * encoder.begin(payload, sizeof(payload));
+ * if (!encoder.add(values)) {
+ *   encoder.setPayload(zbTx);
+ *   xbee.send(zbTx);
+ *   encoder.begin(payload, sizeof(payload));
+ *   encoder.add(values);
+ * }
+ */
+class TelemetryEncoder {
+public:
+	TelemetryEncoder(int32_t *previous, uint8_t channels);
+	/**
+	 * Starts a new payload in buffer.  The next record is a keyframe
+	 */
+	void begin(uint8_t *buffer, uint8_t size);
+	/**
+	 * Appends a record of getChannelCount() values.  Returns false, leaving the payload as it was, if it doesn't fit
+	 */
+	bool add(const int32_t *values);
+	/**
+	 * Points the request's payload at the encoded records
+	 */
+	void setPayload(PayloadRequest &request);
+	uint8_t* getPayload();
+	uint8_t getLength();
+	uint8_t getRecordCount();
+	uint8_t getChannelCount();
+private:
+	int32_t* _previous;
+	uint8_t _channels;
+	uint8_t* _buffer;
+	uint8_t _size;
+	uint8_t _length;
+	uint8_t _recordCount;
+};
+
+/**
+ * Decodes a payload built by TelemetryEncoder.  values must hold channels int32_t; the payload's channel
+ * count must match:
+ * <p/>
+ * TelemetryDecoder records = TelemetryDecoder(rx.getData(), rx.getDataLength(), values, 10);
+ * while (records.next()) {
+ *   use values[0..9]
+ * }
+ */
+class TelemetryDecoder {
+public:
+	TelemetryDecoder(const uint8_t *payload, uint8_t length, int32_t *values, uint8_t channels);
+	/**
+	 * Returns true if the payload is delta encoded with the expected number of channels
+	 */
+	bool isValid();
+	/**
+	 * Decodes the next record into values.  Returns false at the end of the payload, or if it is corrupt
+	 */
+	bool next();
+private:
+	const uint8_t* _payload;
+	uint8_t _length;
+	uint8_t _pos;
+	int32_t* _values;
+	uint8_t _channels;
+	bool _keyframe;
+};
+
+#endif //XBeeTelemetry_h
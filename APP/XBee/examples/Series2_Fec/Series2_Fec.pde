@@ -0,0 +1,77 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <XBee.h>
+#include <XBeeFec.h>
+
+/*
+This example is for Series 2 XBee
+ Sends a reading every 50ms with 2 parity frames after every 8, so the receiver can rebuild up to 2 lost
+ frames in each group of 10 without asking for anything again (see the receiving side below)
+*/
+
+// create the XBee object
+XBee xbee = XBee();
+
+// SH + SL Address of receiving XBee
+XBeeAddress64 addr64 = XBeeAddress64(0x0013a200, 0x403e0f30);
+ZBTxRequest zbTx = ZBTxRequest(addr64, NULL, 0);
+
+// 72 bytes is the largest ZB payload without encryption; check ATNP on your radio
+uint8_t frame[72];
+// 2 parity frames * (66 byte payloads + 1)
+uint8_t parity[2 * 67];
+FecEncoder fec = FecEncoder(xbee, zbTx, frame, sizeof(frame), parity, 8, 2);
+
+void setup() {
+  Serial.begin(57600);
+  xbee.setSerial(Serial);
+
+  // nothing to gain from a TX status per frame
+  zbTx.setFrameId(NO_RESPONSE_FRAME_ID);
+}
+
+void loop() {
+  uint8_t data[4];
+  int value = analogRead(0);
+  unsigned long now = millis();
+
+  data[0] = now >> 8 & 0xff;
+  data[1] = now & 0xff;
+  data[2] = value >> 8 & 0xff;
+  data[3] = value & 0xff;
+
+  fec.send(data, sizeof(data));
+
+  delay(50);
+}
+
+// on the receiving side, with a buffer of (8 + 2) * (fec.getMaxDataLength() + 1) bytes:
+//
+//  uint8_t groups[10 * 67];
+//  FecDecoder fec = FecDecoder(groups, 66, 8, 2, handleReading);
+//
+//  void handleReading(const uint8_t *data, uint8_t length, bool recovered) {
+//    // arrives in order, except rebuilt readings, which come once enough of their group is in
+//  }
+//
+//  xbee.readPacket();
+//
+//  if (xbee.getResponse().isAvailable() && xbee.getResponse().getApiId() == ZB_RX_RESPONSE) {
+//    xbee.getResponse().getZBRxResponse(rx);
+//    fec.handlePayload(rx.getData(), rx.getDataLength());
+//  }
@@ -0,0 +1,79 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <SdFat.h>
+#include <XBee.h>
+#include <XBeeFileTransfer.h>
+
+/*
+This example is for Series 2 XBee
+ Sends the flight log on the SD card to the ground station when it asks for it.
+ Blocks are read straight from the file into the payload; the ground side (a FileDownlinkReceiver,
+ e.g. extras/host/xbee_downlink.cpp) acknowledges them and asks again from where it stopped if the
+ link drops, so a download can be resumed.
+*/
+
+// SparkFun SD shield
+const int chipSelect = 8;
+
+SdFat sd;
+SdFile logFile;
+
+// create the XBee object
+XBee xbee = XBee();
+
+// SH + SL Address of the ground station XBee
+XBeeAddress64 addr64 = XBeeAddress64(0x0013a200, 0x403e0f30);
+ZBTxRequest zbTx = ZBTxRequest(addr64, NULL, 0);
+ZBRxResponse rx = ZBRxResponse();
+
+// 72 bytes is the largest ZB payload without encryption; check ATNP on your radio
+uint8_t block[72];
+FileDownlink* downlink;
+
+int readBlock(uint32_t offset, uint8_t* buffer, uint8_t length) {
+  if (!logFile.seekSet(offset)) {
+    return -1;
+  }
+
+  return logFile.read(buffer, length);
+}
+
+void setup() {
+  Serial.begin(57600);
+  xbee.setSerial(Serial);
+
+  if (!sd.begin(chipSelect, SPI_FULL_SPEED) || !logFile.open("datalog.txt", O_READ)) {
+    // nothing to send
+    while (true) {}
+  }
+
+  // resend a block if it isn't acknowledged within 500ms
+  downlink = new FileDownlink(xbee, zbTx, block, sizeof(block), readBlock, logFile.fileSize(), 500);
+}
+
+void loop() {
+  xbee.readPacket();
+
+  if (xbee.getResponse().isAvailable() && xbee.getResponse().getApiId() == ZB_RX_RESPONSE) {
+    xbee.getResponse().getZBRxResponse(rx);
+    downlink->handlePayload(rx.getData(), rx.getDataLength());
+  }
+
+  // sends at most one frame
+  downlink->poll();
+}
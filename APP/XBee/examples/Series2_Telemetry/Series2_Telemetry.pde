@@ -0,0 +1,86 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <XBee.h>
+#include <XBeeTelemetry.h>
+
+/*
+This example is for Series 2 XBee
+ Samples two analog pins at different rates and sends the readings in batches:
+ a frame goes out when 72 bytes of samples have been gathered, or the oldest one is 250ms old.
+ The receiver splits each ZB RX payload with TelemetryUnpacker (see loop() on the receiving side below)
+*/
+
+#define SOURCE_PIN0 0
+#define SOURCE_PIN1 1
+
+// create the XBee object
+XBee xbee = XBee();
+
+// SH + SL Address of receiving XBee
+XBeeAddress64 addr64 = XBeeAddress64(0x0013a200, 0x403e0f30);
+ZBTxRequest zbTx = ZBTxRequest(addr64, NULL, 0);
+
+// 72 bytes is the largest ZB payload without encryption; check ATNP on your radio
+uint8_t batch[72];
+TelemetryPacketizer telemetry = TelemetryPacketizer(xbee, zbTx, batch, sizeof(batch), 250);
+
+unsigned long lastPin1 = 0;
+
+void addReading(uint8_t source, int pin) {
+  int value = analogRead(pin);
+  uint8_t data[2];
+
+  data[0] = value >> 8 & 0xff;
+  data[1] = value & 0xff;
+
+  telemetry.add(source, data, sizeof(data));
+}
+
+void setup() {
+  Serial.begin(9600);
+  xbee.setSerial(Serial);
+}
+
+void loop() {
+  // pin 0 every 10ms, pin 1 every 50ms
+  addReading(SOURCE_PIN0, 0);
+
+  if (millis() - lastPin1 >= 50) {
+    lastPin1 = millis();
+    addReading(SOURCE_PIN1, 1);
+  }
+
+  // sends the batch once its first sample is 250ms old
+  telemetry.poll();
+
+  delay(10);
+}
+
+// on the receiving side:
+//
+//  xbee.readPacket();
+//
+//  if (xbee.getResponse().isAvailable() && xbee.getResponse().getApiId() == ZB_RX_RESPONSE) {
+//    xbee.getResponse().getZBRxResponse(rx);
+//
+//    TelemetryUnpacker batch = TelemetryUnpacker(rx.getData(), rx.getDataLength());
+//
+//    while (batch.next()) {
+//      // batch.getSource(), batch.getTimestamp(), batch.getData(), batch.getDataLength()
+//    }
+//  }
@@ -0,0 +1,72 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * The parts of the Arduino core XBee-Arduino uses, so the library builds for a PC (Linux, OS X) ground station.
+ * Put this directory first on the include path and define ARDUINO=100, as the IDE does.
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+// HostClock.cpp for the wall clock, SimulatedLink.cpp for simulated time
+unsigned long millis();
+
+class Stream {
+public:
+	virtual ~Stream() {}
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+	virtual void flush() {}
+	virtual size_t write(uint8_t b) = 0;
+	virtual size_t write(const uint8_t *buffer, size_t size) {
+		size_t n = 0;
+
+		while (size-- > 0) {
+			n+= write(*buffer++);
+		}
+
+		return n;
+	}
+	size_t readBytes(char *buffer, size_t length) {
+		size_t n = 0;
+
+		// no timeout; the library only asks for what available() reported
+		while (n < length) {
+			int c = read();
+
+			if (c < 0) {
+				break;
+			}
+
+			buffer[n++] = c;
+		}
+
+		return n;
+	}
+};
+
+#endif
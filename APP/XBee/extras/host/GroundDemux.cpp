@@ -0,0 +1,285 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GroundDemux.h"
+
+// spins a little, then lets other threads run; on a busy machine stages outnumber cores
+static void backOff(unsigned &spins) {
+	if (++spins > 64) {
+		std::this_thread::yield();
+	}
+}
+
+GroundDemux::InputStream::InputStream(SpscQueue<Chunk, GROUND_INPUT_QUEUE_SIZE> &chunks) {
+	_chunks = &chunks;
+	_chunk = NULL;
+	_pos = 0;
+}
+
+int GroundDemux::InputStream::available() {
+	if (_chunk != NULL && _pos < _chunk->length) {
+		return _chunk->length - _pos;
+	}
+
+	if (_chunk != NULL) {
+		// used up; give it back to feed()
+		_chunks->pop();
+		_chunk = NULL;
+	}
+
+	_chunk = _chunks->front();
+	_pos = 0;
+
+	return _chunk != NULL ? _chunk->length : 0;
+}
+
+int GroundDemux::InputStream::read() {
+	if (_chunk != NULL && _pos < _chunk->length) {
+		return _chunk->data[_pos++];
+	}
+
+	return available() > 0 ? _chunk->data[_pos++] : -1;
+}
+
+int GroundDemux::InputStream::peek() {
+	return available() > 0 ? _chunk->data[_pos] : -1;
+}
+
+size_t GroundDemux::InputStream::write(uint8_t) {
+	// the demux only listens
+	return 0;
+}
+
+GroundDemux::GroundDemux(GroundHandler &handler, uint8_t workers) {
+	_handler = &handler;
+	_workerCount = workers < 1 ? 1 : workers > GROUND_MAX_WORKERS ? GROUND_MAX_WORKERS : workers;
+	_workers = new Worker[_workerCount];
+	_chunks = new SpscQueue<Chunk, GROUND_INPUT_QUEUE_SIZE>();
+	_running = false;
+	_fed = false;
+	_framed = false;
+	_frames = 0;
+	_errors = 0;
+
+	for (uint8_t i = 0; i < _workerCount; i++) {
+		_workers[i].frames = 0;
+	}
+}
+
+GroundDemux::~GroundDemux() {
+	end();
+
+	delete[] _workers;
+	delete _chunks;
+}
+
+void GroundDemux::begin() {
+	if (_running) {
+		return;
+	}
+
+	_running = true;
+	_fed = false;
+	_framed = false;
+
+	for (uint8_t i = 0; i < _workerCount; i++) {
+		_workers[i].thread = std::thread(&GroundDemux::work, this, i);
+	}
+
+	_framer = std::thread(&GroundDemux::frame, this);
+}
+
+void GroundDemux::feed(const uint8_t *data, size_t length) {
+	unsigned spins = 0;
+
+	while (length > 0) {
+		Chunk* chunk = _chunks->claim();
+
+		if (chunk == NULL) {
+			backOff(spins);
+			continue;
+		}
+
+		chunk->length = length < GROUND_CHUNK_SIZE ? length : GROUND_CHUNK_SIZE;
+		memcpy(chunk->data, data, chunk->length);
+		_chunks->publish();
+
+		data+= chunk->length;
+		length-= chunk->length;
+		spins = 0;
+	}
+}
+
+void GroundDemux::end() {
+	if (!_running) {
+		return;
+	}
+
+	_fed.store(true, std::memory_order_release);
+	_framer.join();
+
+	for (uint8_t i = 0; i < _workerCount; i++) {
+		_workers[i].thread.join();
+	}
+
+	_running = false;
+}
+
+void GroundDemux::frame() {
+	InputStream input = InputStream(*_chunks);
+	XBee xbee = XBee();
+	xbee.setSerial(input);
+
+	XBeeResponse& response = xbee.getResponse();
+	unsigned spins = 0;
+
+	while (true) {
+		// read the flag first: if it was set and readPacket() then finds nothing, nothing more will come
+		bool fed = _fed.load(std::memory_order_acquire);
+
+		xbee.readPacket();
+
+		if (response.isAvailable()) {
+			Worker& worker = _workers[workerFor(response)];
+			Frame* frame;
+
+			while ((frame = worker.queue.claim()) == NULL) {
+				backOff(spins);
+			}
+
+			frame->apiId = response.getApiId();
+			frame->length = response.getFrameDataLength();
+			frame->checksum = response.getChecksum();
+			memcpy(frame->data, response.getFrameData(), frame->length);
+			worker.queue.publish();
+
+			_frames++;
+			spins = 0;
+		} else if (response.isError()) {
+			_errors++;
+		} else if (fed && input.available() == 0) {
+			break;
+		} else {
+			backOff(spins);
+		}
+	}
+
+	_framed.store(true, std::memory_order_release);
+}
+
+uint8_t GroundDemux::workerFor(XBeeResponse &response) {
+	uint8_t* data = response.getFrameData();
+	uint8_t length = response.getFrameDataLength();
+	uint64_t source = 0;
+	uint8_t addressLength;
+
+	switch (response.getApiId()) {
+		case ZB_RX_RESPONSE:
+		case RX_64_RESPONSE:
+			addressLength = 8;
+			break;
+		case RX_16_RESPONSE:
+			addressLength = 2;
+			break;
+		default:
+			return 0;
+	}
+
+	if (length < addressLength) {
+		return 0;
+	}
+
+	for (uint8_t i = 0; i < addressLength; i++) {
+		source = (source << 8) + data[i];
+	}
+
+	// addresses of one batch of radios differ only in the last bytes; mix them before taking the modulo
+	source ^= source >> 33;
+	source *= 0xff51afd7ed558ccdULL;
+	source ^= source >> 33;
+
+	return source % _workerCount;
+}
+
+void GroundDemux::work(uint8_t worker) {
+	Worker& w = _workers[worker];
+	XBeeResponse response = XBeeResponse();
+	ZBRxResponse zbRx = ZBRxResponse();
+	Rx64Response rx64 = Rx64Response();
+	Rx16Response rx16 = Rx16Response();
+	unsigned spins = 0;
+
+	while (true) {
+		bool framed = _framed.load(std::memory_order_acquire);
+		Frame* frame = w.queue.front();
+
+		if (frame == NULL) {
+			if (framed) {
+				break;
+			}
+
+			backOff(spins);
+			continue;
+		}
+
+		response.init();
+		response.setApiId(frame->apiId);
+		response.setMsbLength(0);
+		response.setLsbLength(frame->length + 1);
+		response.setFrameLength(frame->length);
+		response.setChecksum(frame->checksum);
+		response.setFrameData(frame->data);
+		response.setAvailable(true);
+
+		switch (frame->apiId) {
+			case ZB_RX_RESPONSE:
+				response.getZBRxResponse(zbRx);
+				_handler->handleZBRx(worker, zbRx);
+				break;
+			case RX_64_RESPONSE:
+				response.getRx64Response(rx64);
+				_handler->handleRx64(worker, rx64);
+				break;
+			case RX_16_RESPONSE:
+				response.getRx16Response(rx16);
+				_handler->handleRx16(worker, rx16);
+				break;
+			default:
+				_handler->handleOther(worker, response);
+		}
+
+		w.queue.pop();
+		w.frames++;
+		spins = 0;
+	}
+}
+
+uint8_t GroundDemux::getWorkerCount() {
+	return _workerCount;
+}
+
+uint64_t GroundDemux::getFrameCount() {
+	return _frames;
+}
+
+uint64_t GroundDemux::getErrorCount() {
+	return _errors;
+}
+
+uint64_t GroundDemux::getWorkerFrameCount(uint8_t worker) {
+	return worker < _workerCount ? _workers[worker].frames : 0;
+}
@@ -0,0 +1,145 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GroundDemux_h
+#define GroundDemux_h
+
+#include "Arduino.h"
+#include "XBee.h"
+#include "SpscQueue.h"
+
+#include <atomic>
+#include <thread>
+
+// bytes per chunk handed from feed() to the framer
+#define GROUND_CHUNK_SIZE 4096
+// chunks between feed() and the framer, and frames between the framer and each worker
+#define GROUND_INPUT_QUEUE_SIZE 64
+#define GROUND_FRAME_QUEUE_SIZE 1024
+#define GROUND_MAX_WORKERS 16
+
+/**
+ * Receives the frames GroundDemux decodes, on its worker threads.  Every frame from one source address
+ * goes to the same worker, in the order it arrived, so per source state needs no locking.  Override
+ * the ones you need
+ */
+class GroundHandler {
+public:
+	virtual ~GroundHandler() {}
+	virtual void handleZBRx(uint8_t, ZBRxResponse &) {}
+	virtual void handleRx64(uint8_t, Rx64Response &) {}
+	virtual void handleRx16(uint8_t, Rx16Response &) {}
+	/**
+	 * Every other frame (TX status, AT and modem status responses, IO samples), on worker 0
+	 */
+	virtual void handleOther(uint8_t, XBeeResponse &) {}
+};
+
+/**
+ * Decodes a ground station's byte stream (a serial port, or a capture being replayed) on several threads:
+ * <p/>
+ * feed() (caller's thread) -> framer thread, which splits the bytes into API frames with an XBee
+ * object -> one worker thread per source hash, which decode ZBRxResponse / Rx64Response / Rx16Response
+ * and call the handler.
+ * <p/>
+ * Stages are joined by SpscQueues, so nothing takes a lock; a stage whose queue is full or empty
+ * spins briefly, then yields.
+ * <p/>
+ * GroundDemux demux(handler, 4);
+ * demux.begin();
+ * while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+ *   demux.feed(buffer, n);
+ * }
+ * demux.end();
+ */
+class GroundDemux {
+public:
+	GroundDemux(GroundHandler &handler, uint8_t workers);
+	~GroundDemux();
+	/**
+	 * Starts the framer and worker threads
+	 */
+	void begin();
+	/**
+	 * Queues bytes for the framer; blocks while its queue is full.  Call from one thread only
+	 */
+	void feed(const uint8_t *data, size_t length);
+	/**
+	 * Waits until every byte fed has been framed and handled, and stops the threads
+	 */
+	void end();
+	uint8_t getWorkerCount();
+	uint64_t getFrameCount();
+	/**
+	 * Returns the number of frames the XBee parser rejected (bad checksum, too long, unexpected start byte)
+	 */
+	uint64_t getErrorCount();
+	uint64_t getWorkerFrameCount(uint8_t worker);
+private:
+	struct Chunk {
+		size_t length;
+		uint8_t data[GROUND_CHUNK_SIZE];
+	};
+
+	struct Frame {
+		uint8_t apiId;
+		uint8_t length;
+		uint8_t checksum;
+		uint8_t data[MAX_FRAME_DATA_SIZE];
+	};
+
+	struct Worker {
+		SpscQueue<Frame, GROUND_FRAME_QUEUE_SIZE> queue;
+		std::thread thread;
+		uint64_t frames;
+	};
+
+	/**
+	 * The framer's view of the chunk queue
+	 */
+	class InputStream : public Stream {
+	public:
+		InputStream(SpscQueue<Chunk, GROUND_INPUT_QUEUE_SIZE> &chunks);
+		int available();
+		int read();
+		int peek();
+		size_t write(uint8_t b);
+	private:
+		SpscQueue<Chunk, GROUND_INPUT_QUEUE_SIZE>* _chunks;
+		// front chunk, being read
+		Chunk* _chunk;
+		size_t _pos;
+	};
+
+	void frame();
+	void work(uint8_t worker);
+	uint8_t workerFor(XBeeResponse &response);
+
+	GroundHandler* _handler;
+	uint8_t _workerCount;
+	Worker* _workers;
+	SpscQueue<Chunk, GROUND_INPUT_QUEUE_SIZE>* _chunks;
+	std::thread _framer;
+	bool _running;
+	// set once the producer, then the framer, have nothing more to pass on
+	std::atomic<bool> _fed;
+	std::atomic<bool> _framed;
+	uint64_t _frames;
+	uint64_t _errors;
+};
+
+#endif //GroundDemux_h
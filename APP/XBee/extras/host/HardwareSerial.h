@@ -0,0 +1,47 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HardwareSerial_h
+#define HardwareSerial_h
+
+#include "Arduino.h"
+
+/**
+ * A serial port device (/dev/ttyUSB0) as a Stream, in raw mode.  Reads don't block
+ */
+class PosixSerial : public Stream {
+public:
+	PosixSerial();
+	bool begin(const char *device, long baud);
+	void end();
+	int available();
+	int read();
+	int peek();
+	size_t write(uint8_t b);
+	size_t write(const uint8_t *buffer, size_t size);
+private:
+	int fill();
+	int _fd;
+	uint8_t _buffer[256];
+	int _pos;
+	int _length;
+};
+
+// XBee's default serial port
+extern PosixSerial Serial;
+
+#endif
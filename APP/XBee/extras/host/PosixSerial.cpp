@@ -0,0 +1,135 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "HardwareSerial.h"
+
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+PosixSerial Serial;
+
+static speed_t toSpeed(long baud) {
+	switch (baud) {
+		case 1200: return B1200;
+		case 2400: return B2400;
+		case 4800: return B4800;
+		case 9600: return B9600;
+		case 19200: return B19200;
+		case 38400: return B38400;
+		case 57600: return B57600;
+		case 115200: return B115200;
+		case 230400: return B230400;
+		default: return 0;
+	}
+}
+
+PosixSerial::PosixSerial() {
+	_fd = -1;
+	_pos = 0;
+	_length = 0;
+}
+
+bool PosixSerial::begin(const char *device, long baud) {
+	speed_t speed = toSpeed(baud);
+
+	if (speed == 0) {
+		return false;
+	}
+
+	_fd = open(device, O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+	if (_fd < 0) {
+		return false;
+	}
+
+	struct termios tty;
+
+	if (tcgetattr(_fd, &tty) != 0) {
+		end();
+		return false;
+	}
+
+	cfmakeraw(&tty);
+	cfsetispeed(&tty, speed);
+	cfsetospeed(&tty, speed);
+	tty.c_cflag |= CLOCAL | CREAD;
+	tty.c_cflag &= ~CRTSCTS;
+
+	if (tcsetattr(_fd, TCSANOW, &tty) != 0) {
+		end();
+		return false;
+	}
+
+	tcflush(_fd, TCIOFLUSH);
+
+	return true;
+}
+
+void PosixSerial::end() {
+	if (_fd >= 0) {
+		close(_fd);
+	}
+
+	_fd = -1;
+	_pos = 0;
+	_length = 0;
+}
+
+int PosixSerial::fill() {
+	if (_pos == _length && _fd >= 0) {
+		ssize_t n = ::read(_fd, _buffer, sizeof(_buffer));
+
+		_pos = 0;
+		_length = n > 0 ? n : 0;
+	}
+
+	return _length - _pos;
+}
+
+int PosixSerial::available() {
+	return fill();
+}
+
+int PosixSerial::read() {
+	return fill() > 0 ? _buffer[_pos++] : -1;
+}
+
+int PosixSerial::peek() {
+	return fill() > 0 ? _buffer[_pos] : -1;
+}
+
+size_t PosixSerial::write(uint8_t b) {
+	return write(&b, 1);
+}
+
+size_t PosixSerial::write(const uint8_t *buffer, size_t size) {
+	size_t written = 0;
+
+	// the port is non blocking; wait for room rather than drop bytes mid frame
+	while (written < size && _fd >= 0) {
+		ssize_t n = ::write(_fd, buffer + written, size - written);
+
+		if (n > 0) {
+			written+= n;
+		} else {
+			usleep(1000);
+		}
+	}
+
+	return written;
+}
@@ -0,0 +1,556 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SimulatedLink.h"
+#include "XBee.h"
+
+#include <math.h>
+
+static uint64_t simNow = 0;
+
+unsigned long millis() {
+	return simNow / 1000;
+}
+
+LinkSettings::LinkSettings() {
+	baud = 9600;
+	rxBufferSize = 128;
+	apiMode = 2;
+	rfBitRate = 250000;
+	rfOverhead = 20;
+	rfLatency = 1500;
+	lossRate = 0;
+	bitErrorRate = 0;
+	macRetries = 0;
+	corruptRate = 0;
+	radioQueueSize = 4;
+	atCommandTime = 2000;
+	seed = 1;
+}
+
+LinkStats::LinkStats() {
+	memset(this, 0, sizeof(*this));
+}
+
+int SimulatedSerial::available() {
+	return _rx.size();
+}
+
+int SimulatedSerial::read() {
+	if (_rx.empty()) {
+		return -1;
+	}
+
+	uint8_t b = _rx.front();
+	_rx.pop_front();
+
+	return b;
+}
+
+int SimulatedSerial::peek() {
+	return _rx.empty() ? -1 : _rx.front();
+}
+
+size_t SimulatedSerial::write(uint8_t b) {
+	_link->write(_radio, b);
+	return 1;
+}
+
+SimulatedLink::SimulatedLink(const LinkSettings &settings) {
+	_settings = settings;
+	_airBusy = false;
+	_nextRadio = 0;
+	_random = settings.seed != 0 ? settings.seed : 1;
+	_byteTime = 10000000 / settings.baud;
+
+	for (uint8_t i = 0; i < 2; i++) {
+		Radio& r = _radios[i];
+
+		r.serial._link = this;
+		r.serial._radio = i;
+		r.inFree = 0;
+		r.outFree = 0;
+		r.atFree = 0;
+		r.outFrames = 0;
+		r.damagedFrame = 0;
+		r.state = 0;
+		r.escape = false;
+		r.length = 0;
+
+		setAddress(i, 0x0013a200, 0x40000000 + i, i + 1);
+	}
+}
+
+SimulatedSerial& SimulatedLink::getSerial(uint8_t radio) {
+	return _radios[radio & 1].serial;
+}
+
+void SimulatedLink::setAddress(uint8_t radio, uint32_t msb, uint32_t lsb, uint16_t address16) {
+	Radio& r = _radios[radio & 1];
+
+	r.msb = msb;
+	r.lsb = lsb;
+	r.address16 = address16;
+}
+
+LinkStats& SimulatedLink::getStats(uint8_t radio) {
+	return _radios[radio & 1].stats;
+}
+
+uint64_t SimulatedLink::now() {
+	return simNow;
+}
+
+void SimulatedLink::run(uint32_t micros) {
+	uint64_t end = simNow + micros;
+
+	// take whatever is due first: a scheduled event, or a byte finishing on one of the four serial lines
+	while (true) {
+		uint64_t next = end + 1;
+		int source = -1;
+
+		if (!_events.empty() && _events.begin()->first < next) {
+			next = _events.begin()->first;
+			source = 0;
+		}
+
+		for (uint8_t i = 0; i < 2; i++) {
+			if (!_radios[i].in.empty() && _radios[i].in.front().time < next) {
+				next = _radios[i].in.front().time;
+				source = 1 + i;
+			}
+
+			if (!_radios[i].out.empty() && _radios[i].out.front().time < next) {
+				next = _radios[i].out.front().time;
+				source = 3 + i;
+			}
+		}
+
+		if (source < 0) {
+			break;
+		}
+
+		if (next > simNow) {
+			simNow = next;
+		}
+
+		if (source == 0) {
+			std::function<void()> event = _events.begin()->second;
+			_events.erase(_events.begin());
+			event();
+		} else if (source <= 2) {
+			Radio& r = _radios[source - 1];
+			uint8_t b = r.in.front().b;
+			r.in.pop_front();
+			receive(source - 1, b);
+		} else {
+			Radio& r = _radios[source - 3];
+			SerialByte b = r.out.front();
+			r.out.pop_front();
+
+			if (r.serial._rx.size() < _settings.rxBufferSize) {
+				r.serial._rx.push_back(b.b);
+			} else if (r.damagedFrame != b.frame) {
+				r.damagedFrame = b.frame;
+				r.stats.rxOverflow++;
+			}
+		}
+	}
+
+	simNow = end;
+}
+
+void SimulatedLink::write(uint8_t radio, uint8_t b) {
+	Radio& r = _radios[radio];
+	SerialByte sb;
+
+	// bytes queue up behind each other at the baud rate
+	r.inFree = (r.inFree > simNow ? r.inFree : simNow) + _byteTime;
+	sb.time = r.inFree;
+	sb.b = b;
+	sb.frame = 0;
+	r.in.push_back(sb);
+}
+
+void SimulatedLink::receive(uint8_t radio, uint8_t b) {
+	Radio& r = _radios[radio];
+
+	// in AP=1 nothing is escaped, so a start byte inside a frame is data
+	if (b == START_BYTE && (r.state == 0 || _settings.apiMode == 2)) {
+		r.state = 1;
+		r.escape = false;
+		r.frame.clear();
+		return;
+	}
+
+	if (r.state == 0) {
+		return;
+	}
+
+	if (_settings.apiMode == 2) {
+		if (b == ESCAPE) {
+			r.escape = true;
+			return;
+		}
+
+		if (r.escape) {
+			b ^= 0x20;
+			r.escape = false;
+		}
+	}
+
+	switch (r.state) {
+		case 1:
+			r.length = b << 8;
+			r.state = 2;
+			break;
+		case 2:
+			r.length+= b;
+			r.state = r.length > 0 ? 3 : 0;
+			break;
+		case 3:
+			r.frame.push_back(b);
+
+			if (r.frame.size() == r.length) {
+				r.state = 4;
+			}
+
+			break;
+		case 4: {
+			uint8_t sum = b;
+
+			for (size_t i = 0; i < r.frame.size(); i++) {
+				sum+= r.frame[i];
+			}
+
+			r.state = 0;
+
+			// radios drop frames with a bad checksum without a word
+			if (sum == 0xff) {
+				handleFrame(radio, r.frame);
+			}
+
+			break;
+		}
+	}
+}
+
+void SimulatedLink::handleFrame(uint8_t radio, const std::vector<uint8_t> &frame) {
+	Radio& r = _radios[radio];
+	uint8_t apiId = frame[0];
+	size_t minimum;
+
+	switch (apiId) {
+		case AT_COMMAND_REQUEST:
+		case AT_COMMAND_QUEUE_REQUEST: {
+			if (frame.size() < 4) {
+				return;
+			}
+
+			std::vector<uint8_t> response;
+			response.push_back(AT_COMMAND_RESPONSE);
+			response.insert(response.end(), frame.begin() + 1, frame.begin() + 4);
+
+			std::vector<uint8_t> result = atCommand(radio, &frame[2], &frame[0] + 4, frame.size() - 4);
+			response.insert(response.end(), result.begin(), result.end());
+
+			if (frame[1] != NO_RESPONSE_FRAME_ID) {
+				schedule(atDone(radio), [this, radio, response]() { sendToArduino(radio, response); });
+			}
+
+			return;
+		}
+		case TX_16_REQUEST:
+			minimum = 5;
+			break;
+		case TX_64_REQUEST:
+			minimum = 11;
+			break;
+		case ZB_TX_REQUEST:
+			minimum = 14;
+			break;
+		case REMOTE_AT_REQUEST:
+			minimum = 15;
+			break;
+		default:
+			return;
+	}
+
+	if (frame.size() < minimum) {
+		return;
+	}
+
+	if (r.airQueue.size() >= _settings.radioQueueSize) {
+		r.stats.radioQueueFull++;
+		return;
+	}
+
+	r.stats.txFrames++;
+	r.airQueue.push_back(frame);
+	startAir();
+}
+
+std::vector<uint8_t> SimulatedLink::atCommand(uint8_t radio, const uint8_t *command, const uint8_t *value, uint8_t valueLength) {
+	Radio& r = _radios[radio];
+	uint16_t key = (command[0] << 8) + command[1];
+	std::vector<uint8_t> result(1, AT_OK);
+
+	r.stats.atCommands++;
+
+	if (valueLength > 0) {
+		r.registers[key] = std::vector<uint8_t>(value, value + valueLength);
+	} else if (r.registers.count(key) > 0) {
+		result.insert(result.end(), r.registers[key].begin(), r.registers[key].end());
+	} else if (key == ('S' << 8) + 'H' || key == ('S' << 8) + 'L' || key == ('M' << 8) + 'Y') {
+		uint32_t v = key == ('S' << 8) + 'H' ? r.msb : key == ('S' << 8) + 'L' ? r.lsb : r.address16;
+
+		for (int shift = key == ('M' << 8) + 'Y' ? 8 : 24; shift >= 0; shift-= 8) {
+			result.push_back((v >> shift) & 0xff);
+		}
+	}
+
+	return result;
+}
+
+uint64_t SimulatedLink::atDone(uint8_t radio) {
+	Radio& r = _radios[radio];
+
+	r.atFree = (r.atFree > simNow ? r.atFree : simNow) + _settings.atCommandTime;
+
+	return r.atFree;
+}
+
+void SimulatedLink::startAir() {
+	if (_airBusy) {
+		return;
+	}
+
+	// radios take turns on the channel
+	for (uint8_t k = 0; k < 2; k++) {
+		uint8_t radio = (_nextRadio + k) & 1;
+		Radio& r = _radios[radio];
+
+		if (r.airQueue.empty()) {
+			continue;
+		}
+
+		std::vector<uint8_t> frame = r.airQueue.front();
+		r.airQueue.pop_front();
+
+		uint32_t bits = (frame.size() + _settings.rfOverhead) * 8;
+		uint64_t airTime = uint64_t(bits) * 1000000 / _settings.rfBitRate + _settings.rfLatency;
+		float frameErrorRate = 1 - pow(1 - _settings.bitErrorRate, bits);
+		uint8_t attempts = 0;
+		bool delivered = false;
+
+		do {
+			attempts++;
+			delivered = !chance(_settings.lossRate) && (frameErrorRate == 0 || !chance(frameErrorRate));
+		} while (!delivered && attempts <= _settings.macRetries);
+
+		_airBusy = true;
+		_nextRadio = radio ^ 1;
+
+		schedule(simNow + airTime * attempts, [this, radio, frame, delivered, attempts]() {
+			_airBusy = false;
+			landed(radio, frame, delivered, attempts - 1);
+			startAir();
+		});
+
+		return;
+	}
+}
+
+void SimulatedLink::landed(uint8_t radio, const std::vector<uint8_t> &frame, bool delivered, uint8_t retries) {
+	Radio& r = _radios[radio];
+	uint8_t peer = radio ^ 1;
+	uint8_t apiId = frame[0];
+	uint8_t frameId = frame[1];
+	std::vector<uint8_t> rx;
+
+	if (apiId == REMOTE_AT_COMMAND_RESPONSE) {
+		// a reply to a remote AT command coming back; a lost one looks like no answer
+		rx = frame;
+
+		if (!delivered) {
+			rx.resize(15);
+			rx[14] = AT_NO_RESPONSE;
+		}
+
+		sendToArduino(peer, rx);
+		return;
+	}
+
+	r.stats.rfRetries+= retries;
+
+	if (delivered) {
+		r.stats.delivered++;
+	} else {
+		r.stats.rfLost++;
+	}
+
+	switch (apiId) {
+		case TX_16_REQUEST:
+			rx.push_back(RX_16_RESPONSE);
+			rx.push_back(r.address16 >> 8);
+			rx.push_back(r.address16 & 0xff);
+			// rssi, options
+			rx.push_back(0x28);
+			rx.push_back(0);
+			rx.insert(rx.end(), frame.begin() + 5, frame.end());
+			break;
+		case TX_64_REQUEST:
+			rx.push_back(RX_64_RESPONSE);
+			putAddress(rx, radio);
+			rx.push_back(0x28);
+			rx.push_back(0);
+			rx.insert(rx.end(), frame.begin() + 11, frame.end());
+			break;
+		case ZB_TX_REQUEST:
+			rx.push_back(ZB_RX_RESPONSE);
+			putAddress(rx, radio);
+			rx.push_back(r.address16 >> 8);
+			rx.push_back(r.address16 & 0xff);
+			rx.push_back(ZB_PACKET_ACKNOWLEDGED);
+			rx.insert(rx.end(), frame.begin() + 14, frame.end());
+			break;
+		case REMOTE_AT_REQUEST: {
+			std::vector<uint8_t> reply;
+			reply.push_back(REMOTE_AT_COMMAND_RESPONSE);
+			reply.push_back(frameId);
+			putAddress(reply, peer);
+			reply.push_back(_radios[peer].address16 >> 8);
+			reply.push_back(_radios[peer].address16 & 0xff);
+			reply.push_back(frame[13]);
+			reply.push_back(frame[14]);
+
+			if (delivered) {
+				std::vector<uint8_t> result = atCommand(peer, &frame[13], &frame[0] + 15, frame.size() - 15);
+				reply.insert(reply.end(), result.begin(), result.end());
+
+				// the answer goes back over the air like any other frame
+				schedule(atDone(peer), [this, peer, reply]() {
+					_radios[peer].airQueue.push_back(reply);
+					startAir();
+				});
+			} else {
+				reply.push_back(AT_NO_RESPONSE);
+				sendToArduino(radio, reply);
+			}
+
+			return;
+		}
+	}
+
+	if (delivered) {
+		sendToArduino(peer, rx);
+	}
+
+	if (frameId == NO_RESPONSE_FRAME_ID) {
+		return;
+	}
+
+	std::vector<uint8_t> status;
+
+	if (apiId == ZB_TX_REQUEST) {
+		status.push_back(ZB_TX_STATUS_RESPONSE);
+		status.push_back(frameId);
+		status.push_back(_radios[peer].address16 >> 8);
+		status.push_back(_radios[peer].address16 & 0xff);
+		status.push_back(retries);
+		// MAC ACK failure
+		status.push_back(delivered ? SUCCESS : 0x01);
+		status.push_back(0);
+	} else {
+		status.push_back(TX_STATUS_RESPONSE);
+		status.push_back(frameId);
+		// no ACK
+		status.push_back(delivered ? SUCCESS : 0x01);
+	}
+
+	sendToArduino(radio, status);
+}
+
+void SimulatedLink::sendToArduino(uint8_t radio, const std::vector<uint8_t> &frame) {
+	Radio& r = _radios[radio];
+	std::vector<uint8_t> bytes;
+	uint8_t sum = 0;
+
+	bytes.push_back(frame.size() >> 8);
+	bytes.push_back(frame.size() & 0xff);
+
+	for (size_t i = 0; i < frame.size(); i++) {
+		bytes.push_back(frame[i]);
+		sum+= frame[i];
+	}
+
+	bytes.push_back(0xff - sum);
+
+	r.outFrames++;
+	r.stats.rxFrames++;
+
+	bool corrupted = false;
+
+	for (size_t i = 0; i <= bytes.size(); i++) {
+		// start byte first, never escaped
+		uint8_t b = i == 0 ? START_BYTE : bytes[i - 1];
+		bool escape = i > 0 && _settings.apiMode == 2 && (b == START_BYTE || b == ESCAPE || b == XON || b == XOFF);
+
+		for (uint8_t k = escape ? 0 : 1; k < 2; k++) {
+			SerialByte sb;
+
+			sb.b = k == 0 ? ESCAPE : escape ? b ^ 0x20 : b;
+
+			if (_settings.corruptRate > 0 && chance(_settings.corruptRate)) {
+				sb.b ^= 1 << (_random % 8);
+				corrupted = true;
+			}
+
+			r.outFree = (r.outFree > simNow ? r.outFree : simNow) + _byteTime;
+			sb.time = r.outFree;
+			sb.frame = r.outFrames;
+			r.out.push_back(sb);
+		}
+	}
+
+	if (corrupted) {
+		r.stats.corrupted++;
+	}
+}
+
+void SimulatedLink::schedule(uint64_t time, const std::function<void()> &event) {
+	_events.insert(std::make_pair(time, event));
+}
+
+bool SimulatedLink::chance(float p) {
+	// xorshift32; reproducible for a given seed
+	_random ^= _random << 13;
+	_random ^= _random >> 17;
+	_random ^= _random << 5;
+
+	return (_random >> 8) < p * 16777216.0f;
+}
+
+void SimulatedLink::putAddress(std::vector<uint8_t> &frame, uint8_t radio) {
+	for (int shift = 24; shift >= 0; shift-= 8) {
+		frame.push_back((_radios[radio].msb >> shift) & 0xff);
+	}
+
+	for (int shift = 24; shift >= 0; shift-= 8) {
+		frame.push_back((_radios[radio].lsb >> shift) & 0xff);
+	}
+}
@@ -0,0 +1,190 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SimulatedLink_h
+#define SimulatedLink_h
+
+#include "Arduino.h"
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <vector>
+
+/**
+ * Link parameters.  Times are in microseconds of simulated time
+ */
+struct LinkSettings {
+	// serial port between each Arduino and its radio; 10 bits per byte
+	long baud;
+	// Arduino serial RX buffer; bytes arriving while it is full are dropped, as HardwareSerial does
+	uint16_t rxBufferSize;
+	// radio API mode, 1 or 2 (escaped)
+	uint8_t apiMode;
+	// over the air bit rate, and RF bytes added to each frame (preamble, MAC and network headers)
+	uint32_t rfBitRate;
+	uint8_t rfOverhead;
+	// fixed time per frame on air: turnaround, MAC ACK, processing.  The channel is busy meanwhile
+	uint32_t rfLatency;
+	// chance that a transmission is lost on air, and how many times the radio retries it
+	float lossRate;
+	// bit error rate on air; a frame with any bit error fails the radio's CRC and is lost too
+	float bitErrorRate;
+	uint8_t macRetries;
+	// chance that a byte on the serial port from radio to Arduino is corrupted (a bit flips)
+	float corruptRate;
+	// TX frames a radio holds while the channel is busy; more are dropped
+	uint8_t radioQueueSize;
+	// time a radio takes to answer an AT command, local or remote.  It answers one at a time
+	uint32_t atCommandTime;
+	uint32_t seed;
+
+	// 2.4GHz radio at 9600 baud (as in the examples), no loss: 250kbps, 20 bytes of RF overhead, 1.5ms per frame
+	LinkSettings();
+};
+
+/**
+ * Per radio counters.  The TX counters are for frames this radio sent, the RX ones for frames it passed
+ * to its Arduino
+ */
+struct LinkStats {
+	uint32_t txFrames;
+	uint32_t delivered;
+	// drop causes
+	uint32_t radioQueueFull;
+	uint32_t rfLost;
+	uint32_t rxOverflow;
+	uint32_t corrupted;
+
+	uint32_t rfRetries;
+	uint32_t rxFrames;
+	uint32_t atCommands;
+
+	LinkStats();
+};
+
+class SimulatedLink;
+
+/**
+ * The Arduino side of a serial port to a simulated radio
+ */
+class SimulatedSerial : public Stream {
+public:
+	int available();
+	int read();
+	int peek();
+	size_t write(uint8_t b);
+private:
+	friend class SimulatedLink;
+	SimulatedLink* _link;
+	uint8_t _radio;
+	std::deque<uint8_t> _rx;
+};
+
+/**
+ * Two XBee radios in API mode and the RF channel between them, in simulated time, so XBee objects can
+ * talk to each other on a PC.  Give each end's XBee getSerial(0) or getSerial(1), call the two sketches'
+ * loop code in turn, and advance time with run() in between:
+ * <p/>
+ * SimulatedLink link = SimulatedLink(settings);
+ * xbee.setSerial(link.getSerial(0));
+ * ground.setSerial(link.getSerial(1));
+ * while (...) {
+ *   ...
+ *   link.run(100);
+ * }
+ * <p/>
+ * Link this instead of HostClock.cpp: millis() returns simulated time, which only moves in run().  So
+ * sketch code must not wait for millis() to change (readPacket(timeout) never returns); poll instead.
+ * <p/>
+ * Radios answer TX requests (Series 1 16 and 64-bit, ZigBee) with a TX status and deliver the matching
+ * RX packet to the other end, answer local AT commands (values set are kept and returned on query)
+ * and carry remote AT commands to the other radio.  Frames on air share one half duplex channel.
+ */
+class SimulatedLink {
+public:
+	SimulatedLink(const LinkSettings &settings);
+	SimulatedSerial& getSerial(uint8_t radio);
+	/**
+	 * Sets the radio's SH/SL and MY.  Defaults are 0013a200 4000000n and n + 1
+	 */
+	void setAddress(uint8_t radio, uint32_t msb, uint32_t lsb, uint16_t address16);
+	/**
+	 * Moves time forward by micros, delivering every byte and frame due meanwhile
+	 */
+	void run(uint32_t micros);
+	LinkStats& getStats(uint8_t radio);
+	/**
+	 * Simulated time, in microseconds
+	 */
+	static uint64_t now();
+private:
+	friend class SimulatedSerial;
+
+	struct SerialByte {
+		uint64_t time;
+		uint8_t b;
+		uint32_t frame;
+	};
+
+	struct Radio {
+		SimulatedSerial serial;
+		// Arduino -> radio, and the time the last byte finishes
+		std::deque<SerialByte> in;
+		uint64_t inFree;
+		// radio -> Arduino
+		std::deque<SerialByte> out;
+		uint64_t outFree;
+		uint32_t outFrames;
+		uint32_t damagedFrame;
+		// time the radio finishes the AT commands it has been given
+		uint64_t atFree;
+		// API frame being parsed
+		std::vector<uint8_t> frame;
+		uint8_t state;
+		bool escape;
+		uint16_t length;
+		std::deque<std::vector<uint8_t> > airQueue;
+		uint32_t msb;
+		uint32_t lsb;
+		uint16_t address16;
+		std::map<uint16_t, std::vector<uint8_t> > registers;
+		LinkStats stats;
+	};
+
+	void write(uint8_t radio, uint8_t b);
+	void receive(uint8_t radio, uint8_t b);
+	void handleFrame(uint8_t radio, const std::vector<uint8_t> &frame);
+	std::vector<uint8_t> atCommand(uint8_t radio, const uint8_t *command, const uint8_t *value, uint8_t valueLength);
+	uint64_t atDone(uint8_t radio);
+	void startAir();
+	void landed(uint8_t radio, const std::vector<uint8_t> &frame, bool delivered, uint8_t retries);
+	void sendToArduino(uint8_t radio, const std::vector<uint8_t> &frame);
+	void schedule(uint64_t time, const std::function<void()> &event);
+	bool chance(float p);
+	void putAddress(std::vector<uint8_t> &frame, uint8_t radio);
+
+	LinkSettings _settings;
+	Radio _radios[2];
+	std::multimap<uint64_t, std::function<void()> > _events;
+	bool _airBusy;
+	uint8_t _nextRadio;
+	uint32_t _random;
+	uint32_t _byteTime;
+};
+
+#endif //SimulatedLink_h
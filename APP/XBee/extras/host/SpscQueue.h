@@ -0,0 +1,76 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SpscQueue_h
+#define SpscQueue_h
+
+#include <atomic>
+#include <stddef.h>
+
+/**
+ * Fixed size lock-free queue between one producer thread and one consumer thread.  Slots are filled
+ * and read in place: the producer claims a slot with claim(), fills it and publish()es it; the consumer
+ * reads front() and pop()s it.  size must be a power of two
+ */
+template <typename T, size_t size>
+class SpscQueue {
+public:
+	SpscQueue() : _head(0), _tail(0) {}
+	/**
+	 * Returns the next free slot, or NULL if the queue is full.  Producer only
+	 */
+	T* claim() {
+		size_t tail = _tail.load(std::memory_order_relaxed);
+
+		if (tail - _head.load(std::memory_order_acquire) == size) {
+			return NULL;
+		}
+
+		return &_slots[tail & (size - 1)];
+	}
+	/**
+	 * Hands the claimed slot to the consumer
+	 */
+	void publish() {
+		_tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+	/**
+	 * Returns the oldest published slot, or NULL if the queue is empty.  Consumer only
+	 */
+	T* front() {
+		size_t head = _head.load(std::memory_order_relaxed);
+
+		if (head == _tail.load(std::memory_order_acquire)) {
+			return NULL;
+		}
+
+		return &_slots[head & (size - 1)];
+	}
+	/**
+	 * Gives the front slot back to the producer
+	 */
+	void pop() {
+		_head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+private:
+	// head and tail on their own cache lines, so the two threads don't keep stealing each other's line
+	alignas(64) std::atomic<size_t> _head;
+	alignas(64) std::atomic<size_t> _tail;
+	alignas(64) T _slots[size];
+};
+
+#endif //SpscQueue_h
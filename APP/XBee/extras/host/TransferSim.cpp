@@ -0,0 +1,188 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TransferSim.h"
+
+#include <string.h>
+
+// how often each sketch's loop() runs
+#define STEP_MICROS 50
+
+// the file on the can and the copy on the ground
+static const std::vector<uint8_t>* file;
+static std::vector<uint8_t> copy;
+static uint32_t readFaults;
+static uint32_t reads;
+static uint32_t writes;
+
+static int readBlock(uint32_t offset, uint8_t *buffer, uint8_t length) {
+	reads++;
+
+	if (readFaults > 0 && reads % readFaults == 0) {
+		// a failed read every other time, a short one otherwise
+		if ((reads / readFaults) % 2) {
+			return -1;
+		}
+
+		length--;
+	}
+
+	if (offset + length > file->size()) {
+		return -1;
+	}
+
+	memcpy(buffer, &(*file)[offset], length);
+
+	return length;
+}
+
+static void writeBlock(uint32_t offset, const uint8_t *data, uint8_t length) {
+	writes++;
+
+	if (copy.size() < offset + length) {
+		copy.resize(offset + length);
+	}
+
+	memcpy(&copy[offset], data, length);
+}
+
+PacedSerial::PacedSerial(Stream &serial, long baud) {
+	_serial = &serial;
+	// 10 bits per byte
+	_byteMicros = 10000000ULL / baud;
+	_busyUntil = 0;
+}
+
+int PacedSerial::available() {
+	return _serial->available();
+}
+
+int PacedSerial::read() {
+	return _serial->read();
+}
+
+int PacedSerial::peek() {
+	return _serial->peek();
+}
+
+size_t PacedSerial::write(uint8_t b) {
+	if (_busyUntil < SimulatedLink::now()) {
+		_busyUntil = SimulatedLink::now();
+	}
+
+	_busyUntil+= _byteMicros;
+
+	return _serial->write(b);
+}
+
+bool PacedSerial::isBusy() {
+	return SimulatedLink::now() < _busyUntil;
+}
+
+Transfer::Transfer(const LinkSettings &settings, const std::vector<uint8_t> &bytes, uint8_t payloadSize, uint16_t retransmitTimeout, uint16_t ackDelay) :
+	_link(settings),
+	_canSerial(_link.getSerial(0), settings.baud),
+	_groundSerial(_link.getSerial(1), settings.baud),
+	_groundAddr(0x0013a200, 0x40000001),
+	_canAddr(0x0013a200, 0x40000000),
+	_canTx(_groundAddr, NULL, 0),
+	_groundTx(_canAddr, NULL, 0),
+	_block(payloadSize),
+	_sender(_can, _canTx, &_block[0], payloadSize, readBlock, bytes.size(), retransmitTimeout),
+	_receiver(_ground, _groundTx, _ack, writeBlock, ackDelay),
+	_ackDelay(ackDelay) {
+
+	file = &bytes;
+	copy.clear();
+	readFaults = 0;
+	reads = 0;
+	writes = 0;
+
+	_can.setSerial(_canSerial);
+	_ground.setSerial(_groundSerial);
+}
+
+Transfer::~Transfer() {
+	file = NULL;
+}
+
+void Transfer::setReadFaults(uint32_t every) {
+	readFaults = every;
+}
+
+void Transfer::begin(uint32_t offset) {
+	// a new receiver, as after a restart of the ground station
+	_receiver = FileDownlinkReceiver(_ground, _groundTx, _ack, writeBlock, _ackDelay);
+	_receiver.begin(offset);
+}
+
+bool Transfer::run(uint64_t maxMicros, uint32_t stopAt) {
+	uint64_t end = SimulatedLink::now() + maxMicros;
+
+	while (!_receiver.isComplete() && _receiver.getOffset() < stopAt && SimulatedLink::now() < end) {
+		loop();
+	}
+
+	return _receiver.isComplete();
+}
+
+void Transfer::loop() {
+	if (!_canSerial.isBusy()) {
+		_can.readPacket();
+
+		if (_can.getResponse().isAvailable() && _can.getResponse().getApiId() == ZB_RX_RESPONSE) {
+			_can.getResponse().getZBRxResponse(_rx);
+			_sender.handlePayload(_rx.getData(), _rx.getDataLength());
+		}
+
+		// sends at most one frame
+		_sender.poll();
+	}
+
+	if (!_groundSerial.isBusy()) {
+		_ground.readPacket();
+
+		if (_ground.getResponse().isAvailable() && _ground.getResponse().getApiId() == ZB_RX_RESPONSE) {
+			_ground.getResponse().getZBRxResponse(_rx);
+			_receiver.handlePayload(_rx.getData(), _rx.getDataLength());
+		}
+
+		_receiver.poll();
+	}
+
+	_link.run(STEP_MICROS);
+}
+
+bool Transfer::isIntact() {
+	return copy == *file;
+}
+
+SimulatedLink& Transfer::getLink() {
+	return _link;
+}
+
+FileDownlink& Transfer::getSender() {
+	return _sender;
+}
+
+FileDownlinkReceiver& Transfer::getReceiver() {
+	return _receiver;
+}
+
+uint32_t Transfer::getWriteCount() {
+	return writes;
+}
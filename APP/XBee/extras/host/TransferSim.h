@@ -0,0 +1,103 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TransferSim_h
+#define TransferSim_h
+
+#include "SimulatedLink.h"
+#include "XBee.h"
+#include "XBeeFileTransfer.h"
+
+#include <vector>
+
+/**
+ * A serial port that holds its sketch while written bytes go out, as a sketch blocked in Serial.write()
+ * would be.  SimulatedSerial queues writes without blocking, which would let a sketch that sends a frame
+ * per loop() run ahead of its serial port
+ */
+class PacedSerial : public Stream {
+public:
+	PacedSerial(Stream &serial, long baud);
+	int available();
+	int read();
+	int peek();
+	size_t write(uint8_t b);
+	/**
+	 * Returns true while the sketch is still writing
+	 */
+	bool isBusy();
+private:
+	Stream* _serial;
+	uint64_t _byteMicros;
+	uint64_t _busyUntil;
+};
+
+/**
+ * The Series2_FileDownlink sketch on the can (radio 0) and the xbee_downlink tool on the ground (radio 1),
+ * on a SimulatedLink.  The can's file is in memory, and its reads can be made to fail or come up short;
+ * the ground's copy is in memory too.  One Transfer at a time, as the read and write callbacks are plain
+ * functions
+ */
+class Transfer {
+public:
+	Transfer(const LinkSettings &settings, const std::vector<uint8_t> &file, uint8_t payloadSize, uint16_t retransmitTimeout, uint16_t ackDelay);
+	~Transfer();
+	/**
+	 * Makes every nth read fail, alternately with -1 and one byte short; 0 for none
+	 */
+	void setReadFaults(uint32_t every);
+	/**
+	 * Starts (or restarts, as after a reset of the ground station) the receiver at offset.  A restarted
+	 * receiver forgets the blocks it had past its offset, as a new xbee_downlink would
+	 */
+	void begin(uint32_t offset);
+	/**
+	 * Runs both sketches until the receiver has the whole file, its offset reaches stopAt, or maxMicros
+	 * of simulated time have passed.  Returns true if the receiver is complete
+	 */
+	bool run(uint64_t maxMicros, uint32_t stopAt = 0xffffffff);
+	/**
+	 * Returns true if the ground's copy matches the file byte for byte
+	 */
+	bool isIntact();
+	SimulatedLink& getLink();
+	FileDownlink& getSender();
+	FileDownlinkReceiver& getReceiver();
+	/**
+	 * Returns the number of times the receiver was handed a block
+	 */
+	uint32_t getWriteCount();
+private:
+	void loop();
+	SimulatedLink _link;
+	PacedSerial _canSerial;
+	PacedSerial _groundSerial;
+	XBee _can;
+	XBee _ground;
+	XBeeAddress64 _groundAddr;
+	XBeeAddress64 _canAddr;
+	ZBTxRequest _canTx;
+	ZBTxRequest _groundTx;
+	ZBRxResponse _rx;
+	std::vector<uint8_t> _block;
+	uint8_t _ack[FILE_DOWNLINK_ACK_LENGTH];
+	FileDownlink _sender;
+	FileDownlinkReceiver _receiver;
+	uint16_t _ackDelay;
+};
+
+#endif //TransferSim_h
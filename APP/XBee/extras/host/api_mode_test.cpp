@@ -0,0 +1,302 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Tests XBeeRadio<apiMode, frameDataSize> and compares the radios' size and speed.
+ * <p/>
+ * Round trips: a sender and a receiver of the same XBeeRadio type send TX16, TX64 and ZB TX frames one at a
+ * time over a SimulatedLink in the same API mode.  Payloads are mostly START_BYTE, ESCAPE, XON and XOFF, so
+ * AP=2 escapes nearly every byte and AP=1 must pass them through raw.  Every frame must arrive intact, up to a
+ * full 100 byte Series 1 payload.  An XBeeRadio<2, 40> must take frames that fit in 40 bytes and reject
+ * larger ones with PACKET_EXCEEDS_BYTE_ARRAY_LENGTH.
+ * <p/>
+ * Then it prints sizeof() of each radio, and times send() and readPacket() per mode on the same frames,
+ * in memory.
+ * <p/>
+ * Build from the library directory:
+ * <p/>
+ * g++ -O2 -std=c++11 -DARDUINO=100 -Iextras/host -I. extras/host/api_mode_test.cpp extras/host/SimulatedLink.cpp extras/host/PosixSerial.cpp XBee.cpp -o api_mode_test
+ */
+
+#include "SimulatedLink.h"
+#include "XBee.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+#define STEP_MICROS 50
+// how long the receiver waits for each frame, in simulated microseconds
+#define FRAME_TIMEOUT 200000
+#define FRAMES 1000
+
+#define SPEED_FRAMES 20000
+#define SPEED_PASSES 20
+
+enum FrameType { TX16, TX64, ZB };
+
+static const char* typeNames[] = { "TX16", "TX64", "ZB TX" };
+
+static uint8_t payloadByte(uint16_t seq, uint8_t i) {
+	static const uint8_t special[] = { START_BYTE, ESCAPE, XON, XOFF };
+	uint8_t b = seq * 31 + i * 7;
+
+	return b % 5 == 4 ? b : special[b % 4];
+}
+
+/**
+ * Sends FRAMES frames of the given type with payloads of 1 to maxPayload bytes.  Frames with more than
+ * fitPayload bytes must be rejected by the receiver, the rest must arrive intact
+ */
+template <class Radio>
+static bool roundTrip(uint8_t apiMode, const char *radioName, FrameType type, uint8_t maxPayload, uint8_t fitPayload) {
+	LinkSettings settings;
+	settings.baud = 115200;
+	settings.apiMode = apiMode;
+
+	SimulatedLink link = SimulatedLink(settings);
+
+	Radio sender;
+	Radio receiver;
+	sender.setSerial(link.getSerial(0));
+	receiver.setSerial(link.getSerial(1));
+
+	uint8_t payload[100];
+	XBeeAddress64 addr64 = XBeeAddress64(0x0013a200, 0x40000001);
+	Tx16Request tx16 = Tx16Request(2, payload, 0);
+	Tx64Request tx64 = Tx64Request(addr64, payload, 0);
+	ZBTxRequest zbTx = ZBTxRequest(addr64, payload, 0);
+	// no TX status, so the receiver's response is the only one
+	tx16.setFrameId(NO_RESPONSE_FRAME_ID);
+	tx64.setFrameId(NO_RESPONSE_FRAME_ID);
+	zbTx.setFrameId(NO_RESPONSE_FRAME_ID);
+
+	Rx16Response rx16 = Rx16Response();
+	Rx64Response rx64 = Rx64Response();
+	ZBRxResponse zbRx = ZBRxResponse();
+
+	uint32_t intact = 0, rejected = 0, wrong = 0;
+
+	for (uint16_t seq = 0; seq < FRAMES; seq++) {
+		uint8_t length = 1 + seq % maxPayload;
+
+		for (uint8_t i = 0; i < length; i++) {
+			payload[i] = payloadByte(seq, i);
+		}
+
+		if (type == TX16) {
+			tx16.setPayloadLength(length);
+			sender.send(tx16);
+		} else if (type == TX64) {
+			tx64.setPayloadLength(length);
+			sender.send(tx64);
+		} else {
+			zbTx.setPayloadLength(length);
+			sender.send(zbTx);
+		}
+
+		uint64_t deadline = SimulatedLink::now() + FRAME_TIMEOUT;
+		bool answered = false;
+
+		while (!answered && SimulatedLink::now() < deadline) {
+			sender.readPacket();
+			receiver.readPacket();
+
+			XBeeResponse& response = receiver.getResponse();
+
+			if (response.isError()) {
+				answered = true;
+				rejected+= length > fitPayload && response.getErrorCode() == PACKET_EXCEEDS_BYTE_ARRAY_LENGTH;
+				wrong+= length <= fitPayload || response.getErrorCode() != PACKET_EXCEEDS_BYTE_ARRAY_LENGTH;
+			} else if (response.isAvailable()) {
+				uint8_t* data = NULL;
+				uint8_t dataLength = 0;
+
+				answered = true;
+
+				if (response.getApiId() == RX_16_RESPONSE && type == TX16) {
+					response.getRx16Response(rx16);
+					data = rx16.getData();
+					dataLength = rx16.getDataLength();
+				} else if (response.getApiId() == RX_64_RESPONSE && type == TX64) {
+					response.getRx64Response(rx64);
+					data = rx64.getData();
+					dataLength = rx64.getDataLength();
+				} else if (response.getApiId() == ZB_RX_RESPONSE && type == ZB) {
+					response.getZBRxResponse(zbRx);
+					data = zbRx.getData();
+					dataLength = zbRx.getDataLength();
+				}
+
+				bool ok = data != NULL && length <= fitPayload && dataLength == length;
+
+				for (uint8_t i = 0; ok && i < length; i++) {
+					ok = data[i] == payload[i];
+				}
+
+				intact+= ok;
+				wrong+= !ok;
+			}
+
+			link.run(STEP_MICROS);
+		}
+	}
+
+	uint32_t expectIntact = 0;
+
+	for (uint16_t seq = 0; seq < FRAMES; seq++) {
+		expectIntact+= 1 + seq % maxPayload <= fitPayload;
+	}
+
+	bool ok = intact == expectIntact && rejected == FRAMES - expectIntact && wrong == 0;
+
+	printf("AP=%u %-24s %-6s %4u %6u %6u %6u %6u  %s\n", apiMode, radioName, typeNames[type], maxPayload,
+			FRAMES, intact, rejected, wrong, ok ? "ok" : "FAILED");
+	return ok;
+}
+
+/**
+ * Written frames are discarded, read() replays a capture in memory
+ */
+class MemoryStream : public Stream {
+public:
+	MemoryStream() : _bytes(NULL), _pos(0) {}
+	void replay(const std::vector<uint8_t> &bytes) { _bytes = &bytes; _pos = 0; }
+	int available() { return _bytes != NULL ? _bytes->size() - _pos : 0; }
+	int read() { return available() > 0 ? (*_bytes)[_pos++] : -1; }
+	int peek() { return available() > 0 ? (*_bytes)[_pos] : -1; }
+	size_t write(uint8_t) { return 1; }
+	size_t write(const uint8_t*, size_t size) { return size; }
+private:
+	const std::vector<uint8_t>* _bytes;
+	size_t _pos;
+};
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void appendByte(std::vector<uint8_t> &out, uint8_t apiMode, uint8_t b) {
+	if (apiMode == 2 && (b == START_BYTE || b == ESCAPE || b == XON || b == XOFF)) {
+		out.push_back(ESCAPE);
+		out.push_back(b ^ 0x20);
+	} else {
+		out.push_back(b);
+	}
+}
+
+// RX16 packets carrying the round trip payloads, in the given API mode's framing
+static std::vector<uint8_t> capture(uint8_t apiMode) {
+	std::vector<uint8_t> out;
+
+	for (uint16_t seq = 0; seq < SPEED_FRAMES; seq++) {
+		uint8_t length = 1 + seq % 100;
+		uint8_t checksum = RX_16_RESPONSE + 0x28;
+
+		out.push_back(START_BYTE);
+		appendByte(out, apiMode, 0);
+		appendByte(out, apiMode, length + 5);
+		appendByte(out, apiMode, RX_16_RESPONSE);
+		// source address 0x0002, rssi, options
+		appendByte(out, apiMode, 0);
+		appendByte(out, apiMode, 2);
+		appendByte(out, apiMode, 0x28);
+		appendByte(out, apiMode, 0);
+		checksum+= 2;
+
+		for (uint8_t i = 0; i < length; i++) {
+			appendByte(out, apiMode, payloadByte(seq, i));
+			checksum+= payloadByte(seq, i);
+		}
+
+		appendByte(out, apiMode, 0xff - checksum);
+	}
+
+	return out;
+}
+
+template <class Radio>
+static void speed(uint8_t apiMode, const char *radioName) {
+	MemoryStream stream;
+	Radio radio;
+	radio.setSerial(stream);
+
+	uint8_t payload[100];
+	Tx16Request tx16 = Tx16Request(2, payload, 0);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (uint8_t pass = 0; pass < SPEED_PASSES; pass++) {
+		for (uint16_t seq = 0; seq < SPEED_FRAMES; seq++) {
+			uint8_t length = 1 + seq % 100;
+
+			for (uint8_t i = 0; i < length; i++) {
+				payload[i] = payloadByte(seq, i);
+			}
+
+			tx16.setPayloadLength(length);
+			radio.send(tx16);
+		}
+	}
+
+	double sendRate = SPEED_FRAMES * SPEED_PASSES / seconds(start);
+
+	std::vector<uint8_t> bytes = capture(apiMode);
+	uint32_t frames = 0;
+
+	start = std::chrono::steady_clock::now();
+
+	for (uint8_t pass = 0; pass < SPEED_PASSES; pass++) {
+		stream.replay(bytes);
+
+		while (stream.available() > 0) {
+			radio.readPacket();
+			frames+= radio.getResponse().isAvailable();
+		}
+	}
+
+	double readRate = frames / seconds(start);
+
+	printf("AP=%u %-24s %6lu %10.0f %10.0f %9lu %6s\n", apiMode, radioName, (unsigned long) sizeof(Radio), sendRate,
+			readRate, (unsigned long) bytes.size(), frames == SPEED_FRAMES * SPEED_PASSES ? "ok" : "FAILED");
+}
+
+int main() {
+	printf("%-29s %-6s %4s %6s %6s %6s %6s\n", "radio", "frame", "max", "sent", "intact", "reject", "wrong");
+
+	bool ok = true;
+
+	ok = roundTrip<XBeeRadio<1, MAX_FRAME_DATA_SIZE> >(1, "XBeeRadio<1, MAX>", TX16, 100, 100) && ok;
+	ok = roundTrip<XBeeRadio<1, MAX_FRAME_DATA_SIZE> >(1, "XBeeRadio<1, MAX>", TX64, 100, 100) && ok;
+	ok = roundTrip<XBeeRadio<1, MAX_FRAME_DATA_SIZE> >(1, "XBeeRadio<1, MAX>", ZB, 72, 72) && ok;
+	ok = roundTrip<XBeeRadio<2, MAX_FRAME_DATA_SIZE> >(2, "XBeeRadio<2, MAX>", TX16, 100, 100) && ok;
+	ok = roundTrip<XBeeRadio<2, MAX_FRAME_DATA_SIZE> >(2, "XBeeRadio<2, MAX>", TX64, 100, 100) && ok;
+	ok = roundTrip<XBeeRadio<2, MAX_FRAME_DATA_SIZE> >(2, "XBeeRadio<2, MAX>", ZB, 72, 72) && ok;
+	// ZB RX frame data is 11 bytes plus the payload
+	ok = roundTrip<XBeeRadio<2, 40> >(2, "XBeeRadio<2, 40>", ZB, 40, 29) && ok;
+	ok = roundTrip<XBee>(ATAP, "XBee", TX64, 100, 100) && ok;
+
+	printf("\n%-29s %6s %10s %10s %9s\n", "radio", "bytes", "send/s", "read/s", "capture");
+
+	speed<XBeeRadio<1, MAX_FRAME_DATA_SIZE> >(1, "XBeeRadio<1, MAX>");
+	speed<XBeeRadio<2, MAX_FRAME_DATA_SIZE> >(2, "XBeeRadio<2, MAX>");
+	speed<XBee>(ATAP, "XBee");
+	printf("AP=2 %-24s %6lu\n", "XBeeRadio<2, 40>", (unsigned long) sizeof(XBeeRadio<2, 40>));
+
+	printf("\n%s\n", ok ? "all passed" : "FAILED");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Configures a radio at boot with a typical list of AT commands over a SimulatedLink, local and remote,
+ * once the usual way (send a command, wait for its response, send the next) and once with an
+ * AtCommandBatch, and reports how long each takes.
+ * <p/>
+ * Build from the library directory:
+ * <p/>
+ * g++ -O2 -std=c++11 -DARDUINO=100 -Iextras/host -I. extras/host/at_benchmark.cpp extras/host/SimulatedLink.cpp extras/host/PosixSerial.cpp XBee.cpp -o at_benchmark
+ */
+
+#include "SimulatedLink.h"
+#include "XBee.h"
+
+#include <stdio.h>
+
+#define STEP_MICROS 50
+#define TIMEOUT 2000
+
+struct Command {
+	const char* command;
+	const char* value;
+	uint8_t valueLength;
+};
+
+// sets then reads back the addresses
+static const Command boot[] = {
+	{ "ID", "\x33\x32", 2 },
+	{ "NI", "PROBE-1", 7 },
+	{ "PL", "\x04", 1 },
+	{ "SM", "\x00", 1 },
+	{ "SP", "\x00\x20", 2 },
+	{ "DH", "\x00\x13\xa2\x00", 4 },
+	{ "DL", "\x40\x00\x00\x01", 4 },
+	{ "D0", "\x02", 1 },
+	{ "D1", "\x03", 1 },
+	{ "IR", "\x03\xe8", 2 },
+	{ "NH", "\x0a", 1 },
+	{ "JV", "\x01", 1 },
+	{ "SH", NULL, 0 },
+	{ "SL", NULL, 0 },
+	{ "MY", NULL, 0 }
+};
+
+#define BOOT_COMMANDS (sizeof(boot) / sizeof(boot[0]))
+
+struct Scenario {
+	const char* name;
+	long baud;
+	bool remote;
+};
+
+static const Scenario scenarios[] = {
+	{ "local, 9600 baud", 9600, false },
+	{ "local, 115200 baud", 115200, false },
+	{ "remote, 9600 baud", 9600, true },
+	{ "remote, 115200 baud", 115200, true }
+};
+
+static uint8_t answered;
+
+static void commandDone(uint8_t, uint8_t status, uint8_t *, uint8_t) {
+	if (status == AT_OK) {
+		answered++;
+	}
+}
+
+// the frame id of the AT response, or NO_RESPONSE_FRAME_ID if the packet is something else
+static uint8_t responseFrameId(XBee &xbee) {
+	XBeeResponse& response = xbee.getResponse();
+
+	if (response.isAvailable() && (response.getApiId() == AT_COMMAND_RESPONSE || response.getApiId() == REMOTE_AT_COMMAND_RESPONSE)) {
+		return response.getFrameData()[0];
+	}
+
+	return NO_RESPONSE_FRAME_ID;
+}
+
+// returns milliseconds to configure the radio, or 0 if a command failed
+static float sequential(SimulatedLink &link, XBee &xbee, XBeeAddress64 &remoteAddress) {
+	AtCommandRequest local = AtCommandRequest();
+	RemoteAtCommandRequest remote = RemoteAtCommandRequest();
+	remote.setRemoteAddress64(remoteAddress);
+	remote.setApplyChanges(true);
+
+	AtCommandRequest& request = remoteAddress.getLsb() != 0 ? remote : local;
+	uint64_t start = SimulatedLink::now();
+
+	for (size_t i = 0; i < BOOT_COMMANDS; i++) {
+		request.setCommand((uint8_t*) boot[i].command);
+		request.setCommandValue((uint8_t*) boot[i].value);
+		request.setCommandValueLength(boot[i].valueLength);
+		request.setFrameId(xbee.getNextFrameId());
+		xbee.send(request);
+
+		uint64_t sent = SimulatedLink::now();
+
+		for (;;) {
+			link.run(STEP_MICROS);
+			xbee.readPacket();
+
+			if (responseFrameId(xbee) == request.getFrameId()) {
+				break;
+			}
+
+			if (SimulatedLink::now() - sent > TIMEOUT * 1000ULL) {
+				return 0;
+			}
+		}
+	}
+
+	return (SimulatedLink::now() - start) / 1000.0f;
+}
+
+static float batched(SimulatedLink &link, XBee &xbee, XBeeAddress64 &remoteAddress) {
+	AtCommandBatch batch = AtCommandBatch(xbee, TIMEOUT);
+	batch.setCallback(commandDone);
+
+	if (remoteAddress.getLsb() != 0) {
+		batch.setRemoteAddress64(remoteAddress);
+	}
+
+	for (size_t i = 0; i < BOOT_COMMANDS; i++) {
+		batch.add((uint8_t*) boot[i].command, (uint8_t*) boot[i].value, boot[i].valueLength);
+	}
+
+	uint64_t start = SimulatedLink::now();
+	answered = 0;
+	batch.send();
+
+	while (!batch.isDone()) {
+		link.run(STEP_MICROS);
+		xbee.readPacket();
+
+		if (xbee.getResponse().isAvailable()) {
+			batch.handleResponse(xbee.getResponse());
+		}
+
+		batch.poll();
+	}
+
+	if (!batch.isOk() || answered != BOOT_COMMANDS) {
+		return 0;
+	}
+
+	return (SimulatedLink::now() - start) / 1000.0f;
+}
+
+static void run(const Scenario &scenario) {
+	float ms[2];
+
+	for (int b = 0; b < 2; b++) {
+		LinkSettings settings;
+		settings.baud = scenario.baud;
+
+		SimulatedLink link = SimulatedLink(settings);
+		XBee xbee = XBee();
+		xbee.setSerial(link.getSerial(0));
+
+		// SH + SL of the other radio, or 0 for the local one
+		XBeeAddress64 remoteAddress = scenario.remote ? XBeeAddress64(0x0013a200, 0x40000001) : XBeeAddress64(0, 0);
+
+		ms[b] = b == 0 ? sequential(link, xbee, remoteAddress) : batched(link, xbee, remoteAddress);
+	}
+
+	printf("%-22s %12.1f %12.1f %8.1fx\n", scenario.name, ms[0], ms[1], ms[1] > 0 ? ms[0] / ms[1] : 0);
+}
+
+int main() {
+	printf("%u commands, batch window %u\n", (unsigned) BOOT_COMMANDS, AT_BATCH_WINDOW);
+	printf("%-22s %12s %12s %9s\n", "scenario", "one by one", "batched", "speedup");
+
+	for (size_t s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++) {
+		run(scenarios[s]);
+	}
+
+	return 0;
+}
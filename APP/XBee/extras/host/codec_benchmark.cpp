@@ -0,0 +1,262 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Compression ratio and cost of TelemetryEncoder on a flight's records.  By default the records are a
+ * synthetic CanSat flight at 20 records/s: 10s on the pad, a 30s climb to 4km, then 8m/s under parachute to
+ * the ground, with GPS (lat, lng E7, altitude cm) updating at 5Hz, pressure (Pa) and temperature (0.01C)
+ * with sensor noise, and raw MPU6050 accelerometer and gyro axes, noisy and swinging under the parachute.
+ * A recorded flight can be given instead as a CSV file of integer channels, one record per line; lines
+ * that don't start with a number (a header) are skipped.
+ * <p/>
+ * Reports payload bytes against the same records as int32 and as packed fixed width fields (each channel
+ * in as few bytes as its range needs), records per TELEMETRY_PAYLOAD byte frame, and encode and decode
+ * cost per record, in time stamp counter cycles where there is one (host cycles, not AVR ones).
+ * <p/>
+ * Build from the library directory:
+ * <p/>
+ * g++ -O2 -std=c++11 -DARDUINO=100 -Iextras/host -I. extras/host/codec_benchmark.cpp extras/host/PosixSerial.cpp extras/host/HostClock.cpp XBee.cpp XBeeTelemetry.cpp -o codec_benchmark
+ * ./codec_benchmark [flight.csv]
+ */
+
+#include "XBeeTelemetry.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define TELEMETRY_PAYLOAD 72
+#define RECORD_RATE 20
+#define PASSES 20
+
+// time stamp counter where there is one, nanoseconds otherwise
+#if defined(__x86_64__) || defined(__i386__)
+#define TICKS "cycles"
+static uint64_t ticks() { return __rdtsc(); }
+#else
+#define TICKS "ns"
+static uint64_t ticks() { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+#endif
+
+typedef std::vector<int32_t> Record;
+
+static uint32_t lcg = 1;
+
+// roughly normal, unit variance
+static double noise() {
+	double sum = 0;
+
+	for (uint8_t i = 0; i < 12; i++) {
+		lcg = lcg * 1103515245 + 12345;
+		sum+= (lcg >> 8) / double(1 << 24);
+	}
+
+	return sum - 6;
+}
+
+static int32_t pressureAt(double altitude) {
+	return int32_t(101325 * pow(1 - 2.25577e-5 * altitude, 5.25588));
+}
+
+/**
+ * The synthetic flight: lat, lng, GPS altitude, pressure, temperature, then accelerometer and gyro x, y, z
+ */
+static std::vector<Record> flight() {
+	std::vector<Record> records;
+	double altitude = 0, climb = 0;
+	double lat = 37.1234567, lng = -3.7654321;
+	Record gps(3);
+
+	for (uint32_t n = 0; altitude >= 0; n++) {
+		double t = n / double(RECORD_RATE);
+		double accel = 0;
+
+		if (t >= 10 && t < 40) {
+			// climb to 4km, decelerating
+			climb = 2 * 4000 / 30.0 * (40 - t) / 30;
+			accel = -2 * 4000 / 900.0;
+		} else if (t >= 40) {
+			climb = -8;
+		}
+
+		altitude+= climb / RECORD_RATE;
+
+		if (t >= 40) {
+			// drifting with the wind under the parachute
+			lat+= 4 / 111000.0 / RECORD_RATE;
+			lng+= 2.5 / 88000.0 / RECORD_RATE;
+		}
+
+		if (n % (RECORD_RATE / 5) == 0) {
+			gps[0] = int32_t(lat * 1e7 + noise() * 15);
+			gps[1] = int32_t(lng * 1e7 + noise() * 15);
+			gps[2] = int32_t(altitude * 100 + noise() * 150);
+		}
+
+		double swing = t >= 40 ? sin(t * 2.1) : 0;
+		Record record = gps;
+
+		record.push_back(pressureAt(altitude + noise() * 0.3));
+		record.push_back(int32_t((15 - 0.0065 * altitude) * 100 + noise() * 4));
+		// 16384 counts per g, 131 per degree/s
+		record.push_back(int32_t(noise() * 20 + swing * 1500));
+		record.push_back(int32_t(noise() * 20 + swing * 900));
+		record.push_back(int32_t(16384 * (1 + accel / 9.81) + noise() * 25));
+		record.push_back(int32_t(noise() * 8 + swing * 2600));
+		record.push_back(int32_t(noise() * 8 - swing * 1700));
+		record.push_back(int32_t(noise() * 8 + (t >= 40 ? 131 * 45 : 0)));
+
+		records.push_back(record);
+	}
+
+	return records;
+}
+
+static std::vector<Record> readCsv(const char *path) {
+	std::vector<Record> records;
+	FILE* file = fopen(path, "r");
+	char line[1024];
+
+	if (file == NULL) {
+		return records;
+	}
+
+	while (fgets(line, sizeof(line), file) != NULL) {
+		Record record;
+		char* p = line;
+		char* end;
+
+		while (record.size() < TELEMETRY_MAX_CHANNELS) {
+			long value = strtol(p, &end, 10);
+
+			if (end == p) {
+				break;
+			}
+
+			record.push_back(value);
+			p = end + (*end == ',');
+		}
+
+		if (!record.empty() && (records.empty() || record.size() == records[0].size())) {
+			records.push_back(record);
+		}
+	}
+
+	fclose(file);
+
+	return records;
+}
+
+// bytes each channel needs as a fixed width field, for the range it takes
+static uint8_t fixedBytes(const std::vector<Record> &records) {
+	uint8_t bytes = 0;
+
+	for (size_t c = 0; c < records[0].size(); c++) {
+		int32_t low = 0, high = 0;
+
+		for (size_t n = 0; n < records.size(); n++) {
+			low = records[n][c] < low ? records[n][c] : low;
+			high = records[n][c] > high ? records[n][c] : high;
+		}
+
+		bytes+= low >= -128 && high < 128 ? 1 : low >= -32768 && high < 32768 ? 2 : low >= -8388608 && high < 8388608 ? 3 : 4;
+	}
+
+	return bytes;
+}
+
+int main(int argc, char **argv) {
+	std::vector<Record> records = argc > 1 ? readCsv(argv[1]) : flight();
+
+	if (records.empty()) {
+		fprintf(stderr, "no records in %s\n", argv[1]);
+		return 1;
+	}
+
+	uint8_t channels = records[0].size();
+	std::vector<std::vector<uint8_t> > payloads;
+	int32_t previous[TELEMETRY_MAX_CHANNELS];
+	uint8_t buffer[TELEMETRY_PAYLOAD];
+	uint64_t encodeTicks = ~0ULL, decodeTicks = ~0ULL;
+	size_t decodedRecords = 0;
+
+	for (int pass = 0; pass < PASSES; pass++) {
+		TelemetryEncoder encoder = TelemetryEncoder(previous, channels);
+		std::vector<std::vector<uint8_t> > frames;
+
+		uint64_t start = ticks();
+		encoder.begin(buffer, sizeof(buffer));
+
+		for (size_t n = 0; n < records.size(); n++) {
+			if (!encoder.add(&records[n][0])) {
+				frames.push_back(std::vector<uint8_t>(buffer, buffer + encoder.getLength()));
+				encoder.begin(buffer, sizeof(buffer));
+				encoder.add(&records[n][0]);
+			}
+		}
+
+		frames.push_back(std::vector<uint8_t>(buffer, buffer + encoder.getLength()));
+		uint64_t elapsed = ticks() - start;
+		encodeTicks = elapsed < encodeTicks ? elapsed : encodeTicks;
+		payloads.swap(frames);
+
+		int32_t values[TELEMETRY_MAX_CHANNELS];
+		size_t decoded = 0;
+
+		start = ticks();
+
+		for (size_t i = 0; i < payloads.size(); i++) {
+			TelemetryDecoder decoder = TelemetryDecoder(&payloads[i][0], payloads[i].size(), values, channels);
+
+			while (decoder.next()) {
+				decoded++;
+			}
+		}
+
+		elapsed = ticks() - start;
+		decodeTicks = elapsed < decodeTicks ? elapsed : decodeTicks;
+		decodedRecords = decoded;
+	}
+
+	size_t bytes = 0;
+
+	for (size_t i = 0; i < payloads.size(); i++) {
+		bytes+= payloads[i].size();
+	}
+
+	size_t raw = records.size() * channels * 4;
+	size_t fixed = records.size() * fixedBytes(records);
+
+	printf("%u records of %u channels (%s), %u decoded\n\n", (unsigned) records.size(), channels,
+			argc > 1 ? argv[1] : "synthetic flight", (unsigned) decodedRecords);
+	printf("%-24s %10s %8s %14s\n", "", "bytes", "ratio", "records/frame");
+	printf("%-24s %10u %8.2f %14.1f\n", "int32", (unsigned) raw, 1.0, TELEMETRY_PAYLOAD / (channels * 4.0));
+	printf("%-24s %10u %8.2f %14.1f\n", "fixed width", (unsigned) fixed, double(raw) / fixed,
+			double(TELEMETRY_PAYLOAD) * records.size() / fixed);
+	printf("%-24s %10u %8.2f %14.1f\n", "delta + varint", (unsigned) bytes, double(raw) / bytes,
+			double(records.size()) / payloads.size());
+	printf("\n%-24s %10.0f " TICKS "/record\n", "encode", double(encodeTicks) / records.size());
+	printf("%-24s %10.0f " TICKS "/record\n", "decode", double(decodeTicks) / records.size());
+
+	return decodedRecords == records.size() ? 0 : 1;
+}
@@ -0,0 +1,281 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Randomized recovery test for FecEncoder and FecDecoder.  Per RS code, an encoder sends GROUPS groups of
+ * payloads of random length (2 to getMaxDataLength() bytes, each starting with its sequence number) over a
+ * clean SimulatedLink, and the ground keeps every frame.  Every fifth group is ended early with flush(),
+ * after a random number of payloads, so its parity frames cover a short group.  The frames are then
+ * replayed into a fresh FecDecoder TRIALS times, with frames erased in random positions of every group:
+ * <p/>
+ * - up to parityFrames per group: every payload must come out exactly once, byte for byte, marked
+ *   recovered exactly when its frame was erased, and none may be counted lost
+ * - parityFrames + 1 per group: nothing can be rebuilt, and nothing wrong or repeated may come out
+ * <p/>
+ * Build from the library directory:
+ * <p/>
+ * g++ -O2 -std=c++11 -DARDUINO=100 -Iextras/host -I. extras/host/fec_test.cpp extras/host/SimulatedLink.cpp extras/host/PosixSerial.cpp XBee.cpp XBeeFec.cpp -o fec_test
+ */
+
+#include "SimulatedLink.h"
+#include "XBee.h"
+#include "XBeeFec.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+#define STEP_MICROS 50
+#define PAYLOAD_SIZE 72
+#define GROUPS 60
+#define TRIALS 300
+// every nth group is flushed early
+#define SHORT_GROUP 5
+
+struct Code {
+	uint8_t dataFrames;
+	uint8_t parityFrames;
+};
+
+static const Code codes[] = {
+	{ 1, 1 },
+	{ 4, 2 },
+	{ 8, 2 },
+	{ 8, 4 },
+	{ 3, 3 },
+	{ 28, 4 }
+};
+
+typedef std::vector<uint8_t> Bytes;
+
+static uint32_t lcg = 1;
+
+static uint32_t randomBelow(uint32_t range) {
+	lcg = lcg * 1103515245 + 12345;
+	return (lcg >> 8) % range;
+}
+
+// what the encoder was given, by sequence number, and what the decoder gave back
+static std::vector<Bytes> sent;
+static std::vector<uint8_t> deliveries;
+static std::vector<bool> recoveredFlag;
+static uint32_t wrong;
+
+static void delivered(const uint8_t *data, uint8_t length, bool recovered) {
+	uint16_t seq = length >= 2 ? (data[0] << 8) + data[1] : 0xffff;
+
+	if (seq >= sent.size() || Bytes(data, data + length) != sent[seq]) {
+		wrong++;
+		return;
+	}
+
+	deliveries[seq]++;
+	recoveredFlag[seq] = recovered;
+}
+
+/**
+ * Sends the payloads through an encoder over a clean link, and returns the frames the ground received,
+ * grouped
+ */
+static std::vector<std::vector<Bytes> > capture(const Code &code, uint8_t &maxDataLength) {
+	SimulatedLink link = SimulatedLink(LinkSettings());
+	XBee sender = XBee();
+	XBee receiver = XBee();
+	sender.setSerial(link.getSerial(0));
+	receiver.setSerial(link.getSerial(1));
+
+	XBeeAddress64 addr64 = XBeeAddress64(0x0013a200, 0x40000001);
+	uint8_t frame[PAYLOAD_SIZE];
+	ZBTxRequest zbTx = ZBTxRequest(addr64, frame, 0);
+	zbTx.setFrameId(NO_RESPONSE_FRAME_ID);
+	uint8_t parity[FEC_MAX_PARITY * PAYLOAD_SIZE];
+	FecEncoder encoder = FecEncoder(sender, zbTx, frame, sizeof(frame), parity, code.dataFrames, code.parityFrames);
+	ZBRxResponse rx = ZBRxResponse();
+	std::vector<std::vector<Bytes> > groups;
+
+	maxDataLength = encoder.getMaxDataLength();
+	sent.clear();
+
+	for (uint16_t g = 0; g < GROUPS; g++) {
+		bool early = g % SHORT_GROUP == SHORT_GROUP - 1 && code.dataFrames > 1;
+		uint8_t payloads = early ? 1 + randomBelow(code.dataFrames - 1) : code.dataFrames;
+
+		for (uint8_t i = 0; i < payloads; i++) {
+			// the longest and shortest payloads, and everything between
+			uint8_t length = i == 0 ? maxDataLength : i == 1 ? 2 : 2 + randomBelow(maxDataLength - 1);
+			Bytes data(length);
+
+			data[0] = sent.size() >> 8;
+			data[1] = sent.size() & 0xff;
+
+			for (uint8_t j = 2; j < length; j++) {
+				data[j] = randomBelow(256);
+			}
+
+			sent.push_back(data);
+			encoder.send(&data[0], length);
+		}
+
+		if (early) {
+			encoder.flush();
+		}
+
+		// let the group's frames through before the next one; writes queue, and the ground reads them all
+		uint32_t frames = 0;
+
+		while (frames < payloads + code.parityFrames) {
+			receiver.readPacket();
+
+			if (receiver.getResponse().isAvailable() && receiver.getResponse().getApiId() == ZB_RX_RESPONSE) {
+				receiver.getResponse().getZBRxResponse(rx);
+
+				if (frames == 0) {
+					groups.push_back(std::vector<Bytes>());
+				}
+
+				groups.back().push_back(Bytes(rx.getData(), rx.getData() + rx.getDataLength()));
+				frames++;
+			}
+
+			link.run(STEP_MICROS);
+		}
+	}
+
+	return groups;
+}
+
+/**
+ * Replays the groups with erasures frames erased in each, or up to erasures when exact is false.  Returns
+ * the number of data frames erased
+ */
+static uint32_t replay(const Code &code, const std::vector<std::vector<Bytes> > &groups,
+		uint8_t erasures, bool exact, std::vector<bool> &erased, FecDecoder &decoder) {
+	uint32_t erasedData = 0;
+	uint16_t seq = 0;
+
+	erased.assign(sent.size(), false);
+
+	for (size_t g = 0; g < groups.size(); g++) {
+		std::vector<uint8_t> order(groups[g].size());
+
+		for (uint8_t i = 0; i < order.size(); i++) {
+			order[i] = i;
+		}
+
+		// the first count of a random permutation
+		uint8_t count = exact ? erasures : randomBelow(erasures + 1);
+
+		for (uint8_t i = 0; i < count; i++) {
+			std::swap(order[i], order[i + randomBelow(order.size() - i)]);
+		}
+
+		std::vector<bool> drop(groups[g].size(), false);
+
+		for (uint8_t i = 0; i < count; i++) {
+			drop[order[i]] = true;
+		}
+
+		uint8_t dataFrames = groups[g].size() - code.parityFrames;
+
+		for (uint8_t i = 0; i < groups[g].size(); i++) {
+			if (i < dataFrames && drop[i]) {
+				erased[seq + i] = true;
+				erasedData++;
+			}
+
+			if (!drop[i]) {
+				decoder.handlePayload(&groups[g][i][0], groups[g][i].size());
+			}
+		}
+
+		seq+= dataFrames;
+	}
+
+	decoder.flush();
+
+	return erasedData;
+}
+
+static bool run(const Code &code) {
+	uint8_t maxDataLength;
+	std::vector<std::vector<Bytes> > groups = capture(code, maxDataLength);
+	std::vector<uint8_t> buffer(FEC_MAX_GROUP * PAYLOAD_SIZE);
+	std::vector<bool> erased;
+	bool recovers = true;
+	bool refuses = true;
+	uint32_t rebuilt = 0;
+	uint32_t shortGroups = 0;
+
+	for (size_t g = 0; g < groups.size(); g++) {
+		shortGroups+= groups[g].size() < code.dataFrames + code.parityFrames;
+	}
+
+	for (uint16_t trial = 0; trial < TRIALS; trial++) {
+		FecDecoder decoder = FecDecoder(&buffer[0], maxDataLength, code.dataFrames, code.parityFrames, delivered);
+
+		deliveries.assign(sent.size(), 0);
+		recoveredFlag.assign(sent.size(), false);
+		wrong = 0;
+
+		uint32_t erasedData = replay(code, groups, code.parityFrames, false, erased, decoder);
+
+		for (size_t s = 0; s < sent.size(); s++) {
+			recovers&= deliveries[s] == 1 && recoveredFlag[s] == erased[s];
+		}
+
+		recovers&= wrong == 0 && decoder.getRecoveredCount() == erasedData && decoder.getLostCount() == 0;
+		rebuilt+= erasedData;
+
+		// one erasure too many in every group
+		FecDecoder overloaded = FecDecoder(&buffer[0], maxDataLength, code.dataFrames, code.parityFrames, delivered);
+
+		deliveries.assign(sent.size(), 0);
+		wrong = 0;
+
+		replay(code, groups, code.parityFrames + 1, true, erased, overloaded);
+
+		for (size_t s = 0; s < sent.size(); s++) {
+			refuses&= deliveries[s] == (erased[s] ? 0 : 1);
+		}
+
+		refuses&= wrong == 0 && overloaded.getRecoveredCount() == 0;
+	}
+
+	bool ok = recovers && refuses && (shortGroups > 0) == (code.dataFrames > 1);
+
+	printf("RS(%2u,%2u) %8u %6u %6u %10u %9s %9s  %s\n", code.dataFrames + code.parityFrames, code.dataFrames,
+			(unsigned) sent.size(), (unsigned) groups.size(), shortGroups, rebuilt, recovers ? "ok" : "FAILED",
+			refuses ? "ok" : "FAILED", ok ? "ok" : "FAILED");
+
+	return ok;
+}
+
+int main() {
+	printf("%d trials per code, frames erased in random positions\n\n", TRIALS);
+	printf("%-9s %8s %6s %6s %10s %9s %9s\n", "code", "payloads", "groups", "short", "rebuilt", "<= parity",
+			"parity+1");
+
+	bool ok = true;
+
+	for (size_t c = 0; c < sizeof(codes) / sizeof(codes[0]); c++) {
+		ok&= run(codes[c]);
+	}
+
+	printf("\n%s\n", ok ? "all passed" : "FAILED");
+
+	return ok ? 0 : 1;
+}
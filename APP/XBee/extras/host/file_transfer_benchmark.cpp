@@ -0,0 +1,106 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Goodput of FileDownlink on a SimulatedLink (see TransferSim.h): the Series2_FileDownlink sketch sends a
+ * FILE_SIZE byte flight log to the ground at several baud rates and loss rates, with the radios' MAC
+ * retries off, so every loss is recovered by the protocol.  Per scenario it reports the raw link rate (the
+ * serial port's, which is the bottleneck at these baud rates), goodput (file bytes per second of transfer)
+ * and its share of the raw rate, blocks sent and resent, and whether the copy on the ground matches.
+ * <p/>
+ * A block carries PAYLOAD - 5 file bytes in an API mode 2 ZB TX frame of about PAYLOAD + 19 bytes
+ * (more where bytes need escaping), so on a clean link goodput tops out near 74% of the raw rate.
+ * <p/>
+ * Build from the library directory:
+ * <p/>
+ * g++ -O2 -std=c++11 -DARDUINO=100 -Iextras/host -I. extras/host/file_transfer_benchmark.cpp extras/host/TransferSim.cpp extras/host/SimulatedLink.cpp extras/host/PosixSerial.cpp XBee.cpp XBeeFileTransfer.cpp -o file_transfer_benchmark
+ */
+
+#include "TransferSim.h"
+
+#include <stdio.h>
+
+// as in Series2_FileDownlink
+#define PAYLOAD 72
+#define RETRANSMIT_TIMEOUT 500
+#define ACK_DELAY 50
+
+#define FILE_SIZE 200000
+#define MAX_MICROS 3600000000ULL
+
+struct Scenario {
+	long baud;
+	float lossRate;
+	float bitErrorRate;
+};
+
+static const Scenario scenarios[] = {
+	{ 9600, 0, 0 },
+	{ 9600, 0.05f, 0 },
+	{ 9600, 0.2f, 0 },
+	{ 57600, 0, 0 },
+	{ 57600, 0.05f, 0 },
+	{ 57600, 0.2f, 0 },
+	{ 57600, 0, 1e-4f },
+	{ 115200, 0, 0 },
+	{ 115200, 0.05f, 0 },
+	{ 115200, 0.2f, 0 }
+};
+
+int main() {
+	std::vector<uint8_t> file(FILE_SIZE);
+	uint32_t lcg = 1;
+
+	for (uint32_t i = 0; i < FILE_SIZE; i++) {
+		lcg = lcg * 1103515245 + 12345;
+		file[i] = lcg >> 16;
+	}
+
+	printf("%u byte file, %u byte blocks\n\n", FILE_SIZE, PAYLOAD - FILE_DOWNLINK_HEADER_LENGTH);
+	printf("%6s %6s %6s %8s %9s %6s %7s %7s %8s %7s\n", "baud", "loss", "BER", "raw B/s", "goodput", "of raw",
+			"blocks", "resent", "seconds", "intact");
+
+	bool ok = true;
+
+	for (size_t s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++) {
+		LinkSettings settings;
+		settings.baud = scenarios[s].baud;
+		settings.lossRate = scenarios[s].lossRate;
+		settings.bitErrorRate = scenarios[s].bitErrorRate;
+		settings.macRetries = 0;
+
+		Transfer transfer = Transfer(settings, file, PAYLOAD, RETRANSMIT_TIMEOUT, ACK_DELAY);
+		uint64_t start = SimulatedLink::now();
+
+		transfer.begin(0);
+
+		bool complete = transfer.run(MAX_MICROS);
+		double seconds = (SimulatedLink::now() - start) / 1e6;
+		double raw = scenarios[s].baud / 10.0;
+		double goodput = transfer.getReceiver().getOffset() / seconds;
+		bool intact = complete && transfer.isIntact();
+
+		printf("%6ld %5.0f%% %6.0g %8.0f %9.0f %5.0f%% %7u %7u %8.1f %7s\n", scenarios[s].baud,
+				scenarios[s].lossRate * 100, scenarios[s].bitErrorRate, raw, goodput, 100 * goodput / raw,
+				transfer.getSender().getSentBlockCount(), transfer.getSender().getRetransmitCount(), seconds,
+				intact ? "yes" : "NO");
+
+		ok&= intact;
+	}
+
+	return ok ? 0 : 1;
+}
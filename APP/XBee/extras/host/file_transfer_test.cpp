@@ -0,0 +1,212 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Tests for FileDownlink and FileDownlinkReceiver: a file goes from the can to the ground over a
+ * SimulatedLink (see TransferSim.h) and the ground's copy is compared with it byte for byte.  Checks that
+ * the transfer completes intact:
+ * <p/>
+ * - on a clean link, a lossy one (no MAC retries, so the protocol does all the recovery) and one whose
+ *   serial lines corrupt bytes
+ * - when the can's reads fail or come up short; such blocks are held back and read again, never sent
+ * - when the ground station restarts from the start of the file after the sender's window has moved on,
+ *   when it resumes from where it stopped, and when it restarts over and over on a lossy link
+ * <p/>
+ * and that the receiver drops data blocks of the wrong length.
+ * <p/>
+ * Build from the library directory:
+ * <p/>
+ * g++ -O2 -std=c++11 -DARDUINO=100 -Iextras/host -I. extras/host/file_transfer_test.cpp extras/host/TransferSim.cpp extras/host/SimulatedLink.cpp extras/host/PosixSerial.cpp XBee.cpp XBeeFileTransfer.cpp -o file_transfer_test
+ */
+
+#include "TransferSim.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// as in Series2_FileDownlink
+#define PAYLOAD 72
+#define RETRANSMIT_TIMEOUT 500
+#define ACK_DELAY 50
+
+#define FILE_SIZE 20000
+// simulated time a transfer may take before it counts as stuck
+#define MAX_MICROS 120000000ULL
+
+static bool check(const char* name, bool ok) {
+	printf("%-66s %s\n", name, ok ? "ok" : "FAILED");
+	return ok;
+}
+
+static std::vector<uint8_t> makeFile(uint32_t size) {
+	std::vector<uint8_t> bytes(size);
+	uint32_t lcg = size;
+
+	for (uint32_t i = 0; i < size; i++) {
+		lcg = lcg * 1103515245 + 12345;
+		bytes[i] = lcg >> 16;
+	}
+
+	return bytes;
+}
+
+static LinkSettings link(long baud, float lossRate, float corruptRate) {
+	LinkSettings settings;
+	settings.baud = baud;
+	settings.lossRate = lossRate;
+	settings.macRetries = 0;
+	settings.corruptRate = corruptRate;
+
+	return settings;
+}
+
+static bool whole(const char* name, const LinkSettings &settings, uint32_t readFaults) {
+	std::vector<uint8_t> file = makeFile(FILE_SIZE);
+	Transfer transfer = Transfer(settings, file, PAYLOAD, RETRANSMIT_TIMEOUT, ACK_DELAY);
+
+	transfer.setReadFaults(readFaults);
+	transfer.begin(0);
+
+	bool complete = transfer.run(MAX_MICROS);
+
+	printf("  %u blocks sent, %u resent, %u read errors, %u lost on air\n", transfer.getSender().getSentBlockCount(),
+			transfer.getSender().getRetransmitCount(), transfer.getSender().getReadErrorCount(),
+			transfer.getLink().getStats(0).rfLost + transfer.getLink().getStats(1).rfLost);
+
+	return check(name, complete && transfer.isIntact() && (readFaults == 0 || transfer.getSender().getReadErrorCount() > 0));
+}
+
+static bool restartFromStart() {
+	std::vector<uint8_t> file = makeFile(FILE_SIZE);
+	Transfer transfer = Transfer(link(57600, 0.05f, 0), file, PAYLOAD, RETRANSMIT_TIMEOUT, ACK_DELAY);
+
+	transfer.begin(0);
+	transfer.run(MAX_MICROS, FILE_SIZE / 2);
+
+	bool moved = transfer.getSender().getAckedOffset() > 0;
+
+	// the ground station lost its copy and asks for the file from the start again
+	transfer.begin(0);
+
+	bool complete = transfer.run(MAX_MICROS);
+
+	return check("restart at 0 after the sender's window moved on", moved && complete && transfer.isIntact());
+}
+
+static bool resume() {
+	std::vector<uint8_t> file = makeFile(FILE_SIZE);
+	Transfer transfer = Transfer(link(57600, 0.05f, 0), file, PAYLOAD, RETRANSMIT_TIMEOUT, ACK_DELAY);
+
+	transfer.begin(0);
+	transfer.run(MAX_MICROS, FILE_SIZE / 3);
+
+	uint32_t saved = transfer.getReceiver().getOffset();
+	uint32_t writes = transfer.getWriteCount();
+
+	transfer.begin(saved);
+
+	bool complete = transfer.run(MAX_MICROS);
+	// the rest of the file, and little of what was saved before
+	uint32_t blocks = (FILE_SIZE + PAYLOAD - FILE_DOWNLINK_HEADER_LENGTH - 1) / (PAYLOAD - FILE_DOWNLINK_HEADER_LENGTH);
+
+	return check("resume at the saved offset", complete && transfer.isIntact() && saved > 0 &&
+			transfer.getWriteCount() - writes < blocks - saved / (PAYLOAD - FILE_DOWNLINK_HEADER_LENGTH) + FILE_DOWNLINK_WINDOW);
+}
+
+static bool restarts() {
+	std::vector<uint8_t> file = makeFile(FILE_SIZE);
+	Transfer transfer = Transfer(link(57600, 0.2f, 0), file, PAYLOAD, RETRANSMIT_TIMEOUT, ACK_DELAY);
+	uint8_t count = 0;
+
+	transfer.begin(0);
+
+	// restart every 700ms of simulated time, at the saved offset, blocks received past it forgotten
+	while (!transfer.run(700000) && count < 100) {
+		transfer.begin(transfer.getReceiver().getOffset());
+		count++;
+	}
+
+	bool complete = transfer.run(MAX_MICROS);
+
+	printf("  %u restarts\n", count);
+
+	return check("restart at the saved offset over and over on a 20% lossy link", complete && transfer.isIntact() && count > 3);
+}
+
+static bool blockLengths() {
+	std::vector<uint8_t> file = makeFile(200);
+	Transfer transfer = Transfer(LinkSettings(), file, PAYLOAD, RETRANSMIT_TIMEOUT, ACK_DELAY);
+	FileDownlinkReceiver& receiver = transfer.getReceiver();
+	uint8_t blockSize = PAYLOAD - FILE_DOWNLINK_HEADER_LENGTH;
+	uint8_t payload[PAYLOAD];
+
+	receiver.begin(0);
+
+	// file info: 200 bytes in blocks of 67
+	uint8_t info[] = { FILE_DOWNLINK_INFO, 0, 0, 0, 200, blockSize };
+	receiver.handlePayload(info, sizeof(info));
+
+	payload[0] = FILE_DOWNLINK_DATA;
+	payload[1] = payload[2] = payload[3] = 0;
+	memcpy(payload + FILE_DOWNLINK_HEADER_LENGTH, &file[0], blockSize);
+
+	// short block 0
+	receiver.handlePayload(payload, FILE_DOWNLINK_HEADER_LENGTH + 10);
+	bool shortDropped = transfer.getWriteCount() == 0 && receiver.getOffset() == 0;
+
+	// empty block 0
+	receiver.handlePayload(payload, FILE_DOWNLINK_HEADER_LENGTH);
+	bool emptyDropped = transfer.getWriteCount() == 0 && receiver.getOffset() == 0;
+
+	receiver.handlePayload(payload, PAYLOAD);
+	bool taken = transfer.getWriteCount() == 1 && receiver.getOffset() == blockSize;
+
+	// the last block is the 66 bytes left, not a whole block
+	payload[4] = 2 * blockSize;
+	memcpy(payload + FILE_DOWNLINK_HEADER_LENGTH, &file[2 * blockSize], 200 - 2 * blockSize);
+	receiver.handlePayload(payload, PAYLOAD);
+	bool longDropped = transfer.getWriteCount() == 1;
+	receiver.handlePayload(payload, FILE_DOWNLINK_HEADER_LENGTH + 200 - 2 * blockSize);
+	bool lastTaken = transfer.getWriteCount() == 2;
+
+	// past the end of the file
+	payload[3] = 1;
+	receiver.handlePayload(payload, FILE_DOWNLINK_HEADER_LENGTH + 1);
+	bool pastEnd = transfer.getWriteCount() == 2;
+
+	bool ok = check("receiver drops short and empty blocks", shortDropped && emptyDropped && taken);
+	ok&= check("receiver drops a last block longer than the rest of the file", longDropped && lastTaken && pastEnd);
+
+	return ok;
+}
+
+int main() {
+	bool ok = whole("clean link, 57600 baud", link(57600, 0, 0), 0);
+	ok&= whole("20% lost on air, 57600 baud", link(57600, 0.2f, 0), 0);
+	ok&= whole("5% lost on air, 9600 baud", link(9600, 0.05f, 0), 0);
+	ok&= whole("serial lines corrupt 1 byte in 2000", link(57600, 0, 0.0005f), 0);
+	ok&= whole("every 7th read fails or comes up short", link(57600, 0, 0), 7);
+	ok&= whole("5% lost on air and every 5th read fails or comes up short", link(57600, 0.05f, 0), 5);
+	ok&= restartFromStart();
+	ok&= resume();
+	ok&= restarts();
+	ok&= blockLengths();
+
+	printf("\n%s\n", ok ? "all passed" : "FAILED");
+
+	return ok ? 0 : 1;
+}
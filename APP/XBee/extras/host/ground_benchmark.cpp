@@ -0,0 +1,252 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Replays a synthetic capture from several cans (ZB RX packets carrying TelemetryEncoder payloads) through
+ * the single threaded readPacket() + getApiId() loop, then through GroundDemux with 1 to 8 workers, and
+ * reports frames/s.  The handler decodes every record and checks that each source's frames arrive in order.
+ * An optional argument adds that many microseconds of extra analysis per frame.
+ * <p/>
+ * Build from the library directory:
+ * <p/>
+ * g++ -O2 -std=c++17 -pthread -DARDUINO=100 -Iextras/host -I. extras/host/ground_benchmark.cpp extras/host/GroundDemux.cpp extras/host/PosixSerial.cpp extras/host/HostClock.cpp XBee.cpp XBeeTelemetry.cpp -o ground_benchmark
+ */
+
+#include "GroundDemux.h"
+#include "XBeeTelemetry.h"
+
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+#define SOURCES 8
+#define FRAMES 200000
+#define CHANNELS 10
+
+/**
+ * A capture in memory, as a Stream for the single threaded loop
+ */
+class MemoryStream : public Stream {
+public:
+	MemoryStream(const std::vector<uint8_t> &bytes) : _bytes(&bytes), _pos(0) {}
+	int available() { return _bytes->size() - _pos; }
+	int read() { return _pos < _bytes->size() ? (*_bytes)[_pos++] : -1; }
+	int peek() { return _pos < _bytes->size() ? (*_bytes)[_pos] : -1; }
+	size_t write(uint8_t) { return 0; }
+private:
+	const std::vector<uint8_t>* _bytes;
+	size_t _pos;
+};
+
+static uint32_t extraMicros = 0;
+
+/**
+ * Per source state; each source belongs to one worker, so no locking
+ */
+class TelemetryHandler : public GroundHandler {
+public:
+	TelemetryHandler() {
+		reset();
+	}
+	void reset() {
+		memset(_last, 0, sizeof(_last));
+		memset(_sum, 0, sizeof(_sum));
+		_outOfOrder = 0;
+	}
+	void handleZBRx(uint8_t, ZBRxResponse &rx) {
+		uint8_t source = rx.getRemoteAddress64().getLsb() % SOURCES;
+		int32_t values[CHANNELS];
+		TelemetryDecoder records = TelemetryDecoder(rx.getData(), rx.getDataLength(), values, CHANNELS);
+		bool first = true;
+
+		while (records.next()) {
+			// channel 0 counts records per source
+			if (first && values[0] != _last[source] + 1) {
+				_outOfOrder++;
+			}
+
+			first = false;
+			_last[source] = values[0];
+
+			for (uint8_t i = 1; i < CHANNELS; i++) {
+				_sum[source]+= values[i];
+			}
+		}
+
+		if (extraMicros > 0) {
+			std::chrono::steady_clock::time_point until = std::chrono::steady_clock::now() + std::chrono::microseconds(extraMicros);
+
+			while (std::chrono::steady_clock::now() < until) {
+			}
+		}
+	}
+	uint32_t getOutOfOrder() {
+		return _outOfOrder;
+	}
+	int64_t getChecksum() {
+		int64_t sum = 0;
+
+		for (uint8_t i = 0; i < SOURCES; i++) {
+			sum+= _sum[i] + _last[i];
+		}
+
+		return sum;
+	}
+private:
+	int32_t _last[SOURCES];
+	int64_t _sum[SOURCES];
+	uint32_t _outOfOrder;
+};
+
+static void putEscaped(std::vector<uint8_t> &out, uint8_t b) {
+	if (b == START_BYTE || b == ESCAPE || b == XON || b == XOFF) {
+		out.push_back(ESCAPE);
+		out.push_back(b ^ 0x20);
+	} else {
+		out.push_back(b);
+	}
+}
+
+static std::vector<uint8_t> capture() {
+	std::vector<uint8_t> bytes;
+	int32_t previous[SOURCES][CHANNELS];
+	int32_t values[SOURCES][CHANNELS];
+	uint8_t payload[72];
+
+	memset(values, 0, sizeof(values));
+	srand(1);
+
+	for (uint32_t n = 0; n < FRAMES; n++) {
+		uint8_t source = rand() % SOURCES;
+		TelemetryEncoder encoder = TelemetryEncoder(previous[source], CHANNELS);
+
+		encoder.begin(payload, sizeof(payload));
+
+		while (true) {
+			int32_t next[CHANNELS];
+
+			next[0] = values[source][0] + 1;
+
+			for (uint8_t i = 1; i < CHANNELS; i++) {
+				next[i] = values[source][i] + rand() % 41 - 20;
+			}
+
+			if (!encoder.add(next)) {
+				break;
+			}
+
+			memcpy(values[source], next, sizeof(next));
+		}
+
+		std::vector<uint8_t> frame;
+		frame.push_back(ZB_RX_RESPONSE);
+		uint32_t msb = 0x0013a200;
+		uint32_t lsb = 0x40000000 + source;
+
+		for (int shift = 24; shift >= 0; shift-= 8) {
+			frame.push_back(msb >> shift);
+		}
+
+		for (int shift = 24; shift >= 0; shift-= 8) {
+			frame.push_back(lsb >> shift);
+		}
+
+		frame.push_back(0);
+		frame.push_back(source + 1);
+		frame.push_back(ZB_PACKET_ACKNOWLEDGED);
+		frame.insert(frame.end(), payload, payload + encoder.getLength());
+
+		uint8_t sum = 0;
+		bytes.push_back(START_BYTE);
+		putEscaped(bytes, frame.size() >> 8);
+		putEscaped(bytes, frame.size() & 0xff);
+
+		for (size_t i = 0; i < frame.size(); i++) {
+			putEscaped(bytes, frame[i]);
+			sum+= frame[i];
+		}
+
+		putEscaped(bytes, 0xff - sum);
+	}
+
+	return bytes;
+}
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv) {
+	if (argc > 1) {
+		extraMicros = atoi(argv[1]);
+	}
+
+	std::vector<uint8_t> bytes = capture();
+	TelemetryHandler handler;
+
+	printf("%u frames from %u sources, %lu bytes, %u us extra work per frame, %u cores\n", FRAMES, SOURCES,
+			(unsigned long) bytes.size(), extraMicros, std::thread::hardware_concurrency());
+
+	// what the ground station does today
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	MemoryStream stream = MemoryStream(bytes);
+	XBee xbee = XBee();
+	ZBRxResponse rx = ZBRxResponse();
+	uint32_t frames = 0;
+
+	xbee.setSerial(stream);
+
+	while (stream.available() > 0) {
+		xbee.readPacket();
+
+		if (xbee.getResponse().isAvailable()) {
+			frames++;
+
+			if (xbee.getResponse().getApiId() == ZB_RX_RESPONSE) {
+				xbee.getResponse().getZBRxResponse(rx);
+				handler.handleZBRx(0, rx);
+			}
+		}
+	}
+
+	double elapsed = seconds(start);
+	int64_t expected = handler.getChecksum();
+
+	printf("readPacket loop  %9.0f frames/s  (%u frames, %u out of order)\n", frames / elapsed, frames, handler.getOutOfOrder());
+
+	for (uint8_t workers = 1; workers <= 8; workers*= 2) {
+		handler.reset();
+		start = std::chrono::steady_clock::now();
+
+		GroundDemux demux(handler, workers);
+		demux.begin();
+
+		// feed in serial port sized reads
+		for (size_t pos = 0; pos < bytes.size(); pos+= 1024) {
+			demux.feed(&bytes[pos], bytes.size() - pos < 1024 ? bytes.size() - pos : 1024);
+		}
+
+		demux.end();
+		elapsed = seconds(start);
+
+		printf("%u worker%s       %9.0f frames/s  (%lu frames, %u out of order, %s)\n", workers, workers > 1 ? "s" : " ",
+				demux.getFrameCount() / elapsed, (unsigned long) demux.getFrameCount(), handler.getOutOfOrder(),
+				handler.getChecksum() == expected ? "same values" : "VALUES DIFFER");
+	}
+
+	return 0;
+}
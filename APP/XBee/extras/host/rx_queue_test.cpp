@@ -0,0 +1,192 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Stress test for the RX_QUEUE_SIZE receive queue.  A sender streams ZigBee TX frames of 1 to 60 bytes
+ * (payloads full of bytes that need escaping) over a SimulatedLink; the receiving sketch only gets to
+ * readPacket() every so often and consumes a limited number of queued frames each time, so several frames
+ * are parsed while earlier ones are still held.  Per scenario it checks that:
+ * <p/>
+ * - every frame taken off the queue is intact and frames come out in order, so queued frame data is never
+ *   overwritten by frames parsed after it
+ * - getResponse() is always the oldest queued frame, and not available when the queue is empty, never the
+ *   frame being parsed
+ * - each frame passed to the receiving Arduino is accounted for: consumed, dropped with the queue full, or
+ *   failed (only when the serial line corrupts or overflows)
+ * <p/>
+ * RX_QUEUE_SIZE sizes XBeeBase, so it is set in XBee.h.  Build from the library directory with a copy of
+ * the library that has it set to 4:
+ * <p/>
+ * mkdir -p rxq && sed 's/^#define RX_QUEUE_SIZE 0$/#define RX_QUEUE_SIZE 4/' XBee.h > rxq/XBee.h && cp XBee.cpp rxq/
+ * g++ -O2 -std=c++11 -DARDUINO=100 -Iextras/host -Irxq extras/host/rx_queue_test.cpp extras/host/SimulatedLink.cpp extras/host/PosixSerial.cpp rxq/XBee.cpp -o rx_queue_test
+ */
+
+#include "SimulatedLink.h"
+#include "XBee.h"
+
+#include <stdio.h>
+
+#if RX_QUEUE_SIZE < 2
+#error "set RX_QUEUE_SIZE in XBee.h to 2 or more for this test"
+#endif
+
+// seconds of sending, then time for the link and the receiver to drain
+#define RUN_SECONDS 5
+#define DRAIN_SECONDS 2
+#define STEP_MICROS 50
+
+struct Scenario {
+	const char* name;
+	long baud;
+	// microseconds between the sender's frames; above the serial time of the longest frame, or frames
+	// still sitting in the sender's serial line at the end look like losses
+	uint32_t sendInterval;
+	// time the receiving sketch spends on other work each loop(), and how many frames it consumes per loop()
+	uint32_t receiverBusy;
+	uint8_t framesPerLoop;
+	uint16_t rxBufferSize;
+	float corruptRate;
+};
+
+static const Scenario scenarios[] = {
+	{ "115200, receiver keeps up", 115200, 10000, 0, 255, 1024, 0 },
+	{ "115200, busy 20ms, 1 frame/loop", 115200, 6000, 20000, 1, 4096, 0 },
+	{ "115200, busy 5ms, 2 frames/loop", 115200, 6000, 5000, 2, 4096, 0 },
+	{ "57600, busy 20ms, 128B buffer", 57600, 10000, 20000, 255, 128, 0 },
+	{ "57600, 1e-3 serial errors", 57600, 10000, 2000, 1, 1024, 0.001f }
+};
+
+// payload of frame seq: its sequence number, then bytes counting down from the start byte
+static uint8_t payloadLength(uint16_t seq) {
+	return 3 + seq % 58;
+}
+
+static uint8_t payloadByte(uint16_t seq, uint8_t i) {
+	return i == 0 ? seq >> 8 : i == 1 ? seq & 0xff : (uint8_t)(START_BYTE - seq - i);
+}
+
+static bool run(const Scenario &scenario) {
+	LinkSettings settings;
+	settings.baud = scenario.baud;
+	settings.rxBufferSize = scenario.rxBufferSize;
+	settings.corruptRate = scenario.corruptRate;
+	settings.radioQueueSize = 16;
+
+	SimulatedLink link = SimulatedLink(settings);
+
+	XBee sender = XBee();
+	XBee receiver = XBee();
+	sender.setSerial(link.getSerial(0));
+	receiver.setSerial(link.getSerial(1));
+
+	uint8_t payload[64];
+	XBeeAddress64 addr64 = XBeeAddress64(0x0013a200, 0x40000001);
+	ZBTxRequest zbTx = ZBTxRequest(addr64, payload, 0);
+	zbTx.setFrameId(NO_RESPONSE_FRAME_ID);
+	ZBRxResponse rx = ZBRxResponse();
+
+	uint16_t seq = 0;
+	int32_t lastSeq = -1;
+	uint32_t consumed = 0, damaged = 0, outOfOrder = 0, exposed = 0;
+	uint64_t senderNext = 0, receiverNext = 0;
+	uint64_t sendEnd = SimulatedLink::now() + RUN_SECONDS * 1000000ULL;
+	uint64_t end = sendEnd + DRAIN_SECONDS * 1000000ULL;
+
+	while (SimulatedLink::now() < end) {
+		if (SimulatedLink::now() < sendEnd && SimulatedLink::now() >= senderNext) {
+			senderNext = SimulatedLink::now() + scenario.sendInterval;
+			uint8_t length = payloadLength(seq);
+
+			for (uint8_t i = 0; i < length; i++) {
+				payload[i] = payloadByte(seq, i);
+			}
+
+			zbTx.setPayloadLength(length);
+			sender.send(zbTx);
+			seq++;
+		}
+
+		// the sender's radio answers nothing (frame id 0), but keep its serial drained
+		sender.readPacket();
+
+		if (SimulatedLink::now() >= receiverNext) {
+			receiverNext = SimulatedLink::now() + scenario.receiverBusy;
+			receiver.readPacket();
+
+			for (uint8_t n = 0; n < scenario.framesPerLoop; n++) {
+				XBeeResponse& response = receiver.getResponse();
+
+				if (receiver.getQueuedFrameCount() == 0) {
+					exposed+= response.isAvailable() || response.isError();
+					break;
+				}
+
+				if (&response != &receiver.getQueuedFrame() || !response.isAvailable()) {
+					exposed++;
+				}
+
+				if (response.getApiId() == ZB_RX_RESPONSE) {
+					response.getZBRxResponse(rx);
+					uint8_t* data = rx.getData();
+					uint16_t got = rx.getDataLength() >= 2 ? (data[0] << 8) + data[1] : 0;
+					bool intact = rx.getDataLength() == payloadLength(got);
+
+					for (uint8_t i = 0; intact && i < rx.getDataLength(); i++) {
+						intact = data[i] == payloadByte(got, i);
+					}
+
+					damaged+= !intact;
+					outOfOrder+= intact && (int32_t)got <= lastSeq;
+					lastSeq = intact ? got : lastSeq;
+				}
+
+				consumed++;
+				receiver.releaseQueuedFrame();
+			}
+		}
+
+		link.run(STEP_MICROS);
+	}
+
+	LinkStats& rxStats = link.getStats(1);
+	uint32_t dropped = receiver.getDroppedFrameCount();
+	uint32_t failed = receiver.getFailedFrameCount();
+	bool lossy = scenario.corruptRate > 0 || rxStats.rxOverflow > 0;
+	// a frame whose start byte was lost is skipped without being counted, so only a lossy line may fall short
+	bool accounted = lossy ? consumed + dropped + failed <= rxStats.rxFrames + failed :
+			consumed + dropped == rxStats.rxFrames && failed == 0;
+	bool ok = damaged == 0 && outOfOrder == 0 && exposed == 0 && accounted;
+
+	printf("%-34s %6u %6u %6u %6u %6u %6u %6u %6u  %s\n", scenario.name, (unsigned) seq, rxStats.rxFrames,
+			consumed, dropped, failed, damaged, outOfOrder, exposed, ok ? "ok" : "FAILED");
+	return ok;
+}
+
+int main() {
+	printf("RX_QUEUE_SIZE %u\n\n", RX_QUEUE_SIZE);
+	printf("%-34s %6s %6s %6s %6s %6s %6s %6s %6s\n", "scenario", "sent", "to ard", "used", "qfull", "failed",
+			"damage", "order", "expose");
+
+	bool ok = true;
+
+	for (size_t s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++) {
+		ok = run(scenarios[s]) && ok;
+	}
+
+	printf("\n%s\n", ok ? "all passed" : "FAILED");
+	return ok ? 0 : 1;
+}
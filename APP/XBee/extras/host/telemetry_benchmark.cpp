@@ -0,0 +1,247 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Sends a can's sensor readings over a SimulatedLink (GPS 16 bytes at 5Hz, barometer 8 bytes at 20Hz, IMU
+ * 12 bytes at 50Hz, or a multiple of those rates) two ways: one ZB TX frame per sample, and batched by a
+ * TelemetryPacketizer into TELEMETRY_PAYLOAD byte payloads sent after at most MAX_DELAY ms.  Either way
+ * the sending sketch waits for each frame's TX status before it sends the next, like the examples, and
+ * keeps readings taken meanwhile in a queue of QUEUE_LENGTH, dropping the oldest when it is full.
+ * <p/>
+ * Per link and load: samples/s delivered to the ground sketch, frames/s, readings dropped on the can for
+ * want of a frame to go in, and sample age (reading taken to unpacked on the ground) percentiles.
+ * <p/>
+ * Build from the library directory:
+ * <p/>
+ * g++ -O2 -std=c++11 -DARDUINO=100 -Iextras/host -I. extras/host/telemetry_benchmark.cpp extras/host/SimulatedLink.cpp extras/host/PosixSerial.cpp XBee.cpp XBeeTelemetry.cpp -o telemetry_benchmark
+ */
+
+#include "SimulatedLink.h"
+#include "XBee.h"
+#include "XBeeTelemetry.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+// simulated seconds per run, and how often each sketch's loop() runs
+#define RUN_SECONDS 20
+#define STEP_MICROS 50
+
+#define TELEMETRY_PAYLOAD 72
+#define MAX_DELAY 100
+#define QUEUE_LENGTH 64
+#define STATUS_TIMEOUT 500
+
+struct Source {
+	const char* name;
+	uint8_t length;
+	// readings per second at load 1
+	uint16_t rate;
+};
+
+static const Source sources[] = {
+	{ "GPS", 16, 5 },
+	{ "baro", 8, 20 },
+	{ "IMU", 12, 50 }
+};
+
+#define SOURCE_COUNT (sizeof(sources) / sizeof(sources[0]))
+
+struct Scenario {
+	const char* name;
+	long baud;
+	// multiple of the sources' rates
+	uint8_t load;
+};
+
+static const Scenario scenarios[] = {
+	{ "9600 baud, 75 samples/s", 9600, 1 },
+	{ "9600 baud, 300 samples/s", 9600, 4 },
+	{ "57600 baud, 300 samples/s", 57600, 4 },
+	{ "57600 baud, 1200 samples/s", 57600, 16 }
+};
+
+struct Sample {
+	uint8_t source;
+	uint32_t timestamp;
+	uint16_t seq;
+};
+
+// when each sequence number (the first 2 data bytes of a sample) was read, in milliseconds
+static uint32_t takenAt[65536];
+static std::vector<uint32_t> ages;
+
+static uint32_t percentile(uint8_t p) {
+	if (ages.empty()) {
+		return 0;
+	}
+
+	return ages[(ages.size() - 1) * p / 100];
+}
+
+// a reading: its sequence number, then filler
+static void fill(uint8_t *data, const Sample &sample) {
+	data[0] = sample.seq >> 8;
+	data[1] = sample.seq & 0xff;
+
+	for (uint8_t i = 2; i < sources[sample.source].length; i++) {
+		data[i] = sample.source + i;
+	}
+}
+
+static void received(const uint8_t *data, uint8_t length) {
+	if (length >= 2) {
+		ages.push_back(millis() - takenAt[(data[0] << 8) + data[1]]);
+	}
+}
+
+static void run(const Scenario &scenario, bool batched) {
+	LinkSettings settings;
+	settings.baud = scenario.baud;
+
+	SimulatedLink link = SimulatedLink(settings);
+
+	XBee can = XBee();
+	XBee ground = XBee();
+	can.setSerial(link.getSerial(0));
+	ground.setSerial(link.getSerial(1));
+
+	uint8_t payload[TELEMETRY_PAYLOAD];
+	XBeeAddress64 addr64 = XBeeAddress64(0x0013a200, 0x40000001);
+	ZBTxRequest zbTx = ZBTxRequest(addr64, payload, 0);
+	TelemetryPacketizer packetizer = TelemetryPacketizer(can, zbTx, payload, sizeof(payload), MAX_DELAY);
+	ZBRxResponse rx = ZBRxResponse();
+
+	std::deque<Sample> queue;
+	uint64_t nextReading[SOURCE_COUNT];
+	uint16_t seq = 0;
+	uint32_t taken = 0, dropped = 0, frames = 0;
+	bool waiting = false;
+	unsigned long deadline = 0;
+
+	ages.clear();
+
+	for (uint8_t s = 0; s < SOURCE_COUNT; s++) {
+		nextReading[s] = SimulatedLink::now();
+	}
+
+	uint64_t end = SimulatedLink::now() + RUN_SECONDS * 1000000ULL;
+
+	while (SimulatedLink::now() < end) {
+		// the can's sensors
+		for (uint8_t s = 0; s < SOURCE_COUNT; s++) {
+			if (SimulatedLink::now() >= nextReading[s]) {
+				nextReading[s]+= 1000000 / (sources[s].rate * scenario.load);
+
+				Sample sample;
+				sample.source = s;
+				sample.timestamp = millis();
+				sample.seq = seq++;
+				takenAt[sample.seq] = sample.timestamp;
+				taken++;
+
+				if (queue.size() == QUEUE_LENGTH) {
+					queue.pop_front();
+					dropped++;
+				}
+
+				queue.push_back(sample);
+			}
+		}
+
+		// the can's radio loop
+		bool wasWaiting = waiting;
+
+		if (waiting) {
+			can.readPacket();
+
+			if (can.getResponse().isAvailable() && can.getResponse().getApiId() == ZB_TX_STATUS_RESPONSE) {
+				waiting = false;
+			} else if (millis() >= deadline) {
+				waiting = false;
+			}
+		} else if (batched) {
+			uint32_t sent = packetizer.getFrameCount();
+
+			// a batch that fills up goes out from add(); one frame at a time, so poll() only if none did
+			while (!queue.empty() && packetizer.getFrameCount() == sent) {
+				uint8_t data[32];
+				fill(data, queue.front());
+				packetizer.add(queue.front().source, queue.front().timestamp, data, sources[queue.front().source].length);
+				queue.pop_front();
+			}
+
+			if (packetizer.getFrameCount() == sent) {
+				packetizer.poll();
+			}
+
+			waiting = packetizer.getFrameCount() != sent;
+		} else if (!queue.empty()) {
+			payload[0] = queue.front().source;
+			fill(payload + 1, queue.front());
+			zbTx.setPayload(payload);
+			zbTx.setPayloadLength(1 + sources[queue.front().source].length);
+			queue.pop_front();
+			can.send(zbTx);
+			waiting = true;
+		}
+
+		if (waiting && !wasWaiting) {
+			deadline = millis() + STATUS_TIMEOUT;
+			frames++;
+		}
+
+		// the ground station
+		ground.readPacket();
+
+		if (ground.getResponse().isAvailable() && ground.getResponse().getApiId() == ZB_RX_RESPONSE) {
+			ground.getResponse().getZBRxResponse(rx);
+
+			if (batched) {
+				TelemetryUnpacker batch = TelemetryUnpacker(rx.getData(), rx.getDataLength());
+
+				while (batch.next()) {
+					received(batch.getData(), batch.getDataLength());
+				}
+			} else if (rx.getDataLength() > 1) {
+				received(rx.getData() + 1, rx.getDataLength() - 1);
+			}
+		}
+
+		link.run(STEP_MICROS);
+	}
+
+	std::sort(ages.begin(), ages.end());
+
+	printf("%-28s %-18s %9.1f %8.1f %7.1f%% %7u %7u %7u\n", scenario.name, batched ? "packetizer" : "frame per sample",
+			ages.size() / float(RUN_SECONDS), frames / float(RUN_SECONDS), 100.0f * dropped / taken,
+			percentile(50), percentile(90), percentile(99));
+}
+
+int main() {
+	printf("%-28s %-18s %9s %8s %8s %7s %7s %7s\n", "link, readings", "sent as", "samples/s", "frames/s", "dropped",
+			"p50 ms", "p90 ms", "p99 ms");
+
+	for (size_t s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++) {
+		run(scenarios[s], false);
+		run(scenarios[s], true);
+	}
+
+	return 0;
+}
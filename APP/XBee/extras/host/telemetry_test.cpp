@@ -0,0 +1,585 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Tests for TelemetryPacketizer and TelemetryUnpacker, TelemetryEncoder and TelemetryDecoder.  Payloads go
+ * over a SimulatedLink as ZB TX frames and the ground sketch unpacks or decodes what it receives.  Checks
+ * that:
+ * <p/>
+ * - a stream of samples of every source and length arrives whole and in order, each with its source,
+ *   exact timestamp and data, and the packetizer's counts add up
+ * - poll() holds a batch until its first sample is maxDelay old, then sends it
+ * - a sample more than 0xffff ms after the batch's first starts a new batch
+ * - a sample too large for an empty batch is refused, and one that just fits goes out on its own
+ * - the unpacker refuses a payload that is not a batch and stops at a truncated record
+ * - delta encoded records, with steps of every size up to int32 wrap around, decode to exactly what was
+ *   encoded
+ * - a payload lost on a lossy link costs only its own records: the decoder picks up again at the next one
+ * - the encoder never writes past a 255 byte buffer, whose mask bytes would once wrap the write position
+ * - the decoder refuses a payload with the wrong channel count and stops at a truncated record
+ * <p/>
+ * Build from the library directory:
+ * <p/>
+ * g++ -O2 -std=c++11 -DARDUINO=100 -Iextras/host -I. extras/host/telemetry_test.cpp extras/host/SimulatedLink.cpp extras/host/PosixSerial.cpp XBee.cpp XBeeTelemetry.cpp -o telemetry_test
+ */
+
+#include "SimulatedLink.h"
+#include "XBee.h"
+#include "XBeeTelemetry.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+
+#define STEP_MICROS 50
+#define TELEMETRY_PAYLOAD 72
+#define MAX_DELAY 100
+#define STATUS_TIMEOUT 500
+
+// samples in the stream test
+#define STREAM_SAMPLES 2000
+
+// records in the codec tests, of CHANNELS values; channel 0 is the record's number
+#define RECORDS 5000
+#define CHANNELS 10
+
+struct Sample {
+	uint8_t source;
+	uint32_t timestamp;
+	std::vector<uint8_t> data;
+};
+
+static bool operator==(const Sample &a, const Sample &b) {
+	return a.source == b.source && a.timestamp == b.timestamp && a.data == b.data;
+}
+
+/**
+ * A can and a ground station on a SimulatedLink.  The can packs samples into ZB TX frames to the ground,
+ * which keeps every payload it receives
+ */
+class Harness {
+public:
+	Harness(const LinkSettings &settings = LinkSettings()) :
+		link(settings),
+		addr64(0x0013a200, 0x40000001),
+		zbTx(addr64, payload, 0),
+		packetizer(can, zbTx, payload, sizeof(payload), MAX_DELAY) {
+
+		can.setSerial(link.getSerial(0));
+		ground.setSerial(link.getSerial(1));
+	}
+
+	// runs both sketches for ms of simulated time
+	void run(unsigned long ms) {
+		unsigned long end = millis() + ms;
+
+		while (millis() < end) {
+			loop();
+		}
+	}
+
+	void loop() {
+		can.readPacket();
+		ground.readPacket();
+
+		if (ground.getResponse().isAvailable() && ground.getResponse().getApiId() == ZB_RX_RESPONSE) {
+			ZBRxResponse rx = ZBRxResponse();
+			ground.getResponse().getZBRxResponse(rx);
+			payloads.push_back(std::vector<uint8_t>(rx.getData(), rx.getData() + rx.getDataLength()));
+		}
+
+		link.run(STEP_MICROS);
+	}
+
+	// every sample in the payloads received so far
+	std::vector<Sample> unpacked() {
+		std::vector<Sample> samples;
+
+		for (size_t i = 0; i < payloads.size(); i++) {
+			TelemetryUnpacker batch = TelemetryUnpacker(&payloads[i][0], payloads[i].size());
+
+			while (batch.next()) {
+				Sample sample;
+				sample.source = batch.getSource();
+				sample.timestamp = batch.getTimestamp();
+				sample.data.assign(batch.getData(), batch.getData() + batch.getDataLength());
+				samples.push_back(sample);
+			}
+		}
+
+		return samples;
+	}
+
+	SimulatedLink link;
+	XBee can;
+	XBee ground;
+	uint8_t payload[TELEMETRY_PAYLOAD];
+	XBeeAddress64 addr64;
+	ZBTxRequest zbTx;
+	TelemetryPacketizer packetizer;
+	std::vector<std::vector<uint8_t> > payloads;
+};
+
+static uint32_t lcg = 12345;
+
+static uint32_t random32() {
+	lcg = lcg * 1103515245 + 12345;
+	return (lcg >> 16) | (uint32_t(lcg * 1103515245 + 12345) & 0xffff0000);
+}
+
+static bool check(const char* name, bool ok) {
+	printf("%-66s %s\n", name, ok ? "ok" : "FAILED");
+	return ok;
+}
+
+static bool add(Harness &harness, const Sample &sample) {
+	return harness.packetizer.add(sample.source, sample.timestamp, &sample.data[0], sample.data.size());
+}
+
+static Sample sample(uint8_t source, uint32_t timestamp, uint8_t length) {
+	Sample sample;
+	sample.source = source;
+	sample.timestamp = timestamp;
+
+	for (uint8_t i = 0; i < length; i++) {
+		// bytes the API mode 2 framing has to escape, among others
+		sample.data.push_back(i % 3 == 0 ? 0x7d : (uint8_t) (source * 31 + timestamp + i));
+	}
+
+	return sample;
+}
+
+static bool stream() {
+	Harness harness;
+	std::deque<Sample> pending;
+	std::vector<Sample> sent;
+	bool waiting = false;
+	unsigned long deadline = 0;
+	unsigned long next = millis();
+	uint32_t frames = 0;
+
+	// samples every 7ms, 1 to 31 bytes each, from 5 sources; the can sends one frame at a time
+	while (sent.size() < STREAM_SAMPLES || !pending.empty() || harness.packetizer.getSampleCount() > 0) {
+		if (sent.size() < STREAM_SAMPLES && millis() >= next) {
+			next+= 7;
+			pending.push_back(sample(sent.size() % 5, millis(), 1 + sent.size() * 7 % 31));
+			sent.push_back(pending.back());
+		}
+
+		if (waiting) {
+			if (harness.can.getResponse().isAvailable() && harness.can.getResponse().getApiId() == ZB_TX_STATUS_RESPONSE) {
+				waiting = false;
+			} else if (millis() >= deadline) {
+				waiting = false;
+			}
+		} else {
+			uint32_t before = harness.packetizer.getFrameCount();
+
+			while (!pending.empty() && harness.packetizer.getFrameCount() == before) {
+				add(harness, pending.front());
+				pending.pop_front();
+			}
+
+			if (harness.packetizer.getFrameCount() == before) {
+				if (sent.size() < STREAM_SAMPLES) {
+					harness.packetizer.poll();
+				} else {
+					harness.packetizer.flush();
+				}
+			}
+
+			if (harness.packetizer.getFrameCount() != before) {
+				waiting = true;
+				deadline = millis() + STATUS_TIMEOUT;
+				frames++;
+			}
+		}
+
+		harness.loop();
+	}
+
+	harness.run(1000);
+
+	std::vector<Sample> received = harness.unpacked();
+
+	bool ok = check("stream: every sample arrives with its source, timestamp and data", received == sent);
+	ok&= check("stream: sent sample and frame counts add up", harness.packetizer.getSentSampleCount() == sent.size() &&
+			harness.packetizer.getFrameCount() == frames && harness.payloads.size() == frames);
+
+	bool batched = true;
+
+	for (size_t i = 0; i < harness.payloads.size(); i++) {
+		batched&= harness.payloads[i].size() <= TELEMETRY_PAYLOAD;
+	}
+
+	ok&= check("stream: every batch fits the packetizer's buffer", batched && frames < sent.size() / 2);
+
+	return ok;
+}
+
+static bool deadline() {
+	Harness harness;
+	unsigned long start = millis();
+
+	add(harness, sample(1, start, 8));
+	harness.run(MAX_DELAY / 2);
+	add(harness, sample(2, millis(), 8));
+	harness.packetizer.poll();
+	bool held = harness.packetizer.getFrameCount() == 0 && harness.packetizer.getSampleCount() == 2;
+
+	while (millis() - start < MAX_DELAY) {
+		harness.packetizer.poll();
+		held&= harness.packetizer.getFrameCount() == 0;
+		harness.loop();
+	}
+
+	harness.packetizer.poll();
+	harness.run(200);
+
+	bool ok = check("poll: holds a batch younger than maxDelay", held);
+	ok&= check("poll: sends it once its first sample is maxDelay old", harness.packetizer.getFrameCount() == 1 &&
+			harness.payloads.size() == 1 && harness.unpacked().size() == 2);
+
+	return ok;
+}
+
+static bool offsets() {
+	Harness harness;
+	std::vector<Sample> sent;
+
+	sent.push_back(sample(1, 1000, 4));
+	sent.push_back(sample(1, 1000 + 0xffff, 4));
+	sent.push_back(sample(1, 1000 + 0x10000, 4));
+	sent.push_back(sample(1, 1000 + 0x10000, 4));
+
+	for (size_t i = 0; i < sent.size(); i++) {
+		add(harness, sent[i]);
+	}
+
+	bool split = harness.packetizer.getFrameCount() == 1 && harness.packetizer.getSampleCount() == 2;
+
+	harness.packetizer.flush();
+	harness.run(200);
+
+	bool ok = check("offsets: 0xffff ms still fits a batch, 0x10000 starts the next", split);
+	ok&= check("offsets: timestamps arrive exact either side of the split", harness.unpacked() == sent);
+
+	return ok;
+}
+
+static bool sizes() {
+	Harness harness;
+
+	// batch header 5 bytes, record header 4
+	Sample tooLarge = sample(3, millis(), TELEMETRY_PAYLOAD - 5 - 4 + 1);
+	Sample fits = sample(4, millis(), TELEMETRY_PAYLOAD - 5 - 4);
+	Sample small = sample(5, millis(), 2);
+
+	add(harness, small);
+	bool refused = !add(harness, tooLarge) && harness.packetizer.getSampleCount() == 1 &&
+			harness.packetizer.getFrameCount() == 0;
+	bool alone = add(harness, fits) && harness.packetizer.getFrameCount() == 2 &&
+			harness.packetizer.getSampleCount() == 0;
+
+	harness.run(300);
+
+	std::vector<Sample> received = harness.unpacked();
+
+	bool ok = check("sizes: refuses a sample too large for an empty batch", refused);
+	ok&= check("sizes: a sample that fills a batch goes out on its own", alone && harness.payloads.size() == 2 &&
+			received.size() == 2 && received[0] == small && received[1] == fits);
+
+	return ok;
+}
+
+static bool unpacker() {
+	Harness harness;
+	std::vector<Sample> sent;
+
+	for (uint8_t i = 0; i < 3; i++) {
+		sent.push_back(sample(i, 5000 + i, 10));
+		add(harness, sent.back());
+	}
+
+	harness.packetizer.flush();
+	harness.run(200);
+
+	bool ok = check("unpacker: a whole batch", harness.payloads.size() == 1 && harness.unpacked() == sent);
+
+	std::vector<uint8_t> batch = harness.payloads.empty() ? std::vector<uint8_t>() : harness.payloads[0];
+	uint8_t frame[] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06 };
+	TelemetryUnpacker other = TelemetryUnpacker(frame, sizeof(frame));
+
+	ok&= check("unpacker: refuses a payload that is not a batch", !other.isBatch() && !other.next());
+
+	// cut the last record short: its header and half its data
+	size_t records = 0;
+	TelemetryUnpacker truncated = TelemetryUnpacker(&batch[0], batch.size() - 5);
+
+	while (truncated.next()) {
+		records++;
+	}
+
+	ok&= check("unpacker: stops at a truncated record", truncated.isBatch() && records == 2);
+
+	TelemetryUnpacker header = TelemetryUnpacker(&batch[0], 5);
+	TelemetryUnpacker tooShort = TelemetryUnpacker(&batch[0], 4);
+
+	ok&= check("unpacker: a batch with no records, and one cut inside its header",
+			header.isBatch() && !header.next() && !tooShort.isBatch() && !tooShort.next());
+
+	return ok;
+}
+
+// record n: slow channels, noisy ones, ones that jump by any amount, and int32 extremes
+static void record(uint32_t n, int32_t *values) {
+	values[0] = n;
+	values[1] = 520000000 + n * 3;
+	values[2] = n / 50;
+	values[3] = int32_t(random32() % 64) - 32;
+	values[4] = n % 7 == 0 ? int32_t(random32()) : 0;
+	values[5] = int32_t(random32() >> (random32() % 32));
+	values[6] = n % 2 ? INT32_MIN : INT32_MAX;
+	values[7] = -int32_t(n * n);
+	values[8] = 0;
+	values[9] = n % 100 < 50 ? 1 : -1;
+}
+
+/**
+ * Encodes RECORDS records into TELEMETRY_PAYLOAD byte payloads, and returns them
+ */
+static std::vector<std::vector<uint8_t> > encode(std::vector<std::vector<int32_t> > &records) {
+	std::vector<std::vector<uint8_t> > payloads;
+	int32_t previous[CHANNELS];
+	uint8_t buffer[TELEMETRY_PAYLOAD];
+	TelemetryEncoder encoder = TelemetryEncoder(previous, CHANNELS);
+
+	lcg = 12345;
+	encoder.begin(buffer, sizeof(buffer));
+
+	for (uint32_t n = 0; n < RECORDS; n++) {
+		std::vector<int32_t> values(CHANNELS);
+		record(n, &values[0]);
+		records.push_back(values);
+
+		if (!encoder.add(&values[0])) {
+			payloads.push_back(std::vector<uint8_t>(buffer, buffer + encoder.getLength()));
+			encoder.begin(buffer, sizeof(buffer));
+			encoder.add(&values[0]);
+		}
+	}
+
+	payloads.push_back(std::vector<uint8_t>(buffer, buffer + encoder.getLength()));
+
+	return payloads;
+}
+
+/**
+ * Decodes payloads, returning records by number (channel 0); records not decoded are left empty.  Returns
+ * false if any payload doesn't decode to the end
+ */
+static bool decode(const std::vector<std::vector<uint8_t> > &payloads, std::vector<std::vector<int32_t> > &records) {
+	bool whole = true;
+
+	records.assign(RECORDS, std::vector<int32_t>());
+
+	for (size_t i = 0; i < payloads.size(); i++) {
+		int32_t values[CHANNELS];
+		TelemetryDecoder decoder = TelemetryDecoder(&payloads[i][0], payloads[i].size(), values, CHANNELS);
+		size_t decoded = 0;
+
+		while (decoder.next()) {
+			decoded++;
+
+			if (uint32_t(values[0]) < RECORDS) {
+				records[values[0]].assign(values, values + CHANNELS);
+			}
+		}
+
+		whole&= decoder.isValid() && decoded > 0;
+	}
+
+	return whole;
+}
+
+static bool roundTrip() {
+	std::vector<std::vector<int32_t> > records, decoded;
+	std::vector<std::vector<uint8_t> > payloads = encode(records);
+
+	bool ok = check("codec: every record decodes to the values encoded", decode(payloads, decoded) && decoded == records);
+
+	size_t dropped = payloads.size() / 2;
+	std::vector<std::vector<uint8_t> > lossy = payloads;
+	lossy.erase(lossy.begin() + dropped);
+	decode(lossy, decoded);
+
+	size_t missing = 0;
+	bool others = true;
+
+	for (uint32_t n = 0; n < RECORDS; n++) {
+		if (decoded[n].empty()) {
+			missing++;
+		} else {
+			others&= decoded[n] == records[n];
+		}
+	}
+
+	int32_t values[CHANNELS];
+	TelemetryDecoder lost = TelemetryDecoder(&payloads[dropped][0], payloads[dropped].size(), values, CHANNELS);
+	size_t inLost = 0;
+
+	while (lost.next()) {
+		inLost++;
+	}
+
+	ok&= check("codec: a dropped payload loses only its own records", others && missing == inLost);
+
+	return ok;
+}
+
+static bool lossyLink() {
+	LinkSettings settings;
+	settings.lossRate = 0.2f;
+	settings.macRetries = 0;
+	settings.seed = 7;
+
+	Harness harness = Harness(settings);
+
+	std::vector<std::vector<int32_t> > records, decoded;
+	std::vector<std::vector<uint8_t> > payloads = encode(records);
+
+	// one frame at a time, waiting for each TX status
+	for (size_t i = 0; i < payloads.size(); i++) {
+		memcpy(harness.payload, &payloads[i][0], payloads[i].size());
+		harness.zbTx.setPayload(harness.payload);
+		harness.zbTx.setPayloadLength(payloads[i].size());
+		harness.can.send(harness.zbTx);
+
+		unsigned long deadline = millis() + STATUS_TIMEOUT;
+
+		do {
+			harness.loop();
+		} while (millis() < deadline && !(harness.can.getResponse().isAvailable() &&
+				harness.can.getResponse().getApiId() == ZB_TX_STATUS_RESPONSE));
+	}
+
+	harness.run(200);
+
+	bool whole = decode(harness.payloads, decoded);
+	size_t intact = 0, wrong = 0;
+
+	for (uint32_t n = 0; n < RECORDS; n++) {
+		if (!decoded[n].empty()) {
+			intact+= decoded[n] == records[n];
+			wrong+= decoded[n] != records[n];
+		}
+	}
+
+	LinkStats stats = harness.link.getStats(0);
+
+	printf("  %u payloads, %u lost on air, %u of %u records decoded\n", (unsigned) payloads.size(),
+			stats.rfLost, (unsigned) intact, RECORDS);
+
+	return check("codec: over a lossy link, the decoder resyncs at the next payload",
+			whole && wrong == 0 && stats.rfLost > 0 && harness.payloads.size() == payloads.size() - stats.rfLost &&
+			intact > 0 && intact < RECORDS);
+}
+
+static bool bounds() {
+	// 32 channels: 4 mask bytes a record, all a record needs when nothing changes
+	int32_t previous[32];
+	int32_t values[32] = { 0 };
+	int32_t decodedValues[32];
+	uint8_t buffer[255 + 16];
+	TelemetryEncoder encoder = TelemetryEncoder(previous, 32);
+
+	memset(buffer, 0xa5, sizeof(buffer));
+	encoder.begin(buffer, 255);
+
+	uint16_t added = 0;
+
+	while (encoder.add(values) && added < 1000) {
+		added++;
+	}
+
+	bool clean = true;
+
+	for (size_t i = 255; i < sizeof(buffer); i++) {
+		clean&= buffer[i] == 0xa5;
+	}
+
+	TelemetryDecoder decoder = TelemetryDecoder(buffer, encoder.getLength(), decodedValues, 32);
+	uint16_t decoded = 0;
+
+	while (decoder.next()) {
+		decoded++;
+	}
+
+	bool ok = check("codec: a full 255 byte buffer, and not a byte past it", clean &&
+			added == (255 - TELEMETRY_DELTA_HEADER_LENGTH) / 4 && encoder.getRecordCount() == added && decoded == added);
+
+	// 4 mask bytes and 32 5 byte varints don't fit in 150
+	for (uint8_t i = 0; i < 32; i++) {
+		values[i] = INT32_MIN;
+	}
+
+	TelemetryEncoder big = TelemetryEncoder(previous, 32);
+	big.begin(buffer, 150);
+
+	ok&= check("codec: a record that doesn't fit leaves the payload as it was",
+			!big.add(values) && big.getLength() == TELEMETRY_DELTA_HEADER_LENGTH && big.getRecordCount() == 0);
+
+	std::vector<std::vector<int32_t> > records;
+	std::vector<std::vector<uint8_t> > payloads = encode(records);
+	int32_t few[CHANNELS - 1];
+	TelemetryDecoder wrongChannels = TelemetryDecoder(&payloads[0][0], payloads[0].size(), few, CHANNELS - 1);
+	int32_t all[CHANNELS];
+	TelemetryDecoder truncated = TelemetryDecoder(&payloads[0][0], payloads[0].size() - 1, all, CHANNELS);
+	size_t complete = 0;
+
+	while (truncated.next()) {
+		complete++;
+	}
+
+	TelemetryDecoder whole = TelemetryDecoder(&payloads[0][0], payloads[0].size(), all, CHANNELS);
+	size_t records0 = 0;
+
+	while (whole.next()) {
+		records0++;
+	}
+
+	ok&= check("codec: decoder refuses other channel counts and truncated records",
+			!wrongChannels.isValid() && !wrongChannels.next() && complete == records0 - 1);
+
+	return ok;
+}
+
+int main() {
+	bool ok = stream();
+	ok&= deadline();
+	ok&= offsets();
+	ok&= sizes();
+	ok&= unpacker();
+	ok&= roundTrip();
+	ok&= lossyLink();
+	ok&= bounds();
+
+	printf("\n%s\n", ok ? "all passed" : "FAILED");
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,362 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Runs the bundled examples' traffic over a SimulatedLink and reports what gets through:
+ * Series1_Tx -> Series1_Rx (TX16 and TX64) and Series2_Tx -> Series2_Rx, each one frame at a time
+ * waiting for its TX status like the examples, plus Series 2 with a TxWindow of TX_WINDOW_SIZE frames.
+ * The examples' delay() and LED flashing are left out, so frames go back to back.
+ * <p/>
+ * Per flow and link: frames/s received, one way latency percentiles (send() to the RX packet at the
+ * receiving sketch) and where frames were lost: radio TX queue full, lost on air, receiving Arduino's
+ * RX buffer overflowed, corrupted on a serial line (and the XBee read errors that caused), and TX
+ * status timeouts.
+ * <p/>
+ * Then it times readPacket() alone on a capture of escaped ZB RX frames in memory, with the serial port
+ * reporting 1, 8, READ_BLOCK_SIZE or all bytes available at a time.  With 1 byte available readPacket()
+ * can't read ahead and steps the parser byte by byte, like it did before the read-ahead buffer; the larger
+ * sizes show what copying and checksumming runs of frame data out of the read-ahead buffer gains.
+ * <p/>
+ * Build from the library directory:
+ * <p/>
+ * g++ -O2 -std=c++11 -DARDUINO=100 -Iextras/host -I. extras/host/xbee_benchmark.cpp extras/host/SimulatedLink.cpp extras/host/PosixSerial.cpp XBee.cpp -o xbee_benchmark
+ */
+
+#include "SimulatedLink.h"
+#include "XBee.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+
+// simulated seconds per run, and how often each sketch's loop() runs
+#define RUN_SECONDS 20
+#define STEP_MICROS 50
+
+// frames in the decode capture, and how many times it is decoded per chunk size
+#define DECODE_FRAMES 20000
+#define DECODE_PASSES 20
+
+enum FlowType { SERIES1_TX16, SERIES1_TX64, SERIES2_ZB, SERIES2_ZB_WINDOW };
+
+struct Flow {
+	const char* name;
+	FlowType type;
+	// how long the example waits for a TX status
+	uint16_t statusTimeout;
+};
+
+struct Scenario {
+	const char* name;
+	long baud;
+	float lossRate;
+	uint8_t macRetries;
+	float corruptRate;
+	// time the receiving sketch spends on other work each loop()
+	uint32_t receiverBusy;
+};
+
+static const Flow flows[] = {
+	{ "Series1 TX16 -> RX16", SERIES1_TX16, 5000 },
+	{ "Series1 TX64 -> RX64", SERIES1_TX64, 5000 },
+	{ "Series2 ZB TX -> RX", SERIES2_ZB, 500 },
+	{ "Series2 ZB TxWindow", SERIES2_ZB_WINDOW, 500 }
+};
+
+static const Scenario scenarios[] = {
+	{ "9600 baud", 9600, 0, 0, 0, 0 },
+	{ "57600 baud", 57600, 0, 0, 0, 0 },
+	{ "57600, 10% RF loss", 57600, 0.1f, 0, 0, 0 },
+	{ "57600, 10% loss, 3 retries", 57600, 0.1f, 3, 0, 0 },
+	{ "57600, 1e-3 serial errors", 57600, 0, 0, 0.001f, 0 },
+	{ "57600, receiver busy 20ms", 57600, 0, 0, 0, 20000 }
+};
+
+// send time of each sequence number (the 2 byte payload), in microseconds
+static uint64_t sentAt[65536];
+static std::vector<uint32_t> latencies;
+
+static uint32_t percentile(uint8_t p) {
+	if (latencies.empty()) {
+		return 0;
+	}
+
+	return latencies[(latencies.size() - 1) * p / 100];
+}
+
+static void received(const uint8_t *data, uint8_t length) {
+	if (length >= 2) {
+		uint16_t seq = (data[0] << 8) + data[1];
+		latencies.push_back(SimulatedLink::now() - sentAt[seq]);
+	}
+}
+
+static void run(const Flow &flow, const Scenario &scenario) {
+	LinkSettings settings;
+	settings.baud = scenario.baud;
+	settings.lossRate = scenario.lossRate;
+	settings.macRetries = scenario.macRetries;
+	settings.corruptRate = scenario.corruptRate;
+
+	SimulatedLink link = SimulatedLink(settings);
+
+	XBee sender = XBee();
+	XBee receiver = XBee();
+	sender.setSerial(link.getSerial(0));
+	receiver.setSerial(link.getSerial(1));
+
+	uint8_t payload[] = { 0, 0 };
+	Tx16Request tx16 = Tx16Request(2, payload, sizeof(payload));
+	// SH + SL of the receiving radio
+	XBeeAddress64 addr64 = XBeeAddress64(0x0013a200, 0x40000001);
+	Tx64Request tx64 = Tx64Request(addr64, payload, sizeof(payload));
+	ZBTxRequest zbTx = ZBTxRequest(addr64, payload, sizeof(payload));
+	TxWindow window = TxWindow(sender, flow.statusTimeout);
+
+	Rx16Response rx16 = Rx16Response();
+	Rx64Response rx64 = Rx64Response();
+	ZBRxResponse rx = ZBRxResponse();
+
+	uint16_t seq = 0;
+	bool waiting = false;
+	unsigned long deadline = 0;
+	uint32_t statusTimeouts = 0;
+	uint32_t readErrors = 0;
+	uint64_t receiverNext = 0;
+
+	latencies.clear();
+
+	uint64_t start = SimulatedLink::now();
+	uint64_t end = start + RUN_SECONDS * 1000000ULL;
+
+	while (SimulatedLink::now() < end) {
+		// sending sketch
+		if (flow.type == SERIES2_ZB_WINDOW) {
+			sender.readPacket();
+
+			if (sender.getResponse().isAvailable()) {
+				window.handleResponse(sender.getResponse());
+			}
+
+			window.poll();
+
+			if (!window.isFull()) {
+				payload[0] = seq >> 8;
+				payload[1] = seq & 0xff;
+				sentAt[seq++] = SimulatedLink::now();
+				window.send(zbTx);
+			}
+		} else {
+			if (!waiting) {
+				payload[0] = seq >> 8;
+				payload[1] = seq & 0xff;
+				sentAt[seq++] = SimulatedLink::now();
+
+				if (flow.type == SERIES1_TX16) {
+					sender.send(tx16);
+				} else if (flow.type == SERIES1_TX64) {
+					sender.send(tx64);
+				} else {
+					sender.send(zbTx);
+				}
+
+				waiting = true;
+				deadline = millis() + flow.statusTimeout;
+			}
+
+			// readPacket(timeout) would spin forever on simulated time, so poll like readPacket(timeout) does
+			sender.readPacket();
+
+			if (sender.getResponse().isAvailable()) {
+				uint8_t apiId = sender.getResponse().getApiId();
+
+				if (apiId == TX_STATUS_RESPONSE || apiId == ZB_TX_STATUS_RESPONSE) {
+					waiting = false;
+				}
+			} else if (millis() >= deadline) {
+				statusTimeouts++;
+				waiting = false;
+			}
+		}
+
+		// receiving sketch
+		if (SimulatedLink::now() >= receiverNext) {
+			receiverNext = SimulatedLink::now() + scenario.receiverBusy;
+			receiver.readPacket();
+
+			if (receiver.getResponse().isAvailable()) {
+				uint8_t apiId = receiver.getResponse().getApiId();
+
+				if (apiId == RX_16_RESPONSE) {
+					receiver.getResponse().getRx16Response(rx16);
+					received(rx16.getData(), rx16.getDataLength());
+				} else if (apiId == RX_64_RESPONSE) {
+					receiver.getResponse().getRx64Response(rx64);
+					received(rx64.getData(), rx64.getDataLength());
+				} else if (apiId == ZB_RX_RESPONSE) {
+					receiver.getResponse().getZBRxResponse(rx);
+					received(rx.getData(), rx.getDataLength());
+				}
+			} else if (receiver.getResponse().isError()) {
+				readErrors++;
+			}
+		}
+
+		link.run(STEP_MICROS);
+	}
+
+	statusTimeouts+= flow.type == SERIES2_ZB_WINDOW ? window.getTimeoutCount() : 0;
+	std::sort(latencies.begin(), latencies.end());
+
+	LinkStats& tx = link.getStats(0);
+	LinkStats& rxStats = link.getStats(1);
+
+	printf("%-22s %-28s %7.1f %6.1f %6.1f %6.1f %6u %6u %6u %6u %6u %6u\n", flow.name, scenario.name,
+			latencies.size() / float(RUN_SECONDS),
+			percentile(50) / 1000.0f, percentile(90) / 1000.0f, percentile(99) / 1000.0f,
+			tx.radioQueueFull, tx.rfLost, rxStats.rxOverflow, rxStats.corrupted + tx.corrupted, readErrors, statusTimeouts);
+}
+
+/**
+ * A capture in memory, as a Stream that reports at most chunk bytes available at a time, like a serial port
+ * polled while data is still arriving
+ */
+class ChunkStream : public Stream {
+public:
+	ChunkStream(const std::vector<uint8_t> &bytes, size_t chunk) : _bytes(&bytes), _chunk(chunk), _pos(0) {}
+	int available() { return std::min(_bytes->size() - _pos, _chunk); }
+	int read() { return _pos < _bytes->size() ? (*_bytes)[_pos++] : -1; }
+	int peek() { return _pos < _bytes->size() ? (*_bytes)[_pos] : -1; }
+	size_t write(uint8_t) { return 0; }
+	bool done() { return _pos == _bytes->size(); }
+	void rewind() { _pos = 0; }
+private:
+	const std::vector<uint8_t>* _bytes;
+	size_t _chunk;
+	size_t _pos;
+};
+
+static void appendEscaped(std::vector<uint8_t> &out, uint8_t b) {
+	if (b == START_BYTE || b == ESCAPE || b == XON || b == XOFF) {
+		out.push_back(ESCAPE);
+		out.push_back(b ^ 0x20);
+	} else {
+		out.push_back(b);
+	}
+}
+
+// ZB RX packets with 2 to 72 bytes of random payload, in AP=2 (escaped) framing
+static std::vector<uint8_t> decodeCapture() {
+	std::vector<uint8_t> out;
+	srand(1);
+
+	for (uint32_t i = 0; i < DECODE_FRAMES; i++) {
+		uint8_t frame[1 + 11 + 72];
+		uint8_t length = 0;
+
+		frame[length++] = ZB_RX_RESPONSE;
+
+		// 64-bit source address, 16-bit source address, options
+		for (uint8_t j = 0; j < 11; j++) {
+			frame[length++] = j < 8 ? 0x40 + j : i >> (j * 2);
+		}
+
+		for (uint8_t j = 2 + rand() % 71; j > 0; j--) {
+			frame[length++] = rand();
+		}
+
+		uint8_t checksum = 0;
+
+		out.push_back(START_BYTE);
+		appendEscaped(out, 0);
+		appendEscaped(out, length);
+
+		for (uint8_t j = 0; j < length; j++) {
+			appendEscaped(out, frame[j]);
+			checksum+= frame[j];
+		}
+
+		appendEscaped(out, 0xff - checksum);
+	}
+
+	return out;
+}
+
+// returns frames/s
+static double decode(const std::vector<uint8_t> &bytes, size_t chunk, const char *name, double baseline) {
+	ChunkStream stream = ChunkStream(bytes, chunk);
+	XBee xbee = XBee();
+	uint32_t frames = 0;
+	uint32_t errors = 0;
+
+	xbee.setSerial(stream);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (uint8_t pass = 0; pass < DECODE_PASSES; pass++) {
+		stream.rewind();
+
+		while (!stream.done()) {
+			xbee.readPacket();
+
+			if (xbee.getResponse().isAvailable()) {
+				frames++;
+			} else if (xbee.getResponse().isError()) {
+				errors++;
+			}
+		}
+	}
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	double rate = frames / elapsed;
+
+	printf("%-22s %10.0f %9.0f %6.2fx %6u %6u\n", name, rate, bytes.size() * DECODE_PASSES / elapsed / 1e6,
+			baseline > 0 ? rate / baseline : 1.0, frames, errors);
+
+	if (frames != DECODE_FRAMES * DECODE_PASSES) {
+		printf("decoded %u frames, expected %u\n", frames, DECODE_FRAMES * DECODE_PASSES);
+	}
+
+	return rate;
+}
+
+int main() {
+	printf("%-22s %-28s %7s %6s %6s %6s %6s %6s %6s %6s %6s %6s\n", "flow", "link", "frame/s", "p50ms", "p90ms", "p99ms",
+			"qfull", "rflost", "rxovfl", "corupt", "rderr", "tmout");
+
+	for (size_t s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++) {
+		for (size_t f = 0; f < sizeof(flows) / sizeof(flows[0]); f++) {
+			run(flows[f], scenarios[s]);
+		}
+	}
+
+	std::vector<uint8_t> capture = decodeCapture();
+	char name[32];
+
+	printf("\n%u ZB RX frames, %lu bytes\n", DECODE_FRAMES, (unsigned long) capture.size());
+	printf("%-22s %10s %9s %7s %6s %6s\n", "bytes available", "frames/s", "MB/s", "gain", "frames", "errors");
+
+	double baseline = decode(capture, 1, "1 (byte by byte)", 0);
+
+	decode(capture, 8, "8", baseline);
+	sprintf(name, "%u (READ_BLOCK_SIZE)", READ_BLOCK_SIZE);
+	decode(capture, READ_BLOCK_SIZE, name, baseline);
+	decode(capture, capture.size(), "all", baseline);
+
+	return 0;
+}
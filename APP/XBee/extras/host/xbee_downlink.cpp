@@ -0,0 +1,114 @@
+/**
+ * This file is part of XBee-Arduino.
+ *
+ * XBee-Arduino is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XBee-Arduino is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XBee-Arduino.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Ground station side of FileDownlink: pulls a file from the aircraft through a local XBee (API mode 2)
+ * and saves it.  If the output file already exists the download resumes at its end.
+ * <p/>
+ * Build from the library directory:
+ * <p/>
+ * g++ -O2 -DARDUINO=100 -Iextras/host -I. extras/host/xbee_downlink.cpp extras/host/PosixSerial.cpp extras/host/HostClock.cpp XBee.cpp XBeeFileTransfer.cpp -o xbee_downlink
+ * <p/>
+ * ./xbee_downlink /dev/ttyUSB0 57600 0013a200 403e0f30 flight.log
+ */
+
+#include "HardwareSerial.h"
+#include "XBee.h"
+#include "XBeeFileTransfer.h"
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static int out = -1;
+
+static void writeBlock(uint32_t offset, const uint8_t *data, uint8_t length) {
+	if (pwrite(out, data, length, offset) != length) {
+		perror("write");
+		exit(1);
+	}
+}
+
+int main(int argc, char **argv) {
+	if (argc != 6) {
+		fprintf(stderr, "usage: %s device baud sh sl output\n", argv[0]);
+		return 2;
+	}
+
+	if (!Serial.begin(argv[1], atol(argv[2]))) {
+		fprintf(stderr, "can't open %s at %s baud\n", argv[1], argv[2]);
+		return 1;
+	}
+
+	out = open(argv[5], O_WRONLY | O_CREAT, 0644);
+
+	if (out < 0) {
+		perror(argv[5]);
+		return 1;
+	}
+
+	// resume after what was saved last time
+	struct stat st;
+	fstat(out, &st);
+	uint32_t start = st.st_size;
+
+	XBee xbee = XBee();
+	xbee.begin(Serial);
+
+	XBeeAddress64 addr64 = XBeeAddress64(strtoul(argv[3], NULL, 16), strtoul(argv[4], NULL, 16));
+	uint8_t buffer[FILE_DOWNLINK_ACK_LENGTH];
+	ZBTxRequest zbTx = ZBTxRequest(addr64, buffer, 0);
+	ZBRxResponse rx = ZBRxResponse();
+
+	// a delayed ACK after 50ms; out of order blocks are acknowledged at once
+	FileDownlinkReceiver receiver = FileDownlinkReceiver(xbee, zbTx, buffer, writeBlock, 50);
+	receiver.begin(start);
+
+	unsigned long started = millis();
+	unsigned long lastReport = started;
+
+	while (!receiver.isComplete()) {
+		xbee.readPacket();
+
+		if (xbee.getResponse().isAvailable()) {
+			if (xbee.getResponse().getApiId() == ZB_RX_RESPONSE) {
+				xbee.getResponse().getZBRxResponse(rx);
+				receiver.handlePayload(rx.getData(), rx.getDataLength());
+			}
+		} else if (!Serial.available()) {
+			usleep(500);
+		}
+
+		receiver.poll();
+
+		if (millis() - lastReport >= 1000) {
+			lastReport = millis();
+			fprintf(stderr, "\r%lu / %lu bytes, %lu B/s   ", (unsigned long) receiver.getOffset(), (unsigned long) receiver.getFileSize(),
+					(unsigned long) ((receiver.getOffset() - start) * 1000 / (lastReport - started)));
+		}
+	}
+
+	// the file may have shrunk since a previous, longer download
+	ftruncate(out, receiver.getFileSize());
+	close(out);
+
+	unsigned long elapsed = millis() - started;
+	fprintf(stderr, "\r%lu bytes in %lu.%03lu s\n", (unsigned long) (receiver.getFileSize() - start), elapsed / 1000, elapsed % 1000);
+
+	return 0;
+}